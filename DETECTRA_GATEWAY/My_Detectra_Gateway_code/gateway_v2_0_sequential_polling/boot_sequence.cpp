@@ -0,0 +1,92 @@
+/**
+ * DETECTRA Gateway v2.0 - Boot Sequence Implementation
+ */
+
+#include "boot_sequence.h"
+#include "log.h"
+
+struct BootStep {
+  BootPhase phase;
+  void (*init)();
+  EventBits_t dependsOn;
+};
+
+static EventGroupHandle_t bootEvents = NULL;
+static BootPhaseTiming timings[BOOT_PHASE_COUNT];
+static BootStep steps[BOOT_PHASE_COUNT];
+
+void bootInit() {
+  bootEvents = xEventGroupCreate();
+}
+
+void bootPhaseBegin(BootPhase phase) {
+  if (timings[phase].startMs == 0) timings[phase].startMs = millis();
+}
+
+void bootPhaseDone(BootPhase phase) {
+  if (bootIsDone(phase)) return;
+
+  timings[phase].endMs = millis();
+  xEventGroupSetBits(bootEvents, BOOT_BIT(phase));
+
+  LOG_I("BOOT", "%s ready in %lu ms (at %lu ms)", bootPhaseName(phase),
+        (unsigned long)(timings[phase].endMs - timings[phase].startMs), (unsigned long)timings[phase].endMs);
+}
+
+void bootRun(BootPhase phase, void (*init)()) {
+  bootPhaseBegin(phase);
+  init();
+  bootPhaseDone(phase);
+}
+
+static void bootStepTask(void* parameter) {
+  BootStep* step = (BootStep*)parameter;
+
+  if (step->dependsOn != 0) bootWaitFor(step->dependsOn);
+  bootRun(step->phase, step->init);
+
+  vTaskDelete(NULL);
+}
+
+void bootStart(BootPhase phase, void (*init)(), EventBits_t dependsOn, uint32_t stackSize, BaseType_t core) {
+  BootStep& step = steps[phase];
+  step.phase = phase;
+  step.init = init;
+  step.dependsOn = dependsOn;
+
+  xTaskCreatePinnedToCore(
+    bootStepTask,
+    bootPhaseName(phase),
+    stackSize,
+    &step,
+    1,          // Low priority - bring-up only
+    NULL,
+    core
+  );
+}
+
+bool bootWaitFor(EventBits_t bits, TickType_t timeout) {
+  EventBits_t set = xEventGroupWaitBits(bootEvents, bits, pdFALSE, pdTRUE, timeout);
+  return (set & bits) == bits;
+}
+
+bool bootIsDone(BootPhase phase) {
+  return bootEvents != NULL && (xEventGroupGetBits(bootEvents) & BOOT_BIT(phase)) != 0;
+}
+
+BootPhaseTiming bootGetTiming(BootPhase phase) {
+  return timings[phase];
+}
+
+const char* bootPhaseName(BootPhase phase) {
+  switch (phase) {
+    case BOOT_HARDWARE:     return "hardware";
+    case BOOT_CONFIG:       return "config";
+    case BOOT_LORA:         return "lora";
+    case BOOT_WIFI:         return "wifi";
+    case BOOT_WEB:          return "web";
+    case BOOT_MQTT:         return "mqtt";
+    case BOOT_FIRST_POLL:   return "first_poll";
+    default:                return "unknown";
+  }
+}
@@ -0,0 +1,99 @@
+/**
+ * DETECTRA Gateway v2.0 - Boot Sequence
+ *
+ * Subsystems are brought up as independent phases with explicit
+ * dependencies instead of one long blocking chain in setup(). Each phase
+ * runs inline (bootRun) or in its own short-lived task (bootStart) that
+ * waits for the phases it depends on, then sets its done bit in a
+ * FreeRTOS event group.
+ *
+ * Start/end times (ms since power-on) are recorded for every phase so
+ * startup regressions show up in the status report and /api/boot.
+ *
+ * Dependency graph (see setup()):
+ *
+ *   HARDWARE ─┬─► CONFIG ──► LORA ──► loraTask / pollingTask ──► FIRST_POLL
+ *             └─► WIFI ──► WEB
+ *                      └─► MQTT (first broker connection, from loop)
+ */
+
+#ifndef BOOT_SEQUENCE_H
+#define BOOT_SEQUENCE_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+
+// ==================== PHASES ====================
+
+enum BootPhase : uint8_t {
+  BOOT_HARDWARE,          // LED, buzzer, OLED, TX locks
+  BOOT_CONFIG,            // Preferences, device registry, MQTT client setup
+  BOOT_LORA,              // RAK3172 configured, continuous RX enabled
+  BOOT_WIFI,              // Station connected (or attempt timed out)
+  BOOT_WEB,               // HTTP server listening
+  BOOT_MQTT,              // First broker connection
+  BOOT_FIRST_POLL,        // First polling cycle started
+  BOOT_PHASE_COUNT
+};
+
+#define BOOT_BIT(phase)   ((EventBits_t)1 << (phase))
+
+/**
+ * Phase timing (ms since power-on, 0 = not reached)
+ */
+struct BootPhaseTiming {
+  uint32_t startMs;
+  uint32_t endMs;
+};
+
+// ==================== BOOT FUNCTIONS ====================
+
+/**
+ * Create the phase event group (first call in setup)
+ */
+void bootInit();
+
+/**
+ * Run a phase inline in the calling task
+ */
+void bootRun(BootPhase phase, void (*init)());
+
+/**
+ * Run a phase in its own task once all dependsOn phases are done
+ *
+ * @param phase Phase to run
+ * @param init Initialization function
+ * @param dependsOn BOOT_BIT() mask of required phases (0 = none)
+ * @param stackSize Task stack in bytes
+ * @param core Core to pin the task to
+ */
+void bootStart(BootPhase phase, void (*init)(), EventBits_t dependsOn, uint32_t stackSize, BaseType_t core);
+
+/**
+ * Mark phase boundaries manually (phases not driven by one init function)
+ * A phase marked done without a begin is measured from power-on.
+ * Marking a phase done twice has no effect.
+ */
+void bootPhaseBegin(BootPhase phase);
+void bootPhaseDone(BootPhase phase);
+
+/**
+ * Block until all phases in bits are done
+ *
+ * @return false on timeout
+ */
+bool bootWaitFor(EventBits_t bits, TickType_t timeout = portMAX_DELAY);
+
+/**
+ * Check a phase without blocking
+ */
+bool bootIsDone(BootPhase phase);
+
+/**
+ * Phase timing / name for reports
+ */
+BootPhaseTiming bootGetTiming(BootPhase phase);
+const char* bootPhaseName(BootPhase phase);
+
+#endif // BOOT_SEQUENCE_H
@@ -0,0 +1,672 @@
+/**
+ * DETECTRA Gateway v2.0 - Bulk Transfer Implementation
+ */
+
+#include "bulk_transfer.h"
+#include "log.h"
+#include <esp_heap_caps.h>
+#include <mbedtls/sha256.h>
+
+#define BULK_FRAME_OVERHEAD   44            // "SENDER:CMD:TARGET:SEQ:TIME:" without the command
+#define BULK_BUDGET_PERIOD_MS 3600000UL     // Duty cycle is averaged over one hour
+#define BULK_BUCKET_MS        (BULK_BUDGET_PERIOD_MS / BULK_DUTY_BUCKETS)
+
+struct BulkTarget {
+  BulkTargetInfo info;
+  uint8_t* acked;                   // One bit per chunk
+  uint16_t base;                    // First chunk not acknowledged
+  bool needsQuery;                  // Chunks sent since its last bitmap
+  unsigned long resumeAtMs;
+};
+
+enum BulkFrameKind : uint8_t { BULK_FRAME_OFFER, BULK_FRAME_DATA, BULK_FRAME_QUERY, BULK_FRAME_ABORT };
+
+/**
+ * Next frame to send (chosen under the lock, committed once it fits)
+ */
+struct BulkFrame {
+  BulkFrameKind kind;
+  int target;                       // Index, -1 = BROADCAST_ID
+  int chunk;                        // BLK_DATA only
+  uint32_t needers;                 // BLK_DATA: targets missing the chunk
+  bool ackRequest;
+};
+
+static BulkSendFn sendFrame = NULL;
+static BulkAirtimeFn airtimeOf = NULL;
+static SemaphoreHandle_t bulkLock = NULL;
+
+// Blob, followed by one acked bitmap per target and the sent-once bitmap
+static uint8_t* blob = NULL;
+static size_t blobSize = 0;
+static uint8_t* sentOnce = NULL;
+static bool active = false;
+static bool abortPending = false;
+static uint16_t nextTransferId = 0;
+static uint8_t blobHash[BULK_HASH_BYTES];
+static BulkTarget targets[BULK_MAX_TARGETS];
+static unsigned long startedMs = 0;
+
+// Current window
+static uint16_t window[BULK_WINDOW];
+static uint8_t windowLength = 0;
+static uint8_t windowPos = 0;
+
+// Radio
+static int waitTarget = -1;         // Target whose BLK_STATUS is awaited
+static unsigned long waitDeadline = 0;
+static unsigned long busyUntil = 0;
+static uint16_t dutyPermille = BULK_DUTY_PERMILLE;
+
+// Gateway airtime per minute: the current bucket and the BULK_DUTY_BUCKETS before it, so
+// any hour that ends in the current minute lies inside the sum
+static uint32_t bulkBuckets[BULK_DUTY_BUCKETS + 1];   // Our frames
+static uint32_t otherBuckets[BULK_DUTY_BUCKETS + 1];  // bulkChargeAirtime() (polls, beacons, replies)
+static uint8_t dutyBucket = 0;
+static unsigned long dutyBucketAtMs = 0;
+static unsigned long dutyStartMs = 0;
+
+static BulkStats stats = {};
+
+// ==================== HELPERS ====================
+
+static size_t bitmapBytes(uint16_t chunks) {
+  return (chunks + 7) / 8;
+}
+
+static bool testBit(const uint8_t* map, uint16_t i) {
+  return map[i >> 3] & (1 << (i & 7));
+}
+
+static void setAcked(BulkTarget& t, uint16_t chunk, bool acked) {
+  if (chunk >= stats.chunks || testBit(t.acked, chunk) == acked) return;
+  t.acked[chunk >> 3] ^= 1 << (chunk & 7);
+  if (acked) t.info.received++; else t.info.received--;
+}
+
+static void resetTarget(BulkTarget& t) {
+  memset(t.acked, 0, bitmapBytes(stats.chunks));
+  t.info.received = 0;
+  t.base = 0;
+  t.needsQuery = false;
+}
+
+static void setState(BulkTarget& t, BulkTargetState state) {
+  if (t.info.state == BULK_TARGET_DONE) stats.done--;
+  if (t.info.state == BULK_TARGET_FAILED) stats.failed--;
+  t.info.state = state;
+  if (state == BULK_TARGET_DONE) stats.done++;
+  if (state == BULK_TARGET_FAILED) stats.failed++;
+}
+
+static int findTarget(const FixedString<NODE_ID_MAX>& deviceId) {
+  for (int i = 0; i < stats.numTargets; i++) {
+    if (targets[i].info.deviceId == deviceId) return i;
+  }
+  return -1;
+}
+
+static void advanceBuckets(unsigned long now) {
+  if ((long)(now - dutyBucketAtMs) < 0) return;  // Taken before another task moved on
+  if (now - dutyBucketAtMs >= BULK_BUDGET_PERIOD_MS + BULK_BUCKET_MS) {
+    memset(bulkBuckets, 0, sizeof(bulkBuckets));
+    memset(otherBuckets, 0, sizeof(otherBuckets));
+    dutyBucketAtMs = now;
+    return;
+  }
+  while (now - dutyBucketAtMs >= BULK_BUCKET_MS) {
+    dutyBucket = (dutyBucket + 1) % (BULK_DUTY_BUCKETS + 1);
+    bulkBuckets[dutyBucket] = 0;
+    otherBuckets[dutyBucket] = 0;
+    dutyBucketAtMs += BULK_BUCKET_MS;
+  }
+}
+
+static uint32_t sumBuckets(const uint32_t* buckets) {
+  uint32_t total = 0;
+  for (int i = 0; i <= BULK_DUTY_BUCKETS; i++) total += buckets[i];
+  return total;
+}
+
+static uint32_t hourAirtime(unsigned long now) {
+  advanceBuckets(now);
+  return sumBuckets(bulkBuckets) + sumBuckets(otherBuckets);
+}
+
+/**
+ * Airtime the other traffic will take in any hour ahead: as much as in the
+ * last hour. During the first hour after boot it is extrapolated, plus the
+ * busiest minute so far (cycles come in lumps, not evenly spread).
+ */
+static uint32_t otherHourAirtime(unsigned long now) {
+  advanceBuckets(now);
+  uint64_t other = sumBuckets(otherBuckets);
+  unsigned long uptime = now - dutyStartMs;
+  if (uptime < BULK_BUDGET_PERIOD_MS) {
+    uint32_t peak = 0;
+    for (int i = 0; i <= BULK_DUTY_BUCKETS; i++) {
+      if (otherBuckets[i] > peak) peak = otherBuckets[i];
+    }
+    other = other * BULK_BUDGET_PERIOD_MS / (uptime > BULK_BUCKET_MS ? uptime : BULK_BUCKET_MS) + peak;
+  }
+  return other < UINT32_MAX ? (uint32_t)other : UINT32_MAX;
+}
+
+static uint32_t budgetMs() {
+  return BULK_BUDGET_PERIOD_MS / 1000 * dutyPermille;
+}
+
+static void chargeAirtime(uint32_t* buckets, unsigned long airtimeMs, unsigned long now) {
+  advanceBuckets(now);
+  buckets[dutyBucket] += airtimeMs;
+}
+
+/**
+ * Room for a bulk frame: polls cannot wait, so bulk frames leave an hour of
+ * the other traffic free
+ */
+static bool budgetAllows(unsigned long airtimeMs, unsigned long now) {
+  advanceBuckets(now);
+  uint64_t needed = (uint64_t)sumBuckets(bulkBuckets) + otherHourAirtime(now) + airtimeMs;
+  return needed <= budgetMs();
+}
+
+/**
+ * A request to this target went unanswered
+ */
+static void missed(BulkTarget& t, unsigned long now) {
+  stats.timeouts++;
+  t.info.misses++;
+
+  if (t.info.misses < BULK_MAX_MISSES) {
+    if (t.info.state == BULK_TARGET_SENDING) t.needsQuery = true;
+    return;
+  }
+
+  if (t.info.resumes >= BULK_MAX_RESUMES) {
+    setState(t, BULK_TARGET_FAILED);
+    LOG_W("BULK", "%s: no reply after %u resumes - giving up", t.info.deviceId.c_str(), t.info.resumes);
+  } else {
+    setState(t, BULK_TARGET_PAUSED);
+    t.resumeAtMs = now + (BULK_RESUME_MS << (t.info.resumes < 5 ? t.info.resumes : 5));  // 1, 2, 4 ... 32 min
+    t.needsQuery = false;
+    LOG_W("BULK", "%s: no reply - paused at %u/%u chunks",
+          t.info.deviceId.c_str(), t.info.received, stats.chunks);
+  }
+}
+
+/**
+ * Plan the next window from the lowest chunk any target is missing
+ */
+static bool planWindow() {
+  uint16_t minBase = stats.chunks;
+  for (int i = 0; i < stats.numTargets; i++) {
+    if (targets[i].info.state == BULK_TARGET_SENDING && targets[i].base < minBase) minBase = targets[i].base;
+  }
+
+  // Every target can report chunks up to its base + BULK_ACK_SPAN
+  uint32_t limit = (uint32_t)minBase + BULK_ACK_SPAN;
+  if (limit > stats.chunks) limit = stats.chunks;
+
+  windowLength = 0;
+  windowPos = 0;
+  for (uint32_t c = minBase; c < limit && windowLength < BULK_WINDOW; c++) {
+    for (int i = 0; i < stats.numTargets; i++) {
+      if (targets[i].info.state == BULK_TARGET_SENDING && !testBit(targets[i].acked, c)) {
+        window[windowLength++] = c;
+        break;
+      }
+    }
+  }
+  return windowLength > 0;
+}
+
+static uint32_t chunkNeeders(uint16_t chunk) {
+  uint32_t mask = 0;
+  for (int i = 0; i < stats.numTargets; i++) {
+    if (targets[i].info.state == BULK_TARGET_SENDING && !testBit(targets[i].acked, chunk)) mask |= 1UL << i;
+  }
+  return mask;
+}
+
+/**
+ * Choose the next frame: window chunks, then bitmap queries, then offers,
+ * then the next window
+ */
+static bool nextFrame(BulkFrame& frame) {
+  memset(&frame, 0, sizeof(frame));
+  frame.target = -1;
+
+  for (int pass = 0; pass < 2; pass++) {
+    while (windowPos < windowLength) {
+      uint16_t chunk = window[windowPos];
+      uint32_t needers = chunkNeeders(chunk);
+      if (needers == 0) {
+        windowPos++;                // Acknowledged meanwhile
+        continue;
+      }
+
+      frame.kind = BULK_FRAME_DATA;
+      frame.chunk = chunk;
+      frame.needers = needers;
+      if ((needers & (needers - 1)) == 0) {
+        frame.target = __builtin_ctz(needers);
+        // Last chunk of the window for this target alone: it replies with its bitmap
+        frame.ackRequest = windowPos == windowLength - 1;
+      }
+      return true;
+    }
+
+    for (int i = 0; i < stats.numTargets; i++) {
+      if (targets[i].needsQuery) {
+        frame.kind = BULK_FRAME_QUERY;
+        frame.target = i;
+        return true;
+      }
+    }
+
+    for (int i = 0; i < stats.numTargets; i++) {
+      if (targets[i].info.state == BULK_TARGET_OFFER) {
+        frame.kind = BULK_FRAME_OFFER;
+        frame.target = i;
+        return true;
+      }
+    }
+
+    if (pass == 0 && !planWindow()) {
+      // Nothing missing, but no DONE yet (reply lost): ask again
+      for (int i = 0; i < stats.numTargets; i++) {
+        if (targets[i].info.state == BULK_TARGET_SENDING) targets[i].needsQuery = true;
+      }
+    }
+  }
+  return false;
+}
+
+static void finishTransfer(unsigned long now, const char* outcome) {
+  stats.elapsedMs = now - startedMs;
+  LOG_I("BULK", "Transfer %u %s: %u/%u done, %u failed, %lu frames, %lu retransmitted, %lus airtime, %lus",
+        stats.transferId, outcome, stats.done, stats.numTargets, stats.failed,
+        (unsigned long)stats.frames, (unsigned long)stats.retransmissions,
+        (unsigned long)stats.airtimeMs / 1000, stats.elapsedMs / 1000);
+
+  heap_caps_free(blob);
+  blob = NULL;
+  sentOnce = NULL;
+  blobSize = 0;
+  for (int i = 0; i < stats.numTargets; i++) targets[i].acked = NULL;
+
+  active = false;
+  abortPending = false;
+  waitTarget = -1;
+  windowLength = 0;
+  windowPos = 0;
+}
+
+// ==================== TRANSFER FUNCTIONS ====================
+
+void bulkInit(BulkSendFn send, BulkAirtimeFn airtime) {
+  sendFrame = send;
+  airtimeOf = airtime;
+  bulkLock = xSemaphoreCreateMutex();
+  nextTransferId = (uint16_t)(esp_random() % 9000) + 1;
+  dutyBucketAtMs = dutyStartMs = millis();
+}
+
+uint8_t* bulkReserve(size_t size) {
+  if (bulkLock == NULL || size == 0 || size > BULK_MAX_BYTES) return NULL;
+
+  xSemaphoreTake(bulkLock, portMAX_DELAY);
+
+  if (active) {
+    xSemaphoreGive(bulkLock);
+    return NULL;
+  }
+
+  heap_caps_free(blob);
+  size_t bytes = size + (BULK_MAX_TARGETS + 1) * bitmapBytes(bulkChunkCount(size));
+  blob = (uint8_t*)heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  if (blob == NULL) {
+    blob = (uint8_t*)heap_caps_malloc(bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  }
+  blobSize = blob != NULL ? size : 0;
+  if (blob != NULL) memset(blob + size, 0, bytes - size);
+
+  xSemaphoreGive(bulkLock);
+
+  if (blob == NULL) LOG_E("BULK", "No memory for a %u byte blob", (unsigned)size);
+  return blob;
+}
+
+int bulkStart(const char* name, const char* const* ids, int numTargets, unsigned long now) {
+  size_t nameLength = strlen(name);
+  if (nameLength == 0 || nameLength > BULK_NAME_MAX || numTargets < 1 || numTargets > BULK_MAX_TARGETS) {
+    return -1;
+  }
+  for (int i = 0; i < numTargets; i++) {
+    size_t length = strlen(ids[i]);
+    if (length == 0 || length > NODE_ID_MAX) return -1;
+  }
+
+  xSemaphoreTake(bulkLock, portMAX_DELAY);
+
+  if (active || blob == NULL) {
+    xSemaphoreGive(bulkLock);
+    return -1;
+  }
+
+  // Counters of the previous transfer are replaced
+  stats = BulkStats();
+  stats.active = true;
+  stats.transferId = nextTransferId;
+  stats.name = name;
+  stats.size = blobSize;
+  stats.chunks = bulkChunkCount(blobSize);
+  stats.numTargets = numTargets;
+  nextTransferId = nextTransferId % 9999 + 1;
+
+  mbedtls_sha256_ret(blob, blobSize, blobHash, 0);
+
+  size_t mapBytes = bitmapBytes(stats.chunks);
+  for (int i = 0; i < numTargets; i++) {
+    BulkTarget& t = targets[i];
+    t.info = BulkTargetInfo();
+    t.info.deviceId = ids[i];
+    t.info.state = BULK_TARGET_OFFER;
+    t.acked = blob + blobSize + i * mapBytes;
+    resetTarget(t);
+  }
+  sentOnce = blob + blobSize + BULK_MAX_TARGETS * mapBytes;
+
+  active = true;
+  startedMs = now;
+  waitTarget = -1;
+  windowLength = 0;
+  windowPos = 0;
+
+  xSemaphoreGive(bulkLock);
+
+  LOG_I("BULK", "Transfer %u: %s, %lu bytes in %u chunks to %d device(s)",
+        stats.transferId, name, (unsigned long)stats.size, stats.chunks, numTargets);
+  return stats.transferId;
+}
+
+bool bulkAbort() {
+  if (bulkLock == NULL) return false;
+
+  xSemaphoreTake(bulkLock, portMAX_DELAY);
+  bool running = active;
+  abortPending = active;
+  xSemaphoreGive(bulkLock);
+
+  return running;
+}
+
+void bulkService(unsigned long now, unsigned long idleMs) {
+  if (bulkLock == NULL || !active) return;
+
+  xSemaphoreTake(bulkLock, portMAX_DELAY);
+
+  if (waitTarget >= 0) {
+    if ((long)(now - waitDeadline) < 0) {
+      xSemaphoreGive(bulkLock);
+      return;
+    }
+    missed(targets[waitTarget], now);
+    waitTarget = -1;
+  }
+
+  if ((long)(now - busyUntil) < 0) {
+    xSemaphoreGive(bulkLock);
+    return;
+  }
+
+  for (int i = 0; i < stats.numTargets; i++) {
+    BulkTarget& t = targets[i];
+    if (t.info.state == BULK_TARGET_PAUSED && (long)(now - t.resumeAtMs) >= 0) {
+      t.info.misses = 0;
+      t.info.resumes++;
+      setState(t, BULK_TARGET_OFFER);
+      LOG_I("BULK", "%s: resuming at %u/%u chunks", t.info.deviceId.c_str(), t.info.received, stats.chunks);
+    }
+  }
+
+  BulkFrame frame;
+  if (abortPending) {
+    memset(&frame, 0, sizeof(frame));
+    frame.kind = BULK_FRAME_ABORT;
+    frame.target = -1;
+  } else if (!nextFrame(frame)) {
+    bool waiting = false;
+    for (int i = 0; i < stats.numTargets; i++) {
+      if (targets[i].info.state == BULK_TARGET_PAUSED) waiting = true;
+    }
+    if (!waiting) finishTransfer(now, stats.failed > 0 ? "finished" : "complete");
+    xSemaphoreGive(bulkLock);
+    return;
+  }
+
+  char payload[LORA_MAX_FRAME + 1];
+  size_t length = 0;
+  if (frame.kind == BULK_FRAME_DATA) {
+    size_t offset = (size_t)frame.chunk * BULK_CHUNK_BYTES;
+    size_t bytes = blobSize - offset < BULK_CHUNK_BYTES ? blobSize - offset : BULK_CHUNK_BYTES;
+    length = buildBulkChunk(payload, sizeof(payload), stats.transferId, frame.chunk, frame.ackRequest,
+                            blob + offset, bytes);
+  } else if (frame.kind == BULK_FRAME_OFFER) {
+    length = buildBulkOffer(payload, sizeof(payload), stats.transferId, blobSize, blobHash, stats.name.c_str());
+  } else {
+    length = snprintf(payload, sizeof(payload), "%u", stats.transferId);
+  }
+
+  static const char* const COMMANDS[] = { CMD_BLK_OFFER, CMD_BLK_DATA, CMD_BLK_QUERY, CMD_BLK_ABORT };
+  const char* command = COMMANDS[frame.kind];
+
+  // Hold the frame back unless it (and the reply) fits before other traffic
+  bool expectsReply = frame.kind == BULK_FRAME_OFFER || frame.kind == BULK_FRAME_QUERY || frame.ackRequest;
+  unsigned long airtime = airtimeOf(BULK_FRAME_OVERHEAD + strlen(command) + length);
+  unsigned long needed = airtime + BULK_TX_GAP_MS + BULK_IDLE_GUARD_MS + (expectsReply ? BULK_REPLY_AIRTIME_MS : 0);
+  if (needed > idleMs || !budgetAllows(airtime, now)) {
+    stats.heldBack++;
+    xSemaphoreGive(bulkLock);
+    return;
+  }
+
+  const char* targetId = frame.target >= 0 ? targets[frame.target].info.deviceId.c_str() : BROADCAST_ID;
+  char target[NODE_ID_MAX + 1];
+  strcpy(target, targetId);
+
+  // Commit before sending: the reply may arrive before sendFrame() returns
+  if (frame.kind == BULK_FRAME_DATA) {
+    windowPos++;
+    stats.chunksSent++;
+    if (frame.target < 0) stats.chunksShared++;
+    if (testBit(sentOnce, frame.chunk)) {
+      stats.retransmissions++;
+    } else {
+      sentOnce[frame.chunk >> 3] |= 1 << (frame.chunk & 7);
+    }
+    for (int i = 0; i < stats.numTargets; i++) {
+      if (frame.needers & (1UL << i)) targets[i].needsQuery = !frame.ackRequest;
+    }
+  } else if (frame.target >= 0) {
+    targets[frame.target].needsQuery = false;
+  }
+  if (expectsReply) {
+    waitTarget = frame.target;
+    waitDeadline = now + airtime + BULK_REPLY_TIMEOUT_MS;
+  }
+
+  bool finishing = abortPending;
+  xSemaphoreGive(bulkLock);
+
+  size_t frameBytes = sendFrame(command, target, payload);
+
+  xSemaphoreTake(bulkLock, portMAX_DELAY);
+
+  if (frameBytes > 0) airtime = airtimeOf(frameBytes);
+  stats.frames++;
+  stats.airtimeMs += airtime;
+  chargeAirtime(bulkBuckets, airtime, now);
+  busyUntil = now + airtime + BULK_TX_GAP_MS;
+
+  if (finishing) {
+    for (int i = 0; i < stats.numTargets; i++) {
+      if (targets[i].info.state != BULK_TARGET_DONE) setState(targets[i], BULK_TARGET_FAILED);
+    }
+    finishTransfer(now, "aborted");
+  }
+
+  xSemaphoreGive(bulkLock);
+}
+
+void bulkHandleStatus(const LoRaMessage& msg, unsigned long now) {
+  BulkStatus status;
+  if (!parseBulkStatus(msg, status)) {
+    LOG_W("BULK", "Invalid BLK_STATUS from %s: %s", msg.senderId.c_str(), msg.payload.c_str());
+    return;
+  }
+  if (bulkLock == NULL) return;
+
+  xSemaphoreTake(bulkLock, portMAX_DELAY);
+
+  int index = active ? findTarget(msg.senderId) : -1;
+  if (index < 0 || status.transferId != stats.transferId) {
+    xSemaphoreGive(bulkLock);
+    LOG_D("BULK", "Stale BLK_STATUS from %s (transfer %u)", msg.senderId.c_str(), status.transferId);
+    return;
+  }
+
+  BulkTarget& t = targets[index];
+  BulkTargetState previous = t.info.state;
+  t.info.misses = 0;
+  if (waitTarget == index) waitTarget = -1;
+
+  switch (status.kind) {
+    case BULK_STATUS_PROGRESS: {
+      if (previous == BULK_TARGET_DONE || previous == BULK_TARGET_FAILED) break;
+
+      // The device's bitmap is authoritative (it may have lost chunks in a restart)
+      uint32_t end = (uint32_t)status.base + BULK_ACK_SPAN;
+      for (uint32_t c = 0; c < stats.chunks; c++) {
+        if (c < status.base) {
+          setAcked(t, c, true);
+        } else if (c < end) {
+          setAcked(t, c, testBit(status.bitmap, c - status.base));
+        } else if (previous == BULK_TARGET_OFFER) {
+          setAcked(t, c, false);
+        }
+      }
+      t.base = status.base;
+      while (t.base < stats.chunks && testBit(t.acked, t.base)) t.base++;
+
+      if (previous != BULK_TARGET_SENDING) {
+        setState(t, BULK_TARGET_SENDING);
+        if (t.info.received > 0) {
+          LOG_I("BULK", "%s: resumes with %u/%u chunks", t.info.deviceId.c_str(), t.info.received, stats.chunks);
+        }
+      }
+      break;
+    }
+
+    case BULK_STATUS_DONE:
+      if (previous != BULK_TARGET_DONE) {
+        t.info.received = stats.chunks;
+        t.info.doneMs = now - startedMs;
+        t.needsQuery = false;
+        setState(t, BULK_TARGET_DONE);
+        LOG_I("BULK", "%s: %s installed (%lus)", t.info.deviceId.c_str(), stats.name.c_str(), t.info.doneMs / 1000);
+      }
+      break;
+
+    case BULK_STATUS_HASH_FAIL:
+      if (previous == BULK_TARGET_DONE || previous == BULK_TARGET_FAILED) break;
+      t.info.hashFails++;
+      resetTarget(t);
+      if (t.info.hashFails > BULK_MAX_HASH_FAILS) {
+        setState(t, BULK_TARGET_FAILED);
+        LOG_E("BULK", "%s: hash mismatch %u times - giving up", t.info.deviceId.c_str(), t.info.hashFails);
+      } else {
+        setState(t, BULK_TARGET_SENDING);
+        LOG_W("BULK", "%s: hash mismatch - sending again", t.info.deviceId.c_str());
+      }
+      break;
+
+    case BULK_STATUS_UNKNOWN:
+      if (previous == BULK_TARGET_DONE || previous == BULK_TARGET_FAILED) break;
+      resetTarget(t);
+      setState(t, BULK_TARGET_OFFER);
+      break;
+  }
+
+  xSemaphoreGive(bulkLock);
+}
+
+void bulkChargeAirtime(unsigned long airtimeMs, unsigned long now) {
+  if (bulkLock == NULL) return;
+
+  xSemaphoreTake(bulkLock, portMAX_DELAY);
+  chargeAirtime(otherBuckets, airtimeMs, now);
+  xSemaphoreGive(bulkLock);
+}
+
+bool bulkActive() {
+  return active;
+}
+
+bool bulkRadioBusy(unsigned long now) {
+  if (bulkLock == NULL || !active) return false;
+
+  xSemaphoreTake(bulkLock, portMAX_DELAY);
+  bool busy = (waitTarget >= 0 && (long)(now - waitDeadline) < 0) || (long)(now - busyUntil) < 0;
+  xSemaphoreGive(bulkLock);
+
+  return busy;
+}
+
+void bulkSetDutyPermille(uint16_t permille) {
+  if (permille < 1) permille = 1;
+  if (permille > 1000) permille = 1000;
+
+  if (bulkLock != NULL) xSemaphoreTake(bulkLock, portMAX_DELAY);
+  dutyPermille = permille;
+  if (bulkLock != NULL) xSemaphoreGive(bulkLock);
+}
+
+// ==================== STATUS FUNCTIONS ====================
+
+BulkStats bulkGetStats(unsigned long now) {
+  if (bulkLock == NULL) return stats;
+
+  xSemaphoreTake(bulkLock, portMAX_DELAY);
+  BulkStats snapshot = stats;
+  snapshot.active = active;
+  if (active) snapshot.elapsedMs = now - startedMs;
+  snapshot.hourAirtimeMs = hourAirtime(now);
+  snapshot.budgetMs = budgetMs();
+  xSemaphoreGive(bulkLock);
+
+  return snapshot;
+}
+
+int bulkGetTargets(BulkTargetInfo* out, int maxTargets) {
+  if (bulkLock == NULL) return 0;
+
+  xSemaphoreTake(bulkLock, portMAX_DELAY);
+  int count = stats.numTargets < maxTargets ? stats.numTargets : maxTargets;
+  for (int i = 0; i < count; i++) out[i] = targets[i].info;
+  xSemaphoreGive(bulkLock);
+
+  return count;
+}
+
+const char* bulkTargetStateName(BulkTargetState state) {
+  switch (state) {
+    case BULK_TARGET_OFFER:     return "OFFER";
+    case BULK_TARGET_SENDING:   return "SENDING";
+    case BULK_TARGET_PAUSED:    return "PAUSED";
+    case BULK_TARGET_DONE:      return "DONE";
+    case BULK_TARGET_FAILED:    return "FAILED";
+    default:                    return "UNKNOWN";
+  }
+}
@@ -0,0 +1,195 @@
+/**
+ * DETECTRA Gateway v2.0 - Bulk Transfer (configs and models to edge devices)
+ *
+ * Pushes a blob (detection thresholds, positions, class list, model) to
+ * one or many devices over LoRa with the BLK_* commands of lora_protocol.h:
+ *
+ * - The blob is split into BULK_CHUNK_BYTES chunks and sent in windows of
+ *   BULK_WINDOW chunks. A chunk that several targets still need is sent
+ *   once to BROADCAST_ID, so updating N devices costs little more airtime
+ *   than updating one.
+ * - After each window, every target that was sent chunks reports a bitmap
+ *   (BLK_STATUS, one bit per chunk). Only missing chunks are sent again.
+ *   A window for a single target asks for the bitmap with its last chunk
+ *   instead of a separate BLK_QUERY.
+ * - The device checks the SHA-256 of the whole blob before installing it
+ *   (DONE). A mismatch (HASH_FAIL) restarts that target.
+ * - Interrupted transfers resume: a target that stops answering is paused
+ *   and offered the blob again later. The device reports the chunks it
+ *   kept for that hash, and only the rest is sent.
+ *
+ * Frames go out only in idle radio time. pollingTask calls bulkService()
+ * between polling cycles with the time left before the next cycle is due
+ * (and inside this gateway's coordination window); a frame that does not
+ * fit is held back.
+ *
+ * Duty cycle: the gateway's airtime in any hour stays within
+ * BULK_DUTY_PERMILLE. Every frame counts - bulk frames (queries and
+ * retransmissions included) and, through bulkChargeAirtime(), polls,
+ * beacons and replies - over a sliding hour of one-minute buckets. Polls
+ * cannot wait, so bulk frames are held back and leave room for an hour of
+ * the other traffic (as much as in the last hour).
+ *
+ * tools/bulk_sim runs this module against simulated devices and reports
+ * throughput, airtime and retransmissions.
+ *
+ * Usage:
+ *   bulkInit(sendBulkFrame, bulkAirtimeMs);
+ *   uint8_t* blob = bulkReserve(size);             // fill it, then:
+ *   bulkStart("config/thresholds.json", targets, numTargets, millis());
+ *
+ *   bulkService(millis(), idleMs);                 // pollingTask, between cycles
+ *   bulkChargeAirtime(airtimeMs, millis());        // every other frame sent on the radio
+ *   bulkHandleStatus(msg, millis());               // on BLK_STATUS
+ */
+
+#ifndef BULK_TRANSFER_H
+#define BULK_TRANSFER_H
+
+#include <Arduino.h>
+#include "lora_protocol.h"
+
+// ==================== CONFIGURATION ====================
+
+#define BULK_MAX_BYTES          (256UL * 1024)    // Blob limit (one copy in PSRAM)
+#define BULK_MAX_TARGETS        16
+#define BULK_WINDOW             8                 // Chunks sent before the bitmap ACK
+#define BULK_TX_GAP_MS          100               // Module turnaround after each frame
+#define BULK_REPLY_TIMEOUT_MS   3000              // BLK_STATUS wait after our frame's airtime
+#define BULK_REPLY_AIRTIME_MS   400               // Reserved for the reply when checking idle time
+#define BULK_MAX_MISSES         3                 // Unanswered requests in a row -> target paused
+#define BULK_RESUME_MS          60000             // First resume after a pause, doubling up to 32 min
+#define BULK_MAX_RESUMES        10                // Then the target fails
+#define BULK_MAX_HASH_FAILS     2
+#define BULK_IDLE_GUARD_MS      2000              // Kept free before the next polling cycle
+#define BULK_DUTY_PERMILLE      10                // Airtime budget: 1 % per hour (868.0-868.6 MHz)
+#define BULK_DUTY_BUCKETS       60                // Sliding hour in one-minute steps
+
+// ==================== DATA STRUCTURES ====================
+
+enum BulkTargetState : uint8_t {
+  BULK_TARGET_OFFER,        // Waiting for the reply to BLK_OFFER
+  BULK_TARGET_SENDING,      // Chunks missing
+  BULK_TARGET_PAUSED,       // Stopped answering - offered again after BULK_RESUME_MS
+  BULK_TARGET_DONE,         // Device verified and installed the blob
+  BULK_TARGET_FAILED        // Hash failures / never came back
+};
+
+/**
+ * One target device
+ */
+struct BulkTargetInfo {
+  FixedString<NODE_ID_MAX> deviceId;
+  BulkTargetState state;
+  uint16_t received;                // Chunks acknowledged
+  uint8_t misses;                   // Unanswered requests in a row
+  uint8_t resumes;                  // Times the transfer was resumed after a pause
+  uint8_t hashFails;
+  unsigned long doneMs;             // Time from start to DONE (0 = not done)
+};
+
+/**
+ * Transfer counters (current or last transfer)
+ */
+struct BulkStats {
+  bool active;
+  uint16_t transferId;
+  FixedString<BULK_NAME_MAX> name;
+  uint32_t size;
+  uint16_t chunks;
+  uint8_t numTargets;
+  uint8_t done;
+  uint8_t failed;
+  uint32_t frames;                  // All BLK_* frames sent
+  uint32_t chunksSent;              // BLK_DATA frames, retransmissions included
+  uint32_t chunksShared;            // ... of which sent once for several targets
+  uint32_t retransmissions;         // Chunks sent more than once
+  uint32_t timeouts;                // Requests without a reply
+  uint32_t heldBack;                // Service calls without enough idle time / budget
+  uint32_t airtimeMs;               // Gateway airtime spent on this transfer
+  unsigned long elapsedMs;
+  uint32_t hourAirtimeMs;           // All gateway frames in the last hour (duty budget)
+  uint32_t budgetMs;                // Allowed per hour
+};
+
+/**
+ * Sends one frame (returns the frame length, 0 if not sent)
+ */
+typedef size_t (*BulkSendFn)(const char* command, const char* targetId, const char* payload);
+
+/**
+ * Airtime of a frame with this many bytes
+ */
+typedef unsigned long (*BulkAirtimeFn)(size_t frameBytes);
+
+// ==================== TRANSFER FUNCTIONS ====================
+
+/**
+ * Set the radio callbacks (call once in setup)
+ */
+void bulkInit(BulkSendFn send, BulkAirtimeFn airtime);
+
+/**
+ * Allocate the blob buffer for the next transfer (filled by the caller)
+ *
+ * @return NULL if a transfer is running, the blob is too large or memory is short
+ */
+uint8_t* bulkReserve(size_t size);
+
+/**
+ * Start sending the reserved blob
+ *
+ * @param name Destination on the device (BULK_NAME_MAX characters)
+ * @return Transfer ID, or -1 (nothing reserved, invalid name / targets)
+ */
+int bulkStart(const char* name, const char* const* targets, int numTargets, unsigned long now);
+
+/**
+ * Stop the transfer (BLK_ABORT is broadcast at the next service call)
+ *
+ * @return false if no transfer is running
+ */
+bool bulkAbort();
+
+/**
+ * Send the next frame if it fits (pollingTask, between polling cycles)
+ *
+ * @param idleMs Radio time available before other traffic (ULONG_MAX = unlimited)
+ */
+void bulkService(unsigned long now, unsigned long idleMs);
+
+/**
+ * Handle a BLK_STATUS from a device (any task)
+ */
+void bulkHandleStatus(const LoRaMessage& msg, unsigned long now);
+
+/**
+ * Count a frame sent outside the bulk transfer (polls, beacons, replies)
+ * against the duty-cycle budget (any task)
+ */
+void bulkChargeAirtime(unsigned long airtimeMs, unsigned long now);
+
+/**
+ * Transfer running (or abort pending)?
+ */
+bool bulkActive();
+
+/**
+ * Frame of ours in the air, or a BLK_STATUS awaited? Other idle-time
+ * traffic (time beacons) waits until this is false.
+ */
+bool bulkRadioBusy(unsigned long now);
+
+/**
+ * Change the duty-cycle budget (permille of airtime, e.g. 100 on a 10 % sub-band)
+ */
+void bulkSetDutyPermille(uint16_t permille);
+
+/**
+ * Current / last transfer
+ */
+BulkStats bulkGetStats(unsigned long now);
+int bulkGetTargets(BulkTargetInfo* out, int maxTargets);
+const char* bulkTargetStateName(BulkTargetState state);
+
+#endif // BULK_TRANSFER_H
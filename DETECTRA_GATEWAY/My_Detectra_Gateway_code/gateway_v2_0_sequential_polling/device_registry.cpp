@@ -0,0 +1,263 @@
+/**
+ * DETECTRA Gateway v2.0 - Persistent Device Registry Implementation
+ */
+
+#include "device_registry.h"
+#include "log.h"
+
+static RegistryStats stats = { REGISTRY_EMPTY, 0, 0, 0, 0, 0, 0, false };
+
+static volatile bool dirty = false;
+static volatile unsigned long firstChange = 0;
+static volatile unsigned long lastChange = 0;
+static volatile bool held = false;
+static uint32_t lastWrittenCrc = 0;
+static bool haveWrittenCrc = false;
+
+// Shared by load and write (both run on the loop task)
+static uint8_t blobBuffer[REGISTRY_BLOB_MAX];
+
+// ==================== CRC32 ====================
+
+static uint32_t crc32(const uint8_t* data, size_t length) {
+  uint32_t crc = 0xFFFFFFFFUL;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+
+// ==================== ENCODING ====================
+
+template <size_t N, size_t M>
+static void copyField(char (&dst)[M], const FixedString<N>& src) {
+  static_assert(M >= N + 1, "record field smaller than DeviceInfo field");
+  memset(dst, 0, M);
+  memcpy(dst, src.c_str(), src.length());
+}
+
+template <size_t N, size_t M>
+static void readField(FixedString<N>& dst, const char (&src)[M]) {
+  dst.assign(src, strnlen(src, M));
+}
+
+size_t registryEncode(const DeviceInfo* devices, int numDevices, uint8_t* out, size_t capacity) {
+  size_t length = sizeof(RegistryHeader) + numDevices * sizeof(RegistryRecord);
+  if (numDevices < 0 || numDevices > REGISTRY_MAX_DEVICES || length > capacity) return 0;
+
+  RegistryRecord* records = (RegistryRecord*)(out + sizeof(RegistryHeader));
+
+  for (int i = 0; i < numDevices; i++) {
+    const DeviceInfo& device = devices[i];
+    RegistryRecord& r = records[i];
+
+    copyField(r.deviceId, device.deviceId);
+    copyField(r.sharedSecret, device.sharedSecret);
+    copyField(r.tableLeft, device.tableLeft);
+    copyField(r.tableRight, device.tableRight);
+    r.flags = device.paired ? REGISTRY_FLAG_PAIRED : 0;
+    r.battery = device.battery;
+    r.rssi = device.rssi;
+    r.snr = device.snr;
+    r.totalPolls = device.totalPolls;
+    r.successfulPolls = device.successfulPolls;
+    r.failedPolls = device.failedPolls;
+    r.scheduleGroup = device.scheduleGroup;
+    r.cadenceMinutes = device.cadenceMinutes;
+  }
+
+  RegistryHeader header;
+  header.magic = REGISTRY_MAGIC;
+  header.version = REGISTRY_VERSION;
+  header.count = numDevices;
+  header.recordSize = sizeof(RegistryRecord);
+  header.reserved = 0;
+  header.crc = crc32((const uint8_t*)records, numDevices * sizeof(RegistryRecord));
+  memcpy(out, &header, sizeof(header));
+
+  return length;
+}
+
+int registryDecode(const uint8_t* blob, size_t length, DeviceInfo* devices, int maxDevices, RegistryStatus& status) {
+  if (length == 0) {
+    status = REGISTRY_EMPTY;
+    return 0;
+  }
+  if (length < sizeof(RegistryHeader)) {
+    status = REGISTRY_BAD_SIZE;
+    return 0;
+  }
+
+  RegistryHeader header;
+  memcpy(&header, blob, sizeof(header));
+
+  if (header.magic != REGISTRY_MAGIC) {
+    status = REGISTRY_BAD_MAGIC;
+    return 0;
+  }
+  if (header.version > REGISTRY_VERSION || header.recordSize < REGISTRY_RECORD_MIN_SIZE) {
+    // Newer major layout, or a record too short for the fields we need
+    status = REGISTRY_BAD_VERSION;
+    return 0;
+  }
+
+  size_t recordsLength = (size_t)header.count * header.recordSize;
+  if (length != sizeof(RegistryHeader) + recordsLength || header.count > maxDevices) {
+    status = REGISTRY_BAD_SIZE;
+    return 0;
+  }
+
+  const uint8_t* records = blob + sizeof(RegistryHeader);
+  if (crc32(records, recordsLength) != header.crc) {
+    status = REGISTRY_BAD_CRC;
+    return 0;
+  }
+
+  for (int i = 0; i < header.count; i++) {
+    // Longer records from newer firmware: read the known prefix
+    // Shorter records from older firmware: missing trailing fields read as 0
+    RegistryRecord r;
+    size_t known = (header.recordSize < sizeof(r)) ? header.recordSize : sizeof(r);
+    memset(&r, 0, sizeof(r));
+    memcpy(&r, records + (size_t)i * header.recordSize, known);
+
+    DeviceInfo& device = devices[i];
+    readField(device.deviceId, r.deviceId);
+    readField(device.sharedSecret, r.sharedSecret);
+    readField(device.tableLeft, r.tableLeft);
+    readField(device.tableRight, r.tableRight);
+    device.paired = (r.flags & REGISTRY_FLAG_PAIRED) != 0;
+    device.battery = r.battery;
+    device.rssi = r.rssi;
+    device.snr = r.snr;
+    device.totalPolls = r.totalPolls;
+    device.successfulPolls = r.successfulPolls;
+    device.failedPolls = r.failedPolls;
+    device.scheduleGroup = r.scheduleGroup;
+    device.cadenceMinutes = r.cadenceMinutes;
+
+    // Runtime state starts fresh
+    device.phase = PHASE_IDLE;
+    device.retryCount = 0;
+    device.positionsReceived = 0;
+    device.positionsRequested = POLL_POSITIONS;
+    device.cadenceStretch = 1;
+    device.commandSent = false;
+    device.censusSeen = false;
+    device.online = false;
+    device.lastContact = 0;
+    device.nextPollMs = 0;
+  }
+
+  status = REGISTRY_OK;
+  return header.count;
+}
+
+// ==================== NVS ====================
+
+int registryLoad(Preferences& prefs, DeviceInfo* devices, int maxDevices) {
+  unsigned long start = micros();
+
+  prefs.begin(REGISTRY_NAMESPACE, true);  // Read-only
+  size_t length = prefs.getBytesLength(REGISTRY_KEY);
+  bool fits = (length <= sizeof(blobBuffer));
+  if (fits && length > 0) {
+    length = prefs.getBytes(REGISTRY_KEY, blobBuffer, length);
+  }
+  prefs.end();
+
+  int count = 0;
+  if (fits) {
+    count = registryDecode(blobBuffer, length, devices, maxDevices, stats.loadStatus);
+  } else {
+    stats.loadStatus = REGISTRY_BAD_SIZE;
+  }
+
+  stats.devicesLoaded = count;
+  stats.blobBytes = length;
+  stats.loadUs = micros() - start;
+  stats.restoredAtMs = millis();
+
+  if (stats.loadStatus == REGISTRY_OK) {
+    lastWrittenCrc = crc32(blobBuffer, length);
+    haveWrittenCrc = true;
+  }
+
+  return count;
+}
+
+void registryMarkDirty() {
+  unsigned long now = millis();
+  if (!dirty) firstChange = now;
+  lastChange = now;
+  dirty = true;
+}
+
+void registryHold(bool hold) {
+  held = hold;
+  if (!hold) registryMarkDirty();  // Debounce starts when the batch is done
+}
+
+bool registryService(Preferences& prefs, const DeviceInfo* devices, int numDevices, bool force) {
+  stats.dirty = dirty;
+  if (!dirty || (held && !force)) return false;
+
+  unsigned long now = millis();
+  bool settled = (now - lastChange >= REGISTRY_DEBOUNCE_MS);
+  bool overdue = (now - firstChange >= REGISTRY_MAX_DELAY_MS);
+  if (!force && !settled && !overdue) return false;
+
+  // Changes after this point re-arm the flag
+  dirty = false;
+  stats.dirty = false;
+
+  size_t length = registryEncode(devices, numDevices, blobBuffer, sizeof(blobBuffer));
+  if (length == 0) {
+    LOG_E("REGISTRY", "Encode failed (%d devices)", numDevices);
+    return false;
+  }
+
+  uint32_t crc = crc32(blobBuffer, length);
+  if (haveWrittenCrc && crc == lastWrittenCrc) {
+    stats.skippedWrites++;
+    return false;
+  }
+
+  prefs.begin(REGISTRY_NAMESPACE, false);
+  size_t written = prefs.putBytes(REGISTRY_KEY, blobBuffer, length);
+  prefs.end();
+
+  if (written != length) {
+    LOG_E("REGISTRY", "NVS write failed (%u/%u bytes)", (unsigned)written, (unsigned)length);
+    registryMarkDirty();  // Retry after the next debounce window
+    return false;
+  }
+
+  lastWrittenCrc = crc;
+  haveWrittenCrc = true;
+  stats.writes++;
+  stats.blobBytes = length;
+
+  LOG_I("REGISTRY", "Saved %d devices (%u bytes, write #%lu)", numDevices, (unsigned)length,
+        (unsigned long)stats.writes);
+  return true;
+}
+
+const RegistryStats& registryGetStats() {
+  return stats;
+}
+
+const char* registryStatusToString(RegistryStatus status) {
+  switch (status) {
+    case REGISTRY_OK:           return "OK";
+    case REGISTRY_EMPTY:        return "EMPTY";
+    case REGISTRY_BAD_SIZE:     return "BAD_SIZE";
+    case REGISTRY_BAD_MAGIC:    return "BAD_MAGIC";
+    case REGISTRY_BAD_VERSION:  return "BAD_VERSION";
+    case REGISTRY_BAD_CRC:      return "BAD_CRC";
+    default:                    return "UNKNOWN";
+  }
+}
@@ -0,0 +1,153 @@
+/**
+ * DETECTRA Gateway v2.0 - Persistent Device Registry
+ *
+ * The paired fleet (IDs, secrets, table mappings, learned link stats) is
+ * stored in NVS as one versioned, CRC-checked binary blob and restored with
+ * a single getBytes() at boot.
+ *
+ * Blob layout (little endian):
+ *   RegistryHeader  magic "DREG", version, count, recordSize, CRC32 of records
+ *   RegistryRecord  x count (fixed size)
+ *
+ * recordSize is stored so a newer firmware can append fields to the record
+ * and still read older blobs (and vice versa, up to the shared prefix).
+ *
+ * Writes are debounced: registryMarkDirty() only flags the change, and
+ * registryService() (called from loop) writes once changes have settled
+ * for REGISTRY_DEBOUNCE_MS, at most REGISTRY_MAX_DELAY_MS after the first
+ * one. A blob identical to the last one written is not rewritten.
+ * registryHold() defers writes while a batch of changes is in progress
+ * (bulk pairing), so the whole batch lands in one write.
+ */
+
+#ifndef DEVICE_REGISTRY_H
+#define DEVICE_REGISTRY_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "lora_protocol.h"
+
+// ==================== CONSTANTS ====================
+
+#define REGISTRY_NAMESPACE      "detectra"
+#define REGISTRY_KEY            "registry"
+#define REGISTRY_MAGIC          0x47455244UL  // "DREG"
+#define REGISTRY_VERSION        1
+#define REGISTRY_MAX_DEVICES    32            // Blob capacity (>= MAX_DEVICES)
+#define REGISTRY_DEBOUNCE_MS    5000          // Quiet time before a write
+#define REGISTRY_MAX_DELAY_MS   60000         // Upper bound on write latency
+
+// ==================== DATA STRUCTURES ====================
+
+struct __attribute__((packed)) RegistryHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t count;
+  uint16_t recordSize;
+  uint16_t reserved;
+  uint32_t crc;                               // CRC32 over all records
+};
+
+struct __attribute__((packed)) RegistryRecord {
+  char deviceId[NODE_ID_MAX + 1];
+  char sharedSecret[SECRET_MAX + 1];
+  char tableLeft[TABLE_ID_MAX + 1];
+  char tableRight[TABLE_ID_MAX + 1];
+  uint8_t flags;                              // REGISTRY_FLAG_*
+  int8_t battery;                             // Last known link stats
+  int16_t rssi;
+  int16_t snr;
+  uint32_t totalPolls;
+  uint32_t successfulPolls;
+  uint32_t failedPolls;
+  uint8_t scheduleGroup;                      // Appended: older blobs read as 0 (default cadence)
+  uint16_t cadenceMinutes;
+};
+
+// Shortest record accepted on load (layout before the schedule fields were appended)
+#define REGISTRY_RECORD_MIN_SIZE  offsetof(RegistryRecord, scheduleGroup)
+
+#define REGISTRY_FLAG_PAIRED    0x01
+
+#define REGISTRY_BLOB_MAX       (sizeof(RegistryHeader) + REGISTRY_MAX_DEVICES * sizeof(RegistryRecord))
+
+enum RegistryStatus : uint8_t {
+  REGISTRY_OK,
+  REGISTRY_EMPTY,                             // No blob stored yet
+  REGISTRY_BAD_SIZE,
+  REGISTRY_BAD_MAGIC,
+  REGISTRY_BAD_VERSION,
+  REGISTRY_BAD_CRC
+};
+
+/**
+ * Registry counters (boot report + status)
+ */
+struct RegistryStats {
+  RegistryStatus loadStatus;
+  uint8_t devicesLoaded;
+  uint16_t blobBytes;                         // Size of the last blob read or written
+  uint32_t loadUs;                            // NVS read + decode time
+  uint32_t restoredAtMs;                      // millis() when the fleet was restored
+  uint32_t writes;                            // Blobs written to flash
+  uint32_t skippedWrites;                     // Dirty flushes that matched the stored blob
+  bool dirty;
+};
+
+// ==================== REGISTRY FUNCTIONS ====================
+
+/**
+ * Restore the fleet from NVS (one getBytes call)
+ * Runtime fields (phase, online, retry state) are reset.
+ *
+ * @param prefs Preferences instance (opened and closed here)
+ * @param devices Output array
+ * @param maxDevices Capacity of devices[]
+ * @return Number of devices restored (0 if none or invalid - see registryGetStats())
+ */
+int registryLoad(Preferences& prefs, DeviceInfo* devices, int maxDevices);
+
+/**
+ * Flag the registry as changed (cheap - safe to call from any task)
+ */
+void registryMarkDirty();
+
+/**
+ * Defer writes (true) until the batch is complete (false - marks dirty)
+ * A forced registryService() still writes while held.
+ */
+void registryHold(bool hold);
+
+/**
+ * Write the registry if it is dirty and the debounce window has passed
+ *
+ * @param force Write now if dirty (e.g. before a restart)
+ * @return true if a blob was written
+ */
+bool registryService(Preferences& prefs, const DeviceInfo* devices, int numDevices, bool force = false);
+
+/**
+ * Encode devices into a blob
+ *
+ * @return Blob size, or 0 if out is too small
+ */
+size_t registryEncode(const DeviceInfo* devices, int numDevices, uint8_t* out, size_t capacity);
+
+/**
+ * Decode a blob into devices[]
+ *
+ * @return Number of devices decoded (status reports why 0)
+ */
+int registryDecode(const uint8_t* blob, size_t length, DeviceInfo* devices, int maxDevices, RegistryStatus& status);
+
+/**
+ * Registry counters
+ */
+const RegistryStats& registryGetStats();
+
+/**
+ * RegistryStatus for logs and JSON
+ */
+const char* registryStatusToString(RegistryStatus status);
+
+#endif // DEVICE_REGISTRY_H
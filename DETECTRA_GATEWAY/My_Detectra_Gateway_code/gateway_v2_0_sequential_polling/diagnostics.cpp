@@ -0,0 +1,247 @@
+/**
+ * DETECTRA Gateway v2.0 - Task Health Monitor Implementation
+ */
+
+#include "diagnostics.h"
+#include "log.h"
+#include <atomic>
+#include <esp_attr.h>
+#include <esp_heap_caps.h>
+#include <esp_system.h>
+#include <esp_task_wdt.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/timers.h>
+
+#define DIAG_STALL_MAGIC  0x44535441UL      // "DSTA"
+
+struct DiagTaskState {
+  // Set up by diagWatch() / diagTaskStarted()
+  DiagTaskInfo info;
+  TaskHandle_t handle;
+
+  // Written by the task itself
+  std::atomic<bool> beating;                // First heartbeat seen
+  std::atomic<unsigned long> lastBeatMs;
+  unsigned long busyStartUs;
+  std::atomic<uint32_t> busyUs;             // Wraps - only deltas are used
+
+  // Written by the sampler
+  uint32_t sampledBusyUs;
+};
+
+/**
+ * Survives the watchdog reset (not cleared at boot)
+ */
+struct DiagStallRecord {
+  uint32_t magic;
+  uint8_t task;
+  uint32_t stalledMs;
+};
+
+RTC_NOINIT_ATTR static DiagStallRecord stallRecord;
+
+static DiagTaskState tasks[DIAG_TASK_COUNT];
+static DiagLoopStats loopStats = {};
+static DiagMemory memory = {};
+static DiagResetInfo resetInfo = { "unknown", NULL, 0 };
+
+static TimerHandle_t sampleTimer = NULL;
+static unsigned long lastSampleUs = 0;
+static std::atomic<bool> stallReported(false);
+
+static const char* const SECTION_NAMES[DIAG_SECTION_COUNT] = {
+  "mqtt", "outbox", "ws", "registry", "publish"
+};
+
+// Upper bound of each loop() latency bucket (the last one is open)
+static const uint32_t BUCKET_LIMITS_US[DIAG_LOOP_BUCKETS - 1] = {
+  1000, 2000, 5000, 10000, 20000, 50000, 100000, 500000
+};
+
+static const char* const BUCKET_NAMES[DIAG_LOOP_BUCKETS] = {
+  "<1ms", "<2ms", "<5ms", "<10ms", "<20ms", "<50ms", "<100ms", "<500ms", ">=500ms"
+};
+
+// ==================== HELPERS ====================
+
+static const char* resetReasonName(esp_reset_reason_t reason) {
+  switch (reason) {
+    case ESP_RST_POWERON:   return "power_on";
+    case ESP_RST_EXT:       return "external";
+    case ESP_RST_SW:        return "software";
+    case ESP_RST_PANIC:     return "panic";
+    case ESP_RST_INT_WDT:   return "int_wdt";
+    case ESP_RST_TASK_WDT:  return "task_wdt";
+    case ESP_RST_WDT:       return "wdt";
+    case ESP_RST_DEEPSLEEP: return "deep_sleep";
+    case ESP_RST_BROWNOUT:  return "brownout";
+    default:                return "unknown";
+  }
+}
+
+static void sampleMemory() {
+  memory.heapTotal = heap_caps_get_total_size(MALLOC_CAP_INTERNAL);
+  memory.heapFree = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+  memory.heapMinFree = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
+  memory.heapLargestBlock = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
+  memory.psramTotal = heap_caps_get_total_size(MALLOC_CAP_SPIRAM);
+  memory.psramFree = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+  memory.psramMinFree = heap_caps_get_minimum_free_size(MALLOC_CAP_SPIRAM);
+}
+
+/**
+ * Stall bookkeeping for one task (sampler)
+ */
+static void checkHeartbeat(DiagTask id, DiagTaskState& t, unsigned long now) {
+  if (t.info.stallMs == 0 || !t.beating.load()) return;
+
+  unsigned long silent = now - t.lastBeatMs.load();
+  t.info.sinceBeatMs = silent;
+
+  if (silent > t.info.stallMs) {
+    if (!t.info.stalled) {
+      t.info.stalled = true;
+      t.info.stalls++;
+      stallReported = true;
+      LOG_W("DIAG", "%s stalled - no heartbeat for %lums", t.info.name, silent);
+    }
+    // Named in the next boot's report if the watchdog fires
+    stallRecord.magic = DIAG_STALL_MAGIC;
+    stallRecord.task = id;
+    stallRecord.stalledMs = silent;
+  } else if (t.info.stalled) {
+    t.info.stalled = false;
+    if (stallRecord.magic == DIAG_STALL_MAGIC && stallRecord.task == id) stallRecord.magic = 0;
+    LOG_I("DIAG", "%s recovered", t.info.name);
+  }
+}
+
+/**
+ * Timer callback: stacks, busy time, stalls, memory
+ */
+static void sample(TimerHandle_t timer) {
+  unsigned long now = millis();
+  unsigned long nowUs = micros();
+  uint32_t windowUs = nowUs - lastSampleUs;
+  lastSampleUs = nowUs;
+
+  for (int i = 0; i < DIAG_TASK_COUNT; i++) {
+    DiagTaskState& t = tasks[i];
+    if (t.info.name == NULL) continue;
+
+    checkHeartbeat((DiagTask)i, t, now);
+
+    // Tasks we do not create (log drain, AsyncTCP) are found by name once they exist
+    if (t.handle == NULL) t.handle = xTaskGetHandle(t.info.name);
+    if (t.handle == NULL) continue;
+    t.info.found = true;
+
+    t.info.stackFreeMin = uxTaskGetStackHighWaterMark(t.handle);  // Bytes on ESP-IDF
+
+    uint32_t busy = t.busyUs.load();
+    uint32_t pct = windowUs ? (uint32_t)((uint64_t)(busy - t.sampledBusyUs) * 100 / windowUs) : 0;
+    t.sampledBusyUs = busy;
+    t.info.busyPct = pct > 100 ? 100 : pct;
+    if (t.info.busyPct > t.info.busyPeakPct) t.info.busyPeakPct = t.info.busyPct;
+  }
+
+  sampleMemory();
+}
+
+// ==================== MONITOR FUNCTIONS ====================
+
+void diagWatch(DiagTask task, const char* name, uint32_t stackBytes, uint32_t stallMs) {
+  DiagTaskInfo& info = tasks[task].info;
+  info.name = name;
+  info.stackBytes = stackBytes;
+  info.stallMs = stallMs;
+}
+
+void diagInit() {
+  esp_reset_reason_t reason = esp_reset_reason();
+  resetInfo.reason = resetReasonName(reason);
+  if (reason == ESP_RST_TASK_WDT && stallRecord.magic == DIAG_STALL_MAGIC && stallRecord.task < DIAG_TASK_COUNT) {
+    const char* name = tasks[stallRecord.task].info.name;
+    resetInfo.stalledTask = name ? name : "?";
+    resetInfo.stalledMs = stallRecord.stalledMs;
+    LOG_W("DIAG", "Previous run reset by the task watchdog - %s stalled %lums",
+          resetInfo.stalledTask, resetInfo.stalledMs);
+  }
+  stallRecord.magic = 0;
+
+  // Already running from the Arduino core: ESP-IDF 4.x updates timeout + panic in place
+  esp_task_wdt_init(DIAG_WDT_TIMEOUT_S, true);
+
+  sampleMemory();
+  lastSampleUs = micros();
+  sampleTimer = xTimerCreate("diag", pdMS_TO_TICKS(DIAG_SAMPLE_MS), pdTRUE, NULL, sample);
+  xTimerStart(sampleTimer, 0);
+}
+
+void diagTaskStarted(DiagTask task, bool watchdog) {
+  DiagTaskState& t = tasks[task];
+  t.handle = xTaskGetCurrentTaskHandle();
+  if (watchdog && esp_task_wdt_add(NULL) == ESP_OK) t.info.watchdog = true;
+  diagBeat(task);
+}
+
+void diagBeat(DiagTask task) {
+  DiagTaskState& t = tasks[task];
+  unsigned long now = millis();
+  unsigned long lastBeat = t.lastBeatMs.exchange(now);
+
+  if (t.beating.exchange(true) && now - lastBeat > t.info.longestGapMs) t.info.longestGapMs = now - lastBeat;
+  t.busyStartUs = micros();
+  if (t.info.watchdog) esp_task_wdt_reset();
+}
+
+void diagIdle(DiagTask task) {
+  DiagTaskState& t = tasks[task];
+  uint32_t us = micros() - t.busyStartUs;
+  t.busyUs += us;
+
+  if (task != DIAG_TASK_LOOP) return;
+
+  int b = 0;
+  while (b < DIAG_LOOP_BUCKETS - 1 && us >= BUCKET_LIMITS_US[b]) b++;
+  loopStats.histogram[b]++;
+  loopStats.iterations++;
+  if (us > loopStats.maxUs) loopStats.maxUs = us;
+}
+
+void diagLoopSection(DiagSection section, uint32_t us) {
+  if (us > loopStats.sectionMaxUs[section]) loopStats.sectionMaxUs[section] = us;
+}
+
+bool diagPublishDue(unsigned long now) {
+  static unsigned long lastPublish = 0;
+  if (stallReported.exchange(false) || now - lastPublish >= DIAG_PUBLISH_MS) {
+    lastPublish = now;
+    return true;
+  }
+  return false;
+}
+
+DiagTaskInfo diagGetTask(DiagTask task) {
+  return tasks[task].info;
+}
+
+DiagLoopStats diagGetLoop() {
+  return loopStats;
+}
+
+DiagMemory diagGetMemory() {
+  return memory;
+}
+
+DiagResetInfo diagGetReset() {
+  return resetInfo;
+}
+
+const char* diagSectionName(DiagSection section) {
+  return section < DIAG_SECTION_COUNT ? SECTION_NAMES[section] : "?";
+}
+
+const char* diagBucketName(int bucket) {
+  return (bucket >= 0 && bucket < DIAG_LOOP_BUCKETS) ? BUCKET_NAMES[bucket] : "?";
+}
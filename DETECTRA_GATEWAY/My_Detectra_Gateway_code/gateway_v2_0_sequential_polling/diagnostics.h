@@ -0,0 +1,200 @@
+/**
+ * DETECTRA Gateway v2.0 - Task Health Monitor
+ *
+ * Tracks every long-lived task and loop() so stacks can be sized from
+ * measurements and blocking paths show up before they become outages.
+ *
+ * - Heartbeats: a task calls diagBeat() at the top of each iteration and
+ *   diagIdle() right before it blocks. A task without a beat for longer
+ *   than its stall limit is reported as stalled (log + immediate diag
+ *   publish). Tasks started with watchdog=true are also subscribed to the
+ *   ESP task watchdog, fed by diagBeat(): a stall that lasts
+ *   DIAG_WDT_TIMEOUT_S resets the gateway, and the stalled task is named
+ *   in the next boot's report (kept in RTC memory).
+ * - Stack high-water marks: least free stack ever, per task.
+ * - Busy time: share of each sample window a task spent between diagBeat()
+ *   and diagIdle(). This includes delay() calls made inside the loop body,
+ *   which is what matters for finding blocking paths.
+ * - loop() latency: histogram of iteration times plus the slowest run of
+ *   each timed section (DiagScope).
+ * - Heap / PSRAM: free, minimum free and largest block.
+ *
+ * Sampling runs in a FreeRTOS timer, not in a monitored task, so it still
+ * runs when loop() hangs.
+ *
+ * Usage:
+ *   diagWatch(DIAG_TASK_POLLING, "PollingTask", POLLING_TASK_STACK, DIAG_STALL_POLLING_MS);
+ *   diagInit();
+ *
+ *   // in the task
+ *   diagTaskStarted(DIAG_TASK_POLLING, true);
+ *   while (true) {
+ *     diagBeat(DIAG_TASK_POLLING);
+ *     ...
+ *     diagIdle(DIAG_TASK_POLLING);
+ *     vTaskDelay(...);
+ *   }
+ */
+
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <Arduino.h>
+
+// ==================== CONFIGURATION ====================
+
+#define DIAG_SAMPLE_MS          1000          // Stack / busy / stall sampling period
+#define DIAG_PUBLISH_MS         60000         // Periodic MQTT diag report
+#define DIAG_WDT_TIMEOUT_S      30            // Task watchdog: stall -> reset
+
+#define DIAG_STALL_LOOP_MS      5000          // Heartbeat limits (0 = not monitored)
+#define DIAG_STALL_LORA_MS      2000
+#define DIAG_STALL_POLLING_MS   10000         // Includes the 4 s retry backoff
+#define DIAG_STALL_LORA_TX_MS   5000          // Longest frame + TXP2P DONE margin + busy retries
+#define DIAG_STALL_UI_MS        5000          // Wakes at least every second
+
+#define DIAG_LOOP_BUCKETS       9             // <1, <2, <5, <10, <20, <50, <100, <500, >=500 ms
+
+// ==================== DATA STRUCTURES ====================
+
+enum DiagTask : uint8_t {
+  DIAG_TASK_LOOP,           // Arduino loopTask (MQTT, WebSocket, registry, publishes)
+  DIAG_TASK_LORA,           // UART RX + message handling (core 0)
+  DIAG_TASK_POLLING,        // Polling state machine (core 1)
+  DIAG_TASK_LOG,            // Log drain
+  DIAG_TASK_ASYNC_TCP,      // Web server / WebSocket callbacks
+  DIAG_TASK_LORA_TX,        // Radio 1 TX scheduler (core 0)
+  DIAG_TASK_UI,             // OLED, NeoPixel and buzzer (core 1)
+  DIAG_TASK_COUNT
+};
+
+enum DiagSection : uint8_t {
+  DIAG_SECTION_MQTT,        // mqttReconnect() + mqttClient.loop()
+  DIAG_SECTION_OUTBOX,      // outboxFlush()
+  DIAG_SECTION_WS,          // cleanupClients() + wsService()
+  DIAG_SECTION_REGISTRY,    // registryService() (NVS write)
+  DIAG_SECTION_PUBLISH,     // Periodic status / coordination / diag publishes
+  DIAG_SECTION_COUNT
+};
+
+/**
+ * One monitored task
+ */
+struct DiagTaskInfo {
+  const char* name;                 // FreeRTOS task name
+  bool found;                       // Task exists (handle resolved)
+  bool watchdog;                    // Subscribed to the task watchdog
+  bool stalled;                     // No heartbeat for more than stallMs
+  uint32_t stackBytes;              // Configured stack (0 = unknown)
+  uint32_t stackFreeMin;            // High-water mark: least free stack ever (bytes)
+  uint32_t stallMs;                 // Heartbeat limit (0 = no heartbeat expected)
+  uint32_t stalls;                  // Stalls since boot
+  uint32_t sinceBeatMs;             // Time since the last heartbeat
+  uint32_t longestGapMs;            // Longest time between two heartbeats
+  uint8_t busyPct;                  // Last sample window
+  uint8_t busyPeakPct;              // Highest window since boot
+};
+
+/**
+ * loop() iteration latency
+ */
+struct DiagLoopStats {
+  uint32_t iterations;
+  uint32_t maxUs;
+  uint32_t histogram[DIAG_LOOP_BUCKETS];
+  uint32_t sectionMaxUs[DIAG_SECTION_COUNT];
+};
+
+/**
+ * Heap and PSRAM (bytes)
+ */
+struct DiagMemory {
+  uint32_t heapTotal;
+  uint32_t heapFree;
+  uint32_t heapMinFree;
+  uint32_t heapLargestBlock;
+  uint32_t psramTotal;              // 0 = no PSRAM
+  uint32_t psramFree;
+  uint32_t psramMinFree;
+};
+
+/**
+ * Why the previous run ended
+ */
+struct DiagResetInfo {
+  const char* reason;               // "power_on", "task_wdt", "panic", ...
+  const char* stalledTask;          // Task stalled when the watchdog fired (NULL = none)
+  uint32_t stalledMs;
+};
+
+// ==================== MONITOR FUNCTIONS ====================
+
+/**
+ * Declare a task to monitor (before diagInit; the handle is looked up by name)
+ *
+ * @param stallMs Heartbeat limit, 0 for tasks without diagBeat() calls
+ */
+void diagWatch(DiagTask task, const char* name, uint32_t stackBytes, uint32_t stallMs);
+
+/**
+ * Configure the task watchdog and start the sampling timer
+ */
+void diagInit();
+
+/**
+ * Called once from inside the task (resolves the handle, optional watchdog)
+ */
+void diagTaskStarted(DiagTask task, bool watchdog);
+
+/**
+ * Heartbeat at the top of each iteration (also feeds the watchdog)
+ */
+void diagBeat(DiagTask task);
+
+/**
+ * End of the iteration's work, right before the task blocks
+ * For DIAG_TASK_LOOP the iteration also goes into the latency histogram.
+ */
+void diagIdle(DiagTask task);
+
+/**
+ * Record one run of a loop() section
+ */
+void diagLoopSection(DiagSection section, uint32_t us);
+
+/**
+ * True when the MQTT diag report is due (periodic, or a task just stalled)
+ */
+bool diagPublishDue(unsigned long now);
+
+/**
+ * Current values
+ */
+DiagTaskInfo diagGetTask(DiagTask task);
+DiagLoopStats diagGetLoop();
+DiagMemory diagGetMemory();
+DiagResetInfo diagGetReset();
+
+/**
+ * Labels for reports
+ */
+const char* diagSectionName(DiagSection section);
+const char* diagBucketName(int bucket);
+
+/**
+ * Times one loop() section for the lifetime of the scope
+ */
+class DiagScope {
+public:
+  explicit DiagScope(DiagSection section) : section(section), startUs(micros()) {}
+  ~DiagScope() { diagLoopSection(section, micros() - startUs); }
+
+  DiagScope(const DiagScope&) = delete;
+  DiagScope& operator=(const DiagScope&) = delete;
+
+private:
+  DiagSection section;
+  unsigned long startUs;
+};
+
+#endif // DIAGNOSTICS_H
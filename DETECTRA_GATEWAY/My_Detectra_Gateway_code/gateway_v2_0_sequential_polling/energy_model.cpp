@@ -0,0 +1,283 @@
+/**
+ * DETECTRA Gateway v2.0 - Energy Model Implementation
+ */
+
+#include "energy_model.h"
+#include "log.h"
+#include <math.h>
+
+static const EnergyPlan PLANS[ENERGY_LEVELS] = {
+  { 0, 1, POLL_POSITIONS, false },
+  { 1, 2, POLL_POSITIONS, true },
+  { 2, 2, 3, true },
+  { 3, 4, 3, true },
+  { 4, 4, 1, true },
+  { 5, 8, 1, true }
+};
+
+/**
+ * Per-device state. Least-squares sums are over samples of
+ *   drop % = idle x hours + cost x awake seconds
+ * and decay with age.
+ */
+struct EnergyModel {
+  FixedString<NODE_ID_MAX> deviceId;  // Empty = free slot
+  unsigned long lastUsedMs;
+
+  // Battery trend
+  int8_t battery;                     // Reading the next sample starts from (-1 none)
+  unsigned long batteryMs;
+  float awakeS;                       // Awake seconds since batteryMs
+  uint16_t samples;
+
+  // Decayed sums (t = hours, a = awake s, d = drop %)
+  float tt, ta, aa, td, ad;
+  float idle;                         // %/h
+  float cost;                         // %/awake s
+
+  // Age of the charge: used fraction at the start + hours since
+  float startUsed;
+  float hoursSinceStart;
+  unsigned long hoursRefMs;
+
+  // Phase timing (EWMA)
+  float overheadMs;
+  float perPositionMs;
+
+  uint8_t level;
+};
+
+static EnergyModel models[ENERGY_MAX_DEVICES];
+static uint16_t targetDays = ENERGY_TARGET_DAYS;
+static SemaphoreHandle_t energyLock = NULL;
+
+// ==================== MODELS ====================
+
+static EnergyModel* findModel(const char* deviceId) {
+  for (int i = 0; i < ENERGY_MAX_DEVICES; i++) {
+    if (!models[i].deviceId.isEmpty() && models[i].deviceId == deviceId) return &models[i];
+  }
+  return NULL;
+}
+
+static EnergyModel* findOrCreateModel(const char* deviceId, unsigned long now) {
+  EnergyModel* model = findModel(deviceId);
+  if (model != NULL) return model;
+
+  // Free slot, else the model not used for longest (a removed device)
+  int slot = 0;
+  for (int i = 0; i < ENERGY_MAX_DEVICES; i++) {
+    if (models[i].deviceId.isEmpty()) { slot = i; break; }
+    if (now - models[i].lastUsedMs > now - models[slot].lastUsedMs) slot = i;
+  }
+
+  model = &models[slot];
+  *model = EnergyModel();
+  model->deviceId = deviceId;
+  model->battery = -1;
+  model->idle = ENERGY_PRIOR_IDLE;
+  model->cost = ENERGY_PRIOR_COST;
+  model->overheadMs = ENERGY_INIT_OVERHEAD_MS;
+  model->perPositionMs = ENERGY_INIT_POSITION_MS;
+  model->hoursRefMs = now;
+  return model;
+}
+
+static void fit(EnergyModel& m) {
+  // Ridge towards the priors: [tt+li ta; ta aa+lc] [idle cost]' = [td+li*i0 ad+lc*c0]'
+  const float li = ENERGY_PRIOR_SAMPLES;
+  const float lc = ENERGY_PRIOR_SAMPLES * ENERGY_PRIOR_AWAKE_S * ENERGY_PRIOR_AWAKE_S;
+
+  float a = m.tt + li;
+  float b = m.ta;
+  float c = m.aa + lc;
+  float r1 = m.td + li * ENERGY_PRIOR_IDLE;
+  float r2 = m.ad + lc * ENERGY_PRIOR_COST;
+  float det = a * c - b * b;
+  if (det <= 0.0f) return;
+
+  float idle = (r1 * c - b * r2) / det;
+  float cost = (a * r2 - b * r1) / det;
+
+  // Readings that rise with noise must not project an endless battery
+  m.idle = (idle > ENERGY_PRIOR_IDLE / 100) ? idle : ENERGY_PRIOR_IDLE / 100;
+  m.cost = (cost > ENERGY_PRIOR_COST / 100) ? cost : ENERGY_PRIOR_COST / 100;
+}
+
+// ==================== PROJECTION ====================
+
+static float targetHours() {
+  return targetDays * 24.0f;
+}
+
+static float remainingHours(const EnergyModel& m, unsigned long now) {
+  float age = m.startUsed * targetHours() + m.hoursSinceStart + (now - m.hoursRefMs) / 3600000.0f;
+  float remaining = targetHours() - age;
+  return (remaining > ENERGY_MIN_REMAINING_H) ? remaining : ENERGY_MIN_REMAINING_H;
+}
+
+static float awakeMsAt(const EnergyModel& m, const EnergyPlan& plan) {
+  return m.overheadMs + plan.positions * m.perPositionMs;
+}
+
+static float drainPerHourAt(const EnergyModel& m, const EnergyPlan& plan, uint32_t baseCadenceMs) {
+  float cadenceH = (float)baseCadenceMs * plan.cadenceStretch / 3600000.0f;
+  float pollsPerHour = (cadenceH > 0.0f) ? 1.0f / cadenceH : 0.0f;
+  return m.idle + m.cost * awakeMsAt(m, plan) / 1000.0f * pollsPerHour;
+}
+
+static float timeToEmptyAt(const EnergyModel& m, const EnergyPlan& plan, uint32_t baseCadenceMs) {
+  if (m.battery < 0) return -1.0f;
+  return m.battery / drainPerHourAt(m, plan, baseCadenceMs);
+}
+
+static uint8_t chooseLevel(const EnergyModel& m, uint32_t baseCadenceMs, unsigned long now) {
+  if (targetDays == 0 || m.battery < 0) return 0;
+
+  float remaining = remainingHours(m, now);
+
+  uint8_t level = ENERGY_LEVELS - 1;
+  for (uint8_t l = 0; l < ENERGY_LEVELS; l++) {
+    if (timeToEmptyAt(m, PLANS[l], baseCadenceMs) >= remaining) { level = l; break; }
+  }
+
+  // Stepping down (more service) needs margin, so a device does not flap between levels
+  float margin = remaining * (100 + ENERGY_HYSTERESIS_PCT) / 100.0f;
+  while (level < m.level && timeToEmptyAt(m, PLANS[level], baseCadenceMs) < margin) level++;
+
+  if (m.battery <= ENERGY_LOW_BATTERY && level < ENERGY_LOW_LEVEL) level = ENERGY_LOW_LEVEL;
+  return level;
+}
+
+// ==================== ENERGY FUNCTIONS ====================
+
+void energyInit(uint16_t days) {
+  energyLock = xSemaphoreCreateMutex();
+  targetDays = (days > ENERGY_MAX_TARGET_DAYS) ? ENERGY_MAX_TARGET_DAYS : days;
+  LOG_I("ENERGY", "Battery-life target: %u days%s", targetDays, targetDays == 0 ? " (off)" : "");
+}
+
+void energySetTargetDays(uint16_t days) {
+  xSemaphoreTake(energyLock, portMAX_DELAY);
+  targetDays = (days > ENERGY_MAX_TARGET_DAYS) ? ENERGY_MAX_TARGET_DAYS : days;
+  xSemaphoreGive(energyLock);
+}
+
+uint16_t energyGetTargetDays() {
+  return targetDays;
+}
+
+void energyRecordBattery(const DeviceInfo& device, unsigned long now) {
+  if (device.battery < 0) return;
+
+  xSemaphoreTake(energyLock, portMAX_DELAY);
+
+  EnergyModel& m = *findOrCreateModel(device.deviceId.c_str(), now);
+  m.lastUsedMs = now;
+
+  if (m.battery < 0 || device.battery >= m.battery + ENERGY_CHARGE_JUMP) {
+    // First reading / charged: the charge's age restarts from this level
+    if (m.battery >= 0) LOG_I("ENERGY", "%s charged: %d%% -> %d%%", device.deviceId, m.battery, device.battery);
+    m.battery = device.battery;
+    m.batteryMs = now;
+    m.awakeS = 0.0f;
+    m.startUsed = (100 - device.battery) / 100.0f;
+    m.hoursSinceStart = 0.0f;
+    m.hoursRefMs = now;
+    xSemaphoreGive(energyLock);
+    return;
+  }
+
+  if (now - m.batteryMs < ENERGY_MIN_SAMPLE_MS) {
+    xSemaphoreGive(energyLock);
+    return;
+  }
+
+  float t = (now - m.batteryMs) / 3600000.0f;
+  float a = m.awakeS;
+  float d = (float)(m.battery - device.battery);
+
+  float keep = expf(-t / ENERGY_MEMORY_H);
+  m.tt = m.tt * keep + t * t;
+  m.ta = m.ta * keep + t * a;
+  m.aa = m.aa * keep + a * a;
+  m.td = m.td * keep + t * d;
+  m.ad = m.ad * keep + a * d;
+  m.samples++;
+  fit(m);
+
+  // Fold the elapsed time in (millis() wraps long before a 365-day target)
+  m.hoursSinceStart += (now - m.hoursRefMs) / 3600000.0f;
+  m.hoursRefMs = now;
+
+  m.battery = device.battery;
+  m.batteryMs = now;
+  m.awakeS = 0.0f;
+
+  LOG_D("ENERGY", "%s sample %u: %.2fh, %.0fs awake, -%.0f%% -> idle %.3f%%/h, cost %.4f%%/s",
+        device.deviceId, m.samples, t, a, d, m.idle, m.cost);
+
+  xSemaphoreGive(energyLock);
+}
+
+void energyRecordPoll(DeviceInfo& device, uint32_t baseCadenceMs,
+                      unsigned long awakeMs, unsigned long collectMs, unsigned long now) {
+  xSemaphoreTake(energyLock, portMAX_DELAY);
+
+  EnergyModel& m = *findOrCreateModel(device.deviceId.c_str(), now);
+  m.lastUsedMs = now;
+  m.awakeS += awakeMs / 1000.0f;
+
+  if (device.positionsReceived > 0 && collectMs <= awakeMs) {
+    float perPosition = (float)collectMs / device.positionsReceived;
+    float overhead = (float)(awakeMs - collectMs);
+    m.perPositionMs += (perPosition - m.perPositionMs) * ENERGY_EWMA_WEIGHT;
+    m.overheadMs += (overhead - m.overheadMs) * ENERGY_EWMA_WEIGHT;
+  }
+
+  uint8_t level = chooseLevel(m, baseCadenceMs, now);
+  if (level != m.level) {
+    LOG_I("ENERGY", "%s level %u -> %u (battery %d%%, %.1f days projected, %.1f days to target)",
+          device.deviceId, m.level, level, m.battery,
+          timeToEmptyAt(m, PLANS[level], baseCadenceMs) / 24.0f, remainingHours(m, now) / 24.0f);
+    m.level = level;
+  }
+
+  device.cadenceStretch = PLANS[m.level].cadenceStretch;
+  device.positionsRequested = PLANS[m.level].positions;
+
+  xSemaphoreGive(energyLock);
+}
+
+EnergyPlan energyCurrentPlan(const char* deviceId) {
+  xSemaphoreTake(energyLock, portMAX_DELAY);
+  const EnergyModel* m = findModel(deviceId);
+  EnergyPlan plan = PLANS[m != NULL ? m->level : 0];
+  xSemaphoreGive(energyLock);
+  return plan;
+}
+
+bool energyGetInfo(const char* deviceId, uint32_t baseCadenceMs, unsigned long now, EnergyInfo& out) {
+  xSemaphoreTake(energyLock, portMAX_DELAY);
+
+  const EnergyModel* found = findModel(deviceId);
+  if (found == NULL) {
+    xSemaphoreGive(energyLock);
+    return false;
+  }
+
+  const EnergyModel& m = *found;
+  out.deviceId = m.deviceId;
+  out.plan = PLANS[m.level];
+  out.battery = m.battery;
+  out.samples = m.samples;
+  out.idlePctPerHour = m.idle;
+  out.costPctPerAwakeS = m.cost;
+  out.awakeMs = (uint32_t)awakeMsAt(m, out.plan);
+  out.drainPctPerDay = drainPerHourAt(m, out.plan, baseCadenceMs) * 24.0f;
+  out.timeToEmptyH = timeToEmptyAt(m, out.plan, baseCadenceMs);
+  out.remainingTargetH = (targetDays == 0 || m.battery < 0) ? -1.0f : remainingHours(m, now);
+
+  xSemaphoreGive(energyLock);
+  return true;
+}
@@ -0,0 +1,138 @@
+/**
+ * DETECTRA Gateway v2.0 - Energy Model (battery-aware polling)
+ *
+ * Learns how fast each device drains its battery and picks a polling plan
+ * that makes the battery last a target time (ENERGY_TARGET_DAYS from the
+ * last charge):
+ *
+ *   drain %/h = idle %/h  +  cost %/awake-s  x  awake s per poll  x  polls/h
+ *
+ * - idle and cost are fitted per device by least squares over the battery
+ *   readings of ACK ONLINE (ridge towards ENERGY_PRIOR_* so two readings
+ *   give a usable estimate, older samples fade over ENERGY_MEMORY_H).
+ * - awake s per poll = overhead + positions x time per position, both
+ *   measured on every poll (POLL to FINALIZED, DATA_COLLECTION).
+ *
+ * Plans trade service for battery life, in steps:
+ *
+ *   level  cadence  positions  SLEEP window
+ *     0      x1         5          -
+ *     1      x2         5         yes
+ *     2      x2         3         yes
+ *     3      x4         3         yes
+ *     4      x4         1         yes
+ *     5      x8         1         yes
+ *
+ * After each poll the lowest level whose projected time-to-empty reaches
+ * the target is chosen (stepping back down needs ENERGY_HYSTERESIS_PCT of
+ * margin). The SLEEP window ("wake_<s>") is not in the projection; the
+ * saving shows up in the learned idle rate instead.
+ *
+ * Models live in RAM and are relearned from the priors after a reboot.
+ *
+ * Usage:
+ *   energyInit(config.energyTargetDays);
+ *   energyRecordBattery(device, millis());                 // ACK ONLINE
+ *   energyRecordPoll(device, scheduleBaseCadenceMs(device), awakeMs, collectMs, millis());
+ *   EnergyPlan plan = energyCurrentPlan(device.deviceId.c_str());       // FINALIZED -> SLEEP
+ */
+
+#ifndef ENERGY_MODEL_H
+#define ENERGY_MODEL_H
+
+#include <Arduino.h>
+#include "lora_protocol.h"
+
+// ==================== CONFIGURATION ====================
+
+#define ENERGY_TARGET_DAYS        30        // Default battery-life target (0 = always full service)
+#define ENERGY_MAX_TARGET_DAYS    365
+#define ENERGY_MAX_DEVICES        32        // Models (keyed by device ID)
+#define ENERGY_LEVELS             6
+#define ENERGY_MIN_REMAINING_H    48        // Past the target date, plan for at least two more days
+#define ENERGY_HYSTERESIS_PCT     10        // Step down only if the projection beats the target by 10 %
+#define ENERGY_LOW_BATTERY        10        // At or below: level ENERGY_LOW_LEVEL or higher
+#define ENERGY_LOW_LEVEL          4
+#define ENERGY_CHARGE_JUMP        5         // Battery up by this much = charged
+#define ENERGY_MIN_SAMPLE_MS      600000UL  // Readings closer than 10 min are merged
+#define ENERGY_MEMORY_H           72.0f     // Sample weight falls by 1/e every 72 h
+#define ENERGY_PRIOR_IDLE         0.04f     // %/h (about 100 days on standby)
+#define ENERGY_PRIOR_COST         0.0001f   // % per awake second (priors: 5-min polls, 60 s awake = 37 days)
+#define ENERGY_PRIOR_AWAKE_S      60.0f     // Nominal sample for the prior weight: 1 h, 60 s awake
+#define ENERGY_PRIOR_SAMPLES      2.0f      // Prior counts as this many nominal samples
+#define ENERGY_INIT_OVERHEAD_MS   20000     // Awake time outside DATA_COLLECTION, until measured
+#define ENERGY_INIT_POSITION_MS   8000      // Per position, until measured
+#define ENERGY_EWMA_WEIGHT        0.125f    // Phase timing average: 1/8 per poll
+#define ENERGY_WAKE_GUARD_MS      30000     // Radio back on this long before the earliest next poll
+
+// ==================== DATA STRUCTURES ====================
+
+/**
+ * What the gateway asks of a device (one level)
+ */
+struct EnergyPlan {
+  uint8_t level;
+  uint8_t cadenceStretch;           // Multiplies the schedule cadence
+  uint8_t positions;                // START_INFER "pos_N" (POLL_POSITIONS = full scan)
+  bool sleepWindow;                 // SLEEP "wake_<s>": radio may be off until the next poll
+};
+
+/**
+ * One device's model and projection (GET /api/energy, MQTT)
+ */
+struct EnergyInfo {
+  FixedString<NODE_ID_MAX> deviceId;
+  EnergyPlan plan;
+  int8_t battery;                   // Last reading (-1 unknown)
+  uint16_t samples;                 // Battery samples fitted since boot
+  float idlePctPerHour;
+  float costPctPerAwakeS;
+  uint32_t awakeMs;                 // Predicted awake time per poll at this plan
+  float drainPctPerDay;             // Projected at this plan
+  float timeToEmptyH;               // Projected at this plan (-1 unknown)
+  float remainingTargetH;           // Until the target date (-1 = management off)
+};
+
+// ==================== ENERGY FUNCTIONS ====================
+
+/**
+ * Set the battery-life target (call once in setup)
+ */
+void energyInit(uint16_t targetDays);
+
+/**
+ * Change the target (0 = always full service); plans follow at each device's next poll
+ */
+void energySetTargetDays(uint16_t days);
+uint16_t energyGetTargetDays();
+
+/**
+ * Fold a battery reading into the device's model (device.battery already set)
+ */
+void energyRecordBattery(const DeviceInfo& device, unsigned long now);
+
+/**
+ * Record a finished poll and choose the next plan
+ *
+ * Writes device.cadenceStretch and device.positionsRequested.
+ *
+ * @param baseCadenceMs Schedule cadence without the stretch
+ * @param awakeMs POLL (or START_INFER for census responders) to FINALIZED
+ * @param collectMs DATA_COLLECTION duration
+ */
+void energyRecordPoll(DeviceInfo& device, uint32_t baseCadenceMs,
+                      unsigned long awakeMs, unsigned long collectMs, unsigned long now);
+
+/**
+ * Plan chosen at the device's last poll (full service without a model)
+ */
+EnergyPlan energyCurrentPlan(const char* deviceId);
+
+/**
+ * Current model and projection
+ *
+ * @return false if the device has no model yet
+ */
+bool energyGetInfo(const char* deviceId, uint32_t baseCadenceMs, unsigned long now, EnergyInfo& out);
+
+#endif // ENERGY_MODEL_H
@@ -0,0 +1,95 @@
+/**
+ * DETECTRA Gateway v2.0 - Fixed-Capacity Inline Strings
+ *
+ * Bounded character buffer stored inline in its owning struct.
+ * Assignment copies into the buffer (truncating at capacity) and never
+ * touches the heap, so DeviceInfo / LoRaMessage updates and copies are
+ * plain memcpy instead of String reallocations.
+ *
+ * Usage:
+ *   FixedString<DEVICE_ID_MAX> id = "ED0-00001";
+ *   if (id == msg.senderId) { ... }
+ *   doc["device_id"] = id.c_str();
+ */
+
+#ifndef FIXED_STRING_H
+#define FIXED_STRING_H
+
+#include <Arduino.h>
+
+template <size_t N>
+struct FixedString {
+  static_assert(N > 0 && N <= 65535, "FixedString capacity must fit in uint16_t");
+
+  char buf[N + 1];
+  uint16_t len;
+
+  FixedString() { clear(); }
+  FixedString(const char* s) { assign(s); }
+  FixedString(const String& s) { assign(s.c_str(), s.length()); }
+
+  static constexpr size_t capacity() { return N; }
+
+  void clear() {
+    buf[0] = '\0';
+    len = 0;
+  }
+
+  /**
+   * Copy at most N characters of s
+   *
+   * @return false if s was truncated
+   */
+  bool assign(const char* s, size_t n) {
+    bool fits = (n <= N);
+    if (!fits) n = N;
+    if (n > 0) memcpy(buf, s, n);
+    buf[n] = '\0';
+    len = (uint16_t)n;
+    return fits;
+  }
+
+  bool assign(const char* s) { return assign(s, s ? strlen(s) : 0); }
+
+  FixedString& operator=(const char* s) { assign(s); return *this; }
+  FixedString& operator=(const String& s) { assign(s.c_str(), s.length()); return *this; }
+
+  const char* c_str() const { return buf; }
+  size_t length() const { return len; }
+  bool isEmpty() const { return len == 0; }
+
+  bool equals(const char* s, size_t n) const {
+    return len == n && memcmp(buf, s, n) == 0;
+  }
+
+  bool operator==(const char* s) const { return s && strcmp(buf, s) == 0; }
+  bool operator==(const String& s) const { return equals(s.c_str(), s.length()); }
+  template <size_t M>
+  bool operator==(const FixedString<M>& o) const { return equals(o.buf, o.len); }
+
+  bool operator!=(const char* s) const { return !(*this == s); }
+  bool operator!=(const String& s) const { return !(*this == s); }
+  template <size_t M>
+  bool operator!=(const FixedString<M>& o) const { return !(*this == o); }
+
+  bool startsWith(const char* prefix) const {
+    return strncmp(buf, prefix, strlen(prefix)) == 0;
+  }
+};
+
+// String concatenation for log lines ("Device: " + device.deviceId)
+template <size_t N>
+String operator+(const String& a, const FixedString<N>& b) {
+  String r(a);
+  r += b.c_str();
+  return r;
+}
+
+template <size_t N>
+String operator+(const char* a, const FixedString<N>& b) {
+  String r(a);
+  r += b.c_str();
+  return r;
+}
+
+#endif // FIXED_STRING_H
@@ -0,0 +1,120 @@
+/**
+ * DETECTRA Gateway v2.0 - Fleet State Snapshots Implementation
+ */
+
+#include "fleet_snapshot.h"
+#include <atomic>
+
+static FleetSnapshot buffers[FLEET_BUFFERS];
+static std::atomic<uint8_t> pins[FLEET_BUFFERS];
+static std::atomic<uint8_t> current(0);
+
+static FleetFillFn fillFn = NULL;
+static SemaphoreHandle_t fleetMutex = NULL;
+static std::atomic<bool> writing(false);
+static std::atomic<bool> pending(false);
+
+static std::atomic<uint32_t> folded(0);
+static std::atomic<uint32_t> deferred(0);
+static std::atomic<uint32_t> readRetries(0);
+
+// ==================== HELPERS ====================
+
+/**
+ * Fill a spare buffer and make it current. Caller owns the writer flag.
+ *
+ * @return false if every spare buffer is pinned by a reader
+ */
+static bool writeSnapshot() {
+  uint8_t from = current.load();
+
+  // A buffer nobody has pinned. A reader that pins it after this check sees
+  // that it is not current, unpins and retries - so it is never read while written.
+  int target = -1;
+  for (int k = 1; k < FLEET_BUFFERS; k++) {
+    int i = (from + k) % FLEET_BUFFERS;
+    if (pins[i].load() == 0) {
+      target = i;
+      break;
+    }
+  }
+  if (target < 0) return false;
+
+  FleetSnapshot& next = buffers[target];
+  fleetLock();                      // No writer changes the fleet mid-copy
+  fillFn(next);
+  fleetUnlock();
+  next.version = buffers[from].version + 1;
+  next.publishedMs = millis();
+
+  current.store(target);
+  return true;
+}
+
+// ==================== SNAPSHOT FUNCTIONS ====================
+
+void fleetSnapshotInit(FleetFillFn fill) {
+  fillFn = fill;
+  fleetMutex = xSemaphoreCreateRecursiveMutex();
+  fleetPublish();
+}
+
+void fleetLock() {
+  xSemaphoreTakeRecursive(fleetMutex, portMAX_DELAY);
+}
+
+void fleetUnlock() {
+  xSemaphoreGiveRecursive(fleetMutex);
+}
+
+void fleetPublish() {
+  if (fillFn == NULL) return;
+
+  pending.store(true);
+  while (pending.load()) {
+    bool idle = false;
+    if (!writing.compare_exchange_strong(idle, true)) {
+      folded++;                     // The running writer sees pending and publishes again
+      return;
+    }
+
+    pending.store(false);
+    bool written = writeSnapshot();
+    if (!written) {
+      pending.store(true);
+      deferred++;
+    }
+    writing.store(false);
+
+    if (!written) return;           // fleetService() retries once a reader lets go
+  }
+}
+
+void fleetService() {
+  if (pending.load()) fleetPublish();
+}
+
+const FleetSnapshot* fleetAcquire() {
+  while (true) {
+    uint8_t i = current.load();
+    pins[i]++;
+    if (current.load() == i) return &buffers[i];
+
+    // A publish landed between the two loads - this buffer may be rewritten
+    pins[i]--;
+    readRetries++;
+  }
+}
+
+void fleetRelease(const FleetSnapshot* snapshot) {
+  pins[snapshot - buffers]--;
+}
+
+FleetSnapshotStats fleetSnapshotGetStats() {
+  FleetSnapshotStats stats;
+  stats.version = buffers[current.load()].version;
+  stats.folded = folded.load();
+  stats.deferred = deferred.load();
+  stats.readRetries = readRetries.load();
+  return stats;
+}
@@ -0,0 +1,157 @@
+/**
+ * DETECTRA Gateway v2.0 - Fleet State Snapshots
+ *
+ * devices[] and the polling state are written by the LoRa and polling
+ * tasks and by the pairing, removal and schedule web handlers (AsyncTCP),
+ * and read by the web handlers, loop() (MQTT status, WebSocket pushes,
+ * registry) and uiTask (display). Readers never look at the live globals;
+ * they get a published snapshot instead:
+ *
+ * - Writers change the live state under the fleet lock and call
+ *   fleetPublish() at phase boundaries. The fill callback copies the live
+ *   state into a buffer no reader holds, under the same lock, then the
+ *   buffer becomes current with one atomic store.
+ * - Readers pin the current buffer (FleetReader) and read it in place - no
+ *   copy, no lock. A pinned buffer is never rewritten, so every field of a
+ *   snapshot belongs to the same publish.
+ * - Readers never wait; a publish waits only for the fleet lock. A publish
+ *   that finds another one in progress is folded into it; one that finds
+ *   every spare buffer pinned is retried by fleetService().
+ *
+ * The fleet lock is recursive, so a writer can publish while holding it.
+ * pollingTask holds it for each service pass and lets go only to wait,
+ * loraTask for each received frame, and a web handler across its checks and
+ * the change (e.g. removal: busy check + shift), so no two of them interleave.
+ *
+ * FLEET_BUFFERS = current + one being written + one per concurrent reader
+ * task (AsyncTCP, loop and uiTask) = 5. A reader pins one buffer at a time.
+ *
+ * Usage:
+ *   fleetSnapshotInit(fillFleetSnapshot);   // after the registry is loaded
+ *   fleetPublish();                          // writer, after a state change
+ *
+ *   FleetLock lock;                          // writer, around check + change
+ *
+ *   FleetReader snapshot;                    // reader
+ *   display.print(snapshot->cycleDevices);
+ */
+
+#ifndef FLEET_SNAPSHOT_H
+#define FLEET_SNAPSHOT_H
+
+#include <Arduino.h>
+#include "lora_protocol.h"
+
+// ==================== CONFIGURATION ====================
+
+#define FLEET_MAX_DEVICES     16            // Snapshot capacity (>= MAX_DEVICES)
+#define FLEET_BUFFERS         5
+
+// ==================== DATA STRUCTURES ====================
+
+/**
+ * Fleet state as of one publish
+ */
+struct FleetSnapshot {
+  uint32_t version;                 // Publish count (0 = nothing published yet)
+  unsigned long publishedMs;
+
+  int numDevices;
+  DeviceInfo devices[FLEET_MAX_DEVICES];
+
+  // Polling state
+  bool pollingActive;
+  bool censusActive;
+  int currentDeviceIndex;           // Position in pollOrder[]
+  int pollOrder[FLEET_MAX_DEVICES];
+  int cycleDevices;
+  unsigned long pollingStartTime;
+
+  // Counters
+  unsigned long totalMessages;
+  unsigned long truncatedDetections;
+  unsigned long successfulPolls;
+  unsigned long failedPolls;
+};
+
+/**
+ * Copies the live state into a snapshot (version/publishedMs are set by the module)
+ * Called with the fleet lock held.
+ */
+typedef void (*FleetFillFn)(FleetSnapshot& snapshot);
+
+/**
+ * Snapshot counters (for status reports)
+ */
+struct FleetSnapshotStats {
+  uint32_t version;                 // Current snapshot
+  uint32_t folded;                  // Publishes merged into one already running
+  uint32_t deferred;                // Publishes postponed - all spare buffers pinned
+  uint32_t readRetries;             // Pins retried because a publish landed meanwhile
+};
+
+// ==================== SNAPSHOT FUNCTIONS ====================
+
+/**
+ * Set the fill callback, create the fleet lock and publish the first snapshot
+ */
+void fleetSnapshotInit(FleetFillFn fill);
+
+/**
+ * Take / release the fleet lock (prefer FleetLock; nests in the same task)
+ */
+void fleetLock();
+void fleetUnlock();
+
+/**
+ * Publish the current state (any task; blocks only for the fleet lock)
+ */
+void fleetPublish();
+
+/**
+ * Retry a deferred publish (call periodically from the polling task)
+ */
+void fleetService();
+
+/**
+ * Pin / unpin the current snapshot (prefer FleetReader)
+ */
+const FleetSnapshot* fleetAcquire();
+void fleetRelease(const FleetSnapshot* snapshot);
+
+/**
+ * Current counters
+ */
+FleetSnapshotStats fleetSnapshotGetStats();
+
+/**
+ * Scoped pin of the current snapshot
+ */
+class FleetReader {
+public:
+  FleetReader() : snapshot(fleetAcquire()) {}
+  ~FleetReader() { fleetRelease(snapshot); }
+
+  FleetReader(const FleetReader&) = delete;
+  FleetReader& operator=(const FleetReader&) = delete;
+
+  const FleetSnapshot& operator*() const { return *snapshot; }
+  const FleetSnapshot* operator->() const { return snapshot; }
+
+private:
+  const FleetSnapshot* snapshot;
+};
+
+/**
+ * Scoped fleet lock
+ */
+class FleetLock {
+public:
+  FleetLock() { fleetLock(); }
+  ~FleetLock() { fleetUnlock(); }
+
+  FleetLock(const FleetLock&) = delete;
+  FleetLock& operator=(const FleetLock&) = delete;
+};
+
+#endif // FLEET_SNAPSHOT_H
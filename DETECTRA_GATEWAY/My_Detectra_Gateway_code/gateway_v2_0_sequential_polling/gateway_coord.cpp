@@ -0,0 +1,318 @@
+/**
+ * DETECTRA Gateway v2.0 - Multi-Gateway Channel Coordination Implementation
+ */
+
+#include <ArduinoJson.h>
+#include "gateway_coord.h"
+#include "lora_protocol.h"
+#include "log.h"
+#include <limits.h>
+
+static char selfId[16] = "";
+static char selfChannel[COORD_CHANNEL_MAX + 1] = "";
+static char selfTopic[sizeof(COORD_TOPIC_PREFIX) + 16] = "";
+static uint16_t selfDemand = COORD_MIN_DEMAND;
+
+static CoordPeer peers[COORD_MAX_PEERS];
+static int numPeers = 0;
+
+static long clockOffsetMs = 0;               // Superframe clock = millis() + offset
+static unsigned long pollEstimateMs = COORD_DEFAULT_POLL_MS;
+static uint32_t deferrals = 0;
+static uint32_t staleClocks = 0;
+static bool lastAllowed = true;
+
+static SemaphoreHandle_t coordLock = NULL;
+
+// ==================== MEMBERSHIP ====================
+
+static void expirePeers(unsigned long now) {
+  int kept = 0;
+  for (int i = 0; i < numPeers; i++) {
+    if (now - peers[i].lastSeenMs <= COORD_PEER_TIMEOUT_MS) peers[kept++] = peers[i];
+  }
+  numPeers = kept;
+}
+
+static int findPeer(const char* gatewayId) {
+  for (int i = 0; i < numPeers; i++) {
+    if (strcmp(peers[i].gatewayId, gatewayId) == 0) return i;
+  }
+  return -1;
+}
+
+static uint16_t effectiveDemand(uint16_t demand) {
+  if (demand < COORD_MIN_DEMAND) return COORD_MIN_DEMAND;
+  return (demand > 1000) ? 1000 : demand;
+}
+
+/**
+ * Our window in the superframe (same result on every member of the channel)
+ *
+ * @return Number of peers sharing our channel
+ */
+static int computeWindow(uint32_t& start, uint32_t& length, bool& leader) {
+  uint32_t total = effectiveDemand(selfDemand);
+  uint32_t before = 0;
+  int sharing = 0;
+  leader = true;
+
+  for (int i = 0; i < numPeers; i++) {
+    if (strcmp(peers[i].channel, selfChannel) != 0) continue;
+
+    uint16_t demand = effectiveDemand(peers[i].demand);
+    total += demand;
+    sharing++;
+
+    // Windows are laid out in gateway ID order
+    if (strcmp(peers[i].gatewayId, selfId) < 0) {
+      before += demand;
+      leader = false;
+    }
+  }
+
+  start = (uint32_t)((uint64_t)COORD_SUPERFRAME_MS * before / total);
+  length = (uint32_t)((uint64_t)COORD_SUPERFRAME_MS * effectiveDemand(selfDemand) / total);
+  if (sharing == 0) {
+    start = 0;
+    length = COORD_SUPERFRAME_MS;
+  }
+  return sharing;
+}
+
+static bool isChannelLeader(const char* gatewayId, const char* channel) {
+  if (strcmp(channel, selfChannel) != 0 || strcmp(gatewayId, selfId) > 0) return false;
+
+  for (int i = 0; i < numPeers; i++) {
+    if (strcmp(peers[i].channel, selfChannel) == 0 && strcmp(peers[i].gatewayId, gatewayId) < 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// ==================== COORDINATION ====================
+
+void coordInit(const char* gatewayId, const char* channel) {
+  coordLock = xSemaphoreCreateMutex();
+
+  strlcpy(selfId, gatewayId, sizeof(selfId));
+  strlcpy(selfChannel, channel, sizeof(selfChannel));
+  snprintf(selfTopic, sizeof(selfTopic), "%s%s", COORD_TOPIC_PREFIX, selfId);
+}
+
+const char* coordTopic() {
+  return selfTopic;
+}
+
+void coordHandleMessage(const char* topic, const uint8_t* payload, unsigned int length, unsigned long now) {
+  const char* gatewayId = topic + strlen(COORD_TOPIC_PREFIX);
+  if (strncmp(topic, COORD_TOPIC_PREFIX, strlen(COORD_TOPIC_PREFIX)) != 0 || strcmp(gatewayId, selfId) == 0) {
+    return;
+  }
+
+  xSemaphoreTake(coordLock, portMAX_DELAY);
+
+  int index = findPeer(gatewayId);
+
+  // Empty retained payload / last will: gateway withdrew
+  if (length == 0) {
+    if (index >= 0) {
+      peers[index] = peers[--numPeers];
+      LOG_I("COORD", "%s left", gatewayId);
+    }
+    xSemaphoreGive(coordLock);
+    return;
+  }
+
+  StaticJsonDocument<384> doc;
+  DeserializationError error = deserializeJson(doc, (const char*)payload, length);
+  if (error) {
+    xSemaphoreGive(coordLock);
+    LOG_W("COORD", "Invalid announcement from %s", gatewayId);
+    return;
+  }
+
+  if (index < 0) {
+    if (numPeers >= COORD_MAX_PEERS) {
+      xSemaphoreGive(coordLock);
+      LOG_W("COORD", "Peer table full - %s ignored", gatewayId);
+      return;
+    }
+    index = numPeers++;
+    strlcpy(peers[index].gatewayId, gatewayId, sizeof(peers[index].gatewayId));
+    LOG_I("COORD", "%s joined (%s)", gatewayId, (const char*)(doc["channel"] | "?"));
+  }
+
+  CoordPeer& peer = peers[index];
+  strlcpy(peer.channel, doc["channel"] | "", sizeof(peer.channel));
+  peer.demand = doc["demand"] | COORD_MIN_DEMAND;
+  peer.lastSeenMs = now;
+
+  // Follow the channel leader's superframe clock - only from a fresh announcement
+  bool stale = false;
+  if (isChannelLeader(gatewayId, peer.channel) && doc.containsKey("clock_ms")) {
+    uint64_t sentMs = doc["sent_ms"] | 0ULL;
+    int64_t ageMs = (int64_t)(getCurrentTimeMs() - sentMs);
+    if (sentMs == 0 || !getClockStatus().synced || ageMs < -COORD_CLOCK_MAX_AGE_MS || ageMs > COORD_CLOCK_MAX_AGE_MS) {
+      stale = true;
+      staleClocks++;
+    } else {
+      unsigned long leaderClock = doc["clock_ms"];
+      clockOffsetMs = (long)(leaderClock + (long)ageMs - now);
+    }
+  }
+
+  xSemaphoreGive(coordLock);
+
+  if (stale) LOG_D("COORD", "Clock of %s not followed - announcement stale or not UTC", gatewayId);
+}
+
+size_t coordBuildAnnouncement(char* out, size_t capacity, unsigned long now) {
+  xSemaphoreTake(coordLock, portMAX_DELAY);
+
+  expirePeers(now);
+
+  uint32_t start, length;
+  bool leader;
+  computeWindow(start, length, leader);
+
+  // sent_ms = 0 while the clock is still uptime: followers then do not take clock_ms
+  unsigned long long sentMs = getClockStatus().synced ? getCurrentTimeMs() : 0;
+  int written = snprintf(out, capacity,
+    "{\"gateway_id\":\"%s\",\"channel\":\"%s\",\"demand\":%u,\"clock_ms\":%lu,\"sent_ms\":%llu,"
+    "\"superframe_ms\":%lu,\"window_start_ms\":%lu,\"window_ms\":%lu}",
+    selfId, selfChannel, effectiveDemand(selfDemand), (unsigned long)(now + clockOffsetMs), sentMs,
+    (unsigned long)COORD_SUPERFRAME_MS, (unsigned long)start, (unsigned long)length);
+
+  xSemaphoreGive(coordLock);
+  return (written > 0 && (size_t)written < capacity) ? written : 0;
+}
+
+void coordSetDemand(uint16_t permille) {
+  selfDemand = permille;
+}
+
+void coordRecordPoll(unsigned long durationMs) {
+  // EWMA (1/4 weight) - one slow device should not shrink everyone's schedule
+  pollEstimateMs = (3 * pollEstimateMs + durationMs) / 4;
+}
+
+unsigned long coordPollEstimateMs() {
+  return pollEstimateMs;
+}
+
+/**
+ * Our window and the position in the superframe (caller holds the lock)
+ *
+ * @return false if the channel is not shared
+ */
+static bool windowPosition(unsigned long now, uint32_t& pos, uint32_t& start, uint32_t& usable) {
+  uint32_t length;
+  bool leader;
+
+  expirePeers(now);
+  if (computeWindow(start, length, leader) == 0) return false;
+
+  pos = (uint32_t)((now + clockOffsetMs) % COORD_SUPERFRAME_MS);
+  usable = (length > 2 * COORD_GUARD_MS) ? length - COORD_GUARD_MS : length / 2;
+  return true;
+}
+
+bool coordCanTransmit(unsigned long now) {
+  xSemaphoreTake(coordLock, portMAX_DELAY);
+
+  uint32_t pos, start, usable;
+  bool allowed = true;
+
+  if (windowPosition(now, pos, start, usable)) {
+    // A poll longer than the whole window may only start at its beginning
+    uint32_t need = (pollEstimateMs < usable) ? pollEstimateMs : usable;
+    allowed = (pos >= start && pos + need <= start + usable);
+  }
+
+  if (!allowed && lastAllowed) deferrals++;
+  lastAllowed = allowed;
+
+  xSemaphoreGive(coordLock);
+  return allowed;
+}
+
+unsigned long coordWindowRemainingMs(unsigned long now) {
+  xSemaphoreTake(coordLock, portMAX_DELAY);
+
+  uint32_t pos, start, usable;
+  unsigned long remaining = ULONG_MAX;
+
+  if (windowPosition(now, pos, start, usable)) {
+    remaining = (pos >= start && pos < start + usable) ? start + usable - pos : 0;
+  }
+
+  xSemaphoreGive(coordLock);
+  return remaining;
+}
+
+// ==================== STATUS ====================
+
+CoordView coordGetView(unsigned long now) {
+  static const uint32_t plan[] = COORD_CHANNEL_PLAN;
+
+  xSemaphoreTake(coordLock, portMAX_DELAY);
+
+  expirePeers(now);
+
+  CoordView view;
+  bool leader;
+  int sharing = computeWindow(view.windowStartMs, view.windowMs, leader);
+
+  view.role = (sharing == 0) ? COORD_ALONE : (leader ? COORD_LEADER : COORD_FOLLOWER);
+  view.peers = numPeers;
+  view.sharing = sharing;
+  view.demand = effectiveDemand(selfDemand);
+  view.superframePosMs = (uint32_t)((now + clockOffsetMs) % COORD_SUPERFRAME_MS);
+  view.pollEstimateMs = pollEstimateMs;
+  view.deferrals = deferrals;
+  view.staleClocks = staleClocks;
+  view.suggestedFreq = 0;
+
+  // Least used frequency of the plan (only worth moving if strictly less crowded)
+  if (sharing > 0) {
+    uint32_t selfFreq = strtoul(selfChannel, NULL, 10);
+    int best = sharing;
+    for (size_t c = 0; c < sizeof(plan) / sizeof(plan[0]); c++) {
+      if (plan[c] == selfFreq) continue;
+
+      int users = 0;
+      for (int i = 0; i < numPeers; i++) {
+        if ((uint32_t)strtoul(peers[i].channel, NULL, 10) == plan[c]) users++;
+      }
+      if (users < best) {
+        best = users;
+        view.suggestedFreq = plan[c];
+      }
+    }
+  }
+
+  xSemaphoreGive(coordLock);
+  return view;
+}
+
+int coordGetPeers(CoordPeer* out, int maxPeers, unsigned long now) {
+  xSemaphoreTake(coordLock, portMAX_DELAY);
+
+  expirePeers(now);
+  int count = (numPeers < maxPeers) ? numPeers : maxPeers;
+  memcpy(out, peers, count * sizeof(CoordPeer));
+
+  xSemaphoreGive(coordLock);
+  return count;
+}
+
+const char* coordRoleToString(CoordRole role) {
+  switch (role) {
+    case COORD_ALONE:     return "ALONE";
+    case COORD_LEADER:    return "LEADER";
+    case COORD_FOLLOWER:  return "FOLLOWER";
+    default:              return "UNKNOWN";
+  }
+}
@@ -0,0 +1,158 @@
+/**
+ * DETECTRA Gateway v2.0 - Multi-Gateway Channel Coordination
+ *
+ * Gateways within radio range of each other share the air. Each gateway
+ * announces itself on a retained MQTT topic:
+ *
+ *   detectra/coord/<gateway_id>
+ *   {"gateway_id":"GW0-00001","channel":"868000000/9/125","demand":180,
+ *    "clock_ms":8123456,"sent_ms":1728567890123,"superframe_ms":300000,
+ *    "window_start_ms":0,"window_ms":150000}
+ *
+ * (an empty retained payload - also the MQTT last will - withdraws it).
+ *
+ * Gateways on different channels never wait for each other. Gateways on
+ * the same channel split a repeating superframe into one window each:
+ *
+ *   - Members are sorted by gateway ID; the lowest ID is the leader and
+ *     its clock_ms is the shared superframe clock (followers keep an
+ *     offset, updated on every leader announcement).
+ *   - sent_ms is the UTC time the announcement was built (only sent once
+ *     NTP has set the clock). A follower takes clock_ms only from an
+ *     announcement at most COORD_CLOCK_MAX_AGE_MS old by its own UTC
+ *     clock - the retained copy a new subscriber gets can be up to
+ *     COORD_ANNOUNCE_MS old. Without UTC on both sides clock_ms is not
+ *     used.
+ *   - Window length is proportional to each gateway's demand (permille
+ *     of airtime its schedule needs), so a busy gateway gets more time.
+ *   - Every member computes the same windows from the same announcements,
+ *     so no negotiation round trips are needed.
+ *
+ * A device poll is only started when it fits in the rest of this
+ * gateway's window (minus COORD_GUARD_MS). With no peers on the channel
+ * (or MQTT down long enough for peers to expire) there is no restriction.
+ *
+ * While the channel is shared, the least used frequency of
+ * COORD_CHANNEL_PLAN is reported as a suggestion. Moving a gateway and
+ * its devices (RPi config.json) to its own channel removes the time
+ * sharing entirely.
+ *
+ * tools/coord_sim runs simulated gateways against a local Mosquitto
+ * broker and checks that announced windows never overlap.
+ */
+
+#ifndef GATEWAY_COORD_H
+#define GATEWAY_COORD_H
+
+#include <Arduino.h>
+
+// ==================== CONSTANTS ====================
+
+#define COORD_TOPIC_PREFIX      "detectra/coord/"
+#define COORD_TOPIC_FILTER      "detectra/coord/+"
+#define COORD_MAX_PEERS         8             // Other gateways tracked
+#define COORD_CHANNEL_MAX       31            // "<freq>/<sf>/<bw>"
+#define COORD_SUPERFRAME_MS     300000UL      // 5 minutes shared by all gateways on a channel
+#define COORD_GUARD_MS          2000          // Idle gap at the end of each window
+#define COORD_ANNOUNCE_MS       30000         // Announcement period
+#define COORD_CLOCK_MAX_AGE_MS  500           // Older leader announcements do not move our clock
+#define COORD_PEER_TIMEOUT_MS   95000         // Peer dropped after ~3 missed announcements
+#define COORD_MIN_DEMAND        50            // Permille floor - every member gets a window
+#define COORD_DEFAULT_POLL_MS   45000         // Device poll estimate before the first measurement
+
+// Frequencies offered as alternatives when a channel is shared
+#define COORD_CHANNEL_PLAN      { 868100000UL, 868300000UL, 868500000UL, 867100000UL, 867300000UL }
+
+// ==================== DATA STRUCTURES ====================
+
+enum CoordRole : uint8_t {
+  COORD_ALONE,                    // No peers on our channel - transmit any time
+  COORD_LEADER,                   // Lowest ID on the channel - our clock is the reference
+  COORD_FOLLOWER                  // Windows timed from the leader's clock
+};
+
+/**
+ * Coordination state (status JSON, /api/coord)
+ */
+struct CoordView {
+  CoordRole role;
+  uint8_t peers;                  // Live peers (any channel)
+  uint8_t sharing;                // Live peers on our channel
+  uint16_t demand;                // Our announced demand (permille)
+  uint32_t windowStartMs;         // Our window within the superframe
+  uint32_t windowMs;
+  uint32_t superframePosMs;       // Current position in the superframe
+  uint32_t pollEstimateMs;        // Measured device poll duration (EWMA)
+  uint32_t deferrals;             // Polls held back until our window
+  uint32_t staleClocks;           // Leader announcements too old (or not UTC) to follow
+  uint32_t suggestedFreq;         // Less used frequency (0 = none / not sharing)
+};
+
+/**
+ * One live peer (for /api/coord)
+ */
+struct CoordPeer {
+  char gatewayId[16];
+  char channel[COORD_CHANNEL_MAX + 1];
+  uint16_t demand;
+  unsigned long lastSeenMs;
+};
+
+// ==================== COORDINATION FUNCTIONS ====================
+
+/**
+ * Set our identity and radio channel
+ *
+ * @param channel "<freq>/<sf>/<bw>" - only gateways with the same string share time
+ */
+void coordInit(const char* gatewayId, const char* channel);
+
+/**
+ * Our announcement topic ("detectra/coord/<id>", also the MQTT will topic)
+ */
+const char* coordTopic();
+
+/**
+ * Handle a message received on COORD_TOPIC_FILTER (from the MQTT callback)
+ */
+void coordHandleMessage(const char* topic, const uint8_t* payload, unsigned int length, unsigned long now);
+
+/**
+ * Build our retained announcement
+ *
+ * @return Length written (0 if out is too small)
+ */
+size_t coordBuildAnnouncement(char* out, size_t capacity, unsigned long now);
+
+/**
+ * Airtime our schedule needs, in permille (see COORD_MIN_DEMAND)
+ */
+void coordSetDemand(uint16_t permille);
+
+/**
+ * Feed a measured device poll duration (start of POLL to complete/offline)
+ */
+void coordRecordPoll(unsigned long durationMs);
+unsigned long coordPollEstimateMs();
+
+/**
+ * May a device poll start now? (true = it fits in our window, or no sharing)
+ * Counts a deferral when it returns false.
+ */
+bool coordCanTransmit(unsigned long now);
+
+/**
+ * Time left in our window for other traffic (bulk transfers)
+ *
+ * @return ULONG_MAX when the channel is not shared, 0 outside our window
+ */
+unsigned long coordWindowRemainingMs(unsigned long now);
+
+/**
+ * Current state / live peers
+ */
+CoordView coordGetView(unsigned long now);
+int coordGetPeers(CoordPeer* out, int maxPeers, unsigned long now);
+const char* coordRoleToString(CoordRole role);
+
+#endif // GATEWAY_COORD_H
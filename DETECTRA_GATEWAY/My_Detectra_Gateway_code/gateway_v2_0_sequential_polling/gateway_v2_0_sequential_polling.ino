@@ -36,7 +36,32 @@
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1306.h>
 #include <Adafruit_NeoPixel.h>
+#include <esp_heap_caps.h>
+#include <esp_sntp.h>
 #include "lora_protocol.h"
+#include "lora_frame.h"
+#include "lora_tx.h"
+#include "log.h"
+#include "device_registry.h"
+#include "boot_sequence.h"
+#include "mqtt_outbox.h"
+#include "poll_schedule.h"
+#include "gateway_coord.h"
+#include "table_state.h"
+#include "mqtt_codec.h"
+#include "ws_broadcast.h"
+#include "fleet_snapshot.h"
+#include "diagnostics.h"
+#include "radio_trace.h"
+#include "bulk_transfer.h"
+#include "pair_batch.h"
+#include "job_queue.h"
+#include "seq_space.h"
+#include "energy_model.h"
+#include "link_health.h"
+#include "time_sync.h"
+#include "status_json.h"
+#include "ui_task.h"
 #include "web_interface.h"
 
 // ==================== HARDWARE CONFIGURATION ====================
@@ -66,6 +91,27 @@
 #define LORA_PREAMBLE "8"             // Preamble length
 #define LORA_PWR      "22"            // TX Power 22 dBm
 
+// Polling Configuration
+#define MAX_DEVICES           15      // Devices per gateway (LoRa Module 1)
+static_assert(MAX_DEVICES <= REGISTRY_MAX_DEVICES, "NVS registry blob too small for MAX_DEVICES");
+static_assert(MAX_DEVICES <= FLEET_MAX_DEVICES, "Fleet snapshot too small for MAX_DEVICES");
+#define ENABLE_HEALTH_CENSUS  true    // Broadcast POLL + slotted replies before per-device polling
+#define POLL_ON_BOOT          true    // Restored devices are due at boot (first cycle as soon as the radio is up)
+
+// Task Stacks (bytes) - size from stack_free_min at /api/diag
+#define LORA_TASK_STACK       10000
+#define POLLING_TASK_STACK    10000
+#define LORA_TX_TASK_STACK    4096
+#define UI_TASK_STACK         4096
+#ifdef CONFIG_ASYNC_TCP_STACK_SIZE
+#define ASYNC_TCP_STACK       CONFIG_ASYNC_TCP_STACK_SIZE
+#else
+#define ASYNC_TCP_STACK       (8192 * 2)  // AsyncTCP default
+#endif
+
+// Logging (level is set in log.h or with -DLOG_LEVEL=...)
+#define LOG_TO_FFAT           false   // Also append log lines to /gateway.log (needs FFat)
+
 // ==================== NETWORK CONFIGURATION ====================
 
 // WiFi Credentials
@@ -84,6 +130,9 @@ const char* topic_status = "detectra/GW0-00001/status";
 const char* topic_data = "detectra/GW0-00001/data";
 const char* topic_device = "detectra/GW0-00001/device/";
 const char* topic_polling = "detectra/GW0-00001/polling";
+const char* topic_meta = "detectra/GW0-00001/meta";        // Retained: schema version + content types
+const char* topic_diag = "detectra/GW0-00001/diag";        // Task health (JSON, every minute + on stalls)
+const char* topic_alert = "detectra/GW0-00001/alert";      // Link degradation early warnings (JSON)
 
 // Web Server Credentials
 const char* web_username = "rnd";
@@ -106,6 +155,9 @@ AsyncWebSocket ws("/ws");
 // Storage
 Preferences preferences;
 
+// LoRa RX line buffer: "+EVT:RXP2P:<rssi>:<snr>:" + hex of a full frame
+#define RX_LINE_MAX   (32 + 2 * LORA_MAX_FRAME)
+
 // ==================== GLOBAL VARIABLES ====================
 
 // Gateway Configuration
@@ -114,32 +166,65 @@ struct GatewayConfig {
   String building;
   String floor;
   String lab;
-  int pollingIntervalMinutes;
+  int pollingIntervalMinutes;  // Default cadence (devices without a group / override)
+  int energyTargetDays;       // Battery-life target (0 = energy management off)
   int numDevices;             // Number of paired devices
 } config;
 
 // Device Array (supports 15 devices)
-DeviceInfo devices[15];
+DeviceInfo devices[MAX_DEVICES];
+DeviceResult deviceResults[MAX_DEVICES];  // Latest DATA per device, kept out of the hot array
+DeviceTables deviceTables[MAX_DEVICES];    // Per-table state, last published (delta publishing)
 
 // Polling State
 bool pollingActive = false;
-int currentDeviceIndex = 0;
+int currentDeviceIndex = 0;           // Position in pollOrder[] (not a devices[] index)
+int pollOrder[MAX_DEVICES];           // devices[] indices in this cycle's polling order
+int cycleDevices = 0;                 // Devices in this cycle (the due subset chosen by the schedule)
+unsigned int cycleId = 0;             // Incremented every cycle, echoed in census replies
 unsigned long pollingStartTime = 0;
 unsigned long phaseStartTime = 0;
-int sequenceCounter = 0;
+unsigned long deviceStartTime = 0;    // POLL of the current device (coordination estimate)
+unsigned long collectStartTime = 0;   // DATA_COLLECTION entered (energy model)
+unsigned long collectDurationMs = 0;  // ... and how long it took
+bool pollRecorded = false;            // Energy model has the current device's poll (FINALIZED may repeat)
+
+// Broadcast Health Census
+bool censusActive = false;
+unsigned long censusStartTime = 0;
+unsigned long censusWindow = 0;       // Broadcast airtime + guard + all slots
+int censusResponses = 0;
+
+// Ad-hoc Jobs (job_queue.h) - run one at a time, between two cycle devices
+bool jobRunning = false;
+JobInfo activeJob;                    // Valid while jobRunning
+int jobDeviceIndex = -1;              // devices[] index of the job's device
+PollingPhase jobSavedPhase = PHASE_IDLE;  // Where the cycle left that device, restored after the job
+uint8_t jobSavedPositions = 0;
+bool jobAtBoundary = false;           // A job already ran at this device boundary of the cycle
+
+// Storage
+bool ffatMounted = false;             // initFFat() - FFat-backed routes are registered only then
 
 // Network Status
 bool wifiConnected = false;
 bool mqttConnected = false;
+volatile bool metaChanged = false;    // Encoding changed via the API - republish the meta topic
 
 // Statistics
 unsigned long totalMessages = 0;
+unsigned long truncatedDetections = 0;  // DATA detections cut at DETECTIONS_MAX
 unsigned long successfulPolls = 0;
 unsigned long failedPolls = 0;
 
-// Watchdog
-unsigned long lastLoRaActivity = 0;
-unsigned long lastMQTTActivity = 0;
+// Heap Monitoring (internal 8-bit heap)
+struct HeapStats {
+  size_t freeBytes;
+  size_t minFreeBytes;          // Lowest free heap since boot (IDF watermark)
+  size_t largestBlock;          // Largest allocatable block right now
+  size_t minLargestBlock;       // Smallest largest-block seen since boot
+  uint8_t fragmentationPct;     // 100 - largestBlock / freeBytes
+} heapStats = {0, 0, 0, SIZE_MAX, 0};
 
 // ==================== FUNCTION PROTOTYPES ====================
 
@@ -152,30 +237,51 @@ void initWebServer();
 void initFFat();
 void loadConfiguration();
 void loadDevicePairings();
+void initStorage();
 
 // LoRa Communication
 void loraTask(void* parameter);
-void handleLoRaResponse(String response, int loraModule);
-bool sendLoRaCommand(const String& command, int loraModule);
-bool sendLoRaMessage(const String& message, int loraModule);
+void handleLoRaResponse(char* response, size_t length, int loraModule);
+void handleLoRaFrame(const char* hex, size_t length, int loraModule);
+bool sendLoRaCommand(const String& command, int loraModule, unsigned long timeoutMs = 1000);
+size_t sendLoRaMessage(const char* command, const char* targetId, const char* payload,
+                       int loraModule, TxPriority priority = TX_PRIO_COMMAND);
+void writeLoRaFrame(int loraModule, const TxFrame& frame);
+void loraTxTask(void* parameter);
+size_t sendBulkFrame(const char* command, const char* targetId, const char* payload);
+unsigned long bulkFrameAirtimeMs(size_t frameBytes);
+void sendTimeBeacon();
+void startClockSync();
+void onClockSync(struct timeval* tv);
 
 // Polling State Machine
 void pollingTask(void* parameter);
-void startPollingCycle();
+void pollingDelay(unsigned long ms);
+bool pollingWaitTxIdle(unsigned long timeoutMs);
+void startPollingCycle(int deviceCount);
 void pollNextDevice();
 void processPhase(DeviceInfo& device);
 void advancePhase(DeviceInfo& device);
 void handlePhaseTimeout(DeviceInfo& device);
 void handleDeviceOffline(DeviceInfo& device);
 void completeDevicePolling(DeviceInfo& device);
+void startHealthCensus();
+void finishHealthCensus();
+void serviceDevicePhase(DeviceInfo& device);
+int activeDeviceIndex();
+bool isJobDevice(const DeviceInfo& device);
+void startNextJob();
+void finishJob(DeviceInfo& device, bool ok, const char* error);
+void onJobChanged();
 
 // Message Handling
-void processIncomingMessage(const LoRaMessage& msg);
-void handleAckOnline(const LoRaMessage& msg);
-void handleAckInferring(const LoRaMessage& msg);
-void handleDataMessage(const LoRaMessage& msg);
-void handleAckFinalized(const LoRaMessage& msg);
-void handleAckSleeping(const LoRaMessage& msg);
+void processIncomingMessage(LoRaMessage& msg);
+void handleAckOnline(LoRaMessage& msg);
+void handleAckInferring(LoRaMessage& msg);
+void handleDataMessage(LoRaMessage& msg);
+void resendDataAck(LoRaMessage& msg);
+void handleAckFinalized(LoRaMessage& msg);
+void handleAckSleeping(LoRaMessage& msg);
 
 // MQTT Publishing
 void publishGatewayStatus();
@@ -183,27 +289,62 @@ void publishPollingStatus();
 void publishDeviceData(int deviceIndex);
 void publishPollingComplete();
 void mqttReconnect();
+void mqttCallback(char* topic, byte* payload, unsigned int length);
+void publishCoordAnnouncement();
+void publishMeta();
+void publishDiagnostics();
+void publishLinkAlert(const LinkInfo& info, LinkAlert previous);
+bool mqttPublish(const char* topic, const uint8_t* payload, size_t length, bool retained);
+void mqttEnqueue(const char* topic, const uint8_t* payload, size_t length, bool retained);
 
 // Web Interface
 void setupWebRoutes();
 void handleWebSocketMessage(AsyncWebSocketClient* client, char* data, size_t len);
-void notifyWebClients(const String& message);
+FleetView fleetView(const FleetSnapshot& snapshot);
+void fillFleetSnapshot(FleetSnapshot& snapshot);
 String buildDeviceListJSON();
 String buildPollingStatusJSON();
-
-// Display & Indicators
-void updateDisplay();
-void setLEDColor(uint8_t r, uint8_t g, uint8_t b);
-void beepBuzzer(int duration);
+String buildScheduleJSON();
+String buildCoordJSON();
+String buildWsStatsJSON();
+String buildDiagJSON();
+String buildBulkJSON();
+String buildPairingJSON();
+String buildEnergyJSON();
+String buildTimeJSON();
+String buildLinkJSON();
+String buildJobsJSON();
+String buildSeqJSON();
+String buildJobJSON(const JobInfo& job);
+void submitJob(AsyncWebServerRequest* request, uint8_t* data, size_t len, JobKind kind);
+void addBootTimings(JsonObject boot);
+void addEnergyInfo(JsonObject energy, const EnergyInfo& info);
+void addLinkInfo(JsonObject link, const LinkInfo& info);
+void addJobInfo(JsonObject obj, const JobInfo& job);
+
+// Diagnostics
+void sampleHeapStats();
+
+// Display & Indicators (effects are queued with uiBeep() / uiLed(), played by uiTask)
+void uiTask(void* parameter);
+void renderStatusScreen(Adafruit_SSD1306& screen);
+void writeLedColor(uint8_t r, uint8_t g, uint8_t b);
+void writeBuzzer(bool on);
 
 // Storage & Reports
 void saveConfiguration();
-void saveDevicePairing(const DeviceInfo& device);
 void generateCycleReport();
 
+// Pairing
+int addPendingDevice(const char* deviceId, const char* tableLeft, const char* tableRight);
+bool sendPairFrame(const char* deviceId, const char* tableLeft, const char* tableRight);
+void onPairProgress();
+void onPairDone();
+
 // Utilities
-String getDeviceSecret(const String& deviceId);
-int getDeviceIndexById(const String& deviceId);
+String getDeviceSecret(const char* deviceId);
+int getDeviceIndexById(const char* deviceId);
+bool isRegisteredDevice(const char* deviceId);
 String getLoRaModuleForDevice(int deviceIndex);
 
 // ==================== SETUP ====================
@@ -211,6 +352,7 @@ String getLoRaModuleForDevice(int deviceIndex);
 void setup() {
   Serial.begin(115200);
   delay(1000);
+  logInit();
 
   Serial.println("\n\n");
   Serial.println("==========================================");
@@ -219,102 +361,161 @@ void setup() {
   Serial.println("==========================================");
   Serial.println();
 
-  // Initialize hardware
-  initHardware();
+  // Task health: heartbeats, stack high-water marks, busy time, loop() latency
+  diagWatch(DIAG_TASK_LOOP, "loopTask", getArduinoLoopTaskStackSize(), DIAG_STALL_LOOP_MS);
+  diagWatch(DIAG_TASK_LORA, "LoRaTask", LORA_TASK_STACK, DIAG_STALL_LORA_MS);
+  diagWatch(DIAG_TASK_POLLING, "PollingTask", POLLING_TASK_STACK, DIAG_STALL_POLLING_MS);
+  diagWatch(DIAG_TASK_LORA_TX, "LoRaTx1", LORA_TX_TASK_STACK, DIAG_STALL_LORA_TX_MS);
+  diagWatch(DIAG_TASK_UI, "UiTask", UI_TASK_STACK, DIAG_STALL_UI_MS);
+  diagWatch(DIAG_TASK_LOG, "LogTask", LOG_TASK_STACK, 0);
+  diagWatch(DIAG_TASK_ASYNC_TCP, "async_tcp", ASYNC_TCP_STACK, 0);
+  diagInit();
 
-  // Initialize timestamp
-  initTimestamp();
+  // Boot phases: hardware and config run here, the rest start in parallel tasks.
+  // The radio no longer waits for WiFi - results are queued until MQTT is up.
+  bootInit();
 
-  // FORCE CLEAR OLD CONFIG (remove after first boot with new firmware)
-  Serial.println("[CONFIG] Clearing old preferences...");
-  preferences.begin("detectra", false);
-  preferences.clear();
-  preferences.end();
-  Serial.println("[CONFIG] Preferences cleared!");
+  bootRun(BOOT_HARDWARE, initHardware);
 
-  // Load configuration
-  initFFat();
-  loadConfiguration();
-  loadDevicePairings();
+  // Initialize timestamp (gateway clock runs from boot until NTP answers)
+  initTimestamp();
+  timeSyncInit();
 
-  // Initialize network
-  initWiFi();
-  initMQTT();
-  initWebServer();
+  // Load configuration + device registry, set up MQTT client and outbox
+  bootRun(BOOT_CONFIG, initStorage);
 
-  // Initialize LoRa modules
-  initLoRa();
+  // LoRa (core 0) and WiFi (core 1) come up concurrently, web server after WiFi
+  bootStart(BOOT_LORA, initLoRa, BOOT_BIT(BOOT_HARDWARE) | BOOT_BIT(BOOT_CONFIG), 6144, 0);
+  bootStart(BOOT_WIFI, initWiFi, 0, 4096, 1);
+  bootStart(BOOT_WEB, initWebServer, BOOT_BIT(BOOT_WIFI), 6144, 1);
 
-  // Create FreeRTOS tasks
+  // Create FreeRTOS tasks (all wait for BOOT_LORA before touching the radio)
   xTaskCreatePinnedToCore(
     loraTask,
     "LoRaTask",
-    10000,
+    LORA_TASK_STACK,
     NULL,
     3,          // High priority
     NULL,
     0           // Core 0
   );
 
+  xTaskCreatePinnedToCore(
+    loraTxTask,
+    "LoRaTx1",
+    LORA_TX_TASK_STACK,
+    (void*)1,   // Radio 1 - the only one set up (see lora_tx.h)
+    3,          // Same as loraTask - it forwards the modem's TX events
+    NULL,
+    0           // Core 0
+  );
+
   xTaskCreatePinnedToCore(
     pollingTask,
     "PollingTask",
-    10000,
+    POLLING_TASK_STACK,
     NULL,
     2,          // Medium priority
     NULL,
     1           // Core 1
   );
 
+  xTaskCreatePinnedToCore(
+    uiTask,
+    "UiTask",
+    UI_TASK_STACK,
+    NULL,
+    1,          // Low priority - same as loopTask
+    NULL,
+    1           // Core 1
+  );
+
   Serial.println("==========================================");
-  Serial.println(" Gateway Initialized Successfully");
+  Serial.println(" Gateway Boot Started (" + String(millis()) + " ms)");
   Serial.println(" Gateway ID: " + config.gatewayId);
   Serial.println(" Devices Paired: " + String(config.numDevices));
   Serial.println(" Polling Interval: " + String(config.pollingIntervalMinutes) + " minutes");
   Serial.println("==========================================");
   Serial.println();
-  Serial.println(">>> Ready! Use web interface to pair devices and start polling.");
+  Serial.println(">>> LoRa/WiFi/Web coming up in background - see [BOOT] lines for phase timings.");
   Serial.println();
 
-  // DO NOT auto-start polling - wait for manual trigger from web interface
-  // User will pair devices first, then manually click "Start Polling"
+  sampleHeapStats();
+  diagTaskStarted(DIAG_TASK_LOOP, true);  // setup() runs in loopTask
+
+  // All cycles come from the schedule engine (pollingTask). Newly paired devices are first
+  // polled one cadence later, or right away via "Start Polling" / POST /api/poll/start.
 }
 
 void loop() {
+  diagBeat(DIAG_TASK_LOOP);
+
   // Handle MQTT connection
-  if (!mqttClient.connected()) {
-    mqttReconnect();
+  {
+    DiagScope section(DIAG_SECTION_MQTT);
+    if (!mqttClient.connected()) {
+      mqttReconnect();
+    }
+    mqttClient.loop();
+  }
+
+  // Deliver results queued by the other tasks (and while the broker was unreachable)
+  if (mqttConnected) {
+    DiagScope section(DIAG_SECTION_OUTBOX);
+    outboxFlush(mqttPublish);
+  }
+
+  // Announce new content types before the first payload in the new encoding goes out
+  if (metaChanged && mqttConnected) {
+    metaChanged = false;
+    publishMeta();
+  }
+
+  // Clean up WebSocket clients, push coalesced dashboard updates
+  {
+    DiagScope section(DIAG_SECTION_WS);
+    ws.cleanupClients();
+    wsService(millis());
+  }
+
+  // Sample heap watermarks (every second)
+  static unsigned long lastHeapSample = 0;
+  if (millis() - lastHeapSample > 1000) {
+    sampleHeapStats();
+    lastHeapSample = millis();
   }
-  mqttClient.loop();
 
-  // Clean up WebSocket clients
-  ws.cleanupClients();
+  // Flush registry changes once they settle (debounced NVS write, from a consistent snapshot)
+  {
+    DiagScope section(DIAG_SECTION_REGISTRY);
+    FleetReader snapshot;
+    registryService(preferences, snapshot->devices, snapshot->numDevices);
+    seqService(preferences);  // Sequence reservations - written as soon as they move
+  }
 
-  // Update display periodically
-  static unsigned long lastDisplayUpdate = 0;
-  if (millis() - lastDisplayUpdate > 1000) {
-    updateDisplay();
-    lastDisplayUpdate = millis();
+  // Coordination announcement (shared-channel time windows)
+  static unsigned long lastCoordAnnounce = 0;
+  if (millis() - lastCoordAnnounce > COORD_ANNOUNCE_MS) {
+    DiagScope section(DIAG_SECTION_PUBLISH);
+    publishCoordAnnouncement();
+    lastCoordAnnounce = millis();
   }
 
   // Publish status periodically (every 30 seconds)
   static unsigned long lastStatusPublish = 0;
   if (millis() - lastStatusPublish > 30000) {
+    DiagScope section(DIAG_SECTION_PUBLISH);
     publishGatewayStatus();
     lastStatusPublish = millis();
   }
 
-  // Automatic polling trigger (3 minutes for development, 60 minutes for production)
-  // Note: This is a backup mechanism. Primary polling is handled in pollingTask()
-  static unsigned long lastPollingStart = millis();
-  unsigned long pollingIntervalMs = config.pollingIntervalMinutes * 60UL * 1000UL;
-
-  if (!pollingActive && (millis() - lastPollingStart > pollingIntervalMs)) {
-    Serial.println("[LOOP] Auto-triggering polling cycle (timer expired)");
-    startPollingCycle();
-    lastPollingStart = millis();
+  // Task health report (every minute, at once when a task stalls)
+  if (diagPublishDue(millis())) {
+    DiagScope section(DIAG_SECTION_PUBLISH);
+    publishDiagnostics();
   }
 
+  diagIdle(DIAG_TASK_LOOP);
   delay(10);
 }
 
@@ -325,19 +526,37 @@ void initHardware() {
 
   // NeoPixel LED
   led.begin();
-  setLEDColor(0, 0, 255);  // Blue during init
-  led.show();
+  writeLedColor(0, 0, 255);  // Blue during init
 
   // Buzzer
   pinMode(BUZZER_PIN, OUTPUT);
   digitalWrite(BUZZER_PIN, LOW);
-  beepBuzzer(100);  // Short beep
+
+  // LoRa TX pool (web handlers may queue frames before initLoRa() runs - they are refused until BOOT_LORA)
+  if (!loraTxInit(1, writeLoRaFrame, bulkFrameAirtimeMs)) {
+    Serial.println("[INIT] ⚠ LoRa TX pool allocation failed - gateway cannot transmit");
+  }
+
+  // Radio trace ring (captures the AT bring-up too)
+  if (!traceInit()) {
+    Serial.println("[INIT] ⚠ Radio trace allocation failed - capture disabled");
+  }
+
+  // Bulk transfers (blobs are allocated per transfer)
+  bulkInit(sendBulkFrame, bulkFrameAirtimeMs);
+
+  // Bulk pairing (CSV import)
+  pairBatchInit(sendPairFrame, onPairProgress, onPairDone);
+
+  // Ad-hoc device jobs (web API), run by pollingTask
+  jobInit(onJobChanged);
 
   // I2C for OLED
   Wire.begin(OLED_SDA, OLED_SCL);
 
   // OLED Display
-  if (!display.begin(SSD1306_SWITCHCAPVCC, OLED_ADDR)) {
+  bool oledPresent = display.begin(SSD1306_SWITCHCAPVCC, OLED_ADDR);
+  if (!oledPresent) {
     Serial.println("[INIT] OLED initialization failed!");
   } else {
     display.clearDisplay();
@@ -350,65 +569,60 @@ void initHardware() {
     Serial.println("[INIT] OLED initialized");
   }
 
+  // From here on only uiTask touches the OLED, LED and buzzer
+  uiInit(oledPresent ? &display : NULL, &Wire, OLED_ADDR, renderStatusScreen, writeLedColor, writeBuzzer);
+  uiLed(0, 0, 255);
+  uiBeep(100);  // Short beep, once uiTask runs
+
   Serial.println("[INIT] Hardware ready");
 }
 
 void initLoRa() {
-  Serial.println("[LORA] Initializing LoRa modules...");
+  // Runs in its own boot task, concurrently with WiFi - log, don't print
+  LOG_I("LORA", "Initializing LoRa modules...");
 
   // LoRa Module 1 (Devices 1-15)
   LoRa1.begin(115200, SERIAL_8N1, LORA1_RX, LORA1_TX);
   LoRa1.setRxBufferSize(1024);  // Increase RX buffer to prevent overflow
-  delay(500);
 
-  // Basic AT test
-  Serial.println("[LORA1] Testing communication...");
-  sendLoRaCommand("AT", 1);
+  // Basic AT test (retried until the module has finished its own boot)
+  for (int attempt = 0; attempt < 10; attempt++) {
+    if (sendLoRaCommand("AT", 1, 100)) break;
+  }
 
   // Disable RX mode first (in case it's already running from previous session)
-  Serial.println("[LORA1] Disabling existing RX mode...");
   sendLoRaCommand("AT+PRECV=0", 1);
 
   // Set P2P mode
-  Serial.println("[LORA1] Setting P2P mode...");
   sendLoRaCommand("AT+NWM=0", 1);
 
   // Configure P2P with single command (matches RPi initialization)
-  Serial.println("[LORA1] Configuring P2P parameters...");
   String p2pConfig = "AT+P2P=" + String(LORA_FREQ) + ":" + String(LORA_SF) + ":" +
                      String(LORA_BW) + ":" + String(LORA_CR) + ":" +
                      String(LORA_PREAMBLE) + ":" + String(LORA_PWR);
-
-  Serial.println("[LORA1] " + p2pConfig);
   sendLoRaCommand(p2pConfig, 1);
 
   // Verify configuration
-  Serial.println("[LORA1] Verifying configuration...");
   sendLoRaCommand("AT+P2P?", 1);
 
   // Start receiving
-  Serial.println("[LORA1] Starting RX mode...");
-  sendLoRaCommand("AT+PRECV=65533", 1);  // Continuous RX + TX allowed
+  if (!sendLoRaCommand("AT+PRECV=65533", 1)) {  // Continuous RX + TX allowed
+    LOG_E("LORA1", "RX mode not confirmed - check module wiring");
+  }
 
-  Serial.println("[LORA1] LoRa Module 1 configured");
-  Serial.println("  Freq: " + String(LORA_FREQ) + " Hz (" + String(atol(LORA_FREQ)/1000000) + " MHz)");
-  Serial.println("  SF: " + String(LORA_SF));
-  Serial.println("  BW: " + String(LORA_BW) + " kHz");
-  Serial.println("  CR: 4/" + String(atoi(LORA_CR) + 5));
-  Serial.println("  Preamble: " + String(LORA_PREAMBLE));
-  Serial.println("  Power: " + String(LORA_PWR) + " dBm");
+  LOG_I("LORA1", "LoRa Module 1 configured: %s Hz, SF%s, BW %s kHz, CR 4/%d, preamble %s, %s dBm",
+        LORA_FREQ, LORA_SF, LORA_BW, atoi(LORA_CR) + 5, LORA_PREAMBLE, LORA_PWR);
 
   // TODO: Initialize LoRa Module 2 for devices 16-30
   // Currently supporting devices 1-15 only
 
-  setLEDColor(0, 255, 0);  // Green when LoRa ready
-  led.show();
+  uiLed(0, 255, 0);  // Green when LoRa ready
 }
 
 // ==================== NETWORK INITIALIZATION ====================
 
 void initWiFi() {
-  Serial.print("[WIFI] Connecting to " + String(ssid));
+  LOG_I("WIFI", "Connecting to %s", ssid);
 
   WiFi.mode(WIFI_STA);
   WiFi.begin(ssid, password);
@@ -416,26 +630,113 @@ void initWiFi() {
   int attempts = 0;
   while (WiFi.status() != WL_CONNECTED && attempts < 30) {
     delay(500);
-    Serial.print(".");
     attempts++;
   }
 
   if (WiFi.status() == WL_CONNECTED) {
     wifiConnected = true;
-    Serial.println("\n[WIFI] Connected! IP: " + WiFi.localIP().toString());
-    setLEDColor(0, 255, 255);  // Cyan
-    led.show();
+    LOG_I("WIFI", "Connected! IP: %s", WiFi.localIP().toString());
+    startClockSync();
+    uiLed(0, 255, 255);  // Cyan
   } else {
-    Serial.println("\n[WIFI] Connection failed!");
-    setLEDColor(255, 255, 0);  // Yellow
-    led.show();
+    LOG_W("WIFI", "Connection failed!");
+    uiLed(255, 255, 0);  // Yellow
   }
 }
 
+void startClockSync() {
+  // SNTP keeps polling in the background (hourly) and survives WiFi reconnects
+  sntp_set_time_sync_notification_cb(onClockSync);
+  configTime(0, 0, "pool.ntp.org", "time.google.com");
+  LOG_I("TIME", "NTP started");
+}
+
+void onClockSync(struct timeval* tv) {
+  // SNTP task: the only caller of disciplineTimestamp()
+  disciplineTimestamp((uint64_t)tv->tv_sec * 1000 + tv->tv_usec / 1000);
+
+  ClockStatus clock = getClockStatus();
+  LOG_I("TIME", "NTP reference %u: error %ldms, %.2f ppm", clock.references, (long)clock.lastErrorMs, clock.ppm);
+}
+
 void initMQTT() {
   mqttClient.setServer(mqtt_server, mqtt_port);
   mqttClient.setBufferSize(4096);  // Large buffer for complex messages
+  mqttClient.setCallback(mqttCallback);
   Serial.println("[MQTT] Configured for " + String(mqtt_server) + ":" + String(mqtt_port));
+
+  if (!outboxInit()) {
+    Serial.println("[MQTT] ⚠ Outbox allocation failed - results are lost while offline");
+  }
+}
+
+void mqttCallback(char* topic, byte* payload, unsigned int length) {
+  // From mqttClient.loop() in loop() - the only task that touches mqttClient
+  if (strncmp(topic, COORD_TOPIC_PREFIX, strlen(COORD_TOPIC_PREFIX)) == 0) {
+    coordHandleMessage(topic, payload, length, millis());
+  }
+}
+
+void publishCoordAnnouncement() {
+  // Demand = share of airtime this gateway's schedule needs (permille)
+  uint32_t demand = 0;
+  {
+    FleetReader snapshot;
+    for (int i = 0; i < snapshot->numDevices; i++) {
+      demand += (uint32_t)((uint64_t)coordPollEstimateMs() * 1000 / scheduleCadenceMs(snapshot->devices[i]));
+    }
+  }
+  coordSetDemand(demand > 1000 ? 1000 : demand);
+
+  char buffer[256];
+  if (mqttConnected && coordBuildAnnouncement(buffer, sizeof(buffer), millis()) > 0) {
+    mqttClient.publish(coordTopic(), buffer, true);  // Retained - late joiners see us at once
+  }
+}
+
+void publishDiagnostics() {
+  if (!mqttConnected) return;
+
+  String json = buildDiagJSON();
+  mqttClient.publish(topic_diag, (const uint8_t*)json.c_str(), json.length(), false);
+}
+
+void publishLinkAlert(const LinkInfo& info, LinkAlert previous) {
+  // Queued while the broker is down - an early warning is worth delivering late
+  StaticJsonDocument<1024> doc;
+  doc["gateway_id"] = config.gatewayId;
+  doc["device_id"] = info.deviceId.c_str();
+  doc["alert"] = linkAlertName(info.alert);
+  doc["previous"] = linkAlertName(previous);
+  doc["cause"] = linkMetricName(info.worst);
+  addLinkInfo(doc.createNestedObject("link"), info);
+  doc["timestamp"] = millis();
+
+  char buffer[1024];
+  size_t length = serializeJson(doc, buffer, sizeof(buffer));
+  mqttEnqueue(topic_alert, (const uint8_t*)buffer, length, false);
+}
+
+void publishMeta() {
+  // Content type per topic (MQTT 3.1.1 has no content-type property)
+  char buffer[256];
+  if (mqttConnected && codecBuildMeta(buffer, sizeof(buffer)) > 0) {
+    mqttClient.publish(topic_meta, buffer, true);
+  }
+}
+
+bool mqttPublish(const char* topic, const uint8_t* payload, size_t length, bool retained) {
+  return mqttClient.publish(topic, payload, length, retained);
+}
+
+void mqttEnqueue(const char* topic, const uint8_t* payload, size_t length, bool retained) {
+  if (length == 0) {
+    LOG_W("MQTT", "Payload for %s does not fit its buffer - dropped", topic);
+    return;
+  }
+
+  // Any task: only loop() publishes (outboxFlush), also while the broker is up
+  outboxPush(topic, payload, length, retained);
 }
 
 void mqttReconnect() {
@@ -445,48 +746,64 @@ void mqttReconnect() {
   if (millis() - lastAttempt < 5000) return;  // Try every 5 seconds
   lastAttempt = millis();
 
-  Serial.print("[MQTT] Connecting...");
+  bootPhaseBegin(BOOT_MQTT);
 
-  if (mqttClient.connect(mqtt_client_id, mqtt_username, mqtt_password)) {
+  // Last will clears our retained coordination announcement if we drop off
+  if (mqttClient.connect(mqtt_client_id, mqtt_username, mqtt_password, coordTopic(), 0, true, "")) {
     mqttConnected = true;
-    Serial.println(" Connected!");
+    LOG_I("MQTT", "Connected!");
+    bootPhaseDone(BOOT_MQTT);
+
+    // Deltas lost from a full outbox - resynchronise consumers with keyframes
+    static uint32_t droppedAtConnect = 0;
+    OutboxStats outbox = outboxGetStats();
+    if (outbox.dropped != droppedAtConnect) {
+      for (int i = 0; i < config.numDevices; i++) tablesRequestKeyframe(deviceTables[i]);
+      droppedAtConnect = outbox.dropped;
+    }
+
+    mqttClient.subscribe(COORD_TOPIC_FILTER);
+    publishMeta();
+    publishCoordAnnouncement();
     publishGatewayStatus();
-    setLEDColor(0, 255, 255);  // Cyan
-    led.show();
+    uiLed(0, 255, 255);  // Cyan
   } else {
     mqttConnected = false;
-    Serial.println(" Failed (rc=" + String(mqttClient.state()) + ")");
-    setLEDColor(255, 255, 0);  // Yellow
-    led.show();
+    LOG_W("MQTT", "Connect failed (rc=%d)", mqttClient.state());
+    uiLed(255, 255, 0);  // Yellow
   }
 }
 
 // ==================== WEB SERVER INITIALIZATION ====================
 
 void initWebServer() {
-  Serial.println("[WEB] Initializing web server...");
+  LOG_I("WEB", "Initializing web server...");
 
   // WebSocket handler
   ws.onEvent([](AsyncWebSocket* server, AsyncWebSocketClient* client,
                 AwsEventType type, void* arg, uint8_t* data, size_t len) {
     if (type == WS_EVT_CONNECT) {
-      Serial.println("[WS] Client connected: " + String(client->id()));
+      LOG_I("WS", "Client connected: %u", client->id());
+      wsClientConnected(client->id());
       client->text(buildPollingStatusJSON());
     } else if (type == WS_EVT_DISCONNECT) {
-      Serial.println("[WS] Client disconnected: " + String(client->id()));
+      LOG_I("WS", "Client disconnected: %u", client->id());
+      wsClientDisconnected(client->id());
     } else if (type == WS_EVT_DATA) {
       handleWebSocketMessage(client, (char*)data, len);
     }
   });
 
+  wsBroadcastInit(&ws, buildPollingStatusJSON, buildDeviceListJSON);
+  wsSetBuilder(WS_TOPIC_PAIRING, buildPairingJSON);
+  wsSetBuilder(WS_TOPIC_JOBS, buildJobsJSON);
   webServer.addHandler(&ws);
 
   setupWebRoutes();
 
   webServer.begin();
-  Serial.println("[WEB] Server started on port 80");
-  Serial.println("[WEB] Access: http://" + WiFi.localIP().toString());
-  Serial.println("[WEB] Credentials: " + String(web_username) + " / " + String(web_password));
+  LOG_I("WEB", "Server started on port 80 - http://%s (%s / %s)",
+        WiFi.localIP().toString(), web_username, web_password);
 }
 
 void setupWebRoutes() {
@@ -514,510 +831,1274 @@ void setupWebRoutes() {
     request->send(200, "application/json", buildPollingStatusJSON());
   });
 
-  // API: Start manual polling (all devices)
-  webServer.on("/api/poll/start", HTTP_POST, [](AsyncWebServerRequest* request) {
+  // API: Boot phase timings
+  webServer.on("/api/boot", HTTP_GET, [](AsyncWebServerRequest* request) {
     if (!request->authenticate(web_username, web_password)) {
       return request->requestAuthentication();
     }
-    if (!pollingActive) {
-      startPollingCycle();
-      request->send(200, "application/json", "{\"status\":\"started\"}");
-    } else {
-      request->send(409, "application/json", "{\"error\":\"polling already active\"}");
+    StaticJsonDocument<512> doc;
+    addBootTimings(doc.to<JsonObject>());
+    String json;
+    serializeJson(doc, json);
+    request->send(200, "application/json", json);
+  });
+
+  // API: Upcoming polling work (schedule engine)
+  webServer.on("/api/schedule", HTTP_GET, [](AsyncWebServerRequest* request) {
+    if (!request->authenticate(web_username, web_password)) {
+      return request->requestAuthentication();
     }
+    request->send(200, "application/json", buildScheduleJSON());
   });
 
-  // API: Poll single device
-  webServer.on("/api/poll/device", HTTP_POST, [](AsyncWebServerRequest* request) {}, NULL,
+  // API: Set cadences
+  //   {"group":"storage","cadence_min":60}         create / update a group (0 deletes)
+  //   {"device_id":"ED0-00001","group":"storage"}  assign a device ("" = default)
+  //   {"device_id":"ED0-00001","cadence_min":5}    per-device override (0 clears)
+  //   {"default_cadence_min":15}                   gateway default (poll_interval)
+  webServer.on("/api/schedule", HTTP_POST, [](AsyncWebServerRequest* request) {}, NULL,
     [](AsyncWebServerRequest* request, uint8_t *data, size_t len, size_t index, size_t total) {
       if (!request->authenticate(web_username, web_password)) {
         return request->requestAuthentication();
       }
 
       StaticJsonDocument<256> doc;
-      DeserializationError error = deserializeJson(doc, data);
+      DeserializationError error = deserializeJson(doc, data, len);
 
       if (error) {
         request->send(400, "application/json", "{\"success\":false,\"error\":\"Invalid JSON\"}");
         return;
       }
 
-      String deviceId = doc["device_id"];
-      int deviceIndex = getDeviceIndexById(deviceId);
-
-      if (deviceIndex == -1) {
-        request->send(404, "application/json", "{\"success\":false,\"error\":\"Device not found\"}");
+      int cadence = doc["cadence_min"] | -1;
+      if (cadence > SCHEDULE_MAX_CADENCE_MIN) {
+        request->send(400, "application/json", "{\"success\":false,\"error\":\"cadence_min out of range\"}");
         return;
       }
 
-      if (pollingActive) {
-        request->send(409, "application/json", "{\"success\":false,\"error\":\"Polling cycle already active\"}");
-        return;
+      if (doc.containsKey("default_cadence_min")) {
+        int minutes = doc["default_cadence_min"];
+        if (minutes < 1 || minutes > SCHEDULE_MAX_CADENCE_MIN) {
+          request->send(400, "application/json", "{\"success\":false,\"error\":\"default_cadence_min out of range\"}");
+          return;
+        }
+        config.pollingIntervalMinutes = minutes;
+        scheduleSetDefaultCadence(minutes);
+        saveConfiguration();
+      }
+
+      if (doc.containsKey("device_id")) {
+        String deviceId = doc["device_id"];
+        FleetLock lock;
+        int deviceIndex = getDeviceIndexById(deviceId.c_str());
+        if (deviceIndex == -1) {
+          request->send(404, "application/json", "{\"success\":false,\"error\":\"Device not found\"}");
+          return;
+        }
+
+        DeviceInfo& device = devices[deviceIndex];
+        if (doc.containsKey("group")) {
+          String name = doc["group"] | "";
+          int groupId = (name.length() == 0) ? 0 : scheduleFindGroup(name.c_str());
+          if (groupId < 0) {
+            request->send(404, "application/json", "{\"success\":false,\"error\":\"Group not found\"}");
+            return;
+          }
+          device.scheduleGroup = groupId;
+        }
+        if (cadence >= 0) device.cadenceMinutes = cadence;
+
+        scheduleCadenceChanged(devices, deviceIndex, millis());
+        registryMarkDirty();
+        fleetPublish();
+        LOG_I("API", "Schedule for %s: every %lu min", deviceId, scheduleCadenceMs(device) / 60000UL);
+      } else if (doc.containsKey("group")) {
+        String name = doc["group"] | "";
+        int previousId = scheduleFindGroup(name.c_str());
+
+        if (cadence < 0) {
+          request->send(400, "application/json", "{\"success\":false,\"error\":\"cadence_min required\"}");
+          return;
+        }
+
+        int groupId = scheduleSetGroup(preferences, name.c_str(), cadence);
+        if (groupId < 0) {
+          request->send(400, "application/json", "{\"success\":false,\"error\":\"Invalid group or group table full\"}");
+          return;
+        }
+
+        // Deleted group: members fall back to the default so the id can be reused safely
+        FleetLock lock;
+        for (int i = 0; i < config.numDevices; i++) {
+          if (groupId == 0 && previousId > 0 && devices[i].scheduleGroup == previousId) {
+            devices[i].scheduleGroup = 0;
+            registryMarkDirty();
+          }
+          if (devices[i].scheduleGroup == groupId && groupId > 0) {
+            scheduleCadenceChanged(devices, i, millis());
+          }
+        }
+        fleetPublish();
       }
 
-      // Send POLL command directly to this device
-      DeviceInfo& device = devices[deviceIndex];
+      request->send(200, "application/json", buildScheduleJSON());
+    });
 
-      Serial.println("\n>>> Manual POLL to: " + device.deviceId);
+  // API: Multi-gateway coordination (peers, our window)
+  webServer.on("/api/coord", HTTP_GET, [](AsyncWebServerRequest* request) {
+    if (!request->authenticate(web_username, web_password)) {
+      return request->requestAuthentication();
+    }
+    request->send(200, "application/json", buildCoordJSON());
+  });
 
-      String seq = generateSequence(sequenceCounter);
-      String message = config.gatewayId + ":" + String(CMD_POLL) + ":" + device.deviceId + ":" +
-                       seq + ":" + String(getCurrentTimestamp()) + ":null";
+  // API: WebSocket fan-out metrics
+  webServer.on("/api/ws", HTTP_GET, [](AsyncWebServerRequest* request) {
+    if (!request->authenticate(web_username, web_password)) {
+      return request->requestAuthentication();
+    }
+    request->send(200, "application/json", buildWsStatsJSON());
+  });
 
-      sendLoRaMessage(message, 1);
+  // API: Task health (stacks, heartbeats, busy time, loop latency, memory)
+  webServer.on("/api/diag", HTTP_GET, [](AsyncWebServerRequest* request) {
+    if (!request->authenticate(web_username, web_password)) {
+      return request->requestAuthentication();
+    }
+    request->send(200, "application/json", buildDiagJSON());
+  });
 
-      // Reset device state for this poll
-      device.phase = PHASE_HEALTH_CHECK;
-      device.retryCount = 0;
-      device.commandSent = true;  // Mark as sent
-      phaseStartTime = millis();
+  // API: Radio trace download (binary .trc, see radio_trace.h) - capture pauses until it is sent
+  webServer.on("/api/trace", HTTP_GET, [](AsyncWebServerRequest* request) {
+    if (!request->authenticate(web_username, web_password)) {
+      return request->requestAuthentication();
+    }
+    size_t total = traceFreeze();
+    if (total == 0) {
+      request->send(409, "application/json", "{\"error\":\"trace export already running\"}");
+      return;
+    }
+    request->onDisconnect([]() { traceThaw(); });
+
+    AsyncWebServerResponse* response = request->beginResponse("application/octet-stream", total,
+      [](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+        return traceRead(index, buffer, maxLen);
+      });
+    response->addHeader("Content-Disposition", "attachment; filename=\"radio.trc\"");
+    request->send(response);
+  });
 
-      request->send(200, "application/json", "{\"success\":true,\"message\":\"POLL sent to " + deviceId + "\"}");
+  // API: Write the trace to FFat (/radio.trc) - only with the filesystem mounted
+  if (ffatMounted) {
+    webServer.on("/api/trace/flush", HTTP_POST, [](AsyncWebServerRequest* request) {
+      if (!request->authenticate(web_username, web_password)) {
+        return request->requestAuthentication();
+      }
+      if (traceFlush(FFat, "/radio.trc")) {
+        request->send(200, "application/json", "{\"success\":true,\"path\":\"/radio.trc\"}");
+      } else {
+        request->send(503, "application/json", "{\"success\":false,\"error\":\"FFat write failed\"}");
+      }
     });
+  }
 
-  // API: Pair new device
-  webServer.on("/api/device/pair", HTTP_POST, [](AsyncWebServerRequest* request) {}, NULL,
+  // API: Trace control - {"enabled":false} pauses capture, {"clear":true} empties the ring
+  webServer.on("/api/trace", HTTP_POST, [](AsyncWebServerRequest* request) {}, NULL,
     [](AsyncWebServerRequest* request, uint8_t *data, size_t len, size_t index, size_t total) {
       if (!request->authenticate(web_username, web_password)) {
         return request->requestAuthentication();
       }
 
-      StaticJsonDocument<512> doc;
-      DeserializationError error = deserializeJson(doc, data);
-
-      if (error) {
+      StaticJsonDocument<64> doc;
+      if (deserializeJson(doc, data, len)) {
         request->send(400, "application/json", "{\"success\":false,\"error\":\"Invalid JSON\"}");
         return;
       }
 
-      String deviceId = doc["device_id"];
-      String tableLeft = doc["table_left"] | "";
-      String tableRight = doc["table_right"] | "";
+      if (doc.containsKey("enabled")) traceSetEnabled(doc["enabled"]);
+      if (doc["clear"] | false) traceClear();
 
-      // Validate device ID format (EDy-XXXXX)
-      if (!deviceId.startsWith("ED") || deviceId.length() != 9) {
-        request->send(400, "application/json", "{\"success\":false,\"error\":\"Invalid device ID format\"}");
-        return;
-      }
+      TraceStats stats = traceGetStats();
+      char response[96];
+      snprintf(response, sizeof(response), "{\"success\":true,\"enabled\":%s,\"records\":%u}",
+               stats.enabled ? "true" : "false", (unsigned)stats.records);
+      request->send(200, "application/json", response);
+    });
 
-      // Check if device already paired
-      for (int i = 0; i < config.numDevices; i++) {
-        if (devices[i].deviceId == deviceId) {
-          request->send(409, "application/json", "{\"success\":false,\"error\":\"Device already paired\"}");
+  // API: Bulk transfer progress (current or last transfer)
+  webServer.on("/api/bulk", HTTP_GET, [](AsyncWebServerRequest* request) {
+    if (!request->authenticate(web_username, web_password)) {
+      return request->requestAuthentication();
+    }
+    request->send(200, "application/json", buildBulkJSON());
+  });
+
+  // API: Start a bulk transfer - raw blob body, ?name=<path on device>&targets=ED0-00001,ED0-00002 (or "all")
+  webServer.on("/api/bulk", HTTP_POST, [](AsyncWebServerRequest* request) {}, NULL,
+    [](AsyncWebServerRequest* request, uint8_t *data, size_t len, size_t index, size_t total) {
+      static AsyncWebServerRequest* uploading = NULL;  // One upload at a time into the reserved blob
+      static uint8_t* blob = NULL;
+
+      if (index == 0) {
+        if (!request->authenticate(web_username, web_password)) {
+          return request->requestAuthentication();
+        }
+        if (!request->hasParam("name") || !request->hasParam("targets")) {
+          request->send(400, "application/json", "{\"success\":false,\"error\":\"name and targets required\"}");
           return;
         }
+        if (uploading != NULL || (blob = bulkReserve(total)) == NULL) {
+          request->send(409, "application/json",
+                        "{\"success\":false,\"error\":\"transfer running, blob too large or out of memory\"}");
+          return;
+        }
+        uploading = request;
+        request->onDisconnect([request]() {
+          if (uploading == request) uploading = NULL;
+        });
+      }
+      if (uploading != request) return;
+
+      memcpy(blob + index, data, len);
+      if (index + len < total) return;
+      uploading = NULL;
+
+      // Targets: comma-separated device IDs, or every paired device
+      char list[BULK_MAX_TARGETS * (NODE_ID_MAX + 1)];
+      const char* ids[BULK_MAX_TARGETS];
+      int numTargets = 0;
+
+      strncpy(list, request->getParam("targets")->value().c_str(), sizeof(list) - 1);
+      list[sizeof(list) - 1] = '\0';
+
+      if (strcmp(list, "all") == 0) {
+        FleetReader snapshot;
+        char* out = list;
+        for (int i = 0; i < snapshot->numDevices && numTargets < BULK_MAX_TARGETS; i++) {
+          if (!snapshot->devices[i].paired) continue;
+          size_t length = snapshot->devices[i].deviceId.length();
+          memcpy(out, snapshot->devices[i].deviceId.c_str(), length + 1);
+          ids[numTargets++] = out;
+          out += length + 1;
+        }
+      } else {
+        for (char* id = strtok(list, ","); id != NULL && numTargets < BULK_MAX_TARGETS; id = strtok(NULL, ",")) {
+          ids[numTargets++] = id;
+        }
       }
 
-      // Check capacity
-      if (config.numDevices >= 15) {
-        request->send(507, "application/json", "{\"success\":false,\"error\":\"Maximum devices reached (15)\"}");
+      int transferId = bulkStart(request->getParam("name")->value().c_str(), ids, numTargets, millis());
+      if (transferId < 0) {
+        request->send(400, "application/json", "{\"success\":false,\"error\":\"invalid name or targets\"}");
         return;
       }
 
-      // Add device
-      int idx = config.numDevices;
-      devices[idx].deviceId = deviceId;
-      devices[idx].sharedSecret = "temp_secret_" + deviceId; // TODO: Generate proper secret
-      devices[idx].paired = false; // Will be true after PAIR_ACK
-      devices[idx].tableLeft = tableLeft;
-      devices[idx].tableRight = tableRight;
-      devices[idx].phase = PHASE_IDLE;
-      devices[idx].online = false;
-      devices[idx].battery = -1;
-      devices[idx].rssi = 0;
-      devices[idx].snr = 0;
-      devices[idx].retryCount = 0;
-      devices[idx].commandSent = false;
-      devices[idx].positionsReceived = 0;
-      devices[idx].totalPolls = 0;
-      devices[idx].successfulPolls = 0;
-      devices[idx].failedPolls = 0;
-      devices[idx].lastContact = 0;
-
-      config.numDevices++;
-
-      // Save to FFat (disabled - will use Preferences)
-      // saveDevicePairing(devices[idx]);
-
-      // Save to NVS
-      saveConfiguration();
+      char response[96];
+      snprintf(response, sizeof(response), "{\"success\":true,\"transfer_id\":%d,\"targets\":%d}",
+               transferId, numTargets);
+      request->send(200, "application/json", response);
+    });
 
-      // Send PAIR command via LoRa with table data (simplified protocol - no HMAC)
-      // Format: GWx:PAIR:EDx:000:timestamp:table_left|table_right
-      String pairPayload = tableLeft + "|" + tableRight;
-      if (pairPayload == "|") pairPayload = "null";  // If both empty, send null
-      String pairMessage = config.gatewayId + ":PAIR:" + deviceId + ":000:" + String(getCurrentTimestamp()) + ":" + pairPayload;
-      sendLoRaMessage(pairMessage, 1);
+  // API: Abort the bulk transfer (BLK_ABORT is broadcast in the next idle slot)
+  webServer.on("/api/bulk/abort", HTTP_POST, [](AsyncWebServerRequest* request) {
+    if (!request->authenticate(web_username, web_password)) {
+      return request->requestAuthentication();
+    }
+    if (bulkAbort()) {
+      request->send(200, "application/json", "{\"success\":true}");
+    } else {
+      request->send(409, "application/json", "{\"success\":false,\"error\":\"no transfer running\"}");
+    }
+  });
 
-      Serial.println("[API] Device pairing initiated: " + deviceId);
+  // API: Link statistics, trends and alert level per device (most fragile first)
+  webServer.on("/api/link", HTTP_GET, [](AsyncWebServerRequest* request) {
+    if (!request->authenticate(web_username, web_password)) {
+      return request->requestAuthentication();
+    }
+    request->send(200, "application/json", buildLinkJSON());
+  });
 
-      request->send(200, "application/json", "{\"success\":true,\"message\":\"Pairing command sent\"}");
-    });
+  // API: Sequence spaces and replay windows per peer
+  webServer.on("/api/seq", HTTP_GET, [](AsyncWebServerRequest* request) {
+    if (!request->authenticate(web_username, web_password)) {
+      return request->requestAuthentication();
+    }
+    request->send(200, "application/json", buildSeqJSON());
+  });
 
-  // API: Remove device
-  webServer.on("/api/device/remove", HTTP_POST, [](AsyncWebServerRequest* request) {}, NULL,
+  // API: Forget a device's receive window - {"peer_id":"ED0-00001"} (its storage was wiped)
+  webServer.on("/api/seq/reset", HTTP_POST, [](AsyncWebServerRequest* request) {}, NULL,
     [](AsyncWebServerRequest* request, uint8_t *data, size_t len, size_t index, size_t total) {
       if (!request->authenticate(web_username, web_password)) {
         return request->requestAuthentication();
       }
 
-      StaticJsonDocument<256> doc;
-      DeserializationError error = deserializeJson(doc, data);
+      StaticJsonDocument<128> doc;
+      DeserializationError error = deserializeJson(doc, data, len);
 
       if (error) {
         request->send(400, "application/json", "{\"success\":false,\"error\":\"Invalid JSON\"}");
         return;
       }
 
-      String deviceId = doc["device_id"];
-      int deviceIndex = getDeviceIndexById(deviceId);
-
-      if (deviceIndex == -1) {
+      const char* peerId = doc["peer_id"] | "";
+      if (getDeviceIndexById(peerId) == -1) {
         request->send(404, "application/json", "{\"success\":false,\"error\":\"Device not found\"}");
         return;
       }
 
-      // Remove device by shifting array
-      for (int i = deviceIndex; i < config.numDevices - 1; i++) {
-        devices[i] = devices[i + 1];
+      seqReseed(peerId, 0);  // Its next frame seeds the window
+      LOG_I("API", "Sequence window reset: %s", peerId);
+      request->send(200, "application/json", buildSeqJSON());
+    });
+
+  // API: Energy model and projected time-to-empty per device
+  webServer.on("/api/energy", HTTP_GET, [](AsyncWebServerRequest* request) {
+    if (!request->authenticate(web_username, web_password)) {
+      return request->requestAuthentication();
+    }
+    request->send(200, "application/json", buildEnergyJSON());
+  });
+
+  // API: Battery-life target - {"target_days":30} (0 = always full service)
+  webServer.on("/api/energy", HTTP_POST, [](AsyncWebServerRequest* request) {}, NULL,
+    [](AsyncWebServerRequest* request, uint8_t *data, size_t len, size_t index, size_t total) {
+      if (!request->authenticate(web_username, web_password)) {
+        return request->requestAuthentication();
       }
-      config.numDevices--;
 
-      // Save updated list
-      saveConfiguration();
+      StaticJsonDocument<64> doc;
+      DeserializationError error = deserializeJson(doc, data, len);
+
+      if (error) {
+        request->send(400, "application/json", "{\"success\":false,\"error\":\"Invalid JSON\"}");
+        return;
+      }
+
+      int days = doc["target_days"] | -1;
+      if (days < 0 || days > ENERGY_MAX_TARGET_DAYS) {
+        request->send(400, "application/json", "{\"success\":false,\"error\":\"target_days out of range\"}");
+        return;
+      }
 
-      Serial.println("[API] Device removed: " + deviceId);
+      config.energyTargetDays = days;
+      energySetTargetDays(days);
+      saveConfiguration();
 
-      request->send(200, "application/json", "{\"success\":true,\"message\":\"Device removed\"}");
+      LOG_I("API", "Battery-life target: %d days", days);
+      request->send(200, "application/json", buildEnergyJSON());
     });
-}
 
-// ==================== STORAGE INITIALIZATION ====================
+  // API: Gateway clock discipline and device clocks
+  webServer.on("/api/time", HTTP_GET, [](AsyncWebServerRequest* request) {
+    if (!request->authenticate(web_username, web_password)) {
+      return request->requestAuthentication();
+    }
+    request->send(200, "application/json", buildTimeJSON());
+  });
 
-void initFFat() {
-  Serial.println("[FFAT] Filesystem disabled (using Preferences only)");
+  // API: MQTT payload encoding per topic (same JSON as the retained meta topic)
+  webServer.on("/api/mqtt/encoding", HTTP_GET, [](AsyncWebServerRequest* request) {
+    if (!request->authenticate(web_username, web_password)) {
+      return request->requestAuthentication();
+    }
+    char buffer[256];
+    codecBuildMeta(buffer, sizeof(buffer));
+    request->send(200, "application/json", buffer);
+  });
 
-  // FFat disabled - partition issue with ESP32-S3-N16R8
-  // To enable: Tools → Partition Scheme → "16M Flash (3MB APP/9.9MB FATFS)"
+  // API: Set encoding - {"topic":"device","encoding":"msgpack"} ("topic":"all" for every topic)
+  webServer.on("/api/mqtt/encoding", HTTP_POST, [](AsyncWebServerRequest* request) {}, NULL,
+    [](AsyncWebServerRequest* request, uint8_t *data, size_t len, size_t index, size_t total) {
+      if (!request->authenticate(web_username, web_password)) {
+        return request->requestAuthentication();
+      }
 
-  // if (!FFat.begin(true)) {
-  //   Serial.println("[FFAT] Failed to mount FFat!");
-  //   return;
-  // }
-  // Serial.println("[FFAT] Filesystem mounted");
-  // Serial.println("[FFAT] Total: " + String(FFat.totalBytes() / 1024) + " KB");
-  // Serial.println("[FFAT] Used: " + String(FFat.usedBytes() / 1024) + " KB");
-}
+      StaticJsonDocument<128> doc;
+      DeserializationError error = deserializeJson(doc, data, len);
 
-void loadConfiguration() {
-  preferences.begin("detectra", true);  // Read-only
+      if (error) {
+        request->send(400, "application/json", "{\"success\":false,\"error\":\"Invalid JSON\"}");
+        return;
+      }
+
+      String topicName = doc["topic"] | "";
+      int encoding = codecFindEncoding(doc["encoding"] | "");
+      MqttTopic topic = codecFindTopic(topicName.c_str());
+
+      if (encoding < 0 || (topic == MQTT_TOPIC_COUNT && topicName != "all")) {
+        request->send(400, "application/json", "{\"success\":false,\"error\":\"Unknown topic or encoding\"}");
+        return;
+      }
+
+      if (topic == MQTT_TOPIC_COUNT) {
+        codecSetMask(encoding == ENCODING_MSGPACK ? 0xFF : 0);
+      } else {
+        codecSetEncoding(topic, (PayloadEncoding)encoding);
+      }
+      saveConfiguration();
+      metaChanged = true;
+
+      LOG_I("API", "MQTT %s payloads now %s", topicName, codecContentType((PayloadEncoding)encoding));
+
+      char buffer[256];
+      codecBuildMeta(buffer, sizeof(buffer));
+      request->send(200, "application/json", buffer);
+    });
+
+  // API: Start manual polling (all devices)
+  webServer.on("/api/poll/start", HTTP_POST, [](AsyncWebServerRequest* request) {
+    if (!request->authenticate(web_username, web_password)) {
+      return request->requestAuthentication();
+    }
+    if (!bootIsDone(BOOT_LORA)) {
+      request->send(503, "application/json", "{\"error\":\"radio still initializing\"}");
+    } else if (!pollingActive) {
+      scheduleRequest(-1);  // pollingTask starts the cycle within 100 ms
+      request->send(200, "application/json", "{\"status\":\"started\"}");
+    } else {
+      request->send(409, "application/json", "{\"error\":\"polling already active\"}");
+    }
+  });
+
+  // API: Poll single device - queued as a job, run by pollingTask (between cycle devices)
+  webServer.on("/api/poll/device", HTTP_POST, [](AsyncWebServerRequest* request) {}, NULL,
+    [](AsyncWebServerRequest* request, uint8_t *data, size_t len, size_t index, size_t total) {
+      submitJob(request, data, len, JOB_POLL);
+    });
+
+  // API: Ad-hoc job {"device_id": "ED0-00001", "kind": "poll" | "inference" | "health"}
+  webServer.on("/api/jobs", HTTP_POST, [](AsyncWebServerRequest* request) {}, NULL,
+    [](AsyncWebServerRequest* request, uint8_t *data, size_t len, size_t index, size_t total) {
+      submitJob(request, data, len, JOB_POLL);
+    });
+
+  // API: Jobs (queued, running and the last finished)
+  webServer.on("/api/jobs", HTTP_GET, [](AsyncWebServerRequest* request) {
+    if (!request->authenticate(web_username, web_password)) {
+      return request->requestAuthentication();
+    }
+    request->send(200, "application/json", buildJobsJSON());
+  });
+
+  // API: One job - ?id=N, with &wait_ms=M the reply waits until the job has finished (long-poll)
+  webServer.on("/api/job", HTTP_GET, [](AsyncWebServerRequest* request) {
+    if (!request->authenticate(web_username, web_password)) {
+      return request->requestAuthentication();
+    }
+    if (!request->hasParam("id")) {
+      request->send(400, "application/json", "{\"success\":false,\"error\":\"Missing id\"}");
+      return;
+    }
+
+    uint32_t id = request->getParam("id")->value().toInt();
+    JobInfo job;
+    if (!jobGet(id, job)) {
+      request->send(404, "application/json", "{\"success\":false,\"error\":\"Job not found\"}");
+      return;
+    }
+
+    unsigned long waitMs = request->hasParam("wait_ms") ? request->getParam("wait_ms")->value().toInt() : 0;
+    if (waitMs > JOB_WAIT_MAX_MS) waitMs = JOB_WAIT_MAX_MS;
+    if (waitMs == 0 || job.state == JOB_DONE || job.state == JOB_FAILED) {
+      request->send(200, "application/json", buildJobJSON(job));
+      return;
+    }
+
+    // Long-poll without holding the web server: the chunked response asks to be called
+    // again (every AsyncTCP poll) until the job has finished or the wait is over
+    unsigned long deadline = millis() + waitMs;
+    String body;
+    request->send(request->beginChunkedResponse("application/json",
+      [id, deadline, body](uint8_t* buffer, size_t maxLen, size_t index) mutable -> size_t {
+        if (index == 0) {
+          JobInfo current;
+          bool known = jobGet(id, current);
+          bool finished = !known || current.state == JOB_DONE || current.state == JOB_FAILED;
+          if (!finished && (long)(millis() - deadline) < 0) return RESPONSE_TRY_AGAIN;
+          body = known ? buildJobJSON(current) : String("{\"success\":false,\"error\":\"Job not found\"}");
+        }
+        if (index >= body.length()) return 0;
+
+        size_t n = body.length() - index;
+        if (n > maxLen) n = maxLen;
+        memcpy(buffer, body.c_str() + index, n);
+        return n;
+      }));
+  });
+
+  // API: Bulk pairing progress (current or last batch). Registered before /api/device/pair,
+  // which would otherwise take /api/device/pair/bulk as a sub-path
+  webServer.on("/api/device/pair/bulk", HTTP_GET, [](AsyncWebServerRequest* request) {
+    if (!request->authenticate(web_username, web_password)) {
+      return request->requestAuthentication();
+    }
+    request->send(200, "application/json", buildPairingJSON());
+  });
+
+  // API: Bulk pairing - CSV body "device_id,table_left,table_right", one device per line
+  webServer.on("/api/device/pair/bulk", HTTP_POST, [](AsyncWebServerRequest* request) {}, NULL,
+    [](AsyncWebServerRequest* request, uint8_t *data, size_t len, size_t index, size_t total) {
+      static AsyncWebServerRequest* uploading = NULL;  // One upload at a time into csv[]
+      static char csv[PAIR_BATCH_CSV_MAX];
+      static PairRow rows[PAIR_BATCH_MAX_ROWS];
+
+      if (index == 0) {
+        if (!request->authenticate(web_username, web_password)) {
+          return request->requestAuthentication();
+        }
+        if (total > PAIR_BATCH_CSV_MAX) {
+          request->send(413, "application/json", "{\"success\":false,\"error\":\"CSV too large\"}");
+          return;
+        }
+        if (uploading != NULL || pairBatchActive()) {
+          request->send(409, "application/json", "{\"success\":false,\"error\":\"Pairing batch running\"}");
+          return;
+        }
+        uploading = request;
+        request->onDisconnect([request]() {
+          if (uploading == request) uploading = NULL;
+        });
+      }
+      if (uploading != request) return;
+
+      memcpy(csv + index, data, len);
+      if (index + len < total) return;
+      uploading = NULL;
+
+      int truncated = 0;
+      int count = pairBatchParseCsv(csv, total, rows, PAIR_BATCH_MAX_ROWS, &truncated);
+
+      // Gateway-side checks; devices added earlier but never acknowledged are paired again.
+      // Under the fleet lock: devices[] grows while pollingTask may be reading it.
+      FleetLock lock;
+      registryHold(true);  // The batch is written once, when it is done
+      int added = 0;
+      for (int r = 0; r < count; r++) {
+        PairRow& row = rows[r];
+        if (row.state != PAIR_ROW_QUEUED) continue;
+
+        int idx = getDeviceIndexById(row.deviceId.c_str());
+        if (idx != -1 && devices[idx].paired) {
+          row.state = PAIR_ROW_REJECTED;
+          row.reason = "already paired";
+        } else if (idx != -1) {
+          devices[idx].tableLeft = row.tableLeft;
+          devices[idx].tableRight = row.tableRight;
+          added++;
+        } else if (addPendingDevice(row.deviceId.c_str(), row.tableLeft.c_str(), row.tableRight.c_str()) < 0) {
+          row.state = PAIR_ROW_REJECTED;
+          row.reason = "gateway full";
+        } else {
+          added++;
+        }
+      }
+
+      int batchId = added > 0 ? pairBatchStart(rows, count, millis()) : -1;
+      if (added > 0) {
+        scheduleRebuild(devices, config.numDevices);
+        fleetPublish();
+        registryMarkDirty();
+      }
+      if (batchId < 0) {
+        registryHold(false);
+        request->send(400, "application/json", "{\"success\":false,\"error\":\"No device to pair\"}");
+        return;
+      }
+
+      char response[128];
+      snprintf(response, sizeof(response),
+               "{\"success\":true,\"batch_id\":%d,\"queued\":%d,\"rejected\":%d,\"truncated\":%d}",
+               batchId, added, count - added, truncated);
+      request->send(202, "application/json", response);
+    });
+
+  // API: Pair new device
+  webServer.on("/api/device/pair", HTTP_POST, [](AsyncWebServerRequest* request) {}, NULL,
+    [](AsyncWebServerRequest* request, uint8_t *data, size_t len, size_t index, size_t total) {
+      if (!request->authenticate(web_username, web_password)) {
+        return request->requestAuthentication();
+      }
+
+      StaticJsonDocument<512> doc;
+      DeserializationError error = deserializeJson(doc, data);
+
+      if (error) {
+        request->send(400, "application/json", "{\"success\":false,\"error\":\"Invalid JSON\"}");
+        return;
+      }
+
+      String deviceId = doc["device_id"];
+      String tableLeft = doc["table_left"] | "";
+      String tableRight = doc["table_right"] | "";
+
+      // Validate device ID format (EDy-XXXXX)
+      if (!deviceId.startsWith("ED") || deviceId.length() != 9) {
+        request->send(400, "application/json", "{\"success\":false,\"error\":\"Invalid device ID format\"}");
+        return;
+      }
+
+      // Checks and append under the fleet lock (pollingTask and loraTask use devices[] too)
+      {
+        FleetLock lock;
+
+        // Check if device already paired
+        for (int i = 0; i < config.numDevices; i++) {
+          if (devices[i].deviceId == deviceId) {
+            request->send(409, "application/json", "{\"success\":false,\"error\":\"Device already paired\"}");
+            return;
+          }
+        }
+
+        // Check capacity
+        if (config.numDevices >= MAX_DEVICES) {
+          request->send(507, "application/json", "{\"success\":false,\"error\":\"Maximum devices reached (15)\"}");
+          return;
+        }
+
+        // Add device (paired after PAIR_ACK), then send PAIR with the table data
+        addPendingDevice(deviceId.c_str(), tableLeft.c_str(), tableRight.c_str());
+        scheduleRebuild(devices, config.numDevices);
+        fleetPublish();
+
+        // Persist to the NVS registry (debounced)
+        registryMarkDirty();
+      }
+
+      sendPairFrame(deviceId.c_str(), tableLeft.c_str(), tableRight.c_str());
+
+      LOG_I("API", "Device pairing initiated: %s", deviceId);
+
+      request->send(200, "application/json", "{\"success\":true,\"message\":\"Pairing command sent\"}");
+    });
+
+  // API: Remove device
+  webServer.on("/api/device/remove", HTTP_POST, [](AsyncWebServerRequest* request) {}, NULL,
+    [](AsyncWebServerRequest* request, uint8_t *data, size_t len, size_t index, size_t total) {
+      if (!request->authenticate(web_username, web_password)) {
+        return request->requestAuthentication();
+      }
+
+      StaticJsonDocument<256> doc;
+      DeserializationError error = deserializeJson(doc, data);
+
+      if (error) {
+        request->send(400, "application/json", "{\"success\":false,\"error\":\"Invalid JSON\"}");
+        return;
+      }
+
+      String deviceId = doc["device_id"];
+
+      // pollOrder[], cycleDevices, jobDeviceIndex and the census roster hold device
+      // indexes - the array only shifts while none of them is in use. pollingTask
+      // starts cycles, jobs and censuses under the fleet lock, so the check holds
+      // until the shift is done.
+      FleetLock lock;
+      int deviceIndex = getDeviceIndexById(deviceId.c_str());
+
+      if (deviceIndex == -1) {
+        request->send(404, "application/json", "{\"success\":false,\"error\":\"Device not found\"}");
+        return;
+      }
+
+      if (pollingActive || censusActive || jobRunning) {
+        request->send(409, "application/json",
+                      "{\"success\":false,\"error\":\"Polling cycle or job running - retry when idle\"}");
+        return;
+      }
+      jobDropDevice(deviceId.c_str(), millis());
+
+      // Remove device by shifting array
+      for (int i = deviceIndex; i < config.numDevices - 1; i++) {
+        devices[i] = devices[i + 1];
+        deviceResults[i] = deviceResults[i + 1];
+        deviceTables[i] = deviceTables[i + 1];
+      }
+      config.numDevices--;
+      scheduleRebuild(devices, config.numDevices);
+      fleetPublish();
+
+      // Persist to the NVS registry (debounced)
+      registryMarkDirty();
+
+      LOG_I("API", "Device removed: %s", deviceId);
+
+      request->send(200, "application/json", "{\"success\":true,\"message\":\"Device removed\"}");
+    });
+}
+
+// ==================== STORAGE INITIALIZATION ====================
+
+void initFFat() {
+  Serial.println("[FFAT] Filesystem disabled (using Preferences only)");
+
+  // FFat disabled - partition issue with ESP32-S3-N16R8
+  // To enable: Tools → Partition Scheme → "16M Flash (3MB APP/9.9MB FATFS)"
+
+  // if (!FFat.begin(true)) {
+  //   Serial.println("[FFAT] Failed to mount FFat!");
+  //   return;
+  // }
+  // ffatMounted = true;
+  // Serial.println("[FFAT] Filesystem mounted");
+  // Serial.println("[FFAT] Total: " + String(FFat.totalBytes() / 1024) + " KB");
+  // Serial.println("[FFAT] Used: " + String(FFat.usedBytes() / 1024) + " KB");
+  //
+  // if (LOG_TO_FFAT) logOpenFile(FFat, "/gateway.log");
+}
+
+void initStorage() {
+  initFFat();
+  loadConfiguration();
+  loadDevicePairings();
+  scheduleInit(preferences, devices, config.numDevices, config.pollingIntervalMinutes, POLL_ON_BOOT);
+  energyInit(config.energyTargetDays);
+  linkInit(publishLinkAlert);
+  seqLoad(preferences, isRegisteredDevice);
+  fleetSnapshotInit(fillFleetSnapshot);  // Readers see the restored fleet from here on
+  coordInit(config.gatewayId.c_str(), LORA_FREQ "/" LORA_SF "/" LORA_BW);
+  traceSetGatewayId(config.gatewayId.c_str());
+  initMQTT();
+}
+
+void loadConfiguration() {
+  preferences.begin("detectra", true);  // Read-only
 
   config.gatewayId = preferences.getString("gateway_id", "GW0-00001");
   config.building = preferences.getString("building", "BLR");
   config.floor = preferences.getString("floor", "13");
   config.lab = preferences.getString("lab", "Innovation Lab");
   config.pollingIntervalMinutes = preferences.getInt("poll_interval", 5);  // 5 minutes for development
-  config.numDevices = preferences.getInt("num_devices", 0);
+  config.energyTargetDays = preferences.getInt("energy_days", ENERGY_TARGET_DAYS);
+  codecSetMask(preferences.getUChar(MQTT_ENCODING_NVS_KEY, 0));               // All JSON unless changed
 
   preferences.end();
 
   Serial.println("[CONFIG] Configuration loaded");
   Serial.println("  Gateway ID: " + config.gatewayId);
   Serial.println("  Location: " + config.building + "-" + config.floor + "-" + config.lab);
-  Serial.println("  Devices: " + String(config.numDevices));
 }
 
 void loadDevicePairings() {
-  // FFat disabled - device pairings stored in config.numDevices via Preferences
-  Serial.println("[CONFIG] Device pairings loaded from Preferences (count: " + String(config.numDevices) + ")");
+  // Whole fleet in one NVS blob (IDs, secrets, tables, link stats)
+  config.numDevices = registryLoad(preferences, devices, MAX_DEVICES);
 
-  // FFat-based loading disabled:
-  // File file = FFat.open("/device_secrets.json", "r");
-  // if (!file) {
-  //   Serial.println("[CONFIG] No device pairings found");
-  //   return;
-  // }
-  //
-  // StaticJsonDocument<4096> doc;
-  // DeserializationError error = deserializeJson(doc, file);
-  // file.close();
-  //
-  // if (error) {
-  //   Serial.println("[CONFIG] Failed to parse device_secrets.json");
-  //   return;
-  // }
-  //
-  // JsonArray devicesArray = doc["devices"];
-  // int count = 0;
-  //
-  // for (JsonObject deviceObj : devicesArray) {
-  //   if (count >= 15) break;
-  //
-  //   devices[count].deviceId = deviceObj["device_id"].as<String>();
-  //   devices[count].sharedSecret = deviceObj["shared_secret"].as<String>();
-  //   devices[count].paired = true;
-  //   devices[count].phase = PHASE_IDLE;
-  //   devices[count].retryCount = 0;
-  //   devices[count].online = false;
-  //   devices[count].positionsReceived = 0;
-  //
-  //   Serial.println("[CONFIG] Loaded device: " + devices[count].deviceId);
-  //   count++;
-  // }
-  //
-  // config.numDevices = count;
-  // Serial.println("[CONFIG] Loaded " + String(count) + " device pairings");
+  const RegistryStats& reg = registryGetStats();
+  Serial.println("[REGISTRY] " + String(registryStatusToString(reg.loadStatus)) + ": " +
+                 String(config.numDevices) + " devices restored (" + String(reg.blobBytes) + " bytes, " +
+                 String(reg.loadUs) + " us) at " + String(reg.restoredAtMs) + " ms after boot");
+
+  if (reg.loadStatus != REGISTRY_OK && reg.loadStatus != REGISTRY_EMPTY) {
+    Serial.println("[REGISTRY] ⚠ Stored registry rejected - devices must be re-paired");
+  }
 }
 
 // ==================== LORA TASK (Core 0) ====================
 
 void loraTask(void* parameter) {
-  Serial.println("[LORA TASK] Started on Core " + String(xPortGetCoreID()));
+  LOG_I("LORA TASK", "Started on Core %d", xPortGetCoreID());
+
+  // initLoRa() reads the AT replies itself until the radio is configured
+  bootWaitFor(BOOT_BIT(BOOT_LORA));
+
+  static char loraBuffer[RX_LINE_MAX + 1];
+  size_t loraLength = 0;
+  bool overflow = false;
 
-  String loraBuffer = "";
+  diagTaskStarted(DIAG_TASK_LORA, true);
 
   while (true) {
+    diagBeat(DIAG_TASK_LORA);
+
     // Read from LoRa Module 1
     while (LoRa1.available()) {
       char c = LoRa1.read();
       if (c == '\n') {
-        if (loraBuffer.length() > 0) {
-          handleLoRaResponse(loraBuffer, 1);
-          loraBuffer = "";
+        if (loraLength > 0 && !overflow) {
+          loraBuffer[loraLength] = '\0';
+          traceRecord(1, TRACE_RX, loraBuffer, loraLength);
+          handleLoRaResponse(loraBuffer, loraLength, 1);
+        } else if (overflow) {
+          LOG_W("LORA1", "RX line too long - dropped");
         }
+        loraLength = 0;
+        overflow = false;
       } else if (c != '\r') {
-        loraBuffer += c;
+        if (loraLength < RX_LINE_MAX) {
+          loraBuffer[loraLength++] = c;
+        } else {
+          overflow = true;
+        }
       }
     }
 
     // TODO: Read from LoRa Module 2
 
-    lastLoRaActivity = millis();
+    diagIdle(DIAG_TASK_LORA);
     vTaskDelay(5 / portTICK_PERIOD_MS);  // Reduced from 10ms to 5ms for faster serial reading
   }
 }
 
-void handleLoRaResponse(String response, int loraModule) {
-  response.trim();
+// ==================== LORA TX TASK (Core 0) ====================
 
-  Serial.println("[LORA" + String(loraModule) + "] RX: " + response);
+void loraTxTask(void* parameter) {
+  int loraModule = (int)(intptr_t)parameter;
+  LOG_I("LORA TX", "Radio %d TX task started on Core %d", loraModule, xPortGetCoreID());
 
-  // Check if it's a received message (starts with "+EVT:RXP2P:")
-  if (response.startsWith("+EVT:RXP2P:")) {
-    // Extract message after RSSI/SNR info
-    // Format: +EVT:RXP2P:-49:10:4544302D30...
-    // (RSSI:-49, SNR:10, then HEX payload)
+  // initLoRa() writes the AT configuration itself
+  bootWaitFor(BOOT_BIT(BOOT_LORA));
 
-    // Find the LAST colon - hex payload always comes after it
-    int lastColon = response.lastIndexOf(':');
+  diagTaskStarted(DIAG_TASK_LORA_TX, true);
 
-    if (lastColon != -1) {
-      String hexMessage = response.substring(lastColon + 1);
-      hexMessage.trim();
+  while (true) {
+    diagBeat(DIAG_TASK_LORA_TX);
+    diagIdle(DIAG_TASK_LORA_TX);  // Blocks on the queue and the modem - busy time is in loraTxGetStats()
 
-      Serial.println("[LoRa HEX] " + hexMessage);  // Debug: print hex before decoding
+    // Next frame by priority, written once the modem has finished the previous one
+    loraTxService(loraModule, 1000);
+  }
+}
 
-      // Decode hex to ASCII
-      String decodedMessage = "";
-      for (size_t i = 0; i < hexMessage.length(); i += 2) {
-        if (i + 1 < hexMessage.length()) {
-          String byteString = hexMessage.substring(i, i + 2);
-          char byte = (char)strtol(byteString.c_str(), NULL, 16);
-          decodedMessage += byte;
-        }
-      }
+void handleLoRaResponse(char* response, size_t length, int loraModule) {
+  // Trim surrounding whitespace in place
+  while (length > 0 && isspace((unsigned char)response[length - 1])) response[--length] = '\0';
+  while (length > 0 && isspace((unsigned char)*response)) { response++; length--; }
 
-      Serial.println("[LoRa DECODED] ");
-      Serial.println(decodedMessage);
+  LOG_D(loraModule == 1 ? "LORA1" : "LORA2", "RX: %s", response);
 
-      totalMessages++;
+  // "+EVT:TXP2P DONE" / AT errors belong to the frame the TX task is sending
+  if (loraTxModemLine(loraModule, response, length)) return;
 
-      // Parse decoded message (simplified protocol - no HMAC verification)
-      LoRaMessage msg = parseMessage(decodedMessage);
+  // Received message: "+EVT:RXP2P:-49:10:4544302D30..." (RSSI:-49, SNR:10, then HEX payload),
+  // or a hex continuation line when the RAK3172 splits a long RX message
+  size_t hexLength = 0;
+  const char* hex = rxLineFrameHex(response, length, &hexLength);
+  if (hex == NULL) return;
 
-      if (msg.valid) {
-        Serial.println("[PROTOCOL] ✓ Message received from " + msg.senderId);
-        processIncomingMessage(msg);
-      } else {
-        Serial.println("[PROTOCOL] Invalid message format");
-      }
-    }
+  if (hex == response) LOG_D("LORA", "Detected continuation hex payload");
+  handleLoRaFrame(hex, hexLength, loraModule);
+}
+
+void handleLoRaFrame(const char* hex, size_t length, int loraModule) {
+  uint64_t rxMs = getCurrentTimeMs();  // Before decoding - the timestamp check works in ms
+
+  LOG_D("LORA HEX", "%s", hex);
+
+  // Decode hex to ASCII (table-driven, straight into a stack buffer)
+  char decodedMessage[LORA_MAX_FRAME + 1];
+  if (length > 2 * LORA_MAX_FRAME) length = 2 * LORA_MAX_FRAME;
+  int decodedLength = hexDecode(hex, length, (uint8_t*)decodedMessage);
+  if (decodedLength < 0) {
+    LOG_W("PROTOCOL", "Invalid hex payload");
+    return;
   }
-  // Handle hex payload that comes on a separate line (no +EVT: prefix)
-  // This happens when RAK3172 splits long RX messages across multiple lines
-  else if (response.length() > 16 && response.indexOf("EVT") == -1 && response.indexOf("OK") == -1 && response.indexOf("AT") == -1) {
-    // Check if this looks like a hex string (all characters are hex digits)
-    bool isHex = true;
-    for (size_t i = 0; i < response.length(); i++) {
-      char c = response[i];
-      if (!((c >= '0' && c <= '9') || (c >= 'A' && c <= 'F') || (c >= 'a' && c <= 'f'))) {
-        isHex = false;
-        break;
-      }
-    }
+  decodedMessage[decodedLength] = '\0';
 
-    if (isHex) {
-      Serial.println("[LoRa] Detected continuation hex payload");
+  LOG_D("LORA DECODED", "%s", decodedMessage);
 
-      // Decode hex to ASCII
-      String decodedMessage = "";
-      for (size_t i = 0; i < response.length(); i += 2) {
-        if (i + 1 < response.length()) {
-          String byteString = response.substring(i, i + 2);
-          char byte = (char)strtol(byteString.c_str(), NULL, 16);
-          decodedMessage += byte;
-        }
-      }
+  // Per-device state below changes under the fleet lock (pollingTask and web handlers)
+  FleetLock lock;
+  totalMessages++;
 
-      Serial.println("[LoRa DECODED] " + decodedMessage);
+  // Parse decoded message (simplified protocol - no HMAC verification)
+  LoRaMessage msg;
+  parseMessage(decodedMessage, decodedLength, msg);
 
-      totalMessages++;
+  if (msg.valid) {
+    // Registered devices only (pending pairings included) - per-sender state below is kept for them
+    int deviceIndex = getDeviceIndexById(msg.senderId.c_str());
+    if (deviceIndex == -1) {
+      LOG_W("PROTOCOL", "Frame from unknown sender %s - dropped", msg.senderId);
+      return;
+    }
 
-      // Parse decoded message (simplified protocol - no HMAC verification)
-      LoRaMessage msg = parseMessage(decodedMessage);
+    // Stale / replayed frames from devices on gateway time (see time_sync.h)
+    if (!timeSyncCheck(msg, rxMs, bulkFrameAirtimeMs(decodedLength))) return;
 
-      if (msg.valid) {
-        Serial.println("[PROTOCOL] ✓ Message received from " + msg.senderId);
-        processIncomingMessage(msg);
-      } else {
-        Serial.println("[PROTOCOL] Invalid message format");
+    // Retransmissions and replays by the sender's sequence (see seq_space.h)
+    if (msg.commandId == LORA_CMD_PAIR_ACK && !devices[deviceIndex].paired) {
+      seqReseed(msg.senderId.c_str(), msg.sequence);  // Being paired: its count starts here
+    } else {
+      SeqVerdict verdict = seqCheckRx(msg.senderId.c_str(), msg.sequence);
+      if (verdict == SEQ_DUPLICATE && msg.commandId == LORA_CMD_DATA) {
+        resendDataAck(msg);  // Our ACK was lost - stored once, acknowledged again
+        return;
       }
+      if (verdict == SEQ_DUPLICATE || verdict == SEQ_STALE) return;
     }
+
+    LOG_I("PROTOCOL", "✓ Message received from %s", msg.senderId);
+    processIncomingMessage(msg);
+  } else {
+    LOG_W("PROTOCOL", "Invalid message format");
   }
 }
 
-bool sendLoRaCommand(const String& command, int loraModule) {
-  if (loraModule == 1) {
-    LoRa1.println(command);
-  } else {
-    LoRa2.println(command);
+bool sendLoRaCommand(const String& command, int loraModule, unsigned long timeoutMs) {
+  // Bring-up only: loraTask is not reading the UART yet, so the reply is consumed here
+  HardwareSerial& port = (loraModule == 1) ? LoRa1 : LoRa2;
+  const char* tag = loraModule == 1 ? "LORA1" : "LORA2";
+
+  while (port.available()) port.read();  // Discard boot banner / stale replies
+  port.println(command);
+  traceRecord(loraModule, TRACE_TX, command.c_str(), command.length());
+
+  char line[96];
+  size_t length = 0;
+  unsigned long start = millis();
+
+  // Return on the final "OK" / "AT_ERROR"-style line instead of a fixed delay
+  while (millis() - start < timeoutMs) {
+    if (!port.available()) {
+      vTaskDelay(1);
+      continue;
+    }
+
+    char c = port.read();
+    if (c == '\r') continue;
+    if (c != '\n') {
+      if (length < sizeof(line) - 1) line[length++] = c;
+      continue;
+    }
+
+    line[length] = '\0';
+    if (length > 0) traceRecord(loraModule, TRACE_RX, line, length);
+    length = 0;
+    if (line[0] == '\0') continue;
+
+    LOG_D(tag, "%s -> %s", command, line);
+    if (strcmp(line, "OK") == 0) return true;
+    if (strstr(line, "ERROR") != NULL) {
+      LOG_W(tag, "%s failed: %s", command, line);
+      return false;
+    }
   }
 
-  delay(200);  // Wait for response
-  return true;
+  LOG_W(tag, "%s: no reply within %lums", command, timeoutMs);
+  return false;
 }
 
-bool sendLoRaMessage(const String& message, int loraModule) {
-  Serial.println("[LORA" + String(loraModule) + "] TX: " + message);
-
-  // Convert message to hex string for RAK3172
-  String hexPayload = "";
-  for (unsigned int i = 0; i < message.length(); i++) {
-    char hex[3];
-    sprintf(hex, "%02X", (unsigned char)message[i]);
-    hexPayload += hex;
+size_t sendLoRaMessage(const char* command, const char* targetId, const char* payload,
+                       int loraModule, TxPriority priority) {
+  // AT configuration still in progress (web handlers can run before the radio is up)
+  if (!bootIsDone(BOOT_LORA)) {
+    LOG_W(loraModule == 1 ? "LORA1" : "LORA2", "Radio not ready - %s to %s not sent", command, targetId);
+    return 0;
   }
 
-  String cmd = "AT+PSEND=" + hexPayload;
+  // pollingTask, loraTask and web handlers all transmit - only the radio's TX task writes the UART
+  LoRaTxSlot* slot = loraTxAcquire(loraModule, priority);
+  if (slot == NULL) return 0;
 
-  if (loraModule == 1) {
-    LoRa1.println(cmd);
-  } else {
-    LoRa2.println(cmd);
+  // Fields and hex encoding go straight into the slot's preallocated frame
+  // (sequence taken only once the frame has a slot - a refused frame leaves no gap in the target's space)
+  TxFrame& frame = slot->frame;
+  frameBegin(frame, config.gatewayId.c_str(), command, targetId, seqNextTx(targetId), getCurrentTimestamp());
+  frameAppend(frame, payload);
+
+  if (!frameFinish(frame, NULL)) {  // Simplified protocol - no HMAC
+    LOG_E(loraModule == 1 ? "LORA1" : "LORA2", "TX frame exceeds %d bytes - dropped", LORA_MAX_FRAME);
+    loraTxRelease(loraModule, slot);
+    return 0;
   }
 
-  return true;
+  size_t frameBytes = frame.textLen;
+  loraTxSubmit(loraModule, slot);
+
+  // Polls, beacons and replies share the duty cycle with bulk frames (charged by bulk_transfer)
+  if (loraModule == 1 && priority != TX_PRIO_BULK) bulkChargeAirtime(bulkFrameAirtimeMs(frameBytes), millis());
+  return frameBytes;
+}
+
+void writeLoRaFrame(int loraModule, const TxFrame& frame) {
+  // TX task only: one frame at a time, the modem has finished the previous one
+  LOG_D(loraModule == 1 ? "LORA1" : "LORA2", "TX: %s", frame.text);
+
+  HardwareSerial& port = (loraModule == 1) ? LoRa1 : LoRa2;
+  port.write((const uint8_t*)frame.line, frame.lineLen);
+  traceRecord(loraModule, TRACE_TX, frame.line, frame.lineLen);
+}
+
+size_t sendBulkFrame(const char* command, const char* targetId, const char* payload) {
+  return sendLoRaMessage(command, targetId, payload, 1, TX_PRIO_BULK);
+}
+
+unsigned long bulkFrameAirtimeMs(size_t frameBytes) {
+  return loraAirtimeMs(frameBytes, atoi(LORA_SF), atoi(LORA_BW), atoi(LORA_CR) + 5, atoi(LORA_PREAMBLE));
+}
+
+void sendTimeBeacon() {
+  // t_ is stamped for the end of the transmission - nothing may be queued ahead of the beacon
+  if (!pollingWaitTxIdle(TIME_BEACON_IDLE_MS)) return;
+
+  // Size the frame first (fixed-width payload)
+  char payload[TIME_BEACON_PAYLOAD_MAX];
+  size_t payloadLength = timeSyncBuildBeacon(payload, sizeof(payload), 0);
+  size_t frameBytes = frameTextLength(config.gatewayId.c_str(), CMD_TIME, BROADCAST_ID,
+                                      seqPeekTx(BROADCAST_ID), getCurrentTimestamp(), payloadLength);
+  unsigned long airtime = bulkFrameAirtimeMs(frameBytes);
+  timeSyncBuildBeacon(payload, sizeof(payload), airtime);
+
+  if (sendLoRaMessage(CMD_TIME, BROADCAST_ID, payload, 1) == 0) return;
+  timeSyncBeaconSent(millis());
 }
 
 // ==================== POLLING TASK (Core 1) ====================
 
 void pollingTask(void* parameter) {
-  Serial.println("[POLLING TASK] Started on Core " + String(xPortGetCoreID()));
+  LOG_I("POLLING TASK", "Started on Core %d", xPortGetCoreID());
+
+  // Polling needs the radio only - WiFi/MQTT may still be connecting (results are queued)
+  bootWaitFor(BOOT_BIT(BOOT_LORA));
+
+  diagTaskStarted(DIAG_TASK_POLLING, true);
 
   while (true) {
-    if (pollingActive && currentDeviceIndex < config.numDevices) {
-      DeviceInfo& device = devices[currentDeviceIndex];
+    diagBeat(DIAG_TASK_POLLING);
+    fleetLock();  // Cycle/job/census starts vs. device removal - released only to wait
+    fleetService();  // Publish postponed while readers held every spare snapshot
+
+    if (jobRunning) {
+      // Ad-hoc job (job_queue.h): its device has the phase machine to itself
+      serviceDevicePhase(devices[jobDeviceIndex]);
+    } else if (!pollingActive) {
+      // The only place cycles start: due devices (+ those due within the merge window),
+      // inside this gateway's window when the channel is shared with neighbours
+      if (schedulePending(millis()) && coordCanTransmit(millis())) {
+        int due = scheduleCollect(devices, config.numDevices, millis(), pollOrder);
+        if (due > 0) startPollingCycle(due);
+      }
 
-      // Process current phase
-      processPhase(device);
+      // Ad-hoc jobs back to back until the next cycle is due
+      if (!pollingActive && jobPending() && coordCanTransmit(millis()) && !bulkRadioBusy(millis())) {
+        startNextJob();
+      }
 
-      // Check for timeout
-      unsigned long elapsed = millis() - phaseStartTime;
-      unsigned long timeout = 0;
+      // Time beacon, then bulk transfer frames, fill the idle time until the next device is due
+      if (!pollingActive && !jobRunning && timeSyncBeaconDue(millis()) && !bulkRadioBusy(millis())) {
+        unsigned long now = millis();
+        unsigned long idle = scheduleIdleMs(devices, config.numDevices, now);
+        unsigned long window = coordWindowRemainingMs(now);
+        if ((idle < window ? idle : window) >= TIME_BEACON_IDLE_MS) sendTimeBeacon();
+      }
 
-      switch (device.phase) {
-        case PHASE_HEALTH_CHECK:
-          timeout = TIMEOUT_HEALTH_CHECK;
-          break;
-        case PHASE_START_INFERENCE:
-          timeout = TIMEOUT_START_INFER;
-          break;
-        case PHASE_DATA_COLLECTION:
-          timeout = TIMEOUT_DATA_COLLECT;
-          break;
-        case PHASE_FINALIZE:
-          timeout = TIMEOUT_FINALIZE;
-          break;
-        default:
-          timeout = 10000;
+      // Bulk pairing: PAIR frames between cycles (PAIR_ACK timeouts keep running during one)
+      if (!pollingActive && !jobRunning && pairBatchActive() && coordCanTransmit(millis())) {
+        pairBatchService(millis());
       }
 
-      if (elapsed > timeout) {
-        handlePhaseTimeout(device);
+      if (!pollingActive && !jobRunning && bulkActive()) {
+        unsigned long now = millis();
+        unsigned long idle = scheduleIdleMs(devices, config.numDevices, now);
+        unsigned long window = coordWindowRemainingMs(now);
+        bulkService(now, idle < window ? idle : window);
+      }
+    } else if (censusActive) {
+      // Slotted ONLINE replies are collected in handleAckOnline()
+      if (millis() - censusStartTime > censusWindow || censusResponses >= cycleDevices) {
+        finishHealthCensus();
       }
-    } else if (pollingActive && currentDeviceIndex >= config.numDevices) {
-      // All devices polled - complete cycle
+    } else if (currentDeviceIndex < cycleDevices && devices[pollOrder[currentDeviceIndex]].phase == PHASE_IDLE) {
+      // Device boundary: one queued job, then the next device - both held back until
+      // our coordination window opens
+      if (coordCanTransmit(millis())) {
+        if (!jobAtBoundary && jobPending()) {
+          startNextJob();
+        } else {
+          pollNextDevice();
+        }
+      }
+    } else if (currentDeviceIndex < cycleDevices) {
+      serviceDevicePhase(devices[pollOrder[currentDeviceIndex]]);
+    } else {
+      // All devices in this cycle polled (each was rescheduled as it finished)
       publishPollingComplete();
       generateCycleReport();
+      registryMarkDirty();  // Persist this cycle's link stats + poll counters
       pollingActive = false;
+      fleetPublish();
+      uiRefresh();  // Final counts on the OLED now, not at the next refresh
 
-      Serial.println("\n==========================================");
-      Serial.println(" Polling Cycle Complete");
-      Serial.println(" Duration: " + String((millis() - pollingStartTime) / 1000) + " seconds");
-      Serial.println(" Next cycle in: " + String(config.pollingIntervalMinutes) + " minutes");
-      Serial.println("==========================================\n");
-
-      // Schedule next cycle
-      delay(config.pollingIntervalMinutes * 60 * 1000);
-      startPollingCycle();
+      LOG_I("POLLING", "Polling Cycle Complete - %d devices, duration %lus",
+            cycleDevices, (millis() - pollingStartTime) / 1000);
     }
+    fleetUnlock();
 
+    diagIdle(DIAG_TASK_POLLING);
     vTaskDelay(100 / portTICK_PERIOD_MS);
   }
 }
 
-void startPollingCycle() {
-  Serial.println("\n==========================================");
-  Serial.println(" Starting Polling Cycle");
-  Serial.println(" Devices: " + String(config.numDevices));
-  Serial.println("==========================================\n");
+// pollingTask waits without the fleet lock: loraTask takes it for every received
+// frame, and the modem's TX events it forwards queue behind those frames
+void pollingDelay(unsigned long ms) {
+  fleetUnlock();
+  delay(ms);
+  fleetLock();
+}
+
+bool pollingWaitTxIdle(unsigned long timeoutMs) {
+  fleetUnlock();
+  bool idle = loraTxWaitIdle(1, timeoutMs);
+  fleetLock();
+  return idle;
+}
+
+void startPollingCycle(int deviceCount) {
+  LOG_I("POLLING", "Starting Polling Cycle - %d/%d devices due", deviceCount, config.numDevices);
+  bootPhaseDone(BOOT_FIRST_POLL);  // Boot-to-first-poll, measured from power-on
 
   pollingActive = true;
   currentDeviceIndex = 0;
+  jobAtBoundary = false;
+  cycleDevices = deviceCount;
   pollingStartTime = millis();
-  sequenceCounter = 0;
+  cycleId++;
+
+  // Fragile links first (link_health.h), while they still answer; the rest stay in
+  // registry order until the census reorders them
+  linkSortByFragility(devices, pollOrder, cycleDevices);
+
+  // Reset this cycle's devices to IDLE
+  for (int n = 0; n < cycleDevices; n++) {
+    DeviceInfo& device = devices[pollOrder[n]];
+    device.phase = PHASE_IDLE;
+    device.retryCount = 0;
+    device.positionsReceived = 0;
+    device.censusSeen = false;
+    tablesBeginCycle(deviceTables[pollOrder[n]], device.tableLeft.c_str(), device.tableRight.c_str());
+  }
 
-  // Reset all devices to IDLE
-  for (int i = 0; i < config.numDevices; i++) {
-    devices[i].phase = PHASE_IDLE;
-    devices[i].retryCount = 0;
-    devices[i].positionsReceived = 0;
+  if (ENABLE_HEALTH_CENSUS && cycleDevices > 0) {
+    // pollNextDevice() is called from finishHealthCensus() once all slots have elapsed
+    startHealthCensus();
+    fleetPublish();
+    publishPollingStatus();
+    wsNotify(WS_TOPIC_POLLING);
+    return;
   }
 
+  fleetPublish();
   publishPollingStatus();
-  notifyWebClients(buildPollingStatusJSON());
+  wsNotify(WS_TOPIC_POLLING);
 
   // Start first device
   pollNextDevice();
 }
 
+void startHealthCensus() {
+  // Roster = this cycle's due devices; roster position = reply slot
+  String roster = "";
+  const char* rosterIds[MAX_DEVICES];
+  for (int n = 0; n < cycleDevices; n++) {
+    if (n > 0) roster += ",";
+    roster += devices[pollOrder[n]].deviceId.c_str();
+    rosterIds[n] = devices[pollOrder[n]].deviceId.c_str();
+  }
+
+  // Tight slots when every device's clock is measured (time_sync.h), padded otherwise
+  unsigned int slotMs = timeSyncCensusSlotMs(rosterIds, cycleDevices, bulkFrameAirtimeMs(CENSUS_REPLY_BYTES));
+
+  // at_ is stamped when the payload is built - only valid if nothing is queued ahead of the broadcast
+  if (slotMs < CENSUS_SLOT_MS && !pollingWaitTxIdle(CENSUS_GUARD_MS)) slotMs = CENSUS_SLOT_MS;
+
+  LOG_I("CENSUS", "Health Census: cycle %u, %d slots x %ums%s", cycleId, cycleDevices, slotMs,
+        slotMs < CENSUS_SLOT_MS ? " (clock-synced)" : "");
+
+  String payload = buildCensusPayload(cycleId, slotMs, roster);
+  if (slotMs < CENSUS_SLOT_MS) {
+    // Tight slots are timed from at_ (gateway time of slot 0), not from each device's RX
+    uint64_t atMs = getCurrentTimeMs() + CENSUS_GUARD_MS;
+    String sized = buildCensusPayload(cycleId, slotMs, roster, atMs);
+    size_t textBytes = frameTextLength(config.gatewayId.c_str(), CMD_POLL, BROADCAST_ID,
+                                       seqPeekTx(BROADCAST_ID), getCurrentTimestamp(), sized.length());
+    payload = buildCensusPayload(cycleId, slotMs, roster, atMs + TIME_TX_LATENCY_MS + bulkFrameAirtimeMs(textBytes));
+  }
+  size_t frameBytes = sendLoRaMessage(CMD_POLL, BROADCAST_ID, payload.c_str(), 1);
+
+  // Slots are timed from the end of our broadcast at the device, so include its airtime
+  unsigned long txAirtime = bulkFrameAirtimeMs(frameBytes);
+  censusWindow = txAirtime + censusWindowMs(cycleDevices, slotMs);
+  censusResponses = 0;
+  censusStartTime = millis();
+  censusActive = true;
+}
+
+void finishHealthCensus() {
+  censusActive = false;
+
+  // Devices that answered go first; silent ones go last and get the full unicast POLL + retries
+  int roster[MAX_DEVICES];
+  memcpy(roster, pollOrder, cycleDevices * sizeof(int));
+
+  int n = 0;
+  for (int k = 0; k < cycleDevices; k++) {
+    if (devices[roster[k]].censusSeen) pollOrder[n++] = roster[k];
+  }
+  for (int k = 0; k < cycleDevices; k++) {
+    if (!devices[roster[k]].censusSeen) pollOrder[n++] = roster[k];
+  }
+
+  LOG_I("CENSUS", "%d/%d devices answered in %lums", censusResponses, cycleDevices,
+        millis() - censusStartTime);
+
+  currentDeviceIndex = 0;
+  fleetPublish();
+  if (coordCanTransmit(millis())) pollNextDevice();  // Otherwise pollingTask waits for our window
+}
+
 void pollNextDevice() {
-  if (currentDeviceIndex >= config.numDevices) {
+  if (currentDeviceIndex >= cycleDevices) {
     return;
   }
 
-  DeviceInfo& device = devices[currentDeviceIndex];
-
-  Serial.println("\n>>> Polling Device: " + device.deviceId + " (" +
-                 String(currentDeviceIndex + 1) + "/" + String(config.numDevices) + ")");
-
-  device.phase = PHASE_HEALTH_CHECK;
-  device.retryCount = 0;
-  device.commandSent = false;  // Reset flag when starting new device
-  phaseStartTime = millis();
-
-  publishPollingStatus();
-  notifyWebClients(buildPollingStatusJSON());
+  DeviceInfo& device = devices[pollOrder[currentDeviceIndex]];
+
+  LOG_I("POLLING", ">>> Polling Device: %s (%d/%d)", device.deviceId, currentDeviceIndex + 1, cycleDevices);
+
+  // Census responders already reported health this cycle - skip the unicast POLL round trip
+  device.phase = device.censusSeen ? PHASE_START_INFERENCE : PHASE_HEALTH_CHECK;
+  device.retryCount = 0;
+  device.commandSent = false;  // Reset flag when starting new device
+  phaseStartTime = millis();
+  deviceStartTime = phaseStartTime;
+  pollRecorded = false;
+  jobAtBoundary = false;  // The boundary after this device may run a job again
+
+  fleetPublish();
+  publishPollingStatus();
+  wsNotify(WS_TOPIC_POLLING);
+}
+
+void serviceDevicePhase(DeviceInfo& device) {
+  // Process current phase
+  processPhase(device);
+
+  // Check for timeout
+  unsigned long elapsed = millis() - phaseStartTime;
+  unsigned long timeout = 0;
+
+  switch (device.phase) {
+    case PHASE_HEALTH_CHECK:
+      timeout = TIMEOUT_HEALTH_CHECK;
+      break;
+    case PHASE_START_INFERENCE:
+      timeout = TIMEOUT_START_INFER;
+      break;
+    case PHASE_DATA_COLLECTION:
+      timeout = TIMEOUT_DATA_COLLECT;
+      break;
+    case PHASE_FINALIZE:
+      timeout = TIMEOUT_FINALIZE;
+      break;
+    default:
+      timeout = 10000;
+  }
+
+  if (elapsed > timeout) {
+    handlePhaseTimeout(device);
+  }
 }
 
 void processPhase(DeviceInfo& device) {
@@ -1025,10 +2106,7 @@ void processPhase(DeviceInfo& device) {
     case PHASE_HEALTH_CHECK: {
       // Send POLL command only once per phase entry
       if (!device.commandSent) {
-        String seq = generateSequence(sequenceCounter);
-        String message = config.gatewayId + ":" + String(CMD_POLL) + ":" + device.deviceId + ":" +
-                         seq + ":" + String(getCurrentTimestamp()) + ":null";
-        sendLoRaMessage(message, 1);
+        sendLoRaMessage(CMD_POLL, device.deviceId.c_str(), "null", 1);
         device.commandSent = true;  // Mark as sent
       }
       // Wait for response (handled in processIncomingMessage)
@@ -1036,12 +2114,13 @@ void processPhase(DeviceInfo& device) {
     }
 
     case PHASE_START_INFERENCE: {
-      // Send START_INFER command only once per phase entry
+      // Send START_INFER command only once per phase entry (energy plan may ask for fewer positions)
       if (!device.commandSent) {
-        String seq = generateSequence(sequenceCounter);
-        String message = config.gatewayId + ":" + String(CMD_START_INFER) + ":" + device.deviceId + ":" +
-                         seq + ":" + String(getCurrentTimestamp()) + ":null";
-        sendLoRaMessage(message, 1);
+        StartInferPayload infer;
+        infer.positions = device.positionsRequested;
+        char inferPayload[8];
+        encodeStartInferPayload(inferPayload, sizeof(inferPayload), infer);  // "null" = all positions
+        sendLoRaMessage(CMD_START_INFER, device.deviceId.c_str(), inferPayload, 1);
         device.commandSent = true;  // Mark as sent
       }
       break;
@@ -1049,7 +2128,7 @@ void processPhase(DeviceInfo& device) {
 
     case PHASE_DATA_COLLECTION: {
       // Wait for DATA messages from device
-      // Device will send 5 DATA messages
+      // Device will send positionsRequested DATA messages
       // Each will be acknowledged in processIncomingMessage
       break;
     }
@@ -1057,10 +2136,7 @@ void processPhase(DeviceInfo& device) {
     case PHASE_FINALIZE: {
       // Send FINALIZE command only once per phase entry
       if (!device.commandSent) {
-        String seq = generateSequence(sequenceCounter);
-        String message = config.gatewayId + ":" + String(CMD_FINALIZE) + ":" + device.deviceId + ":" +
-                         seq + ":" + String(getCurrentTimestamp()) + ":null";
-        sendLoRaMessage(message, 1);
+        sendLoRaMessage(CMD_FINALIZE, device.deviceId.c_str(), "null", 1);
         device.commandSent = true;  // Mark as sent
       }
       break;
@@ -1082,27 +2158,41 @@ void processPhase(DeviceInfo& device) {
 }
 
 void advancePhase(DeviceInfo& device) {
+  // Reply to this phase's command: its round trip feeds the link statistics
+  if (device.phase == PHASE_HEALTH_CHECK || device.phase == PHASE_START_INFERENCE ||
+      device.phase == PHASE_FINALIZE) {
+    linkRecordReply(device.deviceId.c_str(), true, millis() - phaseStartTime, millis());
+  }
+
   switch (device.phase) {
     case PHASE_HEALTH_CHECK:
+      // A health job ends with the health report
+      if (isJobDevice(device) && activeJob.kind == JOB_HEALTH) {
+        device.phase = PHASE_COMPLETE;
+        LOG_I("POLLING", "→ COMPLETE (health job)");
+        break;
+      }
       device.phase = PHASE_START_INFERENCE;
-      Serial.println("[POLLING] → START_INFERENCE");
+      LOG_I("POLLING", "→ START_INFERENCE");
       break;
 
     case PHASE_START_INFERENCE:
       device.phase = PHASE_DATA_COLLECTION;
-      Serial.println("[POLLING] → DATA_COLLECTION");
+      collectStartTime = millis();
+      LOG_I("POLLING", "→ DATA_COLLECTION");
       break;
 
     case PHASE_DATA_COLLECTION:
-      if (device.positionsReceived >= 5) {
+      if (device.positionsReceived >= device.positionsRequested) {
         device.phase = PHASE_FINALIZE;
-        Serial.println("[POLLING] → FINALIZE");
+        collectDurationMs = millis() - collectStartTime;
+        LOG_I("POLLING", "→ FINALIZE");
       }
       break;
 
     case PHASE_FINALIZE:
       device.phase = PHASE_COMPLETE;
-      Serial.println("[POLLING] → COMPLETE");
+      LOG_I("POLLING", "→ COMPLETE");
       break;
 
     default:
@@ -1112,211 +2202,380 @@ void advancePhase(DeviceInfo& device) {
   phaseStartTime = millis();
   device.retryCount = 0;
   device.commandSent = false;  // Reset flag when entering new phase
+  fleetPublish();
 }
 
 void handlePhaseTimeout(DeviceInfo& device) {
-  Serial.println("[POLLING] ⚠ Timeout in phase: " + phaseToString(device.phase));
+  LOG_W("POLLING", "⚠ Timeout in phase: %s", phaseToString(device.phase));
 
   device.retryCount++;
+  linkRecordReply(device.deviceId.c_str(), false, 0, millis());
 
   if (device.retryCount >= MAX_RETRIES) {
-    Serial.println("[POLLING] ✗ Max retries reached for " + device.deviceId);
+    LOG_W("POLLING", "✗ Max retries reached for %s", device.deviceId);
     device.phase = PHASE_ERROR;
     failedPolls++;
   } else {
     // Retry with exponential backoff
     unsigned long backoff = RETRY_DELAY_BASE * (1 << (device.retryCount - 1));
-    Serial.println("[POLLING] Retry " + String(device.retryCount) + "/" +
-                   String(MAX_RETRIES) + " after " + String(backoff) + "ms");
-    delay(backoff);
+    LOG_I("POLLING", "Retry %d/%d after %lums", device.retryCount, MAX_RETRIES, backoff);
+    pollingDelay(backoff);
     device.commandSent = false;  // Reset flag to allow retry transmission
     phaseStartTime = millis();
   }
+  fleetPublish();
 }
 
 void handleDeviceOffline(DeviceInfo& device) {
-  Serial.println("[POLLING] ✗ Device OFFLINE: " + device.deviceId);
+  LOG_W("POLLING", "✗ Device OFFLINE: %s", device.deviceId);
 
   device.online = false;
-  publishDeviceData(currentDeviceIndex);
+  publishDeviceData(activeDeviceIndex());
 
-  beepBuzzer(500);  // Alert beep
-  setLEDColor(255, 0, 0);  // Red
-  led.show();
+  uiBeep(500);  // Alert beep
+  uiLed(255, 0, 0);  // Red
+
+  // A failed job leaves the device's schedule alone - the cycle still polls it when due
+  if (jobRunning) {
+    finishJob(device, false, "device offline");
+    return;
+  }
+
+  scheduleCompleted(devices, pollOrder[currentDeviceIndex], millis());
+  coordRecordPoll(millis() - deviceStartTime);
 
   currentDeviceIndex++;
-  if (currentDeviceIndex < config.numDevices) {
-    delay(1000);
-    pollNextDevice();
+  fleetPublish();
+  if (currentDeviceIndex < cycleDevices) {
+    pollingDelay(1000);
+    // A queued job takes this boundary first (started by pollingTask); otherwise
+    // pollingTask waits for our window
+    if (!jobPending() && coordCanTransmit(millis())) pollNextDevice();
   }
 }
 
 void completeDevicePolling(DeviceInfo& device) {
-  Serial.println("[POLLING] ✓ Device COMPLETE: " + device.deviceId);
+  LOG_I("POLLING", "✓ Device COMPLETE: %s", device.deviceId);
 
+  int deviceIndex = activeDeviceIndex();
   device.online = true;
   device.lastContact = millis();
-  device.totalPolls++;
-  device.successfulPolls++;
-  successfulPolls++;
 
-  publishDeviceData(currentDeviceIndex);
+  // A health job only read the health report - not a poll
+  if (!jobRunning || activeJob.kind != JOB_HEALTH) {
+    device.totalPolls++;
+    device.successfulPolls++;
+    successfulPolls++;
 
-  setLEDColor(0, 255, 0);  // Green
-  led.show();
+    publishDeviceData(deviceIndex);
+    scheduleCompleted(devices, deviceIndex, millis());
+    coordRecordPoll(millis() - deviceStartTime);
+  }
+
+  uiLed(0, 255, 0);  // Green
+
+  if (jobRunning) {
+    finishJob(device, true, NULL);
+    return;
+  }
 
   currentDeviceIndex++;
-  if (currentDeviceIndex < config.numDevices) {
-    delay(1000);
-    pollNextDevice();
+  fleetPublish();
+  if (currentDeviceIndex < cycleDevices) {
+    pollingDelay(1000);
+    // A queued job takes this boundary first (started by pollingTask); otherwise
+    // pollingTask waits for our window
+    if (!jobPending() && coordCanTransmit(millis())) pollNextDevice();
+  }
+}
+
+// ==================== AD-HOC JOBS ====================
+
+int activeDeviceIndex() {
+  return jobRunning ? jobDeviceIndex : pollOrder[currentDeviceIndex];
+}
+
+bool isJobDevice(const DeviceInfo& device) {
+  int index = jobDeviceIndex;
+  return jobRunning && index >= 0 && &device == &devices[index];
+}
+
+void startNextJob() {
+  JobInfo job;
+  if (!jobTake(job, millis())) return;
+
+  int deviceIndex = getDeviceIndexById(job.deviceId.c_str());
+  if (deviceIndex == -1) {
+    JobResult none = {};
+    none.battery = -1;
+    jobFinish(job.id, JOB_FAILED, "device removed", none, millis());
+    return;
+  }
+
+  DeviceInfo& device = devices[deviceIndex];
+  LOG_I("POLLING", ">>> Job %u: %s %s", job.id, jobKindName(job.kind), device.deviceId);
+
+  activeJob = job;
+  jobDeviceIndex = deviceIndex;
+  jobSavedPhase = device.phase;
+  jobSavedPositions = device.positionsReceived;
+  if (pollingActive) jobAtBoundary = true;
+
+  // Entered like pollNextDevice(); an inference job skips the health check
+  device.phase = job.kind == JOB_INFERENCE ? PHASE_START_INFERENCE : PHASE_HEALTH_CHECK;
+  device.retryCount = 0;
+  device.commandSent = false;
+  device.positionsReceived = 0;
+  if (job.kind != JOB_HEALTH) {
+    tablesBeginCycle(deviceTables[deviceIndex], device.tableLeft.c_str(), device.tableRight.c_str());
+  }
+  phaseStartTime = millis();
+  deviceStartTime = phaseStartTime;
+  pollRecorded = false;
+  jobRunning = true;  // Last: handlers on loraTask check it before activeJob
+
+  fleetPublish();
+  wsNotify(WS_TOPIC_POLLING);
+}
+
+void finishJob(DeviceInfo& device, bool ok, const char* error) {
+  JobResult result;
+  result.battery = device.battery;
+  result.rssi = device.rssi;
+  result.snr = device.snr;
+  result.positions = device.positionsReceived;
+
+  // Back to where the cycle left the device - it may still be due in this cycle
+  int deviceIndex = jobDeviceIndex;
+  device.phase = jobSavedPhase;
+  device.positionsReceived = jobSavedPositions;
+  device.retryCount = 0;
+  device.commandSent = false;
+  if (activeJob.kind != JOB_HEALTH) {
+    tablesBeginCycle(deviceTables[deviceIndex], device.tableLeft.c_str(), device.tableRight.c_str());
   }
+  jobRunning = false;
+  jobDeviceIndex = -1;
+
+  jobFinish(activeJob.id, ok ? JOB_DONE : JOB_FAILED, error, result, millis());
+  fleetPublish();
+  wsNotify(WS_TOPIC_POLLING);
+
+  if (pollingActive) pollingDelay(1000);  // Same spacing as between two cycle devices
+}
+
+void onJobChanged() {
+  wsNotify(WS_TOPIC_JOBS);
 }
 
 // ==================== MESSAGE PROCESSING ====================
 
-void processIncomingMessage(const LoRaMessage& msg) {
+void processIncomingMessage(LoRaMessage& msg) {
   // Handle PAIR_ACK (special case - device may not be fully registered yet)
-  if (msg.command == "PAIR_ACK") {
-    Serial.println("[PROTOCOL] ✓ PAIR_ACK received from " + msg.senderId);
+  if (msg.commandId == LORA_CMD_PAIR_ACK) {
+    LOG_I("PROTOCOL", "✓ PAIR_ACK received from %s", msg.senderId);
 
-    int deviceIndex = getDeviceIndexById(msg.senderId);
+    int deviceIndex = getDeviceIndexById(msg.senderId.c_str());
     if (deviceIndex != -1) {
       devices[deviceIndex].paired = true;
       devices[deviceIndex].online = true;  // Mark as online when pairing succeeds
       devices[deviceIndex].lastContact = millis();
-      Serial.println("[PROTOCOL] ✓ Device paired successfully: " + msg.senderId);
+      registryMarkDirty();
+      LOG_I("PROTOCOL", "✓ Device paired successfully: %s", msg.senderId);
 
-      // Update display
-      beepBuzzer(200);  // Success beep
-      setLEDColor(0, 255, 0);  // Green
-      led.show();
+      // Update display (a bulk batch beeps once, when it is done)
+      if (!pairBatchHandleAck(msg.senderId.c_str(), millis())) uiBeep(200);  // Success beep
+      uiLed(0, 255, 0);  // Green
 
       // Notify web clients of device status update
-      notifyWebClients(buildDeviceListJSON());
+      fleetPublish();
+      wsNotify(WS_TOPIC_DEVICES);
     } else {
-      Serial.println("[PROTOCOL] ⚠ PAIR_ACK from unknown device: " + msg.senderId);
+      LOG_W("PROTOCOL", "⚠ PAIR_ACK from unknown device: %s", msg.senderId);
     }
     return;
   }
 
   // Find device index
-  int deviceIndex = getDeviceIndexById(msg.senderId);
+  int deviceIndex = getDeviceIndexById(msg.senderId.c_str());
   if (deviceIndex == -1) {
-    Serial.println("[PROTOCOL] Unknown device: " + msg.senderId);
+    LOG_W("PROTOCOL", "Unknown device: %s", msg.senderId);
     return;
   }
 
   DeviceInfo& device = devices[deviceIndex];
 
-  // Handle different commands
-  if (msg.command == CMD_ACK) {
-    // Parse status from payload or targetId
-    String status = msg.targetId;  // Format: ACK:GW01:ONLINE
-
-    if (status == STATUS_ONLINE) {
-      handleAckOnline(msg);
-    } else if (status == STATUS_INFERRING) {
-      handleAckInferring(msg);
-    } else if (status == STATUS_FINALIZED) {
-      handleAckFinalized(msg);
-    } else if (status == STATUS_SLEEPING) {
-      handleAckSleeping(msg);
-    }
-  } else if (msg.command == CMD_DATA) {
-    handleDataMessage(msg);
+  // Handle different commands (enums resolved once in parseMessage)
+  switch (msg.commandId) {
+    case LORA_CMD_ACK:
+      switch (msg.ackStatus) {  // Format: ED0-00001:ACK:ONLINE:...
+        case ACK_STATUS_ONLINE:    handleAckOnline(msg); break;
+        case ACK_STATUS_INFERRING: handleAckInferring(msg); break;
+        case ACK_STATUS_FINALIZED: handleAckFinalized(msg); break;
+        case ACK_STATUS_SLEEPING:  handleAckSleeping(msg); break;
+        default:
+          LOG_W("PROTOCOL", "Unknown ACK status %s from %s", msg.targetId, msg.senderId);
+          break;
+      }
+      break;
+
+    case LORA_CMD_DATA:
+      handleDataMessage(msg);
+      break;
+
+    case LORA_CMD_BLK_STATUS:
+      bulkHandleStatus(msg, millis());
+      break;
+
+    default:
+      LOG_D("PROTOCOL", "Ignored %s from %s", msg.command, msg.senderId);
+      break;
   }
 }
 
-void handleAckOnline(const LoRaMessage& msg) {
-  int deviceIndex = getDeviceIndexById(msg.senderId);
+void handleAckOnline(LoRaMessage& msg) {
+  int deviceIndex = getDeviceIndexById(msg.senderId.c_str());
   if (deviceIndex == -1) return;
 
   DeviceInfo& device = devices[deviceIndex];
 
-  Serial.println("[PROTOCOL] ✓ Device ONLINE: " + device.deviceId);
+  LOG_I("PROTOCOL", "✓ Device ONLINE: %s", device.deviceId);
 
-  // Parse health data
-  LoRaMessage msgCopy = msg;
-  parseHealthPayload(msgCopy);
+  // Parse health data (in place - msg is the receiver's scratch copy)
+  parseHealthPayload(msg);
 
-  device.battery = msgCopy.health.battery;
-  device.rssi = msgCopy.health.rssi;
-  device.snr = msgCopy.health.snr;
+  device.battery = msg.health.battery;
+  device.rssi = msg.health.rssi;
+  device.snr = msg.health.snr;
   device.online = true;
 
-  Serial.println("  Battery: " + String(device.battery) + "%");
-  Serial.println("  RSSI: " + String(device.rssi) + " dBm");
-  Serial.println("  SNR: " + String(device.snr) + " dB");
+  LOG_I("PROTOCOL", "  Battery: %d%%, RSSI: %d dBm, SNR: %d dB", device.battery, device.rssi, device.snr);
+  energyRecordBattery(device, millis());
+  linkRecordHealth(device, millis());
+
+  // Slotted reply to this cycle's broadcast census - record it, phase is set later
+  if (censusActive && msg.health.cycleId == (int32_t)cycleId) {
+    if (!device.censusSeen) {
+      device.censusSeen = true;
+      censusResponses++;
+    }
+    device.lastContact = millis();
+    fleetPublish();
+    return;
+  }
+
+  // Late census reply while this device is in a later phase - health already updated
+  if (device.phase != PHASE_HEALTH_CHECK) return;
 
   advancePhase(device);
 }
 
-void handleAckInferring(const LoRaMessage& msg) {
-  int deviceIndex = getDeviceIndexById(msg.senderId);
+void handleAckInferring(LoRaMessage& msg) {
+  int deviceIndex = getDeviceIndexById(msg.senderId.c_str());
   if (deviceIndex == -1) return;
 
   DeviceInfo& device = devices[deviceIndex];
 
-  Serial.println("[PROTOCOL] ✓ Device INFERRING: " + device.deviceId);
+  LOG_I("PROTOCOL", "✓ Device INFERRING: %s", device.deviceId);
 
   advancePhase(device);
 }
 
-void handleDataMessage(const LoRaMessage& msg) {
-  int deviceIndex = getDeviceIndexById(msg.senderId);
+void handleDataMessage(LoRaMessage& msg) {
+  int deviceIndex = getDeviceIndexById(msg.senderId.c_str());
   if (deviceIndex == -1) return;
 
   DeviceInfo& device = devices[deviceIndex];
 
-  // Parse data payload
-  LoRaMessage msgCopy = msg;
-  parseDataPayload(msgCopy);
+  // Parse data payload (in place - msg is the receiver's scratch copy)
+  parseDataPayload(msg);
 
+  DeviceResult& result = deviceResults[deviceIndex];
   device.positionsReceived++;
-  device.lastPosition = msgCopy.data.position;
-  device.lastTableId = msgCopy.data.tableId;
-  device.lastDetections = msgCopy.data.detections;
+  result.lastPosition = msg.data.position;
+  result.lastTableId = msg.data.tableId;
+  result.lastDetections = msg.data.detections;
+  if (msg.data.detectionsTruncated) {
+    truncatedDetections++;
+    LOG_W("PROTOCOL", "DATA from %s: detections longer than %d chars - cut off", device.deviceId, DETECTIONS_MAX);
+  }
+
+  if (!tablesAddPosition(deviceTables[deviceIndex], msg.data.tableId.c_str(), msg.data.detections.c_str())) {
+    LOG_W("PROTOCOL", "DATA for table %s not paired with %s", msg.data.tableId, device.deviceId);
+  }
 
-  Serial.println("[PROTOCOL] ✓ DATA received (" + String(device.positionsReceived) + "/5)");
-  Serial.println("  Table: " + msgCopy.data.tableId);
-  Serial.println("  Position: " + msgCopy.data.position);
-  Serial.println("  Detections: " + msgCopy.data.detections);
+  LOG_I("PROTOCOL", "✓ DATA received (%d/%d) - table %s, position %s", device.positionsReceived,
+        device.positionsRequested, msg.data.tableId, msg.data.position);
+  LOG_I("PROTOCOL", "  Detections: %s", msg.data.detections);
 
   // Send ACK (simplified protocol - no HMAC)
-  String seq = generateSequence(sequenceCounter);
-  String ackPayload = String(device.positionsReceived) + "/5";
-  String ackMessage = config.gatewayId + ":" + String(CMD_ACK) + ":" + device.deviceId + ":" +
-                      seq + ":" + String(getCurrentTimestamp()) + ":" + ackPayload;
-  sendLoRaMessage(ackMessage, 1);
-
-  // Check if all positions received
-  if (device.positionsReceived >= 5) {
+  DataAckPayload ack;
+  ack.received = device.positionsReceived;
+  ack.requested = device.positionsRequested;
+  char ackPayload[8];
+  encodeDataAckPayload(ackPayload, sizeof(ackPayload), ack);
+  sendLoRaMessage(CMD_ACK, device.deviceId.c_str(), ackPayload, 1, TX_PRIO_ACK);
+
+  // Check if all positions received (firmware that ignores "pos_N" sends the rest
+  // while we are in FINALIZE - stored and acknowledged, phase untouched)
+  if (device.phase == PHASE_DATA_COLLECTION && device.positionsReceived >= device.positionsRequested) {
     advancePhase(device);
+  } else {
+    fleetPublish();
   }
 }
 
-void handleAckFinalized(const LoRaMessage& msg) {
-  int deviceIndex = getDeviceIndexById(msg.senderId);
+void resendDataAck(LoRaMessage& msg) {
+  int deviceIndex = getDeviceIndexById(msg.senderId.c_str());
+  if (deviceIndex == -1) return;
+
+  DeviceInfo& device = devices[deviceIndex];
+
+  LOG_I("PROTOCOL", "DATA retransmitted by %s - ACK again (%d/%d)", device.deviceId, device.positionsReceived,
+        device.positionsRequested);
+
+  DataAckPayload ack;
+  ack.received = device.positionsReceived;
+  ack.requested = device.positionsRequested;
+  char ackPayload[8];
+  encodeDataAckPayload(ackPayload, sizeof(ackPayload), ack);
+  sendLoRaMessage(CMD_ACK, device.deviceId.c_str(), ackPayload, 1, TX_PRIO_ACK);
+}
+
+void handleAckFinalized(LoRaMessage& msg) {
+  int deviceIndex = getDeviceIndexById(msg.senderId.c_str());
   if (deviceIndex == -1) return;
 
   DeviceInfo& device = devices[deviceIndex];
 
-  Serial.println("[PROTOCOL] ✓ Device FINALIZED: " + device.deviceId);
+  LOG_I("PROTOCOL", "✓ Device FINALIZED: %s", device.deviceId);
 
-  // Send SLEEP command (simplified protocol - no HMAC)
-  String seq = generateSequence(sequenceCounter);
-  String sleepMessage = config.gatewayId + ":" + String(CMD_SLEEP) + ":" + device.deviceId + ":" +
-                        seq + ":" + String(getCurrentTimestamp()) + ":null";
-  sendLoRaMessage(sleepMessage, 1);
+  // Device work done - update its energy model and plan before it is rescheduled
+  if (!pollRecorded) {
+    energyRecordPoll(device, scheduleBaseCadenceMs(device), millis() - deviceStartTime, collectDurationMs, millis());
+    pollRecorded = true;
+  }
+  EnergyPlan plan = energyCurrentPlan(device.deviceId.c_str());
+
+  // Send SLEEP command (simplified protocol - no HMAC); with a sleep window the
+  // device may switch its radio off until shortly before the next poll can come
+  SleepPayload sleepRequest;
+  uint32_t gapMs = scheduleMinGapMs(device);
+  if (plan.sleepWindow && gapMs > ENERGY_WAKE_GUARD_MS) {
+    sleepRequest.wakeS = (gapMs - ENERGY_WAKE_GUARD_MS) / 1000;
+  }
+  char sleepPayload[24];
+  encodeSleepPayload(sleepPayload, sizeof(sleepPayload), sleepRequest);  // "null" = stay in RX
+  sendLoRaMessage(CMD_SLEEP, device.deviceId.c_str(), sleepPayload, 1, TX_PRIO_ACK);
 }
 
-void handleAckSleeping(const LoRaMessage& msg) {
-  int deviceIndex = getDeviceIndexById(msg.senderId);
+void handleAckSleeping(LoRaMessage& msg) {
+  int deviceIndex = getDeviceIndexById(msg.senderId.c_str());
   if (deviceIndex == -1) return;
 
   DeviceInfo& device = devices[deviceIndex];
 
-  Serial.println("[PROTOCOL] ✓ Device SLEEPING: " + device.deviceId);
+  LOG_I("PROTOCOL", "✓ Device SLEEPING: %s", device.deviceId);
 
   advancePhase(device);
 }
@@ -1326,27 +2585,110 @@ void handleAckSleeping(const LoRaMessage& msg) {
 void publishGatewayStatus() {
   if (!mqttConnected) return;
 
-  StaticJsonDocument<1024> doc;
+  StaticJsonDocument<2048> doc;
+  FleetReader snapshot;
   doc["gateway_id"] = config.gatewayId;
   doc["wifi_connected"] = wifiConnected;
   doc["mqtt_connected"] = mqttConnected;
-  doc["polling_active"] = pollingActive;
-  doc["devices_paired"] = config.numDevices;
-  doc["total_messages"] = totalMessages;
-  doc["successful_polls"] = successfulPolls;
-  doc["failed_polls"] = failedPolls;
+  doc["polling_active"] = snapshot->pollingActive;
+  doc["devices_paired"] = snapshot->numDevices;
+  doc["total_messages"] = snapshot->totalMessages;
+  doc["truncated_detections"] = snapshot->truncatedDetections;
+  doc["successful_polls"] = snapshot->successfulPolls;
+  doc["failed_polls"] = snapshot->failedPolls;
   doc["uptime_ms"] = millis();
   doc["ip_address"] = WiFi.localIP().toString();
 
+  // Should stay flat over weeks of uptime - a falling min_largest_block means fragmentation
+  JsonObject heap = doc.createNestedObject("heap");
+  heap["free"] = heapStats.freeBytes;
+  heap["min_free"] = heapStats.minFreeBytes;
+  heap["largest_block"] = heapStats.largestBlock;
+  heap["min_largest_block"] = heapStats.minLargestBlock;
+  heap["fragmentation_pct"] = heapStats.fragmentationPct;
+
+  // Non-zero dropped = log rings filled faster than Serial drains them
+  LogStats logStats = logGetStats();
+  JsonObject logging = doc.createNestedObject("log");
+  logging["written"] = logStats.written;
+  logging["dropped"] = logStats.dropped;
+  logging["high_water"] = logStats.highWater;
+
+  const RegistryStats& reg = registryGetStats();
+  JsonObject registry = doc.createNestedObject("registry");
+  registry["load_status"] = registryStatusToString(reg.loadStatus);
+  registry["restored_at_ms"] = reg.restoredAtMs;
+  registry["load_us"] = reg.loadUs;
+  registry["blob_bytes"] = reg.blobBytes;
+  registry["writes"] = reg.writes;
+  registry["skipped_writes"] = reg.skippedWrites;
+  registry["dirty"] = reg.dirty;
+
   JsonObject location = doc.createNestedObject("location");
   location["building"] = config.building;
   location["floor"] = config.floor;
   location["lab"] = config.lab;
 
-  char buffer[1024];
-  serializeJson(doc, buffer);
-
-  mqttClient.publish(topic_status, buffer, true);  // Retained
+  addBootTimings(doc.createNestedObject("boot"));
+
+  CoordView coord = coordGetView(millis());
+  JsonObject coordination = doc.createNestedObject("coord");
+  coordination["role"] = coordRoleToString(coord.role);
+  coordination["sharing"] = coord.sharing;
+  coordination["window_start_ms"] = coord.windowStartMs;
+  coordination["window_ms"] = coord.windowMs;
+  coordination["deferrals"] = coord.deferrals;
+
+  OutboxStats outbox = outboxGetStats();
+  JsonObject queued = doc.createNestedObject("outbox");
+  queued["depth"] = outbox.depth;
+  queued["queued"] = outbox.queued;
+  queued["flushed"] = outbox.flushed;
+  queued["dropped"] = outbox.dropped;
+
+  TableStats tableStats = tablesGetStats();
+  JsonObject tables = doc.createNestedObject("tables");
+  tables["keyframes"] = tableStats.keyframes;
+  tables["deltas"] = tableStats.deltas;
+  tables["suppressed"] = tableStats.suppressed;
+
+  WsStats wsStats = wsGetStats();
+  JsonObject dashboards = doc.createNestedObject("ws");
+  dashboards["clients"] = wsStats.clients;
+  dashboards["flushes"] = wsStats.flushes;
+  dashboards["coalesced"] = wsStats.notifies - wsStats.flushes;
+  dashboards["skipped"] = wsStats.skipped;
+
+  FleetSnapshotStats fleetStats = fleetSnapshotGetStats();
+  JsonObject fleet = doc.createNestedObject("snapshot");
+  fleet["version"] = fleetStats.version;
+  fleet["folded"] = fleetStats.folded;
+  fleet["deferred"] = fleetStats.deferred;
+  fleet["read_retries"] = fleetStats.readRetries;
+
+  TraceStats traceStats = traceGetStats();
+  JsonObject trace = doc.createNestedObject("trace");
+  trace["enabled"] = traceStats.enabled;
+  trace["records"] = traceStats.records;
+  trace["used"] = traceStats.used;
+  trace["capacity"] = traceStats.capacity;
+  trace["dropped"] = traceStats.dropped;
+  trace["missed"] = traceStats.missed;
+
+  BulkStats bulkStats = bulkGetStats(millis());
+  JsonObject bulk = doc.createNestedObject("bulk");
+  bulk["active"] = bulkStats.active;
+  bulk["transfer_id"] = bulkStats.transferId;
+  bulk["targets"] = bulkStats.numTargets;
+  bulk["done"] = bulkStats.done;
+  bulk["failed"] = bulkStats.failed;
+  bulk["airtime_ms"] = bulkStats.airtimeMs;
+  bulk["retransmissions"] = bulkStats.retransmissions;
+
+  uint8_t buffer[2048];
+  size_t length = codecSerialize(doc, MQTT_TOPIC_STATUS, buffer, sizeof(buffer));
+
+  if (length > 0) mqttClient.publish(topic_status, buffer, length, true);  // Retained
 }
 
 void publishPollingStatus() {
@@ -1355,65 +2697,111 @@ void publishPollingStatus() {
   StaticJsonDocument<512> doc;
   doc["polling_active"] = pollingActive;
   doc["current_device_index"] = currentDeviceIndex;
-  doc["total_devices"] = config.numDevices;
+  doc["total_devices"] = cycleDevices;
   doc["elapsed_ms"] = millis() - pollingStartTime;
+  doc["census_active"] = censusActive;
 
-  if (currentDeviceIndex < config.numDevices) {
-    doc["current_device_id"] = devices[currentDeviceIndex].deviceId;
-    doc["current_phase"] = phaseToString(devices[currentDeviceIndex].phase);
+  if (!censusActive && currentDeviceIndex < cycleDevices) {
+    doc["current_device_id"] = devices[pollOrder[currentDeviceIndex]].deviceId.c_str();
+    doc["current_phase"] = phaseToString(devices[pollOrder[currentDeviceIndex]].phase);
   }
 
-  char buffer[512];
-  serializeJson(doc, buffer);
+  uint8_t buffer[512];
+  size_t length = codecSerialize(doc, MQTT_TOPIC_POLLING, buffer, sizeof(buffer));
 
-  mqttClient.publish(topic_polling, buffer, false);
+  if (length > 0) mqttEnqueue(topic_polling, buffer, length, false);  // pollingTask - loop() publishes
 }
 
 void publishDeviceData(int deviceIndex) {
-  if (!mqttConnected || deviceIndex < 0 || deviceIndex >= config.numDevices) return;
+  if (deviceIndex < 0 || deviceIndex >= config.numDevices) return;
 
   DeviceInfo& device = devices[deviceIndex];
+  DeviceResult& result = deviceResults[deviceIndex];
+  DeviceTables& tables = deviceTables[deviceIndex];
+
+  // Steady lab: nothing changed at either table - nothing to publish
+  TablePublish what = tablesDecide(tables, device.online, millis());
+  if (what == TABLES_NOTHING) {
+    tablesCommit(tables, device.online, what, millis());
+    LOG_D("MQTT", "%s unchanged - not published", device.deviceId);
+    return;
+  }
 
   StaticJsonDocument<1024> doc;
+  doc["type"] = (what == TABLES_KEYFRAME) ? "keyframe" : "delta";
   doc["gateway_id"] = config.gatewayId;
-  doc["device_id"] = device.deviceId;
-  doc["online"] = device.online;
-  doc["battery"] = device.battery;
-  doc["rssi"] = device.rssi;
-  doc["snr"] = device.snr;
-  doc["last_position"] = device.lastPosition;
-  doc["last_table_id"] = device.lastTableId;
-  doc["last_detections"] = device.lastDetections;
-  doc["positions_received"] = device.positionsReceived;
-  doc["total_polls"] = device.totalPolls;
-  doc["successful_polls"] = device.successfulPolls;
-  doc["failed_polls"] = device.failedPolls;
-  doc["last_contact"] = device.lastContact;
+  doc["device_id"] = device.deviceId.c_str();
+  doc["seq"] = (what == TABLES_KEYFRAME) ? 0 : tables.deltaSeq + 1;
+
+  if (what == TABLES_KEYFRAME) {
+    doc["online"] = device.online;
+    doc["battery"] = device.battery;
+    doc["rssi"] = device.rssi;
+    doc["snr"] = device.snr;
+    doc["last_position"] = result.lastPosition.c_str();
+    doc["last_table_id"] = result.lastTableId.c_str();
+    doc["last_detections"] = result.lastDetections.c_str();
+    doc["positions_received"] = device.positionsReceived;
+    doc["total_polls"] = device.totalPolls;
+    doc["successful_polls"] = device.successfulPolls;
+    doc["failed_polls"] = device.failedPolls;
+    doc["last_contact"] = device.lastContact;
+
+    EnergyInfo energy;
+    if (energyGetInfo(device.deviceId.c_str(), scheduleBaseCadenceMs(device), millis(), energy)) {
+      addEnergyInfo(doc.createNestedObject("energy"), energy);
+    }
+
+    LinkInfo link;
+    if (linkGetInfo(device.deviceId.c_str(), millis(), link)) {
+      JsonObject linkObj = doc.createNestedObject("link");
+      linkObj["fragility"] = link.fragility;
+      linkObj["alert"] = linkAlertName(link.alert);
+    }
+  } else if (tables.onlineChanged) {
+    doc["online"] = device.online;
+  }
+
+  // Keyframe: every known table. Delta: only the tables that changed.
+  JsonArray tableArray = doc.createNestedArray("tables");
+  for (int t = 0; t < TABLES_PER_DEVICE; t++) {
+    bool changed = tables.changedMask & (1 << t);
+    const TableState& state = changed ? tables.current[t] :
+                              (tables.current[t].positions > 0 ? tables.current[t] : tables.published[t]);
+
+    if (what == TABLES_DELTA && !changed) continue;
+    if (state.tableId.isEmpty() || state.equipment == EQUIP_UNKNOWN) continue;
+
+    JsonObject table = tableArray.createNestedObject();
+    table["table_id"] = state.tableId.c_str();
+    table["occupied"] = state.occupied;
+    table["equipment"] = equipmentToString(state.equipment);
+  }
   doc["timestamp"] = millis();
 
-  char buffer[1024];
-  serializeJson(doc, buffer);
+  uint8_t buffer[1024];
+  size_t length = codecSerialize(doc, MQTT_TOPIC_DEVICE, buffer, sizeof(buffer));
 
   String deviceTopic = String(topic_device) + device.deviceId;
-  mqttClient.publish(deviceTopic.c_str(), buffer, false);
+  mqttEnqueue(deviceTopic.c_str(), buffer, length, false);
+
+  tablesCommit(tables, device.online, what, millis());
 }
 
 void publishPollingComplete() {
-  if (!mqttConnected) return;
-
   StaticJsonDocument<512> doc;
   doc["gateway_id"] = config.gatewayId;
   doc["cycle_complete"] = true;
   doc["duration_ms"] = millis() - pollingStartTime;
-  doc["devices_polled"] = config.numDevices;
+  doc["devices_polled"] = cycleDevices;
   doc["successful"] = successfulPolls;
   doc["failed"] = failedPolls;
   doc["timestamp"] = millis();
 
-  char buffer[512];
-  serializeJson(doc, buffer);
+  uint8_t buffer[512];
+  size_t length = codecSerialize(doc, MQTT_TOPIC_DATA, buffer, sizeof(buffer));
 
-  mqttClient.publish(topic_data, buffer, false);
+  mqttEnqueue(topic_data, buffer, length, false);
 }
 
 // ==================== WEB INTERFACE ====================
@@ -1423,7 +2811,7 @@ void handleWebSocketMessage(AsyncWebSocketClient* client, char* data, size_t len
   DeserializationError error = deserializeJson(doc, data);
 
   if (error) {
-    Serial.println("[WS] Invalid JSON");
+    LOG_W("WS", "Invalid JSON");
     return;
   }
 
@@ -1431,7 +2819,7 @@ void handleWebSocketMessage(AsyncWebSocketClient* client, char* data, size_t len
 
   if (command == "start_polling") {
     if (!pollingActive) {
-      startPollingCycle();
+      scheduleRequest(-1);
       client->text("{\"status\":\"started\"}");
     } else {
       client->text("{\"error\":\"already_active\"}");
@@ -1441,192 +2829,730 @@ void handleWebSocketMessage(AsyncWebSocketClient* client, char* data, size_t len
   }
 }
 
-void notifyWebClients(const String& message) {
-  ws.textAll(message);
+void fillFleetSnapshot(FleetSnapshot& snapshot) {
+  // Runs in the publishing task (polling, LoRa or web), fleet lock held - see fleet_snapshot.h
+  snapshot.numDevices = config.numDevices;
+  for (int i = 0; i < config.numDevices; i++) {
+    snapshot.devices[i] = devices[i];
+  }
+  memcpy(snapshot.pollOrder, pollOrder, sizeof(pollOrder));
+
+  snapshot.pollingActive = pollingActive;
+  snapshot.censusActive = censusActive;
+  snapshot.currentDeviceIndex = currentDeviceIndex;
+  snapshot.cycleDevices = cycleDevices;
+  snapshot.pollingStartTime = pollingStartTime;
+
+  snapshot.totalMessages = totalMessages;
+  snapshot.truncatedDetections = truncatedDetections;
+  snapshot.successfulPolls = successfulPolls;
+  snapshot.failedPolls = failedPolls;
+}
+
+FleetView fleetView(const FleetSnapshot& snapshot) {
+  FleetView view;
+  view.gatewayId = config.gatewayId.c_str();
+  view.ipAddress = WiFi.localIP().toString();
+  view.uptimeMs = millis();
+  view.devices = snapshot.devices;
+  view.numDevices = snapshot.numDevices;
+  view.pollingActive = snapshot.pollingActive;
+  view.censusActive = snapshot.censusActive;
+  view.currentDeviceIndex = snapshot.currentDeviceIndex;
+  view.pollOrder = snapshot.pollOrder;
+  view.cycleDevices = snapshot.cycleDevices;
+  view.elapsedMs = millis() - snapshot.pollingStartTime;
+  view.totalMessages = snapshot.totalMessages;
+  view.truncatedDetections = snapshot.truncatedDetections;
+  view.successfulPolls = snapshot.successfulPolls;
+  view.failedPolls = snapshot.failedPolls;
+  view.heapFree = heapStats.freeBytes;
+  view.heapMinLargestBlock = heapStats.minLargestBlock;
+  view.heapFragmentationPct = heapStats.fragmentationPct;
+  return view;
 }
 
 String buildDeviceListJSON() {
-  StaticJsonDocument<4096> doc;
+  FleetReader snapshot;
+  return buildDeviceListJSON(fleetView(*snapshot));
+}
 
-  // Add stats section
-  JsonObject stats = doc.createNestedObject("stats");
-  stats["gateway_id"] = config.gatewayId;
-  stats["ip_address"] = WiFi.localIP().toString();
-  stats["uptime_ms"] = millis();
-  stats["total_devices"] = config.numDevices;
+String buildScheduleJSON() {
+  StaticJsonDocument<3072> doc;
+  FleetReader snapshot;
+  unsigned long now = millis();
+
+  doc["default_cadence_min"] = scheduleGetDefaultCadence();
+  doc["tick_ms"] = SCHEDULE_TICK_MS;
+  doc["merge_ms"] = SCHEDULE_MERGE_MS;
+  doc["jitter_pct"] = SCHEDULE_JITTER_PCT;
+  doc["polling_active"] = snapshot->pollingActive;
+
+  JsonArray groupArray = doc.createNestedArray("groups");
+  for (int g = 1; g <= SCHEDULE_MAX_GROUPS; g++) {
+    const ScheduleGroup* group = scheduleGetGroup(g);
+    if (group == NULL) continue;
+    JsonObject groupObj = groupArray.createNestedObject();
+    groupObj["name"] = group->name;
+    groupObj["cadence_min"] = group->cadenceMinutes;
+  }
 
-  // Count online devices
-  int onlineCount = 0;
-  for (int i = 0; i < config.numDevices; i++) {
-    if (devices[i].online) onlineCount++;
+  // Soonest first; negative due_in_ms = overdue or in the running cycle
+  ScheduleEntry upcoming[MAX_DEVICES];
+  int count = scheduleUpcoming(snapshot->devices, snapshot->numDevices, now, upcoming, MAX_DEVICES);
+
+  JsonArray upcomingArray = doc.createNestedArray("upcoming");
+  for (int k = 0; k < count; k++) {
+    const DeviceInfo& device = snapshot->devices[upcoming[k].deviceIndex];
+    const ScheduleGroup* group = scheduleGetGroup(device.scheduleGroup);
+
+    JsonObject entry = upcomingArray.createNestedObject();
+    entry["device_id"] = device.deviceId.c_str();
+    entry["group"] = group ? group->name : "";
+    entry["cadence_min"] = upcoming[k].cadenceMs / 60000UL;
+    entry["energy_stretch"] = device.cadenceStretch;
+    entry["due_in_ms"] = upcoming[k].dueInMs;
   }
-  stats["online_devices"] = onlineCount;
-  stats["total_messages"] = totalMessages;
 
-  // Calculate success rate
-  unsigned long totalAttempts = successfulPolls + failedPolls;
-  float successRate = (totalAttempts > 0) ? (successfulPolls * 100.0 / totalAttempts) : 0.0;
-  stats["success_rate"] = successRate;
+  String json;
+  serializeJson(doc, json);
+  return json;
+}
 
-  // Add devices array
-  JsonArray devicesArray = doc.createNestedArray("devices");
+String buildCoordJSON() {
+  StaticJsonDocument<1536> doc;
+  unsigned long now = millis();
+  CoordView view = coordGetView(now);
 
-  for (int i = 0; i < config.numDevices; i++) {
-    JsonObject deviceObj = devicesArray.createNestedObject();
-    deviceObj["device_id"] = devices[i].deviceId;
-    deviceObj["paired"] = devices[i].paired;
-    deviceObj["online"] = devices[i].online;
-    deviceObj["table_left"] = devices[i].tableLeft;
-    deviceObj["table_right"] = devices[i].tableRight;
-    deviceObj["battery"] = devices[i].battery;
-    deviceObj["rssi"] = devices[i].rssi;
-    deviceObj["snr"] = devices[i].snr;
-    deviceObj["phase"] = phaseToString(devices[i].phase);
-    deviceObj["last_contact"] = devices[i].lastContact;
-    deviceObj["positions_received"] = devices[i].positionsReceived;
+  doc["gateway_id"] = config.gatewayId;
+  doc["channel"] = LORA_FREQ "/" LORA_SF "/" LORA_BW;
+  doc["role"] = coordRoleToString(view.role);
+  doc["demand"] = view.demand;
+  doc["superframe_ms"] = COORD_SUPERFRAME_MS;
+  doc["superframe_pos_ms"] = view.superframePosMs;
+  doc["window_start_ms"] = view.windowStartMs;
+  doc["window_ms"] = view.windowMs;
+  doc["poll_estimate_ms"] = view.pollEstimateMs;
+  doc["deferrals"] = view.deferrals;
+  doc["stale_clocks"] = view.staleClocks;
+  if (view.suggestedFreq != 0) doc["suggested_freq"] = view.suggestedFreq;
+
+  CoordPeer peers[COORD_MAX_PEERS];
+  int count = coordGetPeers(peers, COORD_MAX_PEERS, now);
+
+  JsonArray peerArray = doc.createNestedArray("peers");
+  for (int i = 0; i < count; i++) {
+    JsonObject peer = peerArray.createNestedObject();
+    peer["gateway_id"] = peers[i].gatewayId;
+    peer["channel"] = peers[i].channel;
+    peer["demand"] = peers[i].demand;
+    peer["last_seen_ms"] = now - peers[i].lastSeenMs;
   }
 
-  char buffer[4096];
-  serializeJson(doc, buffer);
-  return String(buffer);
+  String json;
+  serializeJson(doc, json);
+  return json;
 }
 
-String buildPollingStatusJSON() {
-  StaticJsonDocument<512> doc;
-  doc["polling_active"] = pollingActive;
-  doc["current_device_index"] = currentDeviceIndex;
-  doc["total_devices"] = config.numDevices;
-  doc["elapsed_ms"] = millis() - pollingStartTime;
+String buildWsStatsJSON() {
+  StaticJsonDocument<768> doc;
+  WsStats stats = wsGetStats();
+
+  doc["clients"] = stats.clients;
+  doc["coalesce_ms"] = WS_COALESCE_MS;
+  doc["notifies"] = stats.notifies;
+  doc["flushes"] = stats.flushes;
+  doc["sent"] = stats.sent;
+  doc["skipped"] = stats.skipped;
+  doc["catch_ups"] = stats.catchUps;
+
+  // Fan-out cost by number of connected dashboards
+  JsonObject fanout = doc.createNestedObject("fanout");
+  for (int b = 0; b < WS_COST_BUCKETS; b++) {
+    const WsFanoutCost& cost = stats.cost[b];
+    JsonObject bucket = fanout.createNestedObject(wsCostBucketName(b));
+    bucket["flushes"] = cost.flushes;
+    bucket["avg_us"] = cost.flushes ? cost.totalUs / cost.flushes : 0;
+    bucket["max_us"] = cost.maxUs;
+    bucket["avg_bytes"] = cost.flushes ? cost.bytes / cost.flushes : 0;
+  }
+
+  String json;
+  serializeJson(doc, json);
+  return json;
+}
 
-  if (currentDeviceIndex < config.numDevices) {
-    doc["current_device_id"] = devices[currentDeviceIndex].deviceId;
-    doc["current_phase"] = phaseToString(devices[currentDeviceIndex].phase);
+String buildBulkJSON() {
+  StaticJsonDocument<2048> doc;
+  BulkStats stats = bulkGetStats(millis());
+
+  doc["active"] = stats.active;
+  if (stats.transferId != 0) {
+    doc["transfer_id"] = stats.transferId;
+    doc["name"] = stats.name.c_str();
+    doc["size"] = stats.size;
+    doc["chunks"] = stats.chunks;
+    doc["elapsed_ms"] = stats.elapsedMs;
+    doc["frames"] = stats.frames;
+    doc["chunks_sent"] = stats.chunksSent;
+    doc["chunks_shared"] = stats.chunksShared;
+    doc["retransmissions"] = stats.retransmissions;
+    doc["timeouts"] = stats.timeouts;
+    doc["held_back"] = stats.heldBack;
+    doc["airtime_ms"] = stats.airtimeMs;
+  }
+  doc["hour_airtime_ms"] = stats.hourAirtimeMs;
+  doc["budget_ms"] = stats.budgetMs;
+
+  BulkTargetInfo targets[BULK_MAX_TARGETS];
+  int count = bulkGetTargets(targets, BULK_MAX_TARGETS);
+
+  JsonArray targetArray = doc.createNestedArray("targets");
+  for (int i = 0; i < count; i++) {
+    JsonObject target = targetArray.createNestedObject();
+    target["device_id"] = targets[i].deviceId.c_str();
+    target["state"] = bulkTargetStateName(targets[i].state);
+    target["received"] = targets[i].received;
+    target["resumes"] = targets[i].resumes;
+    target["hash_fails"] = targets[i].hashFails;
+    if (targets[i].doneMs != 0) target["done_ms"] = targets[i].doneMs;
   }
 
-  char buffer[512];
-  serializeJson(doc, buffer);
-  return String(buffer);
+  String json;
+  serializeJson(doc, json);
+  return json;
 }
 
-// ==================== DISPLAY & INDICATORS ====================
+String buildPairingJSON() {
+  // "type" tells the dashboard this is bulk pairing progress, not a polling / device update
+  StaticJsonDocument<4096> doc;
+  PairBatchStats stats = pairBatchGetStats(millis());
+
+  doc["type"] = "pairing";
+  doc["active"] = stats.active;
+  if (stats.batchId != 0) {
+    doc["batch_id"] = stats.batchId;
+    doc["elapsed_ms"] = stats.elapsedMs;
+    doc["frames"] = stats.frames;
+    doc["queued"] = stats.queued;
+    doc["sent"] = stats.sent;
+    doc["paired"] = stats.paired;
+    doc["failed"] = stats.failed;
+    doc["rejected"] = stats.rejected;
+  }
 
-void updateDisplay() {
-  display.clearDisplay();
-  display.setTextSize(1);
-  display.setTextColor(SSD1306_WHITE);
-
-  display.setCursor(0, 0);
-  //display.print("GW:");
-  display.print(config.gatewayId);
-  display.print(" ");
-  if (wifiConnected) display.print("WiFi:OK ");
-  if (mqttConnected) display.print("MQTT:OK");
-
-  display.setCursor(0, 12);
-  if (pollingActive) {
-    display.print("Polling:");
-    display.print(currentDeviceIndex + 1);
-    display.print("/");
-    display.print(config.numDevices);
-    if (currentDeviceIndex < config.numDevices) {
-      display.print(" ");
-      display.print(devices[currentDeviceIndex].deviceId);
+  // Reasons are static strings; IDs are copied (the chunk buffer is reused)
+  JsonArray rowArray = doc.createNestedArray("rows");
+  PairRow chunk[8];
+  for (int first = 0; first < stats.rows; first += 8) {
+    int count = pairBatchGetRows(chunk, first, 8);
+    for (int i = 0; i < count; i++) {
+      JsonObject row = rowArray.createNestedObject();
+      row["line"] = chunk[i].line;
+      row["device_id"] = String(chunk[i].deviceId.c_str());
+      row["state"] = pairRowStateName(chunk[i].state);
+      row["attempts"] = chunk[i].attempts;
+      if (chunk[i].reason != NULL) row["reason"] = chunk[i].reason;
     }
-  } else {
-    display.print("Idle - Msgs:");
-    display.print(totalMessages);
   }
 
-  display.setCursor(0, 24);
-  display.print("OK:");
-  display.print(successfulPolls);
-  display.print(" Fail:");
-  display.print(failedPolls);
+  String json;
+  serializeJson(doc, json);
+  return json;
+}
 
-  display.display();
+void addEnergyInfo(JsonObject energy, const EnergyInfo& info) {
+  energy["level"] = info.plan.level;
+  energy["cadence_stretch"] = info.plan.cadenceStretch;
+  energy["positions"] = info.plan.positions;
+  energy["sleep_window"] = info.plan.sleepWindow;
+  energy["samples"] = info.samples;
+  energy["idle_pct_h"] = info.idlePctPerHour;
+  energy["cost_pct_s"] = info.costPctPerAwakeS;
+  energy["awake_ms"] = info.awakeMs;
+  energy["drain_pct_day"] = info.drainPctPerDay;
+  energy["tte_h"] = info.timeToEmptyH;
+  energy["target_h"] = info.remainingTargetH;
 }
 
-void setLEDColor(uint8_t r, uint8_t g, uint8_t b) {
-  led.setPixelColor(0, led.Color(r, g, b));
-  led.show();
+void addLinkInfo(JsonObject link, const LinkInfo& info) {
+  link["fragility"] = info.fragility;
+  link["alert"] = linkAlertName(info.alert);
+  link["reply_rate"] = info.replyRate;
+  link["replies"] = info.replies;
+  link["misses"] = info.misses;
+  for (int k = 0; k < LINK_METRIC_COUNT; k++) {
+    const LinkMetricInfo& metric = info.metrics[k];
+    if (metric.samples == 0) continue;
+
+    JsonObject m = link.createNestedObject(linkMetricName((LinkMetric)k));
+    m["samples"] = metric.samples;
+    m["mean"] = metric.mean;
+    m["stddev"] = metric.stddev;
+    m["slope_h"] = metric.slopePerHour;
+    m["hours_to_limit"] = metric.hoursToLimit;
+    m["score"] = metric.score;
+  }
 }
 
-void beepBuzzer(int duration) {
-  digitalWrite(BUZZER_PIN, HIGH);
-  delay(duration);
-  digitalWrite(BUZZER_PIN, LOW);
+String buildLinkJSON() {
+  // Most fragile first - the order the next cycle polls them in
+  StaticJsonDocument<4096> doc;
+  FleetReader snapshot;
+  unsigned long now = millis();
+
+  int order[MAX_DEVICES];
+  for (int i = 0; i < snapshot->numDevices; i++) order[i] = i;
+  linkSortByFragility(snapshot->devices, order, snapshot->numDevices);
+
+  JsonArray deviceArray = doc.createNestedArray("devices");
+  for (int n = 0; n < snapshot->numDevices; n++) {
+    const DeviceInfo& device = snapshot->devices[order[n]];
+    JsonObject deviceObj = deviceArray.createNestedObject();
+    deviceObj["device_id"] = device.deviceId.c_str();
+    deviceObj["online"] = device.online;
+
+    LinkInfo info;
+    if (linkGetInfo(device.deviceId.c_str(), now, info)) {
+      addLinkInfo(deviceObj.createNestedObject("link"), info);
+    }
+  }
+
+  String json;
+  serializeJson(doc, json);
+  return json;
 }
 
-// ==================== STORAGE & REPORTS ====================
+void submitJob(AsyncWebServerRequest* request, uint8_t* data, size_t len, JobKind kind) {
+  if (!request->authenticate(web_username, web_password)) {
+    return request->requestAuthentication();
+  }
 
-void saveConfiguration() {
-  preferences.begin("detectra", false);  // Read-write mode
+  StaticJsonDocument<256> doc;
+  DeserializationError error = deserializeJson(doc, data, len);
 
-  preferences.putString("gateway_id", config.gatewayId);
-  preferences.putString("building", config.building);
-  preferences.putString("floor", config.floor);
-  preferences.putString("lab", config.lab);
-  preferences.putInt("poll_interval", config.pollingIntervalMinutes);
-  preferences.putInt("num_devices", config.numDevices);
+  if (error) {
+    request->send(400, "application/json", "{\"success\":false,\"error\":\"Invalid JSON\"}");
+    return;
+  }
 
-  preferences.end();
+  const char* kindName = doc["kind"] | jobKindName(kind);
+  if (!jobParseKind(kindName, kind)) {
+    request->send(400, "application/json", "{\"success\":false,\"error\":\"Unknown job kind\"}");
+    return;
+  }
+
+  String deviceId = doc["device_id"] | "";
+  int deviceIndex = getDeviceIndexById(deviceId.c_str());
+
+  if (deviceIndex == -1) {
+    request->send(404, "application/json", "{\"success\":false,\"error\":\"Device not found\"}");
+    return;
+  }
 
-  Serial.println("[CONFIG] Configuration saved to NVS");
+  if (!devices[deviceIndex].paired) {
+    request->send(409, "application/json", "{\"success\":false,\"error\":\"Device not paired\"}");
+    return;
+  }
+
+  // Queued, not sent: pollingTask runs it in the next free radio time
+  uint32_t id = jobSubmit(kind, deviceId.c_str(), millis());
+  JobInfo job;
+  if (id == 0 || !jobGet(id, job)) {
+    request->send(503, "application/json", "{\"success\":false,\"error\":\"Job queue full\"}");
+    return;
+  }
+
+  StaticJsonDocument<512> reply;
+  JsonObject obj = reply.to<JsonObject>();
+  obj["success"] = true;
+  addJobInfo(obj, job);
+
+  String json;
+  serializeJson(reply, json);
+  request->send(202, "application/json", json);
+}
+
+void addJobInfo(JsonObject obj, const JobInfo& job) {
+  obj["job_id"] = job.id;
+  obj["kind"] = jobKindName(job.kind);
+  obj["device_id"] = job.deviceId.c_str();  // Caller's copy outlives the serialization
+  obj["state"] = jobStateName(job.state);
+  obj["submitted_ms"] = job.submittedMs;
+  if (job.state != JOB_QUEUED) obj["queue_ms"] = job.startedMs - job.submittedMs;
+  if (job.state == JOB_DONE || job.state == JOB_FAILED) obj["run_ms"] = job.finishedMs - job.startedMs;
+  if (job.error != NULL) obj["error"] = job.error;
+
+  if (job.state == JOB_DONE) {
+    JsonObject result = obj.createNestedObject("result");
+    result["battery"] = job.result.battery;
+    result["rssi"] = job.result.rssi;
+    result["snr"] = job.result.snr;
+    if (job.kind != JOB_HEALTH) result["positions"] = job.result.positions;
+  }
+}
+
+String buildJobJSON(const JobInfo& job) {
+  StaticJsonDocument<512> doc;
+  JsonObject obj = doc.to<JsonObject>();
+  obj["success"] = true;
+  addJobInfo(obj, job);
+
+  String json;
+  serializeJson(doc, json);
+  return json;
+}
+
+String buildJobsJSON() {
+  // "type" tells the dashboard this is a job update, not a polling / device update
+  StaticJsonDocument<4096> doc;
+  JobStats stats = jobGetStats();
+
+  doc["type"] = "jobs";
+  doc["queued"] = stats.queued;
+  doc["running"] = stats.running;
+  doc["submitted"] = stats.submitted;
+  doc["merged"] = stats.merged;
+  doc["refused"] = stats.refused;
+  doc["done"] = stats.done;
+  doc["failed"] = stats.failed;
+
+  JobInfo jobs[JOB_SLOTS];
+  int count = jobList(jobs, JOB_SLOTS);
+  JsonArray jobArray = doc.createNestedArray("jobs");
+  for (int i = 0; i < count; i++) {
+    addJobInfo(jobArray.createNestedObject(), jobs[i]);
+  }
+
+  String json;
+  serializeJson(doc, json);
+  return json;
+}
+
+String buildEnergyJSON() {
+  StaticJsonDocument<4096> doc;
+  FleetReader snapshot;
+  unsigned long now = millis();
+
+  doc["target_days"] = energyGetTargetDays();
+
+  JsonArray deviceArray = doc.createNestedArray("devices");
+  for (int i = 0; i < snapshot->numDevices; i++) {
+    const DeviceInfo& device = snapshot->devices[i];
+    JsonObject deviceObj = deviceArray.createNestedObject();
+    deviceObj["device_id"] = device.deviceId.c_str();
+    deviceObj["battery"] = device.battery;
+    deviceObj["cadence_min"] = scheduleCadenceMs(device) / 60000UL;
+
+    EnergyInfo info;
+    if (energyGetInfo(device.deviceId.c_str(), scheduleBaseCadenceMs(device), now, info)) {
+      addEnergyInfo(deviceObj.createNestedObject("energy"), info);
+    }
+  }
+
+  String json;
+  serializeJson(doc, json);
+  return json;
 }
 
-void saveDevicePairing(const DeviceInfo& device) {
-  // Load existing device_secrets.json
+String buildTimeJSON() {
   StaticJsonDocument<4096> doc;
 
-  File file = FFat.open("/device_secrets.json", "r");
-  if (file) {
-    deserializeJson(doc, file);
-    file.close();
+  ClockStatus clock = getClockStatus();
+  JsonObject gateway = doc.createNestedObject("gateway");
+  gateway["time_ms"] = getCurrentTimeMs();
+  gateway["synced"] = clock.synced;
+  gateway["references"] = clock.references;
+  gateway["steps"] = clock.steps;
+  gateway["ppm"] = clock.ppm;
+  gateway["last_error_ms"] = clock.lastErrorMs;
+  gateway["last_reference_ms"] = clock.lastReferenceMs;
+
+  TimeSyncStats stats = timeSyncGetStats();
+  JsonObject beacons = doc.createNestedObject("beacons");
+  beacons["sent"] = stats.beacons;
+  beacons["last_ago_ms"] = stats.lastBeaconMs > 0 ? millis() - stats.lastBeaconMs : 0;
+  beacons["rejected_frames"] = stats.rejected;
+  beacons["census_slot_ms"] = stats.censusSlotMs;
+  beacons["tolerance_s"] = TIMESTAMP_TOLERANCE;
+
+  TimeSyncInfo infos[TIME_MAX_DEVICES];
+  int count = timeSyncGetDevices(infos, TIME_MAX_DEVICES);
+
+  JsonArray deviceArray = doc.createNestedArray("devices");
+  for (int i = 0; i < count; i++) {
+    JsonObject deviceObj = deviceArray.createNestedObject();
+    deviceObj["device_id"] = infos[i].deviceId.c_str();
+    deviceObj["state"] = timeSyncStateName(infos[i].state);
+    deviceObj["precise"] = infos[i].precise;
+    if (infos[i].precise) {
+      deviceObj["offset_ms"] = infos[i].offsetMs;
+      deviceObj["error_ms"] = infos[i].errorMs;
+      deviceObj["drift_ppm"] = infos[i].driftPpm;
+    }
+    deviceObj["accepted"] = infos[i].accepted;
+    deviceObj["rejected"] = infos[i].rejected;
   }
 
-  // Update gateway ID
-  doc["gateway_id"] = config.gatewayId;
+  String json;
+  serializeJson(doc, json);
+  return json;
+}
 
-  // Get or create devices array
-  JsonArray devicesArray;
-  if (doc.containsKey("devices")) {
-    devicesArray = doc["devices"];
-  } else {
-    devicesArray = doc.createNestedArray("devices");
+String buildSeqJSON() {
+  StaticJsonDocument<4096> doc;
+
+  SeqStats stats = seqGetStats();
+  JsonObject totals = doc.createNestedObject("totals");
+  totals["accepted"] = stats.accepted;
+  totals["duplicates"] = stats.duplicates;
+  totals["stale"] = stats.stale;
+  totals["legacy"] = stats.legacy;
+  totals["reseeds"] = stats.reseeds;
+  totals["nvs_writes"] = stats.writes;
+  totals["overruns"] = stats.overruns;
+  totals["evictions"] = stats.evictions;
+  totals["refused"] = stats.refused;
+  totals["window"] = SEQ_WINDOW;
+
+  static SeqInfo infos[SEQ_MAX_PEERS];  // Web server task only
+  int count = seqList(infos, SEQ_MAX_PEERS);
+
+  JsonArray peerArray = doc.createNestedArray("peers");
+  for (int i = 0; i < count; i++) {
+    JsonObject peerObj = peerArray.createNestedObject();
+    peerObj["peer_id"] = infos[i].peerId.c_str();
+    peerObj["tx_next"] = infos[i].txNext;
+    peerObj["rx_highest"] = infos[i].rxHighest;
+    peerObj["accepted"] = infos[i].accepted;
+    peerObj["duplicates"] = infos[i].duplicates;
+    peerObj["stale"] = infos[i].stale;
+    peerObj["legacy"] = infos[i].legacy;
+    peerObj["reseeds"] = infos[i].reseeds;
   }
 
-  // Check if device already exists
-  bool found = false;
-  for (JsonObject deviceObj : devicesArray) {
-    if (deviceObj["device_id"] == device.deviceId) {
-      // Update existing
-      deviceObj["shared_secret"] = device.sharedSecret;
-      found = true;
-      break;
+  String json;
+  serializeJson(doc, json);
+  return json;
+}
+
+String buildDiagJSON() {
+  StaticJsonDocument<4096> doc;
+  doc["uptime_ms"] = millis();
+
+  DiagResetInfo reset = diagGetReset();
+  JsonObject lastReset = doc.createNestedObject("last_reset");
+  lastReset["reason"] = reset.reason;
+  if (reset.stalledTask != NULL) {
+    lastReset["stalled_task"] = reset.stalledTask;
+    lastReset["stalled_ms"] = reset.stalledMs;
+  }
+
+  JsonArray taskArray = doc.createNestedArray("tasks");
+  for (int i = 0; i < DIAG_TASK_COUNT; i++) {
+    DiagTaskInfo task = diagGetTask((DiagTask)i);
+    if (task.name == NULL || !task.found) continue;
+
+    JsonObject entry = taskArray.createNestedObject();
+    entry["name"] = task.name;
+    entry["stack_bytes"] = task.stackBytes;
+    entry["stack_free_min"] = task.stackFreeMin;
+    entry["busy_pct"] = task.busyPct;
+    entry["busy_peak_pct"] = task.busyPeakPct;
+    if (task.stallMs > 0) {
+      entry["stall_ms"] = task.stallMs;
+      entry["since_beat_ms"] = task.sinceBeatMs;
+      entry["longest_gap_ms"] = task.longestGapMs;
+      entry["stalled"] = task.stalled;
+      entry["stalls"] = task.stalls;
+      entry["watchdog"] = task.watchdog;
     }
   }
 
-  // Add new device if not found
-  if (!found) {
-    JsonObject newDevice = devicesArray.createNestedObject();
-    newDevice["device_id"] = device.deviceId;
-    newDevice["shared_secret"] = device.sharedSecret;
+  DiagLoopStats loopStats = diagGetLoop();
+  JsonObject loopObj = doc.createNestedObject("loop");
+  loopObj["iterations"] = loopStats.iterations;
+  loopObj["max_us"] = loopStats.maxUs;
+  JsonObject histogram = loopObj.createNestedObject("histogram");
+  for (int b = 0; b < DIAG_LOOP_BUCKETS; b++) {
+    histogram[diagBucketName(b)] = loopStats.histogram[b];
+  }
+  JsonObject sections = loopObj.createNestedObject("section_max_us");
+  for (int s = 0; s < DIAG_SECTION_COUNT; s++) {
+    sections[diagSectionName((DiagSection)s)] = loopStats.sectionMaxUs[s];
+  }
+
+  DiagMemory memory = diagGetMemory();
+  JsonObject heap = doc.createNestedObject("heap");
+  heap["total"] = memory.heapTotal;
+  heap["free"] = memory.heapFree;
+  heap["min_free"] = memory.heapMinFree;
+  heap["largest_block"] = memory.heapLargestBlock;
+  JsonObject psram = doc.createNestedObject("psram");
+  psram["total"] = memory.psramTotal;
+  psram["free"] = memory.psramFree;
+  psram["min_free"] = memory.psramMinFree;
+
+  // Radio 1 TX scheduler: queue wait per priority, modem busy with our frames
+  LoRaTxStats tx = loraTxGetStats(1);
+  JsonObject radioTx = doc.createNestedObject("radio_tx");
+  radioTx["queued"] = tx.queued;
+  radioTx["queued_peak"] = tx.queuedPeak;
+  radioTx["on_air"] = tx.onAir;
+  uint32_t framesSent = 0;
+  for (int p = 0; p < TX_PRIO_COUNT; p++) {
+    JsonObject prio = radioTx.createNestedObject(loraTxPriorityName((TxPriority)p));
+    prio["sent"] = tx.sent[p];
+    prio["wait_avg_ms"] = tx.sent[p] > 0 ? tx.waitTotalMs[p] / tx.sent[p] : 0;
+    prio["wait_max_ms"] = tx.waitMaxMs[p];
+    framesSent += tx.sent[p];
+  }
+  radioTx["busy_ms"] = tx.busyTotalMs;
+  radioTx["busy_avg_ms"] = framesSent > 0 ? tx.busyTotalMs / framesSent : 0;
+  radioTx["busy_max_ms"] = tx.busyMaxMs;
+  radioTx["dropped"] = tx.dropped;
+  radioTx["busy_retries"] = tx.busyRetries;
+  radioTx["errors"] = tx.errors;
+  radioTx["done_timeouts"] = tx.doneTimeouts;
+
+  // UI task: what drawing the OLED costs now that it is off loop()
+  UiStats ui = uiGetStats();
+  JsonObject displayObj = doc.createNestedObject("display");
+  displayObj["present"] = ui.displayPresent;
+  displayObj["renders"] = ui.renders;
+  displayObj["unchanged"] = ui.unchanged;
+  displayObj["pages_sent"] = ui.pagesSent;
+  displayObj["pages_skipped"] = ui.pagesSkipped;
+  displayObj["bytes_sent"] = ui.bytesSent;
+  displayObj["render_avg_us"] = ui.renders > 0 ? ui.renderUsTotal / ui.renders : 0;
+  displayObj["render_max_us"] = ui.renderUsMax;
+  displayObj["flush_avg_us"] = ui.flushes > 0 ? ui.flushUsTotal / ui.flushes : 0;
+  displayObj["flush_max_us"] = ui.flushUsMax;
+  displayObj["full_flush_us"] = ui.fullFlushUs;
+  displayObj["i2c_errors"] = ui.i2cErrors;
+  displayObj["effects"] = ui.effects;
+  displayObj["effects_dropped"] = ui.effectsDropped;
+
+  String json;
+  serializeJson(doc, json);
+  return json;
+}
+
+void addBootTimings(JsonObject boot) {
+  // Phase start/end in ms since power-on (0 = not reached yet)
+  for (int p = 0; p < BOOT_PHASE_COUNT; p++) {
+    BootPhaseTiming t = bootGetTiming((BootPhase)p);
+    JsonObject phase = boot.createNestedObject(bootPhaseName((BootPhase)p));
+    phase["start_ms"] = t.startMs;
+    phase["end_ms"] = t.endMs;
+  }
+}
+
+String buildPollingStatusJSON() {
+  FleetReader snapshot;
+  return buildPollingStatusJSON(fleetView(*snapshot));
+}
+
+// ==================== DISPLAY & INDICATORS ====================
+
+void uiTask(void* parameter) {
+  LOG_I("UI", "UI task started on Core %d", xPortGetCoreID());
+  diagTaskStarted(DIAG_TASK_UI, true);
+
+  while (true) {
+    diagBeat(DIAG_TASK_UI);
+    diagIdle(DIAG_TASK_UI);  // Render / flush times are in uiGetStats()
+
+    // Next effect, pattern step or refresh - whichever comes first
+    uiService(1000);
   }
+}
 
-  // Write back to file
-  file = FFat.open("/device_secrets.json", "w");
-  if (file) {
-    serializeJson(doc, file);
-    file.close();
-    Serial.println("[CONFIG] Device pairing saved: " + device.deviceId);
+void renderStatusScreen(Adafruit_SSD1306& screen) {
+  // uiTask sends only what changed since the last frame
+  FleetReader snapshot;
+
+  screen.clearDisplay();
+  screen.setTextSize(1);
+  screen.setTextColor(SSD1306_WHITE);
+
+  screen.setCursor(0, 0);
+  //screen.print("GW:");
+  screen.print(config.gatewayId);
+  screen.print(" ");
+  if (wifiConnected) screen.print("WiFi:OK ");
+  if (mqttConnected) screen.print("MQTT:OK");
+
+  screen.setCursor(0, 12);
+  if (snapshot->pollingActive) {
+    screen.print("Polling:");
+    screen.print(snapshot->currentDeviceIndex + 1);
+    screen.print("/");
+    screen.print(snapshot->cycleDevices);
+    if (snapshot->censusActive) {
+      screen.print(" CENSUS");
+    } else if (snapshot->currentDeviceIndex < snapshot->cycleDevices) {
+      screen.print(" ");
+      screen.print(snapshot->devices[snapshot->pollOrder[snapshot->currentDeviceIndex]].deviceId.c_str());
+    }
   } else {
-    Serial.println("[CONFIG] Failed to save device pairing!");
+    screen.print("Idle - Msgs:");
+    screen.print(snapshot->totalMessages);
+  }
+
+  screen.setCursor(0, 24);
+  screen.print("OK:");
+  screen.print(snapshot->successfulPolls);
+  screen.print(" Fail:");
+  screen.print(snapshot->failedPolls);
+}
+
+void writeLedColor(uint8_t r, uint8_t g, uint8_t b) {
+  led.setPixelColor(0, led.Color(r, g, b));
+  led.show();
+}
+
+void writeBuzzer(bool on) {
+  digitalWrite(BUZZER_PIN, on ? HIGH : LOW);
+}
+
+// ==================== DIAGNOSTICS ====================
+
+void sampleHeapStats() {
+  heapStats.freeBytes = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+  heapStats.minFreeBytes = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+  heapStats.largestBlock = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+
+  if (heapStats.largestBlock < heapStats.minLargestBlock) {
+    heapStats.minLargestBlock = heapStats.largestBlock;
   }
+
+  heapStats.fragmentationPct = (heapStats.freeBytes > 0)
+    ? (uint8_t)(100 - (heapStats.largestBlock * 100) / heapStats.freeBytes)
+    : 0;
+}
+
+// ==================== STORAGE & REPORTS ====================
+
+void saveConfiguration() {
+  preferences.begin("detectra", false);  // Read-write mode
+
+  preferences.putString("gateway_id", config.gatewayId);
+  preferences.putString("building", config.building);
+  preferences.putString("floor", config.floor);
+  preferences.putString("lab", config.lab);
+  preferences.putInt("poll_interval", config.pollingIntervalMinutes);
+  preferences.putInt("energy_days", config.energyTargetDays);
+  preferences.putUChar(MQTT_ENCODING_NVS_KEY, codecGetMask());
+
+  preferences.end();
+
+  LOG_I("CONFIG", "Configuration saved to NVS");
 }
 
 void generateCycleReport() {
   // FFat disabled - report generation skipped
-  Serial.println("[REPORT] Cycle complete (FFat report disabled)");
+  LOG_I("REPORT", "Cycle complete (FFat report disabled)");
 
   // FFat-based report disabled:
   // // Generate CSV report of polling cycle
@@ -1656,29 +3582,88 @@ void generateCycleReport() {
   //   file.print(",");
   //   file.print(devices[i].positionsReceived);
   //   file.print(",");
-  //   file.print(devices[i].lastTableId);
+  //   file.print(deviceResults[i].lastTableId.c_str());
   //   file.print(",");
-  //   file.print(devices[i].lastPosition);
+  //   file.print(deviceResults[i].lastPosition.c_str());
   //   file.print(",");
-  //   file.println(devices[i].lastDetections);
+  //   file.println(deviceResults[i].lastDetections.c_str());
   // }
   //
   // file.close();
   // Serial.println("[REPORT] Cycle report saved: " + filename);
 }
 
+// ==================== PAIRING ====================
+
+int addPendingDevice(const char* deviceId, const char* tableLeft, const char* tableRight) {
+  // Paired once PAIR_ACK arrives; the caller rebuilds the schedule and publishes the fleet
+  if (config.numDevices >= MAX_DEVICES) return -1;
+
+  int idx = config.numDevices;
+  devices[idx].deviceId = deviceId;
+  devices[idx].sharedSecret = String("temp_secret_") + deviceId; // TODO: Generate proper secret
+  devices[idx].paired = false; // Will be true after PAIR_ACK
+  devices[idx].tableLeft = tableLeft;
+  devices[idx].tableRight = tableRight;
+  devices[idx].phase = PHASE_IDLE;
+  devices[idx].online = false;
+  devices[idx].battery = -1;
+  devices[idx].rssi = 0;
+  devices[idx].snr = 0;
+  devices[idx].retryCount = 0;
+  devices[idx].commandSent = false;
+  devices[idx].censusSeen = false;
+  devices[idx].positionsReceived = 0;
+  devices[idx].positionsRequested = POLL_POSITIONS;
+  devices[idx].totalPolls = 0;
+  devices[idx].successfulPolls = 0;
+  devices[idx].failedPolls = 0;
+  devices[idx].lastContact = 0;
+  devices[idx].scheduleGroup = 0;
+  devices[idx].cadenceMinutes = 0;
+  devices[idx].cadenceStretch = 1;
+  devices[idx].nextPollMs = 0;  // Scheduled one cadence from now by scheduleRebuild()
+  deviceTables[idx] = DeviceTables();  // First result is a keyframe
+
+  config.numDevices++;
+  return idx;
+}
+
+bool sendPairFrame(const char* deviceId, const char* tableLeft, const char* tableRight) {
+  // PAIR with the table data (simplified protocol - no HMAC)
+  // Format: GWx:PAIR:EDx:SEQ:timestamp:table_left|table_right
+  // An unpaired device re-seeds its window for this gateway at SEQ (seq_space.h)
+  PairPayload pair;
+  pair.tableLeft = tableLeft;
+  pair.tableRight = tableRight;
+  char pairPayload[2 * TABLE_ID_MAX + 2];
+  encodePairPayload(pairPayload, sizeof(pairPayload), pair);  // "null" if both empty
+  return sendLoRaMessage(CMD_PAIR, deviceId, pairPayload, 1) > 0;
+}
+
+void onPairProgress() {
+  wsNotify(WS_TOPIC_PAIRING);
+}
+
+void onPairDone() {
+  // Every PAIR_ACK of the batch only marked the registry dirty - one write now
+  registryHold(false);
+  wsNotify(WS_TOPIC_DEVICES);
+  uiBeep(200);
+}
+
 // ==================== UTILITIES ====================
 
-String getDeviceSecret(const String& deviceId) {
+String getDeviceSecret(const char* deviceId) {
   for (int i = 0; i < config.numDevices; i++) {
     if (devices[i].deviceId == deviceId) {
-      return devices[i].sharedSecret;
+      return String(devices[i].sharedSecret.c_str());
     }
   }
   return "";
 }
 
-int getDeviceIndexById(const String& deviceId) {
+int getDeviceIndexById(const char* deviceId) {
   for (int i = 0; i < config.numDevices; i++) {
     if (devices[i].deviceId == deviceId) {
       return i;
@@ -1686,3 +3671,7 @@ int getDeviceIndexById(const String& deviceId) {
   }
   return -1;
 }
+
+bool isRegisteredDevice(const char* deviceId) {
+  return getDeviceIndexById(deviceId) != -1;
+}
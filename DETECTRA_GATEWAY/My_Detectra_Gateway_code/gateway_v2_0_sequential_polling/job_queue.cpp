@@ -0,0 +1,226 @@
+/**
+ * DETECTRA Gateway v2.0 - Ad-hoc Device Jobs Implementation
+ */
+
+#include "job_queue.h"
+#include "log.h"
+
+static JobInfo jobs[JOB_SLOTS];
+static uint32_t nextId = 1;
+static JobStats stats = {};
+static JobNotifyFn notifyChange = NULL;
+static SemaphoreHandle_t jobLock = NULL;
+
+static const char* const KIND_NAMES[JOB_KIND_COUNT] = { "poll", "inference", "health" };
+static const char* const STATE_NAMES[] = { "queued", "running", "done", "failed" };
+
+static JobInfo* findJob(uint32_t id) {
+  for (int i = 0; i < JOB_SLOTS; i++) {
+    if (jobs[i].id == id) return &jobs[i];
+  }
+  return NULL;
+}
+
+/**
+ * Free slot, else the oldest finished job (NULL: every slot queued / running)
+ */
+static JobInfo* freeSlot() {
+  JobInfo* oldest = NULL;
+  for (int i = 0; i < JOB_SLOTS; i++) {
+    if (jobs[i].id == 0) return &jobs[i];
+    if (jobs[i].state != JOB_DONE && jobs[i].state != JOB_FAILED) continue;
+    if (oldest == NULL || jobs[i].id < oldest->id) oldest = &jobs[i];
+  }
+  return oldest;
+}
+
+// ==================== JOB FUNCTIONS ====================
+
+void jobInit(JobNotifyFn changed) {
+  notifyChange = changed;
+  jobLock = xSemaphoreCreateMutex();
+}
+
+uint32_t jobSubmit(JobKind kind, const char* deviceId, unsigned long now) {
+  if (jobLock == NULL || kind >= JOB_KIND_COUNT) return 0;
+
+  xSemaphoreTake(jobLock, portMAX_DELAY);
+
+  // Same request still waiting: one radio exchange answers both
+  for (int i = 0; i < JOB_SLOTS; i++) {
+    if (jobs[i].id != 0 && jobs[i].state == JOB_QUEUED && jobs[i].kind == kind && jobs[i].deviceId == deviceId) {
+      uint32_t id = jobs[i].id;
+      stats.merged++;
+      xSemaphoreGive(jobLock);
+      return id;
+    }
+  }
+
+  JobInfo* job = stats.queued < JOB_QUEUE_MAX ? freeSlot() : NULL;
+  if (job == NULL) {
+    stats.refused++;
+    xSemaphoreGive(jobLock);
+    LOG_W("JOB", "Queue full - %s for %s refused", jobKindName(kind), deviceId);
+    return 0;
+  }
+
+  *job = JobInfo();
+  job->id = nextId++;
+  job->kind = kind;
+  job->state = JOB_QUEUED;
+  job->deviceId = deviceId;
+  job->submittedMs = now;
+  job->result.battery = -1;
+  uint32_t id = job->id;
+  stats.queued++;
+  stats.submitted++;
+  xSemaphoreGive(jobLock);
+
+  LOG_I("JOB", "Job %u: %s %s queued", id, jobKindName(kind), deviceId);
+  if (notifyChange != NULL) notifyChange();
+  return id;
+}
+
+bool jobPending() {
+  return stats.queued > 0;
+}
+
+bool jobTake(JobInfo& out, unsigned long now) {
+  if (jobLock == NULL || stats.queued == 0) return false;
+
+  xSemaphoreTake(jobLock, portMAX_DELAY);
+  JobInfo* job = NULL;
+  for (int i = 0; i < JOB_SLOTS; i++) {
+    if (jobs[i].id == 0 || jobs[i].state != JOB_QUEUED) continue;
+    if (job == NULL || jobs[i].id < job->id) job = &jobs[i];
+  }
+  if (job != NULL) {
+    job->state = JOB_RUNNING;
+    job->startedMs = now;
+    stats.queued--;
+    stats.running = true;
+    out = *job;
+  }
+  xSemaphoreGive(jobLock);
+
+  if (job == NULL) return false;
+  LOG_I("JOB", "Job %u: %s %s started after %lums", out.id, jobKindName(out.kind), out.deviceId.c_str(),
+        now - out.submittedMs);
+  if (notifyChange != NULL) notifyChange();
+  return true;
+}
+
+void jobFinish(uint32_t id, JobState state, const char* error, const JobResult& result, unsigned long now) {
+  if (jobLock == NULL) return;
+
+  xSemaphoreTake(jobLock, portMAX_DELAY);
+  JobInfo* job = findJob(id);
+  if (job == NULL || job->state != JOB_RUNNING) {
+    xSemaphoreGive(jobLock);
+    return;
+  }
+  job->state = state == JOB_DONE ? JOB_DONE : JOB_FAILED;
+  job->error = job->state == JOB_FAILED ? error : NULL;
+  job->result = result;
+  job->finishedMs = now;
+  stats.running = false;
+  if (job->state == JOB_DONE) {
+    stats.done++;
+  } else {
+    stats.failed++;
+  }
+  unsigned long runMs = now - job->startedMs;
+  xSemaphoreGive(jobLock);
+
+  if (state == JOB_DONE) {
+    LOG_I("JOB", "Job %u done in %lums", id, runMs);
+  } else {
+    LOG_W("JOB", "Job %u failed after %lums: %s", id, runMs, error != NULL ? error : "");
+  }
+  if (notifyChange != NULL) notifyChange();
+}
+
+int jobDropDevice(const char* deviceId, unsigned long now) {
+  if (jobLock == NULL) return 0;
+
+  xSemaphoreTake(jobLock, portMAX_DELAY);
+  int dropped = 0;
+  for (int i = 0; i < JOB_SLOTS; i++) {
+    JobInfo& job = jobs[i];
+    if (job.id == 0 || job.state != JOB_QUEUED || !(job.deviceId == deviceId)) continue;
+    job.state = JOB_FAILED;
+    job.error = "device removed";
+    job.finishedMs = now;
+    stats.queued--;
+    stats.failed++;
+    dropped++;
+  }
+  xSemaphoreGive(jobLock);
+
+  if (dropped == 0) return 0;
+  LOG_I("JOB", "%d queued job(s) for %s dropped - device removed", dropped, deviceId);
+  if (notifyChange != NULL) notifyChange();
+  return dropped;
+}
+
+bool jobGet(uint32_t id, JobInfo& out) {
+  if (jobLock == NULL || id == 0) return false;
+
+  xSemaphoreTake(jobLock, portMAX_DELAY);
+  JobInfo* job = findJob(id);
+  if (job != NULL) out = *job;
+  xSemaphoreGive(jobLock);
+
+  return job != NULL;
+}
+
+int jobList(JobInfo* out, int maxJobs) {
+  if (jobLock == NULL) return 0;
+
+  xSemaphoreTake(jobLock, portMAX_DELAY);
+  int count = 0;
+  for (int i = 0; i < JOB_SLOTS && count < maxJobs; i++) {
+    if (jobs[i].id != 0) out[count++] = jobs[i];
+  }
+  xSemaphoreGive(jobLock);
+
+  // Insertion sort by ID (slots are reused out of order)
+  for (int i = 1; i < count; i++) {
+    JobInfo job = out[i];
+    int j = i - 1;
+    while (j >= 0 && out[j].id > job.id) {
+      out[j + 1] = out[j];
+      j--;
+    }
+    out[j + 1] = job;
+  }
+  return count;
+}
+
+JobStats jobGetStats() {
+  if (jobLock == NULL) return JobStats();
+
+  xSemaphoreTake(jobLock, portMAX_DELAY);
+  JobStats copy = stats;
+  xSemaphoreGive(jobLock);
+
+  return copy;
+}
+
+const char* jobKindName(JobKind kind) {
+  return kind < JOB_KIND_COUNT ? KIND_NAMES[kind] : "unknown";
+}
+
+const char* jobStateName(JobState state) {
+  return state <= JOB_FAILED ? STATE_NAMES[state] : "unknown";
+}
+
+bool jobParseKind(const char* name, JobKind& out) {
+  for (int k = 0; k < JOB_KIND_COUNT; k++) {
+    if (strcmp(name, KIND_NAMES[k]) == 0) {
+      out = (JobKind)k;
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,171 @@
+/**
+ * DETECTRA Gateway v2.0 - Ad-hoc Device Jobs
+ *
+ * Operator requests for one device (web API) are queued as jobs instead of
+ * writing to the radio from the web server:
+ *
+ *   kind        phases run                                  result
+ *   poll        HEALTH_CHECK .. FINALIZE (a full poll)      health + DATA
+ *   inference   START_INFERENCE .. FINALIZE                 DATA
+ *   health      HEALTH_CHECK (POLL -> ACK ONLINE)           battery / RSSI / SNR
+ *
+ * - Every job gets an ID at submission; the same kind for the same device
+ *   while one is still queued returns that job instead of a second one.
+ * - pollingTask runs jobs through the normal phase state machine, one
+ *   device at a time: back to back between cycles, and one job at each
+ *   device boundary of a running cycle, so a cycle is stretched by a job
+ *   but never interrupted or starved.
+ * - Every state change calls the change callback (WebSocket push); the
+ *   last JOB_SLOTS jobs stay readable (GET /api/job, long-poll).
+ *
+ * Usage:
+ *   jobInit(onJobChanged);
+ *   uint32_t id = jobSubmit(JOB_POLL, deviceId, millis());   // web handler
+ *
+ *   JobInfo job;
+ *   if (jobTake(job, millis())) ... run it ...               // pollingTask
+ *   jobFinish(job.id, JOB_DONE, NULL, result, millis());
+ */
+
+#ifndef JOB_QUEUE_H
+#define JOB_QUEUE_H
+
+#include <Arduino.h>
+#include "lora_protocol.h"
+
+// ==================== CONFIGURATION ====================
+
+#define JOB_SLOTS               16        // Queued + running + finished jobs kept
+#define JOB_QUEUE_MAX           8         // Queued at once (submissions beyond are refused)
+#define JOB_WAIT_MAX_MS         30000     // Longest long-poll (GET /api/job?wait_ms=)
+
+// ==================== DATA STRUCTURES ====================
+
+enum JobKind : uint8_t {
+  JOB_POLL,
+  JOB_INFERENCE,
+  JOB_HEALTH,
+  JOB_KIND_COUNT
+};
+
+enum JobState : uint8_t {
+  JOB_QUEUED,
+  JOB_RUNNING,
+  JOB_DONE,
+  JOB_FAILED
+};
+
+/**
+ * What a finished job read from the device
+ */
+struct JobResult {
+  int16_t battery;                  // -1 = not reported
+  int16_t rssi;
+  int16_t snr;
+  uint8_t positions;                // DATA positions received
+};
+
+/**
+ * One job
+ */
+struct JobInfo {
+  uint32_t id;                      // 0 = free slot
+  JobKind kind;
+  JobState state;
+  FixedString<NODE_ID_MAX> deviceId;
+  unsigned long submittedMs;
+  unsigned long startedMs;
+  unsigned long finishedMs;
+  const char* error;                // Static string, FAILED only
+  JobResult result;
+};
+
+/**
+ * Counters
+ */
+struct JobStats {
+  uint8_t queued;
+  bool running;
+  uint32_t submitted;
+  uint32_t merged;                  // Submissions answered with a job already queued
+  uint32_t refused;                 // Queue full
+  uint32_t done;
+  uint32_t failed;
+};
+
+/**
+ * A job was queued, started or finished (called outside the module lock)
+ */
+typedef void (*JobNotifyFn)();
+
+// ==================== JOB FUNCTIONS ====================
+
+/**
+ * Set the change callback (call once in setup)
+ */
+void jobInit(JobNotifyFn changed);
+
+/**
+ * Queue a job (any task)
+ *
+ * @return Job ID, 0 if the queue is full
+ */
+uint32_t jobSubmit(JobKind kind, const char* deviceId, unsigned long now);
+
+/**
+ * Any job waiting to run
+ */
+bool jobPending();
+
+/**
+ * Start the oldest queued job (pollingTask)
+ *
+ * @return false if none is queued
+ */
+bool jobTake(JobInfo& out, unsigned long now);
+
+/**
+ * End a running job as JOB_DONE or JOB_FAILED
+ */
+void jobFinish(uint32_t id, JobState state, const char* error, const JobResult& result, unsigned long now);
+
+/**
+ * Fail every queued job for a device (device removed)
+ *
+ * @return Number of jobs dropped
+ */
+int jobDropDevice(const char* deviceId, unsigned long now);
+
+/**
+ * One job by ID
+ *
+ * @return false if unknown (never submitted, or no longer kept)
+ */
+bool jobGet(uint32_t id, JobInfo& out);
+
+/**
+ * Kept jobs, oldest first
+ *
+ * @return Number copied
+ */
+int jobList(JobInfo* out, int maxJobs);
+
+/**
+ * Counters
+ */
+JobStats jobGetStats();
+
+/**
+ * Labels
+ */
+const char* jobKindName(JobKind kind);          // "poll", "inference", "health"
+const char* jobStateName(JobState state);       // "queued", "running", "done", "failed"
+
+/**
+ * Kind from its label
+ *
+ * @return false if unknown
+ */
+bool jobParseKind(const char* name, JobKind& out);
+
+#endif // JOB_QUEUE_H
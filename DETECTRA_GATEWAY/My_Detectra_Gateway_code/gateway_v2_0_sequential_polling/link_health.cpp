@@ -0,0 +1,320 @@
+/**
+ * DETECTRA Gateway v2.0 - Link & Health Analytics Implementation
+ */
+
+#include "link_health.h"
+#include "log.h"
+#include <math.h>
+
+#define LINK_FORGET   (1.0f - 1.0f / LINK_WINDOW)
+
+/**
+ * Weighted Welford state of one metric against time (t in hours since the
+ * model was created). Older samples weigh LINK_FORGET^age.
+ */
+struct LinkTrend {
+  uint16_t samples;
+  float w;                          // Sum of weights
+  float meanT;
+  float mean;
+  float sTT, sTY, sYY;              // Weighted co-moments
+};
+
+/**
+ * Failure limit and healthy level of a metric
+ */
+struct LinkLimits {
+  float limit;
+  float good;
+  bool higherIsWorse;
+};
+
+static const LinkLimits LIMITS[LINK_METRIC_COUNT] = {
+  { LINK_RSSI_LIMIT,       LINK_RSSI_GOOD,       false },
+  { LINK_SNR_LIMIT,        LINK_SNR_GOOD,        false },
+  { LINK_BATTERY_LIMIT,    LINK_BATTERY_GOOD,    false },
+  { LINK_LATENCY_LIMIT_MS, LINK_LATENCY_GOOD_MS, true }
+};
+
+static const char* const METRIC_NAMES[LINK_METRIC_COUNT + 1] = { "rssi", "snr", "battery", "latency", "reply_rate" };
+static const char* const ALERT_NAMES[] = { "ok", "warn", "critical" };
+
+struct LinkModel {
+  FixedString<NODE_ID_MAX> deviceId;  // Empty = free slot
+  unsigned long createdMs;
+  unsigned long lastUsedMs;
+  LinkTrend trends[LINK_METRIC_COUNT];
+  float replyRate;
+  uint32_t replies;
+  uint32_t misses;
+  float fragility;
+  LinkAlert alert;
+  uint32_t alerts;
+};
+
+static LinkModel models[LINK_MAX_DEVICES];
+static LinkAlertFn notifyAlert = NULL;
+static SemaphoreHandle_t linkLock = NULL;
+
+static float clamp01(float x) {
+  return x < 0.0f ? 0.0f : (x > 1.0f ? 1.0f : x);
+}
+
+// ==================== MODELS ====================
+
+static LinkModel* findModel(const char* deviceId) {
+  for (int i = 0; i < LINK_MAX_DEVICES; i++) {
+    if (!models[i].deviceId.isEmpty() && models[i].deviceId == deviceId) return &models[i];
+  }
+  return NULL;
+}
+
+static LinkModel* findOrCreateModel(const char* deviceId, unsigned long now) {
+  LinkModel* model = findModel(deviceId);
+  if (model != NULL) return model;
+
+  // Free slot, else the model not used for longest (a removed device)
+  int slot = 0;
+  for (int i = 0; i < LINK_MAX_DEVICES; i++) {
+    if (models[i].deviceId.isEmpty()) { slot = i; break; }
+    if (now - models[i].lastUsedMs > now - models[slot].lastUsedMs) slot = i;
+  }
+
+  model = &models[slot];
+  *model = LinkModel();
+  model->deviceId = deviceId;
+  model->createdMs = now;
+  model->replyRate = 1.0f;
+  return model;
+}
+
+static float hoursOf(const LinkModel& m, unsigned long now) {
+  return (now - m.createdMs) / 3600000.0f;
+}
+
+// ==================== STATISTICS ====================
+
+static void addSample(LinkTrend& s, float t, float y) {
+  s.samples++;
+  s.w = s.w * LINK_FORGET + 1.0f;
+
+  float dt = t - s.meanT;
+  float dy = y - s.mean;
+  s.meanT += dt / s.w;
+  s.mean += dy / s.w;
+
+  s.sTT = s.sTT * LINK_FORGET + dt * (t - s.meanT);
+  s.sTY = s.sTY * LINK_FORGET + dt * (y - s.mean);
+  s.sYY = s.sYY * LINK_FORGET + dy * (y - s.mean);
+}
+
+static LinkMetricInfo describe(const LinkTrend& s, const LinkLimits& limits, float t) {
+  LinkMetricInfo info = {};
+  info.samples = s.samples;
+  info.hoursToLimit = -1.0f;
+  if (s.samples == 0) return info;
+
+  info.mean = s.mean;
+  info.stddev = s.w > 0.0f ? sqrtf(s.sYY / s.w) : 0.0f;
+
+  // Level: how far the average has moved from healthy towards the limit
+  float level = limits.higherIsWorse ? (s.mean - limits.good) / (limits.limit - limits.good)
+                                     : (limits.good - s.mean) / (limits.good - limits.limit);
+  info.score = clamp01(level);
+
+  // Trend: only once it spans some time and its change over the horizon beats the noise
+  if (s.samples >= LINK_MIN_SAMPLES && s.sTT > 1e-6f) {
+    info.slopePerHour = s.sTY / s.sTT;
+
+    bool worsening = limits.higherIsWorse ? info.slopePerHour > 0.0f : info.slopePerHour < 0.0f;
+    if (worsening && fabsf(info.slopePerHour) * LINK_HORIZON_H > info.stddev) {
+      float now = s.mean + info.slopePerHour * (t - s.meanT);
+      float hours = (limits.limit - now) / info.slopePerHour;
+      info.hoursToLimit = hours > 0.0f ? hours : 0.0f;
+
+      // 0.5 (warn) when the limit is one horizon away, 1 when it is here
+      float trend = clamp01(1.0f - info.hoursToLimit / (2.0f * LINK_HORIZON_H));
+      if (trend > info.score) info.score = trend;
+    }
+  }
+  return info;
+}
+
+static void fillInfo(const LinkModel& m, unsigned long now, LinkInfo& out) {
+  out.deviceId = m.deviceId;
+  out.replyRate = m.replyRate;
+  out.replies = m.replies;
+  out.misses = m.misses;
+  out.alert = m.alert;
+  out.alerts = m.alerts;
+
+  float t = hoursOf(m, now);
+  out.fragility = clamp01(2.0f * (1.0f - m.replyRate));  // One miss in two -> 1
+  out.worst = LINK_METRIC_COUNT;
+  for (int k = 0; k < LINK_METRIC_COUNT; k++) {
+    out.metrics[k] = describe(m.trends[k], LIMITS[k], t);
+    if (out.metrics[k].score > out.fragility) {
+      out.fragility = out.metrics[k].score;
+      out.worst = (LinkMetric)k;
+    }
+  }
+}
+
+static bool isCritical(const LinkInfo& info) {
+  if (info.replyRate < 0.5f) return true;
+  for (int k = 0; k < LINK_METRIC_COUNT; k++) {
+    const LinkMetricInfo& metric = info.metrics[k];
+    if (metric.samples == 0) continue;
+    if (metric.score >= 1.0f) return true;
+    if (metric.hoursToLimit >= 0.0f && metric.hoursToLimit <= LINK_HORIZON_H / 4) return true;
+  }
+  return false;
+}
+
+/**
+ * Re-score a model after a sample; fills info and returns true if the alert level changed
+ */
+static bool evaluate(LinkModel& m, unsigned long now, LinkInfo& info, LinkAlert& previous) {
+  fillInfo(m, now, info);
+  m.fragility = info.fragility;
+
+  LinkAlert level = m.alert;
+  if (isCritical(info)) {
+    level = LINK_ALERT_CRITICAL;
+  } else if (info.fragility >= LINK_WARN_SCORE) {
+    level = LINK_ALERT_WARN;
+  } else if (info.fragility < LINK_CLEAR_SCORE) {
+    level = LINK_ALERT_OK;
+  } else if (level == LINK_ALERT_CRITICAL) {
+    level = LINK_ALERT_WARN;  // Between clear and warn: step down, but not to ok
+  }
+
+  previous = m.alert;
+  if (level == m.alert) return false;
+
+  m.alert = level;
+  m.alerts++;
+  info.alert = level;
+  info.alerts = m.alerts;
+  return true;
+}
+
+static void report(const LinkInfo& info, LinkAlert previous) {
+  if (info.alert > previous) {
+    LOG_W("LINK", "%s %s: %s (fragility %.2f)", info.deviceId.c_str(), linkAlertName(info.alert),
+          linkMetricName(info.worst), info.fragility);
+  } else {
+    LOG_I("LINK", "%s back to %s (fragility %.2f)", info.deviceId.c_str(), linkAlertName(info.alert),
+          info.fragility);
+  }
+  if (notifyAlert != NULL) notifyAlert(info, previous);
+}
+
+// ==================== LINK FUNCTIONS ====================
+
+void linkInit(LinkAlertFn alert) {
+  notifyAlert = alert;
+  linkLock = xSemaphoreCreateMutex();
+}
+
+void linkRecordHealth(const DeviceInfo& device, unsigned long now) {
+  if (linkLock == NULL) return;
+
+  xSemaphoreTake(linkLock, portMAX_DELAY);
+  LinkModel& m = *findOrCreateModel(device.deviceId.c_str(), now);
+  m.lastUsedMs = now;
+
+  float t = hoursOf(m, now);
+  addSample(m.trends[LINK_METRIC_RSSI], t, device.rssi);
+  addSample(m.trends[LINK_METRIC_SNR], t, device.snr);
+  if (device.battery >= 0) addSample(m.trends[LINK_METRIC_BATTERY], t, device.battery);
+
+  LinkInfo info;
+  LinkAlert previous;
+  bool changed = evaluate(m, now, info, previous);
+  xSemaphoreGive(linkLock);
+
+  if (changed) report(info, previous);
+}
+
+void linkRecordReply(const char* deviceId, bool answered, unsigned long latencyMs, unsigned long now) {
+  if (linkLock == NULL) return;
+
+  xSemaphoreTake(linkLock, portMAX_DELAY);
+  LinkModel& m = *findOrCreateModel(deviceId, now);
+  m.lastUsedMs = now;
+
+  if (answered) {
+    m.replies++;
+    addSample(m.trends[LINK_METRIC_LATENCY], hoursOf(m, now), latencyMs);
+  } else {
+    m.misses++;
+  }
+  m.replyRate += ((answered ? 1.0f : 0.0f) - m.replyRate) * LINK_REPLY_WEIGHT;
+
+  LinkInfo info;
+  LinkAlert previous;
+  bool changed = evaluate(m, now, info, previous);
+  xSemaphoreGive(linkLock);
+
+  if (changed) report(info, previous);
+}
+
+float linkFragility(const char* deviceId) {
+  if (linkLock == NULL) return 0.0f;
+
+  xSemaphoreTake(linkLock, portMAX_DELAY);
+  LinkModel* m = findModel(deviceId);
+  float fragility = m != NULL ? m->fragility : 0.0f;
+  xSemaphoreGive(linkLock);
+
+  return fragility;
+}
+
+void linkSortByFragility(const DeviceInfo* devices, int* order, int count) {
+  if (linkLock == NULL || count < 2) return;
+
+  float scores[LINK_MAX_DEVICES];
+  if (count > LINK_MAX_DEVICES) count = LINK_MAX_DEVICES;
+
+  xSemaphoreTake(linkLock, portMAX_DELAY);
+  for (int i = 0; i < count; i++) {
+    LinkModel* m = findModel(devices[order[i]].deviceId.c_str());
+    float score = m != NULL ? m->fragility : 0.0f;
+    scores[i] = score >= LINK_FRAGILE_SCORE ? score : 0.0f;  // Healthy devices keep their order
+  }
+  xSemaphoreGive(linkLock);
+
+  // Stable insertion sort, highest score first
+  for (int i = 1; i < count; i++) {
+    int index = order[i];
+    float score = scores[i];
+    int j = i - 1;
+    while (j >= 0 && scores[j] < score) {
+      order[j + 1] = order[j];
+      scores[j + 1] = scores[j];
+      j--;
+    }
+    order[j + 1] = index;
+    scores[j + 1] = score;
+  }
+}
+
+bool linkGetInfo(const char* deviceId, unsigned long now, LinkInfo& out) {
+  if (linkLock == NULL) return false;
+
+  xSemaphoreTake(linkLock, portMAX_DELAY);
+  LinkModel* m = findModel(deviceId);
+  if (m != NULL) fillInfo(*m, now, out);
+  xSemaphoreGive(linkLock);
+
+  return m != NULL;
+}
+
+const char* linkMetricName(LinkMetric metric) {
+  return metric <= LINK_METRIC_COUNT ? METRIC_NAMES[metric] : "unknown";
+}
+
+const char* linkAlertName(LinkAlert alert) {
+  return alert <= LINK_ALERT_CRITICAL ? ALERT_NAMES[alert] : "unknown";
+}
@@ -0,0 +1,159 @@
+/**
+ * DETECTRA Gateway v2.0 - Link & Health Analytics (streaming, per device)
+ *
+ * ACK ONLINE overwrites battery / RSSI / SNR in DeviceInfo; this module
+ * keeps their history as a few running sums per device, so a link that is
+ * getting worse shows up before the device goes offline:
+ *
+ *   metric     sample                          failure at
+ *   rssi       ACK ONLINE (dBm)                LINK_RSSI_LIMIT
+ *   snr        ACK ONLINE (dB)                 LINK_SNR_LIMIT
+ *   battery    ACK ONLINE (%)                  LINK_BATTERY_LIMIT
+ *   latency    command -> reply per phase (ms) LINK_LATENCY_LIMIT_MS
+ *
+ * Each metric is a Welford update with exponential forgetting (window of
+ * about LINK_WINDOW samples, O(1) memory): weighted mean (the EWMA),
+ * variance, and the least-squares slope against time. The trend line gives
+ * the hours until the metric reaches its failure limit.
+ *
+ * Missed replies (phase timeouts) go into a reply rate (EWMA).
+ *
+ * - Alerts: a metric whose trend reaches its limit within LINK_HORIZON_H
+ *   (or that is already past its warning level) raises "warn"; past the
+ *   limit, or due within a quarter of the horizon, raises "critical".
+ *   Every change of a device's alert level calls the alert callback once
+ *   (MQTT detectra/<gw>/alert), including the return to "ok".
+ * - Polling order: each device gets a fragility score (0 = healthy,
+ *   1 = about to fail). linkSortByFragility() puts fragile devices first
+ *   in a cycle, so they are polled while they are still reachable.
+ *
+ * Statistics live in RAM and are relearned after a reboot.
+ *
+ * Usage:
+ *   linkInit(publishLinkAlert);
+ *   linkRecordHealth(device, millis());                        // ACK ONLINE
+ *   linkRecordReply(deviceId, true, latencyMs, millis());      // phase reply
+ *   linkRecordReply(deviceId, false, 0, millis());             // phase timeout
+ *   linkSortByFragility(devices, pollOrder, cycleDevices);     // cycle start
+ */
+
+#ifndef LINK_HEALTH_H
+#define LINK_HEALTH_H
+
+#include <Arduino.h>
+#include "lora_protocol.h"
+
+// ==================== CONFIGURATION ====================
+
+#define LINK_MAX_DEVICES          32        // Models (keyed by device ID)
+#define LINK_WINDOW               16        // Samples: weight falls by 1/e over ~16 samples
+#define LINK_MIN_SAMPLES          4         // Before a trend is trusted
+#define LINK_HORIZON_H            24.0f     // Projected failure within this -> warn
+#define LINK_REPLY_WEIGHT         0.125f    // Reply rate EWMA: 1/8 per command
+
+// Failure limits and the level at which a metric counts as healthy (fragility 0)
+#define LINK_RSSI_LIMIT           -120.0f   // dBm (SX1262, SF9 / BW125 sensitivity ~ -126)
+#define LINK_RSSI_GOOD            -95.0f
+#define LINK_SNR_LIMIT            -12.0f    // dB (SF9 demodulation floor ~ -12.5)
+#define LINK_SNR_GOOD             0.0f
+#define LINK_BATTERY_LIMIT        10.0f     // % (ENERGY_LOW_BATTERY)
+#define LINK_BATTERY_GOOD         40.0f
+#define LINK_LATENCY_LIMIT_MS     5000.0f   // HEALTH_CHECK phase timeout
+#define LINK_LATENCY_GOOD_MS      1500.0f
+
+#define LINK_WARN_SCORE           0.5f      // Fragility that raises "warn"
+#define LINK_CLEAR_SCORE          0.3f      // ...and below which it clears (hysteresis)
+#define LINK_FRAGILE_SCORE        0.25f     // Polled ahead of healthy devices from here
+
+// ==================== DATA STRUCTURES ====================
+
+enum LinkMetric : uint8_t {
+  LINK_METRIC_RSSI,
+  LINK_METRIC_SNR,
+  LINK_METRIC_BATTERY,
+  LINK_METRIC_LATENCY,
+  LINK_METRIC_COUNT
+};
+
+enum LinkAlert : uint8_t {
+  LINK_ALERT_OK,
+  LINK_ALERT_WARN,          // Trending towards failure
+  LINK_ALERT_CRITICAL       // At / past the limit, or due within LINK_HORIZON_H / 4
+};
+
+/**
+ * One metric (GET /api/link, alerts)
+ */
+struct LinkMetricInfo {
+  uint16_t samples;                 // Since boot
+  float mean;                       // Weighted mean (EWMA)
+  float stddev;
+  float slopePerHour;               // Trend (0 until LINK_MIN_SAMPLES)
+  float hoursToLimit;               // Trend reaches the failure limit (-1 = not heading there)
+  float score;                      // 0 healthy .. 1 failing
+};
+
+/**
+ * One device
+ */
+struct LinkInfo {
+  FixedString<NODE_ID_MAX> deviceId;
+  LinkMetricInfo metrics[LINK_METRIC_COUNT];
+  float replyRate;                  // Share of commands answered (EWMA)
+  uint32_t replies;
+  uint32_t misses;
+  float fragility;                  // Highest score, reply rate included
+  LinkMetric worst;                 // Metric behind the fragility (LINK_METRIC_COUNT = reply rate)
+  LinkAlert alert;
+  uint32_t alerts;                  // Alert level changes since boot
+};
+
+/**
+ * A device's alert level changed (called outside the module lock)
+ */
+typedef void (*LinkAlertFn)(const LinkInfo& info, LinkAlert previous);
+
+// ==================== LINK FUNCTIONS ====================
+
+/**
+ * Set the alert callback (call once in setup)
+ */
+void linkInit(LinkAlertFn alert);
+
+/**
+ * Fold an ACK ONLINE into the device's statistics (device.battery / rssi / snr already set)
+ */
+void linkRecordHealth(const DeviceInfo& device, unsigned long now);
+
+/**
+ * A phase command was answered (latency: command -> reply), or timed out
+ */
+void linkRecordReply(const char* deviceId, bool answered, unsigned long latencyMs, unsigned long now);
+
+/**
+ * Fragility score (0 without statistics)
+ */
+float linkFragility(const char* deviceId);
+
+/**
+ * Reorder a cycle's devices: fragile (>= LINK_FRAGILE_SCORE) first, most
+ * fragile first; the rest keep their order
+ *
+ * @param order devices[] indices
+ */
+void linkSortByFragility(const DeviceInfo* devices, int* order, int count);
+
+/**
+ * Current statistics
+ *
+ * @return false if the device has no statistics yet
+ */
+bool linkGetInfo(const char* deviceId, unsigned long now, LinkInfo& out);
+
+/**
+ * Labels
+ */
+const char* linkMetricName(LinkMetric metric);    // "rssi", ... ("reply_rate" for LINK_METRIC_COUNT)
+const char* linkAlertName(LinkAlert alert);       // "ok", "warn", "critical"
+
+#endif // LINK_HEALTH_H
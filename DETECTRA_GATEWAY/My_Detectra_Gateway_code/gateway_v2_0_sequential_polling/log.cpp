@@ -0,0 +1,365 @@
+/**
+ * DETECTRA Gateway v2.0 - Asynchronous Logger Implementation
+ */
+
+#include <FS.h>
+#include "log.h"
+
+// ==================== RINGS ====================
+
+/**
+ * Per-core ring: producers claim slot (head) with a CAS while head - tail
+ * < LOG_RING_SLOTS, fill it and set slot.ready. The drain task is the only
+ * reader; it waits for ready at tail, then clears it and advances tail.
+ */
+struct LogRing {
+  std::atomic<uint32_t> head;
+  std::atomic<uint32_t> tail;
+  std::atomic<uint32_t> dropped;
+  LogSlot slots[LOG_RING_SLOTS];
+};
+
+static_assert((LOG_RING_SLOTS & (LOG_RING_SLOTS - 1)) == 0, "LOG_RING_SLOTS must be a power of two");
+
+static LogRing rings[portNUM_PROCESSORS];
+
+static uint32_t written = 0;
+static uint32_t droppedReported = 0;
+static uint8_t highWater = 0;
+
+static fs::File logFile;
+static fs::FS* logFs = NULL;
+static char logPath[32];
+
+LogSlot* logClaim() {
+  LogRing& ring = rings[xPortGetCoreID()];
+  uint32_t h = ring.head.load(std::memory_order_relaxed);
+
+  uint32_t tail;
+
+  do {
+    // Slot not yet drained - ring full
+    tail = ring.tail.load(std::memory_order_acquire);
+    if (h - tail >= LOG_RING_SLOTS) {
+      ring.dropped.fetch_add(1, std::memory_order_relaxed);
+      return NULL;
+    }
+  } while (!ring.head.compare_exchange_weak(h, h + 1, std::memory_order_acq_rel));
+
+  uint32_t used = h + 1 - tail;
+  if (used > highWater) highWater = (uint8_t)used;
+
+  return &ring.slots[h & (LOG_RING_SLOTS - 1)];
+}
+
+void logCommit(LogSlot* slot, uint8_t level, const char* tag, const char* format, const LogPacker& packer) {
+  slot->level = level;
+  slot->tag = tag;
+  slot->format = format;
+  slot->argBytes = (uint8_t)(packer.p - slot->args);
+  slot->truncated = packer.truncated;
+  slot->timestampUs = micros();
+  slot->ready.store(1, std::memory_order_release);
+}
+
+// ==================== ARGUMENT PACKING ====================
+
+static bool packReserve(LogPacker& pk, size_t bytes) {
+  if (pk.p + bytes > pk.end) {
+    pk.truncated = true;
+    pk.p = pk.end;   // No further arguments after a truncated one
+    return false;
+  }
+  return true;
+}
+
+static void packValue(LogPacker& pk, LogArgType type, const void* value, size_t size) {
+  if (!packReserve(pk, 1 + size)) return;
+  *pk.p++ = type;
+  memcpy(pk.p, value, size);
+  pk.p += size;
+}
+
+void logPackInt(LogPacker& pk, int64_t v) { packValue(pk, LOG_ARG_INT, &v, sizeof(v)); }
+void logPackUInt(LogPacker& pk, uint64_t v) { packValue(pk, LOG_ARG_UINT, &v, sizeof(v)); }
+void logPackDouble(LogPacker& pk, double v) { packValue(pk, LOG_ARG_DOUBLE, &v, sizeof(v)); }
+
+void logPackPtr(LogPacker& pk, const void* p) {
+  uintptr_t v = (uintptr_t)p;
+  packValue(pk, LOG_ARG_PTR, &v, sizeof(v));
+}
+
+void logPackStr(LogPacker& pk, const char* s, size_t length) {
+  // Type + length + '\0'; long strings are cut to the space left
+  if (pk.p + 3 > pk.end) {
+    pk.truncated = true;
+    pk.p = pk.end;
+    return;
+  }
+  size_t room = pk.end - pk.p - 3;
+  if (length > room) {
+    length = room;
+    pk.truncated = true;
+  }
+  if (length > 255) length = 255;
+
+  *pk.p++ = LOG_ARG_STR;
+  *pk.p++ = (uint8_t)length;
+  if (length > 0) memcpy(pk.p, s, length);
+  pk.p += length;
+  *pk.p++ = '\0';
+}
+
+// ==================== FORMATTING ====================
+
+struct LogArg {
+  LogArgType type;
+  union {
+    int64_t i;
+    uint64_t u;
+    double d;
+    uintptr_t p;
+    const char* s;
+  };
+};
+
+static bool nextArg(const uint8_t*& p, const uint8_t* end, LogArg& arg) {
+  if (p >= end) return false;
+  arg.type = (LogArgType)*p++;
+
+  switch (arg.type) {
+    case LOG_ARG_INT:    memcpy(&arg.i, p, sizeof(arg.i)); p += sizeof(arg.i); break;
+    case LOG_ARG_UINT:   memcpy(&arg.u, p, sizeof(arg.u)); p += sizeof(arg.u); break;
+    case LOG_ARG_DOUBLE: memcpy(&arg.d, p, sizeof(arg.d)); p += sizeof(arg.d); break;
+    case LOG_ARG_PTR:    memcpy(&arg.p, p, sizeof(arg.p)); p += sizeof(arg.p); break;
+    case LOG_ARG_STR:    arg.s = (const char*)p + 1; p += 1 + *p + 1; break;
+    default:             return false;
+  }
+  return true;
+}
+
+/**
+ * Format one conversion. spec holds "%[flags][width][.prec]" without
+ * length modifier or conversion; the modifier is chosen from the stored type.
+ */
+static int formatArg(char* out, size_t size, char* spec, size_t specLen, char conv, const LogArg& arg) {
+  bool isInt = (arg.type == LOG_ARG_INT || arg.type == LOG_ARG_UINT);
+
+  switch (conv) {
+    case 'd': case 'i': case 'u': case 'x': case 'X': case 'o':
+      if (isInt) {
+        // Stored as 64-bit - signedness follows the conversion, like printf
+        memcpy(spec + specLen, "ll", 2);
+        spec[specLen + 2] = conv;
+        spec[specLen + 3] = '\0';
+        return snprintf(out, size, spec, (long long)arg.i);
+      }
+      break;
+
+    case 'c':
+      if (isInt) return snprintf(out, size, "%c", (int)arg.i);
+      break;
+
+    case 'f': case 'F': case 'e': case 'E': case 'g': case 'G':
+      spec[specLen] = conv;
+      spec[specLen + 1] = '\0';
+      if (arg.type == LOG_ARG_DOUBLE) return snprintf(out, size, spec, arg.d);
+      if (arg.type == LOG_ARG_INT) return snprintf(out, size, spec, (double)arg.i);
+      if (arg.type == LOG_ARG_UINT) return snprintf(out, size, spec, (double)arg.u);
+      break;
+
+    case 's':
+      if (arg.type == LOG_ARG_STR) {
+        spec[specLen] = 's';
+        spec[specLen + 1] = '\0';
+        return snprintf(out, size, spec, arg.s);
+      }
+      break;
+
+    case 'p':
+      if (arg.type == LOG_ARG_PTR) return snprintf(out, size, "%p", (void*)arg.p);
+      break;
+  }
+
+  // Type mismatch - print the value in its natural form
+  switch (arg.type) {
+    case LOG_ARG_INT:    return snprintf(out, size, "%lld", (long long)arg.i);
+    case LOG_ARG_UINT:   return snprintf(out, size, "%llu", (unsigned long long)arg.u);
+    case LOG_ARG_DOUBLE: return snprintf(out, size, "%g", arg.d);
+    case LOG_ARG_STR:    return snprintf(out, size, "%s", arg.s);
+    case LOG_ARG_PTR:    return snprintf(out, size, "%p", (void*)arg.p);
+  }
+  return 0;
+}
+
+static size_t formatRecord(const LogSlot& slot, char* out, size_t size) {
+  static const char LEVEL_CHARS[] = "-EWID";
+
+  unsigned long ms = slot.timestampUs / 1000;
+  int n = snprintf(out, size, "%lu.%03lu %c [%s] ", ms / 1000, ms % 1000, LEVEL_CHARS[slot.level], slot.tag);
+  size_t len = (n > 0) ? (size_t)n : 0;
+
+  const uint8_t* argp = slot.args;
+  const uint8_t* argEnd = slot.args + slot.argBytes;
+  const char* f = slot.format;
+
+  while (*f != '\0' && len < size - 1) {
+    if (*f != '%') {
+      out[len++] = *f++;
+      continue;
+    }
+
+    f++;
+    if (*f == '%') {
+      out[len++] = '%';
+      f++;
+      continue;
+    }
+
+    // Collect flags / width / precision, skip length modifiers
+    char spec[24];
+    size_t specLen = 0;
+    spec[specLen++] = '%';
+    while (*f != '\0' && strchr("-+ #0123456789.", *f) != NULL && specLen < sizeof(spec) - 5) {
+      spec[specLen++] = *f++;
+    }
+    while (*f != '\0' && strchr("hlLqjzt", *f) != NULL) f++;
+    if (*f == '\0') break;
+    char conv = *f++;
+
+    LogArg arg;
+    if (!nextArg(argp, argEnd, arg)) {
+      n = snprintf(out + len, size - len, "<?>");
+    } else {
+      n = formatArg(out + len, size - len, spec, specLen, conv, arg);
+    }
+    if (n > 0) len += ((size_t)n < size - len) ? (size_t)n : size - len - 1;
+  }
+
+  if (slot.truncated && len + 4 < size) {
+    memcpy(out + len, " ...", 4);
+    len += 4;
+  }
+  out[len] = '\0';
+  return len;
+}
+
+// ==================== OUTPUT ====================
+
+static void writeLine(const char* line, size_t length) {
+  Serial.write((const uint8_t*)line, length);
+  Serial.write('\n');
+
+  if (logFile) {
+    if (logFile.size() + length + 1 > LOG_FILE_MAX_BYTES) {
+      // Rotate: keep one previous file
+      logFile.close();
+      char oldPath[sizeof(logPath) + 4];
+      snprintf(oldPath, sizeof(oldPath), "%s.old", logPath);
+      logFs->remove(oldPath);
+      logFs->rename(logPath, oldPath);
+      logFile = logFs->open(logPath, FILE_APPEND);
+      if (!logFile) return;
+    }
+    logFile.write((const uint8_t*)line, length);
+    logFile.write('\n');
+  }
+}
+
+/**
+ * Output the oldest ready record across all cores
+ *
+ * @return false if every ring is empty
+ */
+static bool drainOne() {
+  LogRing* oldest = NULL;
+  LogSlot* oldestSlot = NULL;
+
+  for (int core = 0; core < portNUM_PROCESSORS; core++) {
+    LogRing& ring = rings[core];
+    LogSlot& slot = ring.slots[ring.tail.load(std::memory_order_relaxed) & (LOG_RING_SLOTS - 1)];
+    if (!slot.ready.load(std::memory_order_acquire)) continue;
+
+    // Merge cores in call order (wrap-safe comparison)
+    if (oldestSlot == NULL || (int32_t)(slot.timestampUs - oldestSlot->timestampUs) < 0) {
+      oldest = &ring;
+      oldestSlot = &slot;
+    }
+  }
+
+  if (oldestSlot == NULL) return false;
+
+  char line[LOG_LINE_MAX];
+  size_t length = formatRecord(*oldestSlot, line, sizeof(line));
+
+  oldestSlot->ready.store(0, std::memory_order_relaxed);
+  oldest->tail.fetch_add(1, std::memory_order_release);   // Hands the slot back to producers
+  written++;
+
+  writeLine(line, length);
+  return true;
+}
+
+static void reportDrops() {
+  uint32_t dropped = 0;
+  for (int core = 0; core < portNUM_PROCESSORS; core++) {
+    dropped += rings[core].dropped.load(std::memory_order_relaxed);
+  }
+
+  if (dropped != droppedReported) {
+    char line[48];
+    int n = snprintf(line, sizeof(line), "[LOG] %lu messages dropped", (unsigned long)(dropped - droppedReported));
+    writeLine(line, n);
+    droppedReported = dropped;
+  }
+}
+
+static void logTask(void* parameter) {
+  unsigned long lastFlush = millis();
+
+  while (true) {
+    int batch = 0;
+    while (batch < LOG_RING_SLOTS && drainOne()) batch++;
+    reportDrops();
+
+    if (logFile && millis() - lastFlush > 5000) {
+      logFile.flush();
+      lastFlush = millis();
+    }
+
+    if (batch == 0) vTaskDelay(20 / portTICK_PERIOD_MS);
+  }
+}
+
+// ==================== PUBLIC API ====================
+
+void logInit() {
+  xTaskCreatePinnedToCore(
+    logTask,
+    "LogTask",
+    LOG_TASK_STACK,
+    NULL,
+    LOG_TASK_PRIORITY,
+    NULL,
+    1           // Core 1 (radio task owns core 0)
+  );
+}
+
+bool logOpenFile(fs::FS& fs, const char* path) {
+  strncpy(logPath, path, sizeof(logPath) - 1);
+  logPath[sizeof(logPath) - 1] = '\0';
+  logFs = &fs;
+  logFile = fs.open(logPath, FILE_APPEND);
+  return (bool)logFile;
+}
+
+LogStats logGetStats() {
+  LogStats stats;
+  stats.written = written;
+  stats.dropped = 0;
+  for (int core = 0; core < portNUM_PROCESSORS; core++) {
+    stats.dropped += rings[core].dropped.load(std::memory_order_relaxed);
+  }
+  stats.highWater = highWater;
+  return stats;
+}
@@ -0,0 +1,202 @@
+/**
+ * DETECTRA Gateway v2.0 - Asynchronous Logger
+ *
+ * Log calls never touch the UART. Each call claims a fixed slot in the
+ * calling core's ring buffer, stores the format pointer plus the raw
+ * argument values (strings are copied), and returns. A low-priority task
+ * formats the records and writes them to Serial (and optionally FFat).
+ *
+ * - Levels below LOG_LEVEL are removed at compile time (arguments are not
+ *   evaluated). Override with a build flag, e.g. -DLOG_LEVEL=4 for
+ *   RX/TX frame dumps.
+ * - Producers are lock-free: a slot is claimed with a CAS on the ring head,
+ *   so tasks on the same core (and ISRs) may log concurrently.
+ * - When a ring is full the record is dropped and counted; the drain task
+ *   reports drops as "[LOG] N messages dropped".
+ *
+ * Format strings and tags must be string literals (only the pointer is
+ * stored). Supported conversions: d i u x X o c s f e g p and %%.
+ *
+ * Usage:
+ *   LOG_I("LORA1", "TX: %s", frame.text);
+ *   LOG_W("POLLING", "Retry %d/%d after %lums", retry, MAX_RETRIES, backoff);
+ */
+
+#ifndef LOG_H
+#define LOG_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <type_traits>
+#include "fixed_string.h"
+
+namespace fs { class FS; }
+
+// ==================== CONFIGURATION ====================
+
+#define LOG_LEVEL_NONE    0
+#define LOG_LEVEL_ERROR   1
+#define LOG_LEVEL_WARN    2
+#define LOG_LEVEL_INFO    3
+#define LOG_LEVEL_DEBUG   4               // Raw RX lines, hex, decoded frames, TX frames
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL         LOG_LEVEL_INFO
+#endif
+
+#define LOG_RING_SLOTS    32              // Records per core (power of two)
+#define LOG_ARG_BYTES     176             // Packed argument space per record
+#define LOG_LINE_MAX      320             // Formatted line incl. "[TAG]" prefix
+#define LOG_TASK_PRIORITY 1               // Below pollingTask (2) and loraTask (3)
+#define LOG_TASK_STACK    4096
+#define LOG_FILE_MAX_BYTES (256UL * 1024) // FFat log is rotated to .old at this size
+
+// ==================== DATA STRUCTURES ====================
+
+enum LogArgType : uint8_t {
+  LOG_ARG_INT,          // int64_t
+  LOG_ARG_UINT,         // uint64_t
+  LOG_ARG_DOUBLE,       // double
+  LOG_ARG_STR,          // uint8_t length + characters + '\0'
+  LOG_ARG_PTR           // uintptr_t
+};
+
+/**
+ * One log record (fixed size, lives in a per-core ring)
+ */
+struct LogSlot {
+  std::atomic<uint8_t> ready;       // Set last by the producer, cleared by the drain task
+  uint8_t level;
+  uint8_t argBytes;                 // Used bytes in args[]
+  bool truncated;                   // Arguments did not fit
+  uint32_t timestampUs;             // micros() at the call site
+  const char* tag;
+  const char* format;
+  uint8_t args[LOG_ARG_BYTES];
+};
+
+/**
+ * Logger counters (for status reports)
+ */
+struct LogStats {
+  uint32_t written;                 // Records formatted and output
+  uint32_t dropped;                 // Records lost because a ring was full
+  uint8_t highWater;                // Most slots in use at once (any core)
+};
+
+/**
+ * Argument packing cursor
+ */
+struct LogPacker {
+  uint8_t* p;
+  uint8_t* end;
+  bool truncated;
+};
+
+// ==================== LOGGER API ====================
+
+/**
+ * Start the drain task (call once in setup, after Serial.begin)
+ * Records logged before this are buffered and printed once it runs.
+ */
+void logInit();
+
+/**
+ * Also append formatted lines to a file (e.g. FFat "/gateway.log")
+ *
+ * @return false if the file cannot be opened
+ */
+bool logOpenFile(fs::FS& fs, const char* path);
+
+/**
+ * Current logger counters
+ */
+LogStats logGetStats();
+
+/**
+ * Claim a free slot in this core's ring (NULL and drop counted if full)
+ */
+LogSlot* logClaim();
+
+/**
+ * Publish a filled slot to the drain task
+ */
+void logCommit(LogSlot* slot, uint8_t level, const char* tag, const char* format, const LogPacker& packer);
+
+// ==================== ARGUMENT PACKING ====================
+
+void logPackInt(LogPacker& pk, int64_t v);
+void logPackUInt(LogPacker& pk, uint64_t v);
+void logPackDouble(LogPacker& pk, double v);
+void logPackStr(LogPacker& pk, const char* s, size_t length);
+void logPackPtr(LogPacker& pk, const void* p);
+
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value>::type
+logPack(LogPacker& pk, T v) {
+  if (std::is_signed<T>::value) logPackInt(pk, (int64_t)v);
+  else logPackUInt(pk, (uint64_t)v);
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_enum<T>::value>::type
+logPack(LogPacker& pk, T v) {
+  logPackInt(pk, (int64_t)v);
+}
+
+inline void logPack(LogPacker& pk, double v) { logPackDouble(pk, v); }
+inline void logPack(LogPacker& pk, const char* s) { logPackStr(pk, s, s ? strlen(s) : 0); }
+inline void logPack(LogPacker& pk, const String& s) { logPackStr(pk, s.c_str(), s.length()); }
+inline void logPack(LogPacker& pk, const void* p) { logPackPtr(pk, p); }
+
+template <size_t N>
+inline void logPack(LogPacker& pk, const FixedString<N>& s) { logPackStr(pk, s.c_str(), s.length()); }
+
+inline void logPackAll(LogPacker&) {}
+
+template <typename T, typename... Rest>
+inline void logPackAll(LogPacker& pk, const T& v, const Rest&... rest) {
+  logPack(pk, v);
+  logPackAll(pk, rest...);
+}
+
+/**
+ * Queue one record (use the LOG_x macros instead)
+ */
+template <typename... Args>
+void logWrite(uint8_t level, const char* tag, const char* format, const Args&... args) {
+  LogSlot* slot = logClaim();
+  if (slot == NULL) return;
+
+  LogPacker pk = { slot->args, slot->args + LOG_ARG_BYTES, false };
+  logPackAll(pk, args...);
+  logCommit(slot, level, tag, format, pk);
+}
+
+// ==================== MACROS ====================
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_E(tag, ...)   logWrite(LOG_LEVEL_ERROR, tag, __VA_ARGS__)
+#else
+#define LOG_E(tag, ...)   ((void)0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_W(tag, ...)   logWrite(LOG_LEVEL_WARN, tag, __VA_ARGS__)
+#else
+#define LOG_W(tag, ...)   ((void)0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_I(tag, ...)   logWrite(LOG_LEVEL_INFO, tag, __VA_ARGS__)
+#else
+#define LOG_I(tag, ...)   ((void)0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_D(tag, ...)   logWrite(LOG_LEVEL_DEBUG, tag, __VA_ARGS__)
+#else
+#define LOG_D(tag, ...)   ((void)0)
+#endif
+
+#endif // LOG_H
@@ -0,0 +1,232 @@
+/**
+ * DETECTRA Gateway v2.0 - LoRa Frame Builder & Hex Codec Implementation
+ */
+
+#include "lora_frame.h"
+
+// ==================== HEX CODEC ====================
+
+static const char HEX_DIGITS[16] = {
+  '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'
+};
+
+// Nibble value per ASCII character, -1 for non-hex
+static const int8_t HEX_VALUES[256] = {
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+   0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,   // '0'-'9'
+  -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,   // 'A'-'F'
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,   // 'a'-'f'
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+};
+
+size_t hexEncode(const uint8_t* in, size_t length, char* out) {
+  for (size_t i = 0; i < length; i++) {
+    out[2 * i] = HEX_DIGITS[in[i] >> 4];
+    out[2 * i + 1] = HEX_DIGITS[in[i] & 0x0F];
+  }
+  return 2 * length;
+}
+
+int hexDecode(const char* in, size_t length, uint8_t* out) {
+  size_t bytes = length / 2;
+  for (size_t i = 0; i < bytes; i++) {
+    int8_t hi = HEX_VALUES[(uint8_t)in[2 * i]];
+    int8_t lo = HEX_VALUES[(uint8_t)in[2 * i + 1]];
+    if ((hi | lo) < 0) return -1;
+    out[i] = (uint8_t)((hi << 4) | lo);
+  }
+  return (int)bytes;
+}
+
+bool isHexString(const char* in, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    if (HEX_VALUES[(uint8_t)in[i]] < 0) return false;
+  }
+  return true;
+}
+
+static const char BASE64_DIGITS[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+size_t base64Encode(const uint8_t* in, size_t length, char* out) {
+  char* p = out;
+  size_t i = 0;
+
+  for (; i + 3 <= length; i += 3) {
+    uint32_t v = (in[i] << 16) | (in[i + 1] << 8) | in[i + 2];
+    *p++ = BASE64_DIGITS[v >> 18];
+    *p++ = BASE64_DIGITS[(v >> 12) & 0x3F];
+    *p++ = BASE64_DIGITS[(v >> 6) & 0x3F];
+    *p++ = BASE64_DIGITS[v & 0x3F];
+  }
+
+  if (i < length) {
+    uint32_t v = in[i] << 16;
+    if (i + 1 < length) v |= in[i + 1] << 8;
+    *p++ = BASE64_DIGITS[v >> 18];
+    *p++ = BASE64_DIGITS[(v >> 12) & 0x3F];
+    *p++ = (i + 1 < length) ? BASE64_DIGITS[(v >> 6) & 0x3F] : '=';
+    *p++ = '=';
+  }
+
+  return p - out;
+}
+
+static int base64Value(char c) {
+  if (c >= 'A' && c <= 'Z') return c - 'A';
+  if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+  if (c >= '0' && c <= '9') return c - '0' + 52;
+  if (c == '+') return 62;
+  if (c == '/') return 63;
+  return -1;
+}
+
+int base64Decode(const char* in, size_t length, uint8_t* out) {
+  while (length > 0 && in[length - 1] == '=') length--;
+
+  uint32_t bits = 0;
+  int count = 0;
+  int written = 0;
+
+  for (size_t i = 0; i < length; i++) {
+    int v = base64Value(in[i]);
+    if (v < 0) return -1;
+    bits = (bits << 6) | v;
+    count += 6;
+    if (count >= 8) {
+      count -= 8;
+      out[written++] = (uint8_t)(bits >> count);
+    }
+  }
+
+  return written;
+}
+
+const char* rxLineFrameHex(const char* line, size_t length, size_t* hexLength) {
+  const char* hex = NULL;
+
+  if (length >= 11 && strncmp(line, "+EVT:RXP2P:", 11) == 0) {
+    // Hex payload always comes after the LAST colon (RSSI and SNR before it)
+    hex = line;
+    for (size_t i = 0; i < length; i++) {
+      if (line[i] == ':') hex = line + i + 1;
+    }
+  } else if (length > 16 && strstr(line, "EVT") == NULL && strstr(line, "OK") == NULL &&
+             strstr(line, "AT") == NULL && isHexString(line, length)) {
+    hex = line;
+  }
+
+  if (hex != NULL) *hexLength = line + length - hex;
+  return hex;
+}
+
+// ==================== FRAME BUILDER ====================
+
+void frameAppend(TxFrame& f, const char* s, size_t length) {
+  if (f.textLen + length > LORA_MAX_FRAME) {
+    f.overflow = true;
+    return;
+  }
+  memcpy(f.text + f.textLen, s, length);
+  f.textLen += length;
+}
+
+void frameAppend(TxFrame& f, const char* s) {
+  frameAppend(f, s, strlen(s));
+}
+
+void frameAppendChar(TxFrame& f, char c) {
+  frameAppend(f, &c, 1);
+}
+
+static void appendDecimal(TxFrame& f, unsigned long v, bool negative) {
+  char digits[12];
+  char* p = digits + sizeof(digits);
+
+  do {
+    *--p = '0' + (v % 10);
+    v /= 10;
+  } while (v > 0);
+  if (negative) *--p = '-';
+
+  frameAppend(f, p, digits + sizeof(digits) - p);
+}
+
+static size_t decimalLength(unsigned long v) {
+  size_t digits = 1;
+  while (v >= 10) {
+    v /= 10;
+    digits++;
+  }
+  return digits;
+}
+
+void frameAppendInt(TxFrame& f, long value) {
+  bool negative = value < 0;
+  appendDecimal(f, negative ? 0UL - (unsigned long)value : (unsigned long)value, negative);
+}
+
+void frameAppendUInt(TxFrame& f, unsigned long value) {
+  appendDecimal(f, value, false);
+}
+
+void frameBegin(TxFrame& f, const char* senderId, const char* command,
+                const char* targetId, uint32_t sequence, unsigned long timestamp) {
+  f.textLen = 0;
+  f.lineLen = 0;
+  f.overflow = false;
+
+  frameAppend(f, senderId);
+  frameAppendChar(f, ':');
+  frameAppend(f, command);
+  frameAppendChar(f, ':');
+  frameAppend(f, targetId);
+  frameAppendChar(f, ':');
+
+  frameAppendUInt(f, sequence);
+  frameAppendChar(f, ':');
+
+  frameAppendUInt(f, timestamp);
+  frameAppendChar(f, ':');
+}
+
+size_t frameTextLength(const char* senderId, const char* command, const char* targetId,
+                       uint32_t sequence, unsigned long timestamp, size_t payloadLength) {
+  // SENDER:COMMAND:TARGET:SEQ:TIMESTAMP:PAYLOAD
+  return strlen(senderId) + strlen(command) + strlen(targetId) + decimalLength(sequence) +
+         decimalLength(timestamp) + 5 + payloadLength;
+}
+
+bool frameFinish(TxFrame& f, const char* secret) {
+  if (secret != NULL) {
+    char mac[HMAC_LENGTH];
+    calculateHMAC(f.text, f.textLen, secret, strlen(secret), mac);
+    frameAppendChar(f, ':');
+    frameAppend(f, mac, HMAC_LENGTH);
+  }
+
+  f.text[f.textLen] = '\0';
+
+  if (f.overflow) {
+    f.lineLen = 0;
+    return false;
+  }
+
+  memcpy(f.line, AT_PSEND_PREFIX, AT_PSEND_PREFIX_LEN);
+  f.lineLen = AT_PSEND_PREFIX_LEN;
+  f.lineLen += hexEncode((const uint8_t*)f.text, f.textLen, f.line + f.lineLen);
+  f.line[f.lineLen++] = '\r';
+  f.line[f.lineLen++] = '\n';
+  f.line[f.lineLen] = '\0';
+  return true;
+}
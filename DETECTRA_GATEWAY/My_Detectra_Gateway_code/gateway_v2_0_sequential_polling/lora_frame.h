@@ -0,0 +1,134 @@
+/**
+ * DETECTRA Gateway v2.0 - LoRa Frame Builder & Hex Codec
+ *
+ * Zero-allocation TX path for the RAK3172 P2P AT interface:
+ * header fields, payload and optional HMAC are written into a
+ * preallocated TxFrame, then hex-encoded straight into the
+ * "AT+PSEND=<hex>\r\n" line that goes to the UART.
+ *
+ * The same table-driven codec decodes the hex payload of
+ * "+EVT:RXP2P:<rssi>:<snr>:<hex>" lines on the RX side. Binary data inside
+ * a frame (bulk transfer chunks) is carried as base64.
+ *
+ * Usage:
+ *   TxFrame& f = txFrames[0];
+ *   frameBegin(f, "GW0-00001", CMD_ACK, "ED0-00001", seqNextTx("ED0-00001"), getCurrentTimestamp());
+ *   frameAppendInt(f, 3); frameAppend(f, "/5");
+ *   frameFinish(f, NULL);                // NULL = no HMAC (simplified protocol)
+ *   LoRa1.write((const uint8_t*)f.line, f.lineLen);
+ */
+
+#ifndef LORA_FRAME_H
+#define LORA_FRAME_H
+
+#include <Arduino.h>
+#include "lora_protocol.h"
+
+// ==================== CONSTANTS ====================
+
+#define AT_PSEND_PREFIX       "AT+PSEND="
+#define AT_PSEND_PREFIX_LEN   9
+#define TX_LINE_MAX           (AT_PSEND_PREFIX_LEN + 2 * LORA_MAX_FRAME + 2)   // + "\r\n"
+
+// ==================== DATA STRUCTURES ====================
+
+/**
+ * Preallocated TX buffer (one per radio)
+ */
+struct TxFrame {
+  char text[LORA_MAX_FRAME + 1];    // ASCII frame: SENDER:CMD:TARGET:SEQ:TIME:PAYLOAD[:HMAC]
+  size_t textLen;
+  char line[TX_LINE_MAX + 1];       // "AT+PSEND=<hex>\r\n"
+  size_t lineLen;
+  bool overflow;                    // Frame exceeded LORA_MAX_FRAME (not sent)
+};
+
+// ==================== HEX CODEC ====================
+
+/**
+ * Hex-encode bytes (uppercase, as expected by AT+PSEND)
+ *
+ * @param in Input bytes
+ * @param length Number of input bytes
+ * @param out Output buffer (at least 2 * length characters, not terminated)
+ * @return Number of characters written (2 * length)
+ */
+size_t hexEncode(const uint8_t* in, size_t length, char* out);
+
+/**
+ * Decode a hex string (either case)
+ *
+ * @param in Hex characters
+ * @param length Number of characters (a trailing odd nibble is ignored)
+ * @param out Output buffer (at least length / 2 bytes)
+ * @return Number of bytes written, or -1 on a non-hex character
+ */
+int hexDecode(const char* in, size_t length, uint8_t* out);
+
+/**
+ * Check that every character is a hex digit
+ */
+bool isHexString(const char* in, size_t length);
+
+/**
+ * Base64-encode bytes (standard alphabet, '=' padding)
+ *
+ * @param out Output buffer (at least 4 * ((length + 2) / 3) characters, not terminated)
+ * @return Number of characters written
+ */
+size_t base64Encode(const uint8_t* in, size_t length, char* out);
+
+/**
+ * Decode base64 (padding optional)
+ *
+ * @param out Output buffer (at least 3 * length / 4 bytes)
+ * @return Number of bytes written, or -1 on an invalid character
+ */
+int base64Decode(const char* in, size_t length, uint8_t* out);
+
+/**
+ * Find the hex frame in a trimmed RX line from the module
+ * "+EVT:RXP2P:<rssi>:<snr>:<hex>", or a bare hex line (the RAK3172 splits
+ * long RX messages across lines)
+ *
+ * @param hexLength Receives the number of hex characters
+ * @return Start of the hex payload, or NULL for AT replies and other events
+ */
+const char* rxLineFrameHex(const char* line, size_t length, size_t* hexLength);
+
+// ==================== FRAME BUILDER ====================
+
+/**
+ * Start a frame with the fixed header fields
+ * Writes: SENDER:COMMAND:TARGET:SEQ:TIMESTAMP:
+ *
+ * @param sequence Sequence number (unpadded decimal, see seq_space.h)
+ */
+void frameBegin(TxFrame& f, const char* senderId, const char* command,
+                const char* targetId, uint32_t sequence, unsigned long timestamp);
+
+/**
+ * Length of the frame frameBegin() + a payload of payloadLength would build
+ * (no HMAC) - for airtime before the frame exists
+ */
+size_t frameTextLength(const char* senderId, const char* command, const char* targetId,
+                       uint32_t sequence, unsigned long timestamp, size_t payloadLength);
+
+/**
+ * Append payload text / characters / decimal integers
+ */
+void frameAppend(TxFrame& f, const char* s);
+void frameAppend(TxFrame& f, const char* s, size_t length);
+void frameAppendChar(TxFrame& f, char c);
+void frameAppendInt(TxFrame& f, long value);
+void frameAppendUInt(TxFrame& f, unsigned long value);
+
+/**
+ * Finish the frame: optional ":<HMAC>" then hex-encode into f.line
+ *
+ * @param secret Shared secret for HMAC, or NULL for the simplified protocol
+ * @return false if the frame overflowed LORA_MAX_FRAME
+ */
+bool frameFinish(TxFrame& f, const char* secret);
+
+#endif // LORA_FRAME_H
@@ -3,18 +3,78 @@
  */
 
 #include "lora_protocol.h"
+#include "lora_frame.h"
+#include "log.h"
+#include <esp_timer.h>
+#include <atomic>
 
 // ==================== TIMESTAMP MANAGEMENT ====================
 
-static unsigned long timestampOffset = 0;
+/**
+ * Gateway time = baseMs + (timer - baseUs) x (1 + ppm). Two copies: the
+ * writer fills the spare one and switches, readers never take a lock.
+ */
+struct ClockState {
+  int64_t baseUs;           // esp_timer_get_time() at the last reference
+  uint64_t baseMs;          // Gateway time at baseUs
+  ClockStatus status;
+};
+
+static ClockState clockStates[2];
+static std::atomic<uint8_t> clockCurrent(0);
+
+static uint64_t clockAt(const ClockState& state, int64_t nowUs) {
+  double elapsedMs = (nowUs - state.baseUs) / 1000.0;
+  return state.baseMs + (uint64_t)(elapsedMs * (1.0 + state.status.ppm * 1e-6));
+}
 
 void initTimestamp() {
-  // Use millis() as timestamp base (seconds)
-  timestampOffset = millis() / 1000;
+  // Seconds since boot until the first reference
+  clockStates[0] = ClockState();
+  clockCurrent.store(0);
+}
+
+uint64_t getCurrentTimeMs() {
+  return clockAt(clockStates[clockCurrent.load(std::memory_order_acquire)], esp_timer_get_time());
 }
 
 unsigned long getCurrentTimestamp() {
-  return timestampOffset + (millis() / 1000);
+  return (unsigned long)(getCurrentTimeMs() / 1000);
+}
+
+void disciplineTimestamp(uint64_t referenceMs) {
+  uint8_t current = clockCurrent.load();
+  ClockState next = clockStates[current];
+  int64_t nowUs = esp_timer_get_time();
+
+  int64_t errorMs = (int64_t)referenceMs - (int64_t)clockAt(next, nowUs);
+  int64_t spanMs = (nowUs - next.baseUs) / 1000;
+
+  if (!next.status.synced || errorMs > CLOCK_STEP_MS || errorMs < -CLOCK_STEP_MS) {
+    next.status.steps++;
+    LOG_I("CLOCK", "Stepped by %lld ms%s", (long long)errorMs, next.status.synced ? "" : " (first sync)");
+  } else if (spanMs >= CLOCK_MIN_SPAN_MS) {
+    // Error accumulated since the last reference = remaining frequency error
+    float ppm = next.status.ppm + CLOCK_FREQ_GAIN * (float)errorMs * 1e6f / (float)spanMs;
+    if (ppm > CLOCK_MAX_PPM) ppm = CLOCK_MAX_PPM;
+    if (ppm < -CLOCK_MAX_PPM) ppm = -CLOCK_MAX_PPM;
+    next.status.ppm = ppm;
+    LOG_D("CLOCK", "Error %lld ms over %lld s -> %.1f ppm", (long long)errorMs, (long long)(spanMs / 1000), ppm);
+  }
+
+  next.baseUs = nowUs;
+  next.baseMs = referenceMs;
+  next.status.synced = true;
+  next.status.references++;
+  next.status.lastErrorMs = (int32_t)errorMs;
+  next.status.lastReferenceMs = referenceMs;
+
+  clockStates[current ^ 1] = next;
+  clockCurrent.store(current ^ 1, std::memory_order_release);
+}
+
+ClockStatus getClockStatus() {
+  return clockStates[clockCurrent.load(std::memory_order_acquire)].status;
 }
 
 bool validateTimestamp(unsigned long messageTimestamp, unsigned long currentTimestamp) {
@@ -24,7 +84,7 @@ bool validateTimestamp(unsigned long messageTimestamp, unsigned long currentTime
 
 // ==================== HMAC CALCULATION ====================
 
-String calculateHMAC(const String& message, const String& secret) {
+void calculateHMAC(const char* message, size_t length, const char* secret, size_t secretLength, char* out) {
   byte hmacResult[32];
 
   // Calculate HMAC-SHA256
@@ -33,20 +93,24 @@ String calculateHMAC(const String& message, const String& secret) {
 
   mbedtls_md_init(&ctx);
   mbedtls_md_setup(&ctx, mbedtls_md_info_from_type(md_type), 1);
-  mbedtls_md_hmac_starts(&ctx, (const unsigned char*)secret.c_str(), secret.length());
-  mbedtls_md_hmac_update(&ctx, (const unsigned char*)message.c_str(), message.length());
+  mbedtls_md_hmac_starts(&ctx, (const unsigned char*)secret, secretLength);
+  mbedtls_md_hmac_update(&ctx, (const unsigned char*)message, length);
   mbedtls_md_hmac_finish(&ctx, hmacResult);
   mbedtls_md_free(&ctx);
 
-  // Convert first 8 bytes to hex string (16 characters)
-  String hmac = "";
-  for (int i = 0; i < 8; i++) {
-    char hex[3];
-    sprintf(hex, "%02x", hmacResult[i]);
-    hmac += hex;
+  // Convert first 8 bytes to lowercase hex (16 characters)
+  static const char digits[] = "0123456789abcdef";
+  for (int i = 0; i < HMAC_LENGTH / 2; i++) {
+    out[2 * i] = digits[hmacResult[i] >> 4];
+    out[2 * i + 1] = digits[hmacResult[i] & 0x0F];
   }
+}
 
-  return hmac;
+String calculateHMAC(const String& message, const String& secret) {
+  char hmac[HMAC_LENGTH + 1];
+  calculateHMAC(message.c_str(), message.length(), secret.c_str(), secret.length(), hmac);
+  hmac[HMAC_LENGTH] = '\0';
+  return String(hmac);
 }
 
 bool verifyHMAC(const String& message, const String& secret) {
@@ -79,165 +143,276 @@ String buildMessage(
 ) {
   unsigned long timestamp = getCurrentTimestamp();
 
-  // Build message without HMAC
-  String message = senderId + ":" + command + ":" + targetId + ":" +
-                   sequence + ":" + String(timestamp) + ":" + payload;
-
-  // Calculate HMAC
-  String hmac = calculateHMAC(message, secret);
+  // Build message and HMAC in one fixed buffer, single String at the end
+  TxFrame frame;
+  frameBegin(frame, senderId.c_str(), command.c_str(), targetId.c_str(),
+             strtoul(sequence.c_str(), NULL, 10), timestamp);
+  frameAppend(frame, payload.c_str(), payload.length());
+  frameFinish(frame, secret.c_str());
 
-  // Append HMAC
-  return message + ":" + hmac;
+  return String(frame.text);
 }
 
 // ==================== MESSAGE PARSING ====================
 
-LoRaMessage parseMessage(const String& rawMessage) {
-  LoRaMessage msg;
+void parseMessage(const char* rawMessage, size_t length, LoRaMessage& msg) {
   msg.valid = false;
-
-  // Count colons (should be at least 5: sender:cmd:target:seq:time:payload) - SIMPLIFIED PROTOCOL
-  int colonCount = 0;
-  for (unsigned int i = 0; i < rawMessage.length(); i++) {
-    if (rawMessage.charAt(i) == ':') colonCount++;
+  msg.commandId = LORA_CMD_UNKNOWN;
+  msg.ackStatus = ACK_STATUS_NONE;
+
+  // Split on the first 5 colons: sender:cmd:target:seq:time:payload - SIMPLIFIED PROTOCOL
+  // Payload keeps any further colons
+  size_t starts[6];
+  size_t ends[6];
+  int field = 0;
+  starts[0] = 0;
+
+  for (size_t i = 0; i < length && field < 5; i++) {
+    if (rawMessage[i] == ':') {
+      ends[field] = i;
+      field++;
+      starts[field] = i + 1;
+    }
   }
 
-  if (colonCount < 5) {
-    Serial.println("[PROTOCOL] Invalid message format (expected at least 6 fields, got " + String(colonCount + 1) + ")");
-    return msg;
+  if (field < 5) {
+    LOG_W("PROTOCOL", "Invalid message format (expected at least 6 fields, got %d)", field + 1);
+    return;
+  }
+  ends[5] = length;
+
+  // Populate structure (header fields must fit their fixed capacity)
+  bool fits = msg.senderId.assign(rawMessage + starts[0], ends[0] - starts[0]) &&
+              msg.command.assign(rawMessage + starts[1], ends[1] - starts[1]) &&
+              msg.targetId.assign(rawMessage + starts[2], ends[2] - starts[2]) &&
+              msg.payload.assign(rawMessage + starts[5], ends[5] - starts[5]);
+  if (!fits) {
+    LOG_W("PROTOCOL", "Field exceeds protocol length");
+    return;
   }
 
-  // Parse fields
-  int idx = 0;
-  int lastIdx = 0;
-  String fields[6];
+  // Resolved once here - handlers switch on the enums instead of comparing strings
+  msg.commandId = loraCommandFromWire(msg.command.c_str(), msg.command.length());
+  msg.ackStatus = (msg.commandId == LORA_CMD_ACK) ? ackStatusFromWire(msg.targetId.c_str(), msg.targetId.length())
+                                                  : ACK_STATUS_NONE;
 
-  for (int i = 0; i < 6; i++) {
-    idx = rawMessage.indexOf(':', lastIdx);
-    if (idx == -1 && i < 5) {
-      Serial.println("[PROTOCOL] Parsing error at field " + String(i));
-      return msg;
-    }
+  msg.sequence = strtoul(rawMessage + starts[3], NULL, 10);
+  msg.timestamp = strtoul(rawMessage + starts[4], NULL, 10);
+  msg.hmac.clear();  // No HMAC in simplified protocol
 
-    if (i == 5) {
-      // Last field (payload)
-      fields[i] = rawMessage.substring(lastIdx);
-    } else {
-      fields[i] = rawMessage.substring(lastIdx, idx);
-      lastIdx = idx + 1;
-    }
-  }
-
-  // Populate structure
-  msg.senderId = fields[0];
-  msg.command = fields[1];
-  msg.targetId = fields[2];
-  msg.sequence = fields[3];
-  msg.timestamp = fields[4].toInt();
-  msg.payload = fields[5];
-  msg.hmac = "";  // No HMAC in simplified protocol
-
-  // Skip timestamp validation for now (devices may not have synced time)
-  // if (!validateTimestamp(msg.timestamp, getCurrentTimestamp())) {
-  //   Serial.println("[PROTOCOL] Timestamp validation failed");
-  //   Serial.println("  Message time: " + String(msg.timestamp));
-  //   Serial.println("  Current time: " + String(getCurrentTimestamp()));
-  //   Serial.println("  Difference: " + String((long)getCurrentTimestamp() - (long)msg.timestamp) + "s");
-  //   return msg;
-  // }
+  // Timestamp validation needs the sender's sync state - timeSyncCheck() (time_sync.h)
 
   msg.valid = true;
+}
+
+LoRaMessage parseMessage(const String& rawMessage) {
+  LoRaMessage msg;
+  parseMessage(rawMessage.c_str(), rawMessage.length(), msg);
   return msg;
 }
 
 void parseDataPayload(LoRaMessage& msg) {
   // Expected format: "BLR-13-IL-01:left:motherboard:40%,led_on:50%"
-  // Or with position index: "1/5" embedded
+  // Optional trailers after the detections: ":1/5" (position index), ":COMPLETE"
 
   if (msg.payload == "null" || msg.payload.isEmpty()) {
     return;
   }
 
-  String payload = msg.payload;
-  int colonCount = 0;
-  int positions[4] = {-1, -1, -1, -1};
-
-  // Find colon positions
-  for (unsigned int i = 0; i < payload.length(); i++) {
-    if (payload.charAt(i) == ':') {
-      if (colonCount < 4) {
-        positions[colonCount] = i;
-      }
-      colonCount++;
-    }
-  }
-
-  if (colonCount >= 2) {
-    // Extract table ID
-    msg.data.tableId = payload.substring(0, positions[0]);
-
-    // Extract position
-    msg.data.position = payload.substring(positions[0] + 1, positions[1]);
-
-    // Extract detections (rest of the string)
-    if (colonCount >= 3) {
-      msg.data.detections = payload.substring(positions[1] + 1, positions[2]);
-
-      // Check if there's position index info (e.g., "COMPLETE" or position count)
-      if (colonCount >= 3) {
-        String extra = payload.substring(positions[2] + 1);
-        if (extra.indexOf('/') != -1) {
-          // Format: "1/5"
-          int slashIdx = extra.indexOf('/');
-          msg.data.positionIndex = extra.substring(0, slashIdx).toInt();
-          msg.data.totalPositions = extra.substring(slashIdx + 1).toInt();
-        }
-      }
+  const char* payload = msg.payload.c_str();
+  size_t length = msg.payload.length();
+
+  const char* first = (const char*)memchr(payload, ':', length);
+  if (first == NULL) return;
+  const char* second = (const char*)memchr(first + 1, ':', payload + length - first - 1);
+  if (second == NULL) return;
+
+  // Extract table ID and position
+  msg.data.tableId.assign(payload, first - payload);
+  msg.data.position.assign(first + 1, second - first - 1);
+
+  // Detections are "class:conf%" pairs and contain colons themselves -
+  // take the rest of the string and strip the known trailers from the end
+  const char* start = second + 1;
+  const char* end = payload + length;
+
+  for (;;) {
+    const char* colon = end;
+    while (colon > start && *(colon - 1) != ':') colon--;
+    if (colon == start) break;
+
+    const char* field = colon;
+    size_t fieldLen = end - field;
+    const char* slash = (const char*)memchr(field, '/', fieldLen);
+
+    if (fieldLen == 8 && memcmp(field, "COMPLETE", 8) == 0) {
+      end = colon - 1;
+    } else if (slash != NULL && slash > field && isdigit((unsigned char)field[0])) {
+      // Format: "1/5"
+      msg.data.positionIndex = (uint8_t)atoi(field);
+      msg.data.totalPositions = (uint8_t)atoi(slash + 1);
+      end = colon - 1;
     } else {
-      msg.data.detections = payload.substring(positions[1] + 1);
+      break;
     }
   }
+
+  msg.data.detectionsTruncated = !msg.data.detections.assign(start, end - start);
 }
 
 void parseHealthPayload(LoRaMessage& msg) {
-  // Expected format: "bat_95:rssi_-45:snr_8"
-  // Or just: "bat_95" or combination
+  // Expected format: "bat_95:rssi_-45:snr_8" - any subset, unknown fields ignored
+  decodeHealthPayload(msg.payload.c_str(), msg.payload.length(), msg.health);
+}
 
-  if (msg.payload == "null" || msg.payload.isEmpty()) {
-    msg.health.battery = -1;
-    msg.health.rssi = -999;
-    msg.health.snr = -999;
-    return;
-  }
+// ==================== AIRTIME ====================
 
-  msg.health.battery = -1;
-  msg.health.rssi = -999;
-  msg.health.snr = -999;
+unsigned long loraAirtimeMs(int payloadBytes, int sf, int bwKHz, int crDenom, int preamble) {
+  float tSym = (float)(1UL << sf) / bwKHz;   // ms per symbol
+  int de = (sf >= 11 && bwKHz == 125) ? 1 : 0;
 
-  String payload = msg.payload;
-  int startIdx = 0;
+  // Payload symbols: 8 + ceil((8PL - 4SF + 28 + 16) / (4(SF - 2DE))) * CR
+  long num = 8L * payloadBytes - 4L * sf + 28 + 16;
+  long den = 4L * (sf - 2 * de);
+  long blocks = (num > 0) ? (num + den - 1) / den : 0;
+  float payloadSymbols = 8 + blocks * crDenom;
 
-  while (startIdx < (int)payload.length()) {
-    int colonIdx = payload.indexOf(':', startIdx);
-    String field;
+  float tPreamble = (preamble + 4.25f) * tSym;
+  return (unsigned long)ceil(tPreamble + payloadSymbols * tSym);
+}
 
-    if (colonIdx == -1) {
-      field = payload.substring(startIdx);
-      startIdx = payload.length();
-    } else {
-      field = payload.substring(startIdx, colonIdx);
-      startIdx = colonIdx + 1;
-    }
+// ==================== BROADCAST CENSUS ====================
+
+String buildCensusPayload(unsigned int cycleId, unsigned int slotMs, const String& roster, uint64_t atMs) {
+  // Format: "cyc_12:slot_600:ED0-00001,ED0-00002[:at_8123456]"
+  CensusPayload census;
+  census.cycleId = cycleId;
+  census.slotMs = slotMs;
+  census.roster.assign(roster.c_str(), roster.length());
+  census.atMs = atMs;
+
+  char payload[LORA_MAX_FRAME + 1];
+  encodeCensusPayload(payload, sizeof(payload), census);
+  return String(payload);
+}
+
+unsigned long censusWindowMs(int numSlots, unsigned int slotMs) {
+  return CENSUS_GUARD_MS + (unsigned long)numSlots * slotMs;
+}
+
+// ==================== BULK TRANSFER ====================
+
+size_t buildBulkOffer(char* out, size_t capacity, uint16_t transferId, uint32_t size,
+                      const uint8_t* sha256, const char* name) {
+  char hash[2 * BULK_HASH_BYTES + 1];
+  hexEncode(sha256, BULK_HASH_BYTES, hash);
+  hash[2 * BULK_HASH_BYTES] = '\0';
+
+  int n = snprintf(out, capacity, "%u:%lu:%u:%s:%s", transferId, (unsigned long)size,
+                   bulkChunkCount(size), hash, name);
+  return (n > 0 && (size_t)n < capacity) ? n : 0;
+}
 
-    // Parse field
-    if (field.startsWith("bat_")) {
-      msg.health.battery = field.substring(4).toInt();
-    } else if (field.startsWith("rssi_")) {
-      msg.health.rssi = field.substring(5).toInt();
-    } else if (field.startsWith("snr_")) {
-      msg.health.snr = field.substring(4).toInt();
+size_t buildBulkChunk(char* out, size_t capacity, uint16_t transferId, uint16_t index,
+                      bool ackRequest, const uint8_t* data, size_t length) {
+  int n = snprintf(out, capacity, "%u:%u:%c:", transferId, index, ackRequest ? 'A' : '-');
+  if (n <= 0 || (size_t)n + 4 * ((length + 2) / 3) >= capacity) return 0;
+
+  n += base64Encode(data, length, out + n);
+  out[n] = '\0';
+  return n;
+}
+
+size_t buildBulkStatus(char* out, size_t capacity, const BulkStatus& status) {
+  static const char* const KINDS[] = { "", "DONE", "HASH_FAIL", "UNKNOWN" };
+
+  if (status.kind != BULK_STATUS_PROGRESS) {
+    int n = snprintf(out, capacity, "%u:%s", status.transferId, KINDS[status.kind]);
+    return (n > 0 && (size_t)n < capacity) ? n : 0;
+  }
+
+  size_t bytes = sizeof(status.bitmap);
+  while (bytes > 0 && status.bitmap[bytes - 1] == 0) bytes--;
+
+  int n = snprintf(out, capacity, "%u:%u:", status.transferId, status.base);
+  if (n <= 0 || (size_t)n + 2 * bytes >= capacity) return 0;
+
+  n += hexEncode(status.bitmap, bytes, out + n);
+  out[n] = '\0';
+  return n;
+}
+
+bool parseBulkStatus(const LoRaMessage& msg, BulkStatus& status) {
+  const char* p = msg.payload.c_str();
+  char* end;
+
+  memset(&status, 0, sizeof(status));
+  status.transferId = (uint16_t)strtoul(p, &end, 10);
+  if (end == p || *end != ':') return false;
+  p = end + 1;
+
+  if (strcmp(p, "DONE") == 0) {
+    status.kind = BULK_STATUS_DONE;
+  } else if (strcmp(p, "HASH_FAIL") == 0) {
+    status.kind = BULK_STATUS_HASH_FAIL;
+  } else if (strcmp(p, "UNKNOWN") == 0) {
+    status.kind = BULK_STATUS_UNKNOWN;
+  } else {
+    status.kind = BULK_STATUS_PROGRESS;
+    status.base = (uint16_t)strtoul(p, &end, 10);
+    if (end == p || (*end != ':' && *end != '\0')) return false;
+
+    // Bitmap may be shorter than BULK_ACK_SPAN (trailing empty bytes left out)
+    if (*end == ':') {
+      size_t length = strlen(end + 1);
+      if (length > 2 * sizeof(status.bitmap)) length = 2 * sizeof(status.bitmap);
+      if (hexDecode(end + 1, length, status.bitmap) < 0) return false;
     }
   }
+  return true;
+}
+
+bool parseBulkOffer(const LoRaMessage& msg, uint16_t& transferId, uint32_t& size, uint16_t& chunks,
+                    uint8_t* sha256, char* name) {
+  const char* p = msg.payload.c_str();
+  char* end;
+
+  transferId = (uint16_t)strtoul(p, &end, 10);
+  if (end == p || *end != ':') return false;
+  p = end + 1;
+  size = strtoul(p, &end, 10);
+  if (end == p || *end != ':') return false;
+  p = end + 1;
+  chunks = (uint16_t)strtoul(p, &end, 10);
+  if (end == p || *end != ':' || chunks != bulkChunkCount(size)) return false;
+  p = end + 1;
+
+  if (strlen(p) < 2 * BULK_HASH_BYTES + 1 || p[2 * BULK_HASH_BYTES] != ':') return false;
+  if (hexDecode(p, 2 * BULK_HASH_BYTES, sha256) < 0) return false;
+  p += 2 * BULK_HASH_BYTES + 1;
+
+  size_t nameLength = strlen(p);
+  if (nameLength == 0 || nameLength > BULK_NAME_MAX) return false;
+  memcpy(name, p, nameLength + 1);
+  return true;
+}
+
+int parseBulkChunk(const LoRaMessage& msg, uint16_t& transferId, uint16_t& index, bool& ackRequest,
+                   uint8_t* data) {
+  const char* p = msg.payload.c_str();
+  char* end;
+
+  transferId = (uint16_t)strtoul(p, &end, 10);
+  if (end == p || *end != ':') return -1;
+  p = end + 1;
+  index = (uint16_t)strtoul(p, &end, 10);
+  if (end == p || *end != ':' || (end[1] != 'A' && end[1] != '-') || end[2] != ':') return -1;
+  ackRequest = end[1] == 'A';
+  p = end + 3;
+
+  size_t length = strlen(p);
+  if (length > 4 * ((BULK_CHUNK_BYTES + 2) / 3)) return -1;
+  return base64Decode(p, length, data);
 }
 
 // ==================== UTILITY FUNCTIONS ====================
@@ -254,12 +429,3 @@ String phaseToString(PollingPhase phase) {
     default:                      return "UNKNOWN";
   }
 }
-
-String generateSequence(int& counter) {
-  counter++;
-  if (counter > 999) counter = 1;
-
-  char seq[4];
-  sprintf(seq, "%03d", counter);
-  return String(seq);
-}
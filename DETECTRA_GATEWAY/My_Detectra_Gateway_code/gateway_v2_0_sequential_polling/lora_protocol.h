@@ -14,24 +14,13 @@
 
 #include <Arduino.h>
 #include <mbedtls/md.h>
+#include "fixed_string.h"
 
 // ==================== PROTOCOL CONSTANTS ====================
 
-// Commands - Gateway → Device
-#define CMD_POLL         "POLL"           // Health check
-#define CMD_START_INFER  "START_INFER"    // Begin inference
-#define CMD_ACK          "ACK"            // Acknowledge
-#define CMD_FINALIZE     "FINALIZE"       // Complete cycle
-#define CMD_SLEEP        "SLEEP"          // Enter listening mode
-
-// Commands - Device → Gateway
-#define CMD_DATA         "DATA"           // Inference data
-
-// Response Status
-#define STATUS_ONLINE      "ONLINE"       // Device responding
-#define STATUS_INFERRING   "INFERRING"    // Device processing
-#define STATUS_FINALIZED   "FINALIZED"    // Cycle completed
-#define STATUS_SLEEPING    "SLEEPING"     // Entering RX mode
+// Commands, ACK statuses, BROADCAST_ID and the typed payloads are generated
+// from tools/protocol_gen/lora_protocol.schema.json (shared with the devices)
+#include "lora_schema.h"
 
 // Timeouts (milliseconds)
 #define TIMEOUT_HEALTH_CHECK  15000       // 15 seconds
@@ -39,6 +28,22 @@
 #define TIMEOUT_DATA_COLLECT  120000      // 120 seconds (2 minutes)
 #define TIMEOUT_FINALIZE      10000       // 10 seconds
 
+// Positions per poll (START_INFER "pos_N" asks for fewer, see energy_model.h)
+#define POLL_POSITIONS        5
+
+// Broadcast Health Census (milliseconds)
+// Device in roster slot N replies at: RX time + CENSUS_GUARD_MS + N * slot
+#define CENSUS_GUARD_MS       1500        // Decode + RX→TX turnaround before slot 0
+#define CENSUS_SLOT_MS        600         // ONLINE reply ~430 ms airtime at SF9/125 kHz + margin
+#define CENSUS_REPLY_BYTES    84          // ONLINE reply with bat/rssi/snr/cyc/clk fields (tight slots)
+
+// Bulk Transfer
+// BLK_DATA: header (<= 51, 10-digit SEQ) + "tid:index:A:" (<= 12) + base64 chunk (192) <= LORA_MAX_FRAME
+#define BULK_CHUNK_BYTES      144         // Blob bytes per BLK_DATA frame
+#define BULK_ACK_SPAN         256         // Chunks covered by one status bitmap (64 hex chars)
+#define BULK_NAME_MAX         31          // Destination on the device, e.g. "config/thresholds.json"
+#define BULK_HASH_BYTES       32          // SHA-256 of the whole blob
+
 // Retry Configuration
 #define MAX_RETRIES           3           // Maximum retry attempts
 #define RETRY_DELAY_BASE      2000        // Base delay: 2 seconds
@@ -48,43 +53,85 @@
 #define TIMESTAMP_TOLERANCE   60          // ±60 seconds allowed
 #define HMAC_LENGTH           16          // 16 hex characters (8 bytes)
 
+// Gateway Clock (disciplined against NTP when WiFi is up)
+#define CLOCK_STEP_MS         1000        // Larger errors step the clock instead of steering it
+#define CLOCK_MIN_SPAN_MS     600000      // References closer than 10 min correct the offset only
+#define CLOCK_FREQ_GAIN       0.5f        // Share of the measured frequency error applied per reference
+#define CLOCK_MAX_PPM         200         // Frequency correction limit
+
+// Field Capacities (characters, excluding terminator)
+#define LORA_MAX_FRAME        255         // RAK3172 P2P max payload (bytes)
+#define NODE_ID_MAX           9           // "ED0-00001" / "GW0-00001", or ACK status "INFERRING"
+#define SECRET_MAX            32          // 32-character hex
+#define TABLE_ID_MAX          15          // "BLR-13-IL-01"
+#define POSITION_MAX          15          // "center_right"
+#define DETECTIONS_MAX        192         // Rest of one DATA frame after header/table/position (longer: cut, counted)
+
 // ==================== DATA STRUCTURES ====================
 
 /**
  * Parsed LoRa Message Structure
  */
 struct LoRaMessage {
-  String senderId;      // e.g., "GW01", "D1"
-  String command;       // e.g., "POLL", "ACK", "DATA"
-  String targetId;      // e.g., "D1", "GW01"
-  String sequence;      // e.g., "001"
+  FixedString<NODE_ID_MAX> senderId;      // e.g., "ED0-00001"
+  FixedString<COMMAND_MAX> command;       // e.g., "POLL", "ACK", "DATA"
+  FixedString<NODE_ID_MAX> targetId;      // e.g., "GW0-00001", or ACK status
+  LoRaCommand commandId;                  // command, for switch dispatch (LORA_CMD_UNKNOWN if not in the schema)
+  AckStatus ackStatus;                    // targetId of an ACK as status (ACK_STATUS_NONE otherwise)
+  uint32_t sequence;                      // Per-sender space (seq_space.h); 0-999 from old firmware
   unsigned long timestamp;
-  String payload;       // Command-specific data
-  String hmac;          // 16-character hex string
+  FixedString<LORA_MAX_FRAME> payload;    // Command-specific data
+  FixedString<HMAC_LENGTH> hmac;          // 16-character hex string
 
   // Parsed payload (for DATA messages)
   struct {
-    String tableId;         // e.g., "BLR-13-IL-01"
-    String position;        // "left", "center", "right", etc.
-    String detections;      // "motherboard:40%,led_on:50%"
-    int positionIndex;      // 1-5
-    int totalPositions;     // 5
+    FixedString<TABLE_ID_MAX> tableId;        // e.g., "BLR-13-IL-01"
+    FixedString<POSITION_MAX> position;       // "left", "center", "right", etc.
+    FixedString<DETECTIONS_MAX> detections;   // "motherboard:40%,led_on:50%"
+    bool detectionsTruncated;                 // Longer than DETECTIONS_MAX - the rest was cut off
+    uint8_t positionIndex;                    // 1-5
+    uint8_t totalPositions;                   // 5
   } data;
 
   // Parsed payload (for ONLINE messages)
-  struct {
-    int battery;            // Battery percentage
-    int rssi;               // Signal strength
-    int snr;                // Signal-to-noise ratio
-  } health;
+  HealthPayload health;
 
   bool valid;               // Message validation status
 };
 
+/**
+ * Gateway clock state (getClockStatus)
+ */
+struct ClockStatus {
+  bool synced;              // Disciplined by a reference - time is UTC (false = uptime)
+  uint32_t references;      // Reference times applied
+  uint32_t steps;           // Times the clock jumped (first sync included)
+  float ppm;                // Frequency correction (positive = local oscillator slow)
+  int32_t lastErrorMs;      // Error found by the last reference, before correction
+  uint64_t lastReferenceMs; // Gateway time of the last reference (0 = none)
+};
+
+/**
+ * Parsed BLK_STATUS (device's view of one transfer)
+ */
+enum BulkStatusKind : uint8_t {
+  BULK_STATUS_PROGRESS,     // Chunk bitmap follows
+  BULK_STATUS_DONE,         // All chunks received, hash verified, blob installed
+  BULK_STATUS_HASH_FAIL,    // All chunks received but the hash did not match (chunks dropped)
+  BULK_STATUS_UNKNOWN       // Transfer ID not known (device restarted) - offer again
+};
+
+struct BulkStatus {
+  uint16_t transferId;
+  BulkStatusKind kind;
+  uint16_t base;                          // First chunk not received (all before it are held)
+  uint8_t bitmap[BULK_ACK_SPAN / 8];      // Bit n (LSB first) = chunk base + n received
+};
+
 /**
  * Device Polling State
  */
-enum PollingPhase {
+enum PollingPhase : uint8_t {
   PHASE_IDLE,
   PHASE_HEALTH_CHECK,
   PHASE_START_INFERENCE,
@@ -96,36 +143,50 @@ enum PollingPhase {
 
 /**
  * Device Information
+ *
+ * Hot fields (ID lookup on every frame, polling state, health) come first
+ * so a scan of devices[] stays within the leading bytes of each entry.
+ * Pairing data and statistics follow; per-cycle results live in the
+ * separate DeviceResult array.
  */
 struct DeviceInfo {
-  String deviceId;          // e.g., "D1", "D2"
-  String sharedSecret;      // 32-character hex string
-  bool paired;              // Device paired status
-  String tableLeft;         // Table left ID (e.g., "BLR-13-IL-02")
-  String tableRight;        // Table right ID (e.g., "BLR-13-IL-01")
-
-  // Current state
+  // Hot - touched on every frame / phase step
+  FixedString<NODE_ID_MAX> deviceId;  // e.g., "ED0-00001"
   PollingPhase phase;
-  int retryCount;
-  unsigned long lastContact;
-  bool commandSent;         // Flag to prevent re-sending commands
-
-  // Health data
-  int battery;
-  int rssi;
-  int snr;
+  uint8_t retryCount;
+  uint8_t positionsReceived;          // 0-5
+  uint8_t positionsRequested;         // 1-5, set by the energy plan
+  bool commandSent;                   // Flag to prevent re-sending commands
+  bool censusSeen;                    // Answered this cycle's broadcast census
   bool online;
+  bool paired;                        // Device paired status
+  int8_t battery;                     // % (-1 unknown)
+  int16_t rssi;                       // dBm (-999 unknown)
+  int16_t snr;                        // dB (-999 unknown)
+  unsigned long lastContact;
 
-  // Data collection progress
-  int positionsReceived;    // 0-5
-  String lastPosition;
-  String lastTableId;
-  String lastDetections;
-
-  // Statistics
+  // Cold - pairing data and statistics
+  FixedString<SECRET_MAX> sharedSecret;    // 32-character hex string
+  FixedString<TABLE_ID_MAX> tableLeft;     // Table left ID (e.g., "BLR-13-IL-02")
+  FixedString<TABLE_ID_MAX> tableRight;    // Table right ID (e.g., "BLR-13-IL-01")
   unsigned long totalPolls;
   unsigned long successfulPolls;
   unsigned long failedPolls;
+
+  // Schedule (see poll_schedule.h)
+  uint8_t scheduleGroup;              // Cadence group id (0 = gateway default)
+  uint16_t cadenceMinutes;            // Per-device override (0 = group / default)
+  uint8_t cadenceStretch;             // Energy plan multiplier (1 = none)
+  unsigned long nextPollMs;           // millis() when the next poll is due
+};
+
+/**
+ * Latest DATA result per device (written once per position, read at publish)
+ */
+struct DeviceResult {
+  FixedString<POSITION_MAX> lastPosition;
+  FixedString<TABLE_ID_MAX> lastTableId;
+  FixedString<DETECTIONS_MAX> lastDetections;
 };
 
 // ==================== PROTOCOL FUNCTIONS ====================
@@ -139,6 +200,17 @@ struct DeviceInfo {
  */
 String calculateHMAC(const String& message, const String& secret);
 
+/**
+ * Calculate HMAC-SHA256 into a caller buffer (no heap allocation)
+ *
+ * @param message Message bytes (without HMAC)
+ * @param length Message length
+ * @param secret Shared secret key
+ * @param secretLength Secret length
+ * @param out Receives HMAC_LENGTH lowercase hex characters (not terminated)
+ */
+void calculateHMAC(const char* message, size_t length, const char* secret, size_t secretLength, char* out);
+
 /**
  * Verify HMAC-SHA256 of received message
  *
@@ -154,7 +226,7 @@ bool verifyHMAC(const String& message, const String& secret);
  * @param senderId Gateway/Device ID
  * @param command Command string
  * @param targetId Target Device/Gateway ID
- * @param sequence Sequence number (e.g., "001")
+ * @param sequence Sequence number (decimal, e.g. "1042")
  * @param payload Payload data (use "null" if empty)
  * @param secret Shared secret for HMAC
  * @return Complete message with HMAC
@@ -168,6 +240,16 @@ String buildMessage(
   const String& secret
 );
 
+/**
+ * Parse incoming LoRa message in place (no heap allocation)
+ * Header fields longer than their capacity mark the message invalid.
+ *
+ * @param rawMessage Raw message characters (need not be terminated)
+ * @param length Number of characters
+ * @param msg Output structure (msg.valid reports the result)
+ */
+void parseMessage(const char* rawMessage, size_t length, LoRaMessage& msg);
+
 /**
  * Parse incoming LoRa message
  *
@@ -186,7 +268,7 @@ LoRaMessage parseMessage(const String& rawMessage);
 void parseDataPayload(LoRaMessage& msg);
 
 /**
- * Parse ONLINE/ACK payload with health data
+ * Parse ONLINE/ACK payload with health data (decodeHealthPayload)
  *
  * Example: "bat_95:rssi_-45:snr_8"
  *
@@ -194,6 +276,109 @@ void parseDataPayload(LoRaMessage& msg);
  */
 void parseHealthPayload(LoRaMessage& msg);
 
+/**
+ * Estimate LoRa time-on-air for one packet (Semtech AN1200.13 formula)
+ * Explicit header, CRC on, low data rate optimize for SF11/SF12 at 125 kHz
+ *
+ * @param payloadBytes Raw payload size (bytes after hex decoding)
+ * @param sf Spreading factor (7-12)
+ * @param bwKHz Bandwidth in kHz (125, 250, 500)
+ * @param crDenom Coding rate denominator (5-8 for 4/5..4/8)
+ * @param preamble Preamble length in symbols
+ * @return Time on air in milliseconds (rounded up)
+ */
+unsigned long loraAirtimeMs(int payloadBytes, int sf, int bwKHz, int crDenom, int preamble);
+
+/**
+ * Build broadcast census payload (sent as POLL to BROADCAST_ID)
+ *
+ * Example: "cyc_12:slot_600:ED0-00001,ED0-00002,ED0-00003"
+ * Each device finds its own ID in the roster; its index is its TDMA slot.
+ * With atMs, ":at_<ms>" follows the roster: gateway time of slot 0, for
+ * devices that keep the beacon time (time_sync.h).
+ *
+ * @param cycleId Polling cycle ID (echoed back as cyc_ in ONLINE reply)
+ * @param slotMs Slot length in milliseconds
+ * @param roster Comma-separated device IDs in registry order
+ * @param atMs Gateway time at the start of slot 0 (0 = omit)
+ * @return Census payload string
+ */
+String buildCensusPayload(unsigned int cycleId, unsigned int slotMs, const String& roster, uint64_t atMs = 0);
+
+/**
+ * Length of the census listening window after the broadcast
+ *
+ * @param numSlots Number of devices in the roster
+ * @param slotMs Slot length in milliseconds
+ * @return Guard time + all slots, in milliseconds
+ */
+unsigned long censusWindowMs(int numSlots, unsigned int slotMs);
+
+// ==================== BULK TRANSFER PAYLOADS ====================
+//
+// BLK_OFFER   "<tid>:<size>:<chunks>:<sha256 hex>:<name>"
+// BLK_DATA    "<tid>:<index>:<A|->:<base64 chunk>"     A = reply with BLK_STATUS
+// BLK_QUERY   "<tid>"
+// BLK_ABORT   "<tid>"
+// BLK_STATUS  "<tid>:<base>:<bitmap hex>" | "<tid>:DONE" | "<tid>:HASH_FAIL" | "<tid>:UNKNOWN"
+//
+// A device answers BLK_OFFER with BLK_STATUS. Chunks it kept from an earlier,
+// interrupted offer of the same hash are reported as received (resume).
+
+/**
+ * Build a BLK_OFFER payload
+ *
+ * @return Length written (0 if it does not fit)
+ */
+size_t buildBulkOffer(char* out, size_t capacity, uint16_t transferId, uint32_t size,
+                      const uint8_t* sha256, const char* name);
+
+/**
+ * Build a BLK_DATA payload
+ *
+ * @param ackRequest Ask the device for a BLK_STATUS reply (last chunk of a unicast window)
+ * @return Length written (0 if it does not fit)
+ */
+size_t buildBulkChunk(char* out, size_t capacity, uint16_t transferId, uint16_t index,
+                      bool ackRequest, const uint8_t* data, size_t length);
+
+/**
+ * Build a BLK_STATUS payload (device side; trailing empty bitmap bytes are left out)
+ *
+ * @return Length written (0 if it does not fit)
+ */
+size_t buildBulkStatus(char* out, size_t capacity, const BulkStatus& status);
+
+/**
+ * Parse a BLK_STATUS payload
+ */
+bool parseBulkStatus(const LoRaMessage& msg, BulkStatus& status);
+
+/**
+ * Parse a BLK_OFFER payload (device side)
+ *
+ * @param sha256 Receives BULK_HASH_BYTES bytes
+ * @param name Receives the name (BULK_NAME_MAX + 1 bytes)
+ */
+bool parseBulkOffer(const LoRaMessage& msg, uint16_t& transferId, uint32_t& size, uint16_t& chunks,
+                    uint8_t* sha256, char* name);
+
+/**
+ * Parse a BLK_DATA payload (device side)
+ *
+ * @param data Receives the chunk (BULK_CHUNK_BYTES bytes)
+ * @return Chunk length, or -1 if malformed
+ */
+int parseBulkChunk(const LoRaMessage& msg, uint16_t& transferId, uint16_t& index, bool& ackRequest,
+                   uint8_t* data);
+
+/**
+ * Number of chunks for a blob
+ */
+inline uint16_t bulkChunkCount(uint32_t size) {
+  return (uint16_t)((size + BULK_CHUNK_BYTES - 1) / BULK_CHUNK_BYTES);
+}
+
 /**
  * Validate message timestamp (must be within ±60 seconds)
  *
@@ -204,33 +389,46 @@ void parseHealthPayload(LoRaMessage& msg);
 bool validateTimestamp(unsigned long messageTimestamp, unsigned long currentTimestamp);
 
 /**
- * Get current Unix timestamp (seconds since epoch)
- * Uses millis() as reference (not real time)
+ * Get current timestamp (seconds) - Unix time once the clock is synced,
+ * seconds since boot before that
  *
  * @return Current timestamp
  */
 unsigned long getCurrentTimestamp();
 
 /**
- * Initialize timestamp reference
- * Call this in setup() after NTP sync or use millis-based time
+ * Gateway time in milliseconds (same base as getCurrentTimestamp)
+ *
+ * Runs from the 64-bit microsecond timer with the frequency correction
+ * learned from the references, so it neither wraps nor drifts between them.
+ */
+uint64_t getCurrentTimeMs();
+
+/**
+ * Initialize timestamp reference (gateway time starts at 0 = boot)
  */
 void initTimestamp();
 
 /**
- * Convert PollingPhase enum to string for logging
+ * Apply a reference time (NTP). Small errors are corrected and the
+ * frequency error is learned from them; errors above CLOCK_STEP_MS step
+ * the clock. Call from one task at a time.
  *
- * @param phase PollingPhase enum value
- * @return Human-readable string
+ * @param referenceMs Unix time in milliseconds at the moment of the call
  */
-String phaseToString(PollingPhase phase);
+void disciplineTimestamp(uint64_t referenceMs);
 
 /**
- * Generate sequence number (3-digit format)
+ * Current clock discipline state (safe from any task)
+ */
+ClockStatus getClockStatus();
+
+/**
+ * Convert PollingPhase enum to string for logging
  *
- * @param counter Sequence counter (rolls over at 999)
- * @return Formatted sequence string (e.g., "001", "042", "999")
+ * @param phase PollingPhase enum value
+ * @return Human-readable string
  */
-String generateSequence(int& counter);
+String phaseToString(PollingPhase phase);
 
 #endif // LORA_PROTOCOL_H
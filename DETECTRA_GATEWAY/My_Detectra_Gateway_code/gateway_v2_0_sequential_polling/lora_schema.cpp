@@ -0,0 +1,408 @@
+/**
+ * DETECTRA Gateway v2.0 - LoRa Protocol Schema (GENERATED - do not edit)
+ *
+ * See lora_schema.h and tools/protocol_gen/protocol_gen.py
+ */
+
+#include "lora_schema.h"
+
+// ==================== HELPERS ====================
+
+struct SchemaWriter {
+  char* out;
+  size_t capacity;
+  size_t length;
+  char separator;
+  bool ok;
+};
+
+static void schemaPut(SchemaWriter& w, const char* s, size_t n) {
+  if (!w.ok || w.length + n >= w.capacity) {
+    w.ok = false;
+    return;
+  }
+  memcpy(w.out + w.length, s, n);
+  w.length += n;
+}
+
+static void schemaBeginField(SchemaWriter& w, const char* tag) {
+  if (w.length > 0) schemaPut(w, &w.separator, 1);
+  if (tag != NULL) schemaPut(w, tag, strlen(tag));
+}
+
+static void schemaPutUInt(SchemaWriter& w, const char* tag, uint64_t value, int width) {
+  char digits[20];
+  int n = 0;
+  do {
+    digits[n++] = '0' + (char)(value % 10);
+    value /= 10;
+  } while (value > 0 && n < (int)sizeof(digits));
+  while (n < width && n < (int)sizeof(digits)) digits[n++] = '0';
+
+  char text[20];
+  for (int i = 0; i < n; i++) text[i] = digits[n - 1 - i];
+  schemaBeginField(w, tag);
+  schemaPut(w, text, n);
+}
+
+static void schemaPutInt(SchemaWriter& w, const char* tag, int64_t value) {
+  if (value >= 0) {
+    schemaPutUInt(w, tag, (uint64_t)value, 0);
+    return;
+  }
+  schemaBeginField(w, tag);
+  schemaPut(w, "-", 1);
+  SchemaWriter digits = { w.out, w.capacity, w.length, w.separator, w.ok };
+  schemaPutUInt(digits, NULL, (uint64_t)(-(value + 1)) + 1, 0);
+  w.length = digits.length;
+  w.ok = digits.ok;
+}
+
+static void schemaPutStr(SchemaWriter& w, const char* tag, const char* s, size_t n) {
+  schemaBeginField(w, tag);
+  schemaPut(w, s, n);
+}
+
+static size_t schemaFinish(SchemaWriter& w) {
+  if (!w.ok) return 0;
+  w.out[w.length] = '\0';
+  return w.length;
+}
+
+static size_t schemaNull(char* out, size_t capacity) {
+  size_t n = sizeof(NULL_PAYLOAD) - 1;
+  if (n >= capacity) return 0;
+  memcpy(out, NULL_PAYLOAD, n + 1);
+  return n;
+}
+
+static bool schemaIsNull(const char* s, size_t n) {
+  return n == 0 || (n == sizeof(NULL_PAYLOAD) - 1 && memcmp(s, NULL_PAYLOAD, n) == 0);
+}
+
+static bool schemaNextField(const char*& cursor, const char* end, char separator,
+                            const char*& field, size_t& length) {
+  if (cursor == NULL) return false;
+  const char* stop = (const char*)memchr(cursor, separator, end - cursor);
+  field = cursor;
+  length = (stop != NULL ? stop : end) - cursor;
+  cursor = (stop != NULL) ? stop + 1 : NULL;
+  return true;
+}
+
+static bool schemaTag(const char* field, size_t length, const char* tag, size_t tagLength) {
+  return length >= tagLength && memcmp(field, tag, tagLength) == 0;
+}
+
+static bool schemaParseUInt(const char* s, size_t n, uint64_t& value) {
+  if (n == 0) return false;
+  value = 0;
+  for (size_t i = 0; i < n; i++) {
+    if (s[i] < '0' || s[i] > '9') return false;
+    value = value * 10 + (uint64_t)(s[i] - '0');
+  }
+  return true;
+}
+
+static bool schemaParseInt(const char* s, size_t n, int64_t& value) {
+  bool negative = n > 0 && s[0] == '-';
+  uint64_t magnitude;
+  if (!schemaParseUInt(s + (negative ? 1 : 0), n - (negative ? 1 : 0), magnitude)) return false;
+  value = negative ? -(int64_t)magnitude : (int64_t)magnitude;
+  return true;
+}
+
+// ==================== HEALTH PAYLOAD ====================
+
+size_t encodeHealthPayload(char* out, size_t capacity, const HealthPayload& p) {
+  if (p.battery == -1 && p.rssi == -999 && p.snr == -999 && p.cycleId == -1 && p.clockMs == 0) {
+    return schemaNull(out, capacity);
+  }
+
+  SchemaWriter w = { out, capacity, 0, ':', capacity > 0 };
+  if (p.battery != -1) schemaPutInt(w, "bat_", p.battery);
+  if (p.rssi != -999) schemaPutInt(w, "rssi_", p.rssi);
+  if (p.snr != -999) schemaPutInt(w, "snr_", p.snr);
+  if (p.cycleId != -1) schemaPutInt(w, "cyc_", p.cycleId);
+  if (p.clockMs != 0) schemaPutUInt(w, "clk_", p.clockMs, 0);
+  return schemaFinish(w);
+}
+
+bool decodeHealthPayload(const char* payload, size_t length, HealthPayload& p) {
+  p = HealthPayload();
+  if (schemaIsNull(payload, length)) return true;
+
+  const char* cursor = payload;
+  const char* field;
+  size_t fieldLength;
+
+  while (schemaNextField(cursor, payload + length, ':', field, fieldLength)) {
+    if (schemaTag(field, fieldLength, "bat_", 4)) {
+      int64_t value;
+      if (schemaParseInt(field + 4, fieldLength - 4, value)) {
+        p.battery = (int8_t)value;
+      }
+    } else if (schemaTag(field, fieldLength, "rssi_", 5)) {
+      int64_t value;
+      if (schemaParseInt(field + 5, fieldLength - 5, value)) {
+        p.rssi = (int16_t)value;
+      }
+    } else if (schemaTag(field, fieldLength, "snr_", 4)) {
+      int64_t value;
+      if (schemaParseInt(field + 4, fieldLength - 4, value)) {
+        p.snr = (int16_t)value;
+      }
+    } else if (schemaTag(field, fieldLength, "cyc_", 4)) {
+      int64_t value;
+      if (schemaParseInt(field + 4, fieldLength - 4, value)) {
+        p.cycleId = (int32_t)value;
+      }
+    } else if (schemaTag(field, fieldLength, "clk_", 4)) {
+      uint64_t value;
+      if (schemaParseUInt(field + 4, fieldLength - 4, value)) {
+        p.clockMs = value;
+      }
+    }
+  }
+
+  return true;
+}
+
+// ==================== CENSUS PAYLOAD ====================
+
+size_t encodeCensusPayload(char* out, size_t capacity, const CensusPayload& p) {
+  SchemaWriter w = { out, capacity, 0, ':', capacity > 0 };
+  schemaPutUInt(w, "cyc_", p.cycleId, 0);
+  schemaPutUInt(w, "slot_", p.slotMs, 0);
+  schemaPutStr(w, NULL, p.roster.c_str(), p.roster.length());
+  if (p.atMs != 0) schemaPutUInt(w, "at_", p.atMs, 0);
+  return schemaFinish(w);
+}
+
+bool decodeCensusPayload(const char* payload, size_t length, CensusPayload& p) {
+  p = CensusPayload();
+  if (schemaIsNull(payload, length)) return false;
+
+  bool haveCycleId = false;
+  bool haveSlotMs = false;
+  int position = 0;
+  const char* cursor = payload;
+  const char* field;
+  size_t fieldLength;
+
+  while (schemaNextField(cursor, payload + length, ':', field, fieldLength)) {
+    if (schemaTag(field, fieldLength, "cyc_", 4)) {
+      uint64_t value;
+      if (schemaParseUInt(field + 4, fieldLength - 4, value)) {
+        p.cycleId = (uint32_t)value;
+        haveCycleId = true;
+      }
+    } else if (schemaTag(field, fieldLength, "slot_", 5)) {
+      uint64_t value;
+      if (schemaParseUInt(field + 5, fieldLength - 5, value)) {
+        p.slotMs = (uint16_t)value;
+        haveSlotMs = true;
+      }
+    } else if (schemaTag(field, fieldLength, "at_", 3)) {
+      uint64_t value;
+      if (schemaParseUInt(field + 3, fieldLength - 3, value)) {
+        p.atMs = value;
+      }
+    } else {
+      switch (position++) {
+        case 0: {
+          if (!p.roster.assign(field, fieldLength)) return false;
+          break;
+        }
+        default:
+          break;
+      }
+    }
+  }
+
+  return haveCycleId && haveSlotMs && position >= 1;
+}
+
+// ==================== START INFER PAYLOAD ====================
+
+size_t encodeStartInferPayload(char* out, size_t capacity, const StartInferPayload& p) {
+  if (p.positions == 5) {
+    return schemaNull(out, capacity);
+  }
+
+  SchemaWriter w = { out, capacity, 0, ':', capacity > 0 };
+  if (p.positions != 5) schemaPutUInt(w, "pos_", p.positions, 0);
+  return schemaFinish(w);
+}
+
+bool decodeStartInferPayload(const char* payload, size_t length, StartInferPayload& p) {
+  p = StartInferPayload();
+  if (schemaIsNull(payload, length)) return true;
+
+  const char* cursor = payload;
+  const char* field;
+  size_t fieldLength;
+
+  while (schemaNextField(cursor, payload + length, ':', field, fieldLength)) {
+    if (schemaTag(field, fieldLength, "pos_", 4)) {
+      uint64_t value;
+      if (schemaParseUInt(field + 4, fieldLength - 4, value)) {
+        p.positions = (uint8_t)value;
+      }
+    }
+  }
+
+  return true;
+}
+
+// ==================== DATA ACK PAYLOAD ====================
+
+size_t encodeDataAckPayload(char* out, size_t capacity, const DataAckPayload& p) {
+  SchemaWriter w = { out, capacity, 0, '/', capacity > 0 };
+  schemaPutUInt(w, NULL, p.received, 0);
+  schemaPutUInt(w, NULL, p.requested, 0);
+  return schemaFinish(w);
+}
+
+bool decodeDataAckPayload(const char* payload, size_t length, DataAckPayload& p) {
+  p = DataAckPayload();
+  if (schemaIsNull(payload, length)) return false;
+
+  int position = 0;
+  const char* cursor = payload;
+  const char* field;
+  size_t fieldLength;
+
+  while (schemaNextField(cursor, payload + length, '/', field, fieldLength)) {
+    switch (position++) {
+      case 0: {
+        uint64_t value;
+        if (schemaParseUInt(field, fieldLength, value)) {
+          p.received = (uint8_t)value;
+        }
+        break;
+      }
+      case 1: {
+        uint64_t value;
+        if (schemaParseUInt(field, fieldLength, value)) {
+          p.requested = (uint8_t)value;
+        }
+        break;
+      }
+      default:
+        break;
+    }
+  }
+
+  return position >= 2;
+}
+
+// ==================== SLEEP PAYLOAD ====================
+
+size_t encodeSleepPayload(char* out, size_t capacity, const SleepPayload& p) {
+  if (p.wakeS == 0) {
+    return schemaNull(out, capacity);
+  }
+
+  SchemaWriter w = { out, capacity, 0, ':', capacity > 0 };
+  if (p.wakeS != 0) schemaPutUInt(w, "wake_", p.wakeS, 0);
+  return schemaFinish(w);
+}
+
+bool decodeSleepPayload(const char* payload, size_t length, SleepPayload& p) {
+  p = SleepPayload();
+  if (schemaIsNull(payload, length)) return true;
+
+  const char* cursor = payload;
+  const char* field;
+  size_t fieldLength;
+
+  while (schemaNextField(cursor, payload + length, ':', field, fieldLength)) {
+    if (schemaTag(field, fieldLength, "wake_", 5)) {
+      uint64_t value;
+      if (schemaParseUInt(field + 5, fieldLength - 5, value)) {
+        p.wakeS = (uint32_t)value;
+      }
+    }
+  }
+
+  return true;
+}
+
+// ==================== TIME BEACON PAYLOAD ====================
+
+size_t encodeTimeBeaconPayload(char* out, size_t capacity, const TimeBeaconPayload& p) {
+  SchemaWriter w = { out, capacity, 0, ':', capacity > 0 };
+  schemaPutUInt(w, "t_", p.timeMs, 13);
+  schemaPutUInt(w, "q_", p.utc ? 1 : 0, 0);
+  return schemaFinish(w);
+}
+
+bool decodeTimeBeaconPayload(const char* payload, size_t length, TimeBeaconPayload& p) {
+  p = TimeBeaconPayload();
+  if (schemaIsNull(payload, length)) return false;
+
+  bool haveTimeMs = false;
+  bool haveUtc = false;
+  const char* cursor = payload;
+  const char* field;
+  size_t fieldLength;
+
+  while (schemaNextField(cursor, payload + length, ':', field, fieldLength)) {
+    if (schemaTag(field, fieldLength, "t_", 2)) {
+      uint64_t value;
+      if (schemaParseUInt(field + 2, fieldLength - 2, value)) {
+        p.timeMs = value;
+        haveTimeMs = true;
+      }
+    } else if (schemaTag(field, fieldLength, "q_", 2)) {
+      uint64_t value;
+      if (schemaParseUInt(field + 2, fieldLength - 2, value)) {
+        p.utc = value != 0;
+        haveUtc = true;
+      }
+    }
+  }
+
+  return haveTimeMs && haveUtc;
+}
+
+// ==================== PAIR PAYLOAD ====================
+
+size_t encodePairPayload(char* out, size_t capacity, const PairPayload& p) {
+  if (p.tableLeft.isEmpty() && p.tableRight.isEmpty()) {
+    return schemaNull(out, capacity);
+  }
+
+  SchemaWriter w = { out, capacity, 0, '|', capacity > 0 };
+  schemaPutStr(w, NULL, p.tableLeft.c_str(), p.tableLeft.length());
+  schemaPutStr(w, NULL, p.tableRight.c_str(), p.tableRight.length());
+  return schemaFinish(w);
+}
+
+bool decodePairPayload(const char* payload, size_t length, PairPayload& p) {
+  p = PairPayload();
+  if (schemaIsNull(payload, length)) return false;
+
+  int position = 0;
+  const char* cursor = payload;
+  const char* field;
+  size_t fieldLength;
+
+  while (schemaNextField(cursor, payload + length, '|', field, fieldLength)) {
+    switch (position++) {
+      case 0: {
+        if (!p.tableLeft.assign(field, fieldLength)) return false;
+        break;
+      }
+      case 1: {
+        if (!p.tableRight.assign(field, fieldLength)) return false;
+        break;
+      }
+      default:
+        break;
+    }
+  }
+
+  return position >= 2;
+}
@@ -0,0 +1,269 @@
+/**
+ * DETECTRA Gateway v2.0 - LoRa Protocol Schema (GENERATED - do not edit)
+ *
+ * Generated by tools/protocol_gen/protocol_gen.py from
+ * tools/protocol_gen/lora_protocol.schema.json, together with the edge
+ * device module RPI_ZERO_DETECTRA/scripts/detectra_lora.py. Change the
+ * schema and run the generator; both sides then agree by construction.
+ *
+ * Dispatch on the enums (parseMessage fills msg.commandId / msg.ackStatus):
+ *
+ *   switch (msg.commandId) {
+ *     case LORA_CMD_ACK:  ...msg.ackStatus...
+ *     case LORA_CMD_DATA: ...
+ *   }
+ *
+ * Payloads: fields joined by ':' (or the payload's separator), tagged
+ * fields as "<tag>_<value>" in any order, "null" when all are default.
+ */
+
+#ifndef LORA_SCHEMA_H
+#define LORA_SCHEMA_H
+
+#include <Arduino.h>
+#include "fixed_string.h"
+
+#define LORA_SCHEMA_VERSION   1
+
+// ==================== WIRE STRINGS ====================
+
+// Commands
+#define CMD_POLL          "POLL"         // Gateway → device: health check (to ALL: broadcast census)
+#define CMD_START_INFER   "START_INFER"  // Gateway → device: begin inference
+#define CMD_ACK           "ACK"          // Both ways: acknowledge (device: status in TARGET)
+#define CMD_FINALIZE      "FINALIZE"     // Gateway → device: complete cycle
+#define CMD_SLEEP         "SLEEP"        // Gateway → device: enter listening mode
+#define CMD_TIME          "TIME"         // Gateway → device: time-sync beacon to ALL (see time_sync.h)
+#define CMD_PAIR          "PAIR"         // Gateway → device: pair, with the tables to watch
+#define CMD_DATA          "DATA"         // Device → gateway: inference data
+#define CMD_PAIR_ACK      "PAIR_ACK"     // Device → gateway: pairing accepted
+#define CMD_BLK_OFFER     "BLK_OFFER"    // Gateway → device: bulk - announce a blob
+#define CMD_BLK_DATA      "BLK_DATA"     // Gateway → device: bulk - one chunk
+#define CMD_BLK_QUERY     "BLK_QUERY"    // Gateway → device: bulk - report received chunks
+#define CMD_BLK_ABORT     "BLK_ABORT"    // Gateway → device: bulk - drop the transfer
+#define CMD_BLK_STATUS    "BLK_STATUS"   // Device → gateway: bulk - chunk bitmap / DONE / HASH_FAIL / UNKNOWN
+
+// ACK status (device -> gateway, in the TARGET field)
+#define STATUS_ONLINE      "ONLINE"      // Device responding
+#define STATUS_INFERRING   "INFERRING"   // Device processing
+#define STATUS_FINALIZED   "FINALIZED"   // Cycle completed
+#define STATUS_SLEEPING    "SLEEPING"    // Entering RX mode
+
+#define BROADCAST_ID          "ALL"      // Addressed to every paired device
+#define NULL_PAYLOAD          "null"     // Empty payload
+#define COMMAND_MAX           11         // "START_INFER"
+
+// Sequences (SEQ field): a 32-bit space per sender and peer
+#define SEQ_FIRST             1000       // Below: old 3-digit counter, not checked
+#define SEQ_WINDOW            64         // Replay window (bits)
+#define SEQ_RESERVE           256        // Sequences per persisted reservation
+
+// ==================== ENUMS ====================
+
+enum LoRaCommand : uint8_t {
+  LORA_CMD_UNKNOWN,
+  LORA_CMD_POLL,
+  LORA_CMD_START_INFER,
+  LORA_CMD_ACK,
+  LORA_CMD_FINALIZE,
+  LORA_CMD_SLEEP,
+  LORA_CMD_TIME,
+  LORA_CMD_PAIR,
+  LORA_CMD_DATA,
+  LORA_CMD_PAIR_ACK,
+  LORA_CMD_BLK_OFFER,
+  LORA_CMD_BLK_DATA,
+  LORA_CMD_BLK_QUERY,
+  LORA_CMD_BLK_ABORT,
+  LORA_CMD_BLK_STATUS,
+  LORA_CMD_COUNT
+};
+
+enum AckStatus : uint8_t {
+  ACK_STATUS_NONE,          // Not an ACK, or an unknown status
+  ACK_STATUS_ONLINE,
+  ACK_STATUS_INFERRING,
+  ACK_STATUS_FINALIZED,
+  ACK_STATUS_SLEEPING,
+  ACK_STATUS_COUNT
+};
+
+/**
+ * Wire string -> enum (switch on length and first character, one memcmp)
+ */
+inline LoRaCommand loraCommandFromWire(const char* s, size_t length) {
+  switch (length) {
+    case 3:
+      if (memcmp(s, "ACK", 3) == 0) return LORA_CMD_ACK;
+      break;
+    case 4:
+      switch (s[0]) {
+        case 'D':
+          if (memcmp(s, "DATA", 4) == 0) return LORA_CMD_DATA;
+          break;
+        case 'P':
+          if (memcmp(s, "POLL", 4) == 0) return LORA_CMD_POLL;
+          if (memcmp(s, "PAIR", 4) == 0) return LORA_CMD_PAIR;
+          break;
+        case 'T':
+          if (memcmp(s, "TIME", 4) == 0) return LORA_CMD_TIME;
+          break;
+      }
+      break;
+    case 5:
+      if (memcmp(s, "SLEEP", 5) == 0) return LORA_CMD_SLEEP;
+      break;
+    case 8:
+      switch (s[0]) {
+        case 'B':
+          if (memcmp(s, "BLK_DATA", 8) == 0) return LORA_CMD_BLK_DATA;
+          break;
+        case 'F':
+          if (memcmp(s, "FINALIZE", 8) == 0) return LORA_CMD_FINALIZE;
+          break;
+        case 'P':
+          if (memcmp(s, "PAIR_ACK", 8) == 0) return LORA_CMD_PAIR_ACK;
+          break;
+      }
+      break;
+    case 9:
+      switch (s[0]) {
+        case 'B':
+          if (memcmp(s, "BLK_OFFER", 9) == 0) return LORA_CMD_BLK_OFFER;
+          if (memcmp(s, "BLK_QUERY", 9) == 0) return LORA_CMD_BLK_QUERY;
+          if (memcmp(s, "BLK_ABORT", 9) == 0) return LORA_CMD_BLK_ABORT;
+          break;
+      }
+      break;
+    case 10:
+      if (memcmp(s, "BLK_STATUS", 10) == 0) return LORA_CMD_BLK_STATUS;
+      break;
+    case 11:
+      if (memcmp(s, "START_INFER", 11) == 0) return LORA_CMD_START_INFER;
+      break;
+  }
+  return LORA_CMD_UNKNOWN;
+}
+
+inline AckStatus ackStatusFromWire(const char* s, size_t length) {
+  switch (length) {
+    case 6:
+      if (memcmp(s, "ONLINE", 6) == 0) return ACK_STATUS_ONLINE;
+      break;
+    case 8:
+      if (memcmp(s, "SLEEPING", 8) == 0) return ACK_STATUS_SLEEPING;
+      break;
+    case 9:
+      switch (s[0]) {
+        case 'F':
+          if (memcmp(s, "FINALIZED", 9) == 0) return ACK_STATUS_FINALIZED;
+          break;
+        case 'I':
+          if (memcmp(s, "INFERRING", 9) == 0) return ACK_STATUS_INFERRING;
+          break;
+      }
+      break;
+  }
+  return ACK_STATUS_NONE;
+}
+
+/**
+ * Enum -> wire string
+ */
+inline const char* loraCommandName(LoRaCommand command) {
+  static const char* const NAMES[LORA_CMD_COUNT] = {
+    "?", CMD_POLL, CMD_START_INFER, CMD_ACK, CMD_FINALIZE, CMD_SLEEP, CMD_TIME, CMD_PAIR, CMD_DATA, CMD_PAIR_ACK, CMD_BLK_OFFER, CMD_BLK_DATA, CMD_BLK_QUERY, CMD_BLK_ABORT, CMD_BLK_STATUS
+  };
+  return (command < LORA_CMD_COUNT) ? NAMES[command] : "?";
+}
+
+inline const char* ackStatusName(AckStatus status) {
+  static const char* const NAMES[ACK_STATUS_COUNT] = {
+    "?", STATUS_ONLINE, STATUS_INFERRING, STATUS_FINALIZED, STATUS_SLEEPING
+  };
+  return (status < ACK_STATUS_COUNT) ? NAMES[status] : "?";
+}
+
+// ==================== PAYLOADS ====================
+
+/**
+ * ACK ONLINE: bat_95:rssi_-45:snr_8[:cyc_12][:clk_1728567890123]
+ */
+struct HealthPayload {
+  int8_t battery = -1;                  // bat_ - Battery percentage (-1 unknown)
+  int16_t rssi = -999;                  // rssi_ - Signal strength (-999 unknown)
+  int16_t snr = -999;                   // snr_ - Signal-to-noise ratio (-999 unknown)
+  int32_t cycleId = -1;                 // cyc_ - Census cycle echoed back (-1 if unicast reply)
+  uint64_t clockMs = 0;                 // clk_ - Device clock when it started sending (0 = not sent)
+};
+
+size_t encodeHealthPayload(char* out, size_t capacity, const HealthPayload& p);
+bool decodeHealthPayload(const char* payload, size_t length, HealthPayload& p);
+
+/**
+ * POLL to ALL: cyc_12:slot_600:ED0-00001,ED0-00002[:at_1728567891742]
+ */
+struct CensusPayload {
+  uint32_t cycleId = 0;                 // cyc_ - Echoed back as cyc_ in the ONLINE reply
+  uint16_t slotMs = 0;                  // slot_ - Slot length
+  FixedString<230> roster;              // Comma-separated device IDs - position = slot
+  uint64_t atMs = 0;                    // at_ - Gateway time of slot 0 (0 = slots from RX end + guard)
+};
+
+size_t encodeCensusPayload(char* out, size_t capacity, const CensusPayload& p);
+bool decodeCensusPayload(const char* payload, size_t length, CensusPayload& p);
+
+/**
+ * START_INFER: [pos_3]
+ */
+struct StartInferPayload {
+  uint8_t positions = 5;                // pos_ - Positions to report (5 = full scan)
+};
+
+size_t encodeStartInferPayload(char* out, size_t capacity, const StartInferPayload& p);
+bool decodeStartInferPayload(const char* payload, size_t length, StartInferPayload& p);
+
+/**
+ * ACK to a DATA frame: 3/5 (positions received / requested)
+ */
+struct DataAckPayload {
+  uint8_t received = 0;                 // Positions received so far
+  uint8_t requested = 0;                // Positions requested this poll
+};
+
+size_t encodeDataAckPayload(char* out, size_t capacity, const DataAckPayload& p);
+bool decodeDataAckPayload(const char* payload, size_t length, DataAckPayload& p);
+
+/**
+ * SLEEP: [wake_840]
+ */
+struct SleepPayload {
+  uint32_t wakeS = 0;                   // wake_ - Radio may be off this long (0 = stay in RX)
+};
+
+size_t encodeSleepPayload(char* out, size_t capacity, const SleepPayload& p);
+bool decodeSleepPayload(const char* payload, size_t length, SleepPayload& p);
+
+/**
+ * TIME: t_1728567890123:q_1
+ */
+struct TimeBeaconPayload {
+  uint64_t timeMs = 0;                  // t_ - Gateway time at the end of the transmission
+  bool utc = false;                     // q_ - 1 = UTC, 0 = gateway uptime
+};
+
+size_t encodeTimeBeaconPayload(char* out, size_t capacity, const TimeBeaconPayload& p);
+bool decodeTimeBeaconPayload(const char* payload, size_t length, TimeBeaconPayload& p);
+
+/**
+ * PAIR: BLR-13-IL-02|BLR-13-IL-01 (left|right, either may be empty)
+ */
+struct PairPayload {
+  FixedString<15> tableLeft;            // Table on the left
+  FixedString<15> tableRight;           // Table on the right
+};
+
+size_t encodePairPayload(char* out, size_t capacity, const PairPayload& p);
+bool decodePairPayload(const char* payload, size_t length, PairPayload& p);
+
+#endif // LORA_SCHEMA_H
@@ -0,0 +1,258 @@
+/**
+ * DETECTRA Gateway v2.0 - LoRa TX Scheduler Implementation
+ */
+
+#include "lora_tx.h"
+#include "log.h"
+#include <esp_heap_caps.h>
+#include <atomic>
+
+/**
+ * One radio: slot pool, one queue of slot indices per priority
+ */
+struct TxRadio {
+  LoRaTxSlot* slots;
+  QueueHandle_t freeSlots;                    // Indices of free slots
+  QueueHandle_t queues[TX_PRIO_COUNT];        // Indices of queued frames
+  SemaphoreHandle_t pending;                  // Counts queued frames - wakes the TX task
+  QueueHandle_t modemEvents;                  // TxModemResult, from loraTask
+  SemaphoreHandle_t lock;                     // stats
+  std::atomic<uint8_t> inFlight;              // Queued + on air
+  std::atomic<bool> onAir;
+  LoRaTxStats stats;
+};
+
+static TxRadio radios[TX_RADIOS];
+static LoRaTxWriteFn writeFrame = NULL;
+static LoRaTxAirtimeFn airtimeOf = NULL;
+
+static const char* const PRIORITY_NAMES[TX_PRIO_COUNT] = { "ack", "command", "bulk" };
+
+static TxRadio* radioOf(int loraModule) {
+  if (loraModule < 1 || loraModule > TX_RADIOS) return NULL;
+  TxRadio* radio = &radios[loraModule - 1];
+  return radio->slots != NULL ? radio : NULL;
+}
+
+static const char* radioTag(int loraModule) {
+  return loraModule == 1 ? "LORA1" : "LORA2";
+}
+
+// ==================== MODEM ====================
+
+static TxModemResult waitModem(TxRadio& radio, unsigned long timeoutMs) {
+  TxModemResult result;
+  if (xQueueReceive(radio.modemEvents, &result, pdMS_TO_TICKS(timeoutMs)) != pdTRUE) return TX_MODEM_TIMEOUT;
+  return result;
+}
+
+static TxModemResult transmit(int loraModule, TxRadio& radio, const TxFrame& frame, unsigned long& busyMs) {
+  unsigned long timeoutMs = airtimeOf(frame.textLen) + TX_DONE_MARGIN_MS;
+  TxModemResult result = TX_MODEM_TIMEOUT;
+
+  for (int attempt = 0; attempt <= TX_BUSY_RETRIES; attempt++) {
+    // Events that arrived after an earlier frame's timeout belong to that frame
+    TxModemResult stale;
+    while (xQueueReceive(radio.modemEvents, &stale, 0) == pdTRUE) {}
+
+    unsigned long writtenMs = millis();
+    writeFrame(loraModule, frame);
+    result = waitModem(radio, timeoutMs);
+    busyMs = millis() - writtenMs;
+
+    if (result != TX_MODEM_BUSY) break;
+
+    xSemaphoreTake(radio.lock, portMAX_DELAY);
+    radio.stats.busyRetries++;
+    xSemaphoreGive(radio.lock);
+    vTaskDelay(pdMS_TO_TICKS(TX_BUSY_BACKOFF_MS));
+  }
+
+  return result;
+}
+
+// ==================== TX FUNCTIONS ====================
+
+bool loraTxInit(int loraModule, LoRaTxWriteFn write, LoRaTxAirtimeFn airtime) {
+  if (loraModule < 1 || loraModule > TX_RADIOS) return false;
+  writeFrame = write;
+  airtimeOf = airtime;
+
+  TxRadio& radio = radios[loraModule - 1];
+  LoRaTxSlot* slots = (LoRaTxSlot*)heap_caps_malloc(TX_QUEUE_SLOTS * sizeof(LoRaTxSlot),
+                                                    MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  if (slots == NULL) {
+    LOG_E(radioTag(loraModule), "TX pool allocation failed - radio cannot transmit");
+    return false;
+  }
+
+  radio.freeSlots = xQueueCreate(TX_QUEUE_SLOTS, sizeof(uint8_t));
+  for (int p = 0; p < TX_PRIO_COUNT; p++) radio.queues[p] = xQueueCreate(TX_QUEUE_SLOTS, sizeof(uint8_t));
+  radio.pending = xSemaphoreCreateCounting(TX_QUEUE_SLOTS, 0);
+  radio.modemEvents = xQueueCreate(4, sizeof(TxModemResult));
+  radio.lock = xSemaphoreCreateMutex();
+  radio.inFlight = 0;
+  radio.onAir = false;
+  radio.stats = LoRaTxStats();
+  radio.stats.running = true;
+
+  for (uint8_t i = 0; i < TX_QUEUE_SLOTS; i++) {
+    slots[i].index = i;
+    xQueueSend(radio.freeSlots, &i, 0);
+  }
+  radio.slots = slots;  // Last: radioOf() treats the radio as ready from here
+
+  LOG_I(radioTag(loraModule), "TX scheduler: %d slots (%u KB), %d kept from bulk", TX_QUEUE_SLOTS,
+        (unsigned)(TX_QUEUE_SLOTS * sizeof(LoRaTxSlot) / 1024), TX_BULK_RESERVE);
+  return true;
+}
+
+LoRaTxSlot* loraTxAcquire(int loraModule, TxPriority priority) {
+  TxRadio* radio = radioOf(loraModule);
+  if (radio == NULL) return NULL;
+
+  uint8_t index;
+  bool taken;
+  if (priority == TX_PRIO_BULK) {
+    // Bulk never waits, and leaves room for the replies and commands that interrupt it
+    taken = uxQueueMessagesWaiting(radio->freeSlots) > TX_BULK_RESERVE &&
+            xQueueReceive(radio->freeSlots, &index, 0) == pdTRUE;
+  } else {
+    taken = xQueueReceive(radio->freeSlots, &index, pdMS_TO_TICKS(TX_ACQUIRE_WAIT_MS)) == pdTRUE;
+  }
+
+  if (!taken) {
+    xSemaphoreTake(radio->lock, portMAX_DELAY);
+    radio->stats.dropped++;
+    xSemaphoreGive(radio->lock);
+    if (priority != TX_PRIO_BULK) {
+      LOG_E(radioTag(loraModule), "TX queue full for %lums - %s frame dropped",
+            (unsigned long)TX_ACQUIRE_WAIT_MS, PRIORITY_NAMES[priority]);
+    }
+    return NULL;
+  }
+
+  LoRaTxSlot* slot = &radio->slots[index];
+  slot->priority = priority;
+  return slot;
+}
+
+void loraTxSubmit(int loraModule, LoRaTxSlot* slot) {
+  TxRadio* radio = radioOf(loraModule);
+  if (radio == NULL || slot == NULL) return;
+
+  slot->queuedMs = millis();
+
+  xSemaphoreTake(radio->lock, portMAX_DELAY);
+  radio->stats.queued++;
+  if (radio->stats.queued > radio->stats.queuedPeak) radio->stats.queuedPeak = radio->stats.queued;
+  xSemaphoreGive(radio->lock);
+
+  radio->inFlight++;
+  xQueueSend(radio->queues[slot->priority], &slot->index, 0);  // Never full: one entry per slot
+  xSemaphoreGive(radio->pending);
+}
+
+void loraTxRelease(int loraModule, LoRaTxSlot* slot) {
+  TxRadio* radio = radioOf(loraModule);
+  if (radio == NULL || slot == NULL) return;
+
+  xQueueSend(radio->freeSlots, &slot->index, 0);
+}
+
+bool loraTxService(int loraModule, unsigned long waitMs) {
+  TxRadio* radio = radioOf(loraModule);
+  if (radio == NULL) {
+    vTaskDelay(pdMS_TO_TICKS(waitMs));
+    return false;
+  }
+  if (xSemaphoreTake(radio->pending, pdMS_TO_TICKS(waitMs)) != pdTRUE) return false;
+
+  // Highest priority first, oldest first within it
+  uint8_t index = 0;
+  int priority = 0;
+  while (priority < TX_PRIO_COUNT && xQueueReceive(radio->queues[priority], &index, 0) != pdTRUE) priority++;
+  if (priority == TX_PRIO_COUNT) return false;
+
+  LoRaTxSlot& slot = radio->slots[index];
+  unsigned long waitedMs = millis() - slot.queuedMs;
+
+  xSemaphoreTake(radio->lock, portMAX_DELAY);
+  radio->stats.queued--;
+  xSemaphoreGive(radio->lock);
+
+  radio->onAir = true;
+  unsigned long busyMs = 0;
+  TxModemResult result = transmit(loraModule, *radio, slot.frame, busyMs);
+  radio->onAir = false;
+
+  xSemaphoreTake(radio->lock, portMAX_DELAY);
+  LoRaTxStats& stats = radio->stats;
+  if (result == TX_MODEM_DONE || result == TX_MODEM_TIMEOUT) {
+    stats.sent[priority]++;
+    stats.waitTotalMs[priority] += waitedMs;
+    if (waitedMs > stats.waitMaxMs[priority]) stats.waitMaxMs[priority] = waitedMs;
+    stats.busyTotalMs += busyMs;
+    if (busyMs > stats.busyMaxMs) stats.busyMaxMs = busyMs;
+    if (result == TX_MODEM_TIMEOUT) stats.doneTimeouts++;
+  } else {
+    stats.errors++;
+  }
+  xSemaphoreGive(radio->lock);
+
+  if (result == TX_MODEM_BUSY || result == TX_MODEM_ERROR) {
+    LOG_W(radioTag(loraModule), "TX rejected by the module (%s) - %s not sent",
+          result == TX_MODEM_BUSY ? "busy" : "error", slot.frame.text);
+  }
+
+  xQueueSend(radio->freeSlots, &slot.index, 0);
+  radio->inFlight--;
+  return true;
+}
+
+bool loraTxModemLine(int loraModule, const char* line, size_t length) {
+  TxRadio* radio = radioOf(loraModule);
+  if (radio == NULL) return false;
+
+  TxModemResult result;
+  if (length == sizeof(TX_EVT_DONE) - 1 && memcmp(line, TX_EVT_DONE, length) == 0) {
+    result = TX_MODEM_DONE;
+  } else if (length >= 3 && memcmp(line, "AT_", 3) == 0) {
+    result = strstr(line, "BUSY") != NULL ? TX_MODEM_BUSY : TX_MODEM_ERROR;
+  } else {
+    // "OK" after AT+PSEND only means the command was accepted
+    return radio->onAir && length == 2 && memcmp(line, "OK", 2) == 0;
+  }
+
+  // Late events (after the frame's timeout) are dropped before the next write
+  if (radio->onAir) xQueueSend(radio->modemEvents, &result, 0);
+  return true;
+}
+
+bool loraTxWaitIdle(int loraModule, unsigned long timeoutMs) {
+  TxRadio* radio = radioOf(loraModule);
+  if (radio == NULL) return true;
+
+  unsigned long start = millis();
+  while (radio->inFlight > 0) {
+    if (millis() - start >= timeoutMs) return false;
+    vTaskDelay(pdMS_TO_TICKS(5));
+  }
+  return true;
+}
+
+LoRaTxStats loraTxGetStats(int loraModule) {
+  TxRadio* radio = radioOf(loraModule);
+  if (radio == NULL) return LoRaTxStats();
+
+  xSemaphoreTake(radio->lock, portMAX_DELAY);
+  LoRaTxStats copy = radio->stats;
+  xSemaphoreGive(radio->lock);
+
+  copy.onAir = radio->onAir;
+  return copy;
+}
+
+const char* loraTxPriorityName(TxPriority priority) {
+  return priority < TX_PRIO_COUNT ? PRIORITY_NAMES[priority] : "unknown";
+}
@@ -0,0 +1,161 @@
+/**
+ * DETECTRA Gateway v2.0 - LoRa TX Scheduler (one TX task per radio)
+ *
+ * pollingTask (POLL, START_INFER, FINALIZE, census, beacons, bulk frames),
+ * loraTask (data ACKs, SLEEP) and web handlers all transmit. None of them
+ * writes to the UART: each builds its frame into a slot of the radio's
+ * pool and queues it. The radio's TX task is the only writer:
+ *
+ * - Queued frames go out by priority - replies (ACK, SLEEP) before
+ *   commands, commands before bulk traffic - and in order within one.
+ * - One frame at a time: after "AT+PSEND" the task waits for the module's
+ *   "+EVT:TXP2P DONE" (forwarded by loraTask) before the next write.
+ *   Without it the frame is taken as sent after its airtime plus
+ *   TX_DONE_MARGIN_MS. AT_BUSY_ERROR is retried.
+ * - Bulk frames leave TX_BULK_RESERVE slots free, so a bulk transfer never
+ *   holds back an ACK.
+ *
+ * Each frame's queue wait (queued -> written) and modem-busy time
+ * (written -> TXP2P DONE) go into the per-priority stats (GET /api/diag).
+ *
+ * Only radio 1 is in use: LoRa Module 2 (devices 16-30) is not configured,
+ * so setup() calls loraTxInit() and starts a TX task for radio 1 only.
+ * Frames for radio 2 are not sent: loraTxAcquire() returns NULL, as it
+ * has no pool. TX_RADIOS keeps room for the second radio's pool and task.
+ *
+ * Usage:
+ *   loraTxInit(1, writeLoRaFrame, bulkFrameAirtimeMs);   // setup
+ *   loraTxService(1, waitMs);                            // radio 1 TX task loop
+ *
+ *   LoRaTxSlot* slot = loraTxAcquire(1, TX_PRIO_ACK);    // any task
+ *   frameBegin(slot->frame, ...); frameFinish(slot->frame, NULL);
+ *   loraTxSubmit(1, slot);
+ *
+ *   loraTxModemLine(1, line, length);                    // loraTask, every RX line
+ */
+
+#ifndef LORA_TX_H
+#define LORA_TX_H
+
+#include <Arduino.h>
+#include "lora_frame.h"
+
+// ==================== CONFIGURATION ====================
+
+#define TX_RADIOS               2
+#define TX_QUEUE_SLOTS          8         // Frames per radio: being built + queued + on air
+#define TX_BULK_RESERVE         3         // Slots bulk frames leave free for replies / commands
+#define TX_ACQUIRE_WAIT_MS      2000      // Replies / commands wait this long for a free slot
+#define TX_DONE_MARGIN_MS       300       // Airtime + this without TXP2P DONE -> taken as sent
+#define TX_BUSY_RETRIES         2         // AT_BUSY_ERROR -> written again
+#define TX_BUSY_BACKOFF_MS      50
+
+#define TX_EVT_DONE             "+EVT:TXP2P DONE"
+
+// ==================== DATA STRUCTURES ====================
+
+enum TxPriority : uint8_t {
+  TX_PRIO_ACK,              // Replies to a device: data ACK, SLEEP
+  TX_PRIO_COMMAND,          // POLL, START_INFER, FINALIZE, PAIR, TIME
+  TX_PRIO_BULK,             // BLK_* (idle radio time only)
+  TX_PRIO_COUNT
+};
+
+enum TxModemResult : uint8_t {
+  TX_MODEM_TIMEOUT,         // No event - taken as sent after the airtime
+  TX_MODEM_DONE,            // "+EVT:TXP2P DONE"
+  TX_MODEM_BUSY,            // "AT_BUSY_ERROR"
+  TX_MODEM_ERROR            // Any other "..._ERROR" reply
+};
+
+/**
+ * One frame of a radio's pool
+ */
+struct LoRaTxSlot {
+  TxFrame frame;
+  TxPriority priority;
+  unsigned long queuedMs;
+  uint8_t index;
+};
+
+/**
+ * Per-radio counters (times in ms)
+ */
+struct LoRaTxStats {
+  bool running;                     // Pool allocated
+  uint8_t queued;                   // Waiting right now
+  uint8_t queuedPeak;
+  bool onAir;                       // Frame written, modem not done yet
+  uint32_t sent[TX_PRIO_COUNT];
+  uint32_t waitTotalMs[TX_PRIO_COUNT];
+  uint32_t waitMaxMs[TX_PRIO_COUNT];
+  uint32_t busyTotalMs;             // Modem busy with our frames
+  uint32_t busyMaxMs;
+  uint32_t dropped;                 // No free slot in time
+  uint32_t busyRetries;
+  uint32_t errors;                  // Rejected by the module (not sent)
+  uint32_t doneTimeouts;            // No TXP2P DONE
+};
+
+/**
+ * Writes one frame's "AT+PSEND=<hex>\r\n" line to the radio's UART
+ */
+typedef void (*LoRaTxWriteFn)(int loraModule, const TxFrame& frame);
+
+/**
+ * Airtime of a frame with this many bytes
+ */
+typedef unsigned long (*LoRaTxAirtimeFn)(size_t frameBytes);
+
+// ==================== TX FUNCTIONS ====================
+
+/**
+ * Allocate the radio's pool and queues (call once in setup, before any TX)
+ *
+ * @return false if memory is short (the radio cannot transmit)
+ */
+bool loraTxInit(int loraModule, LoRaTxWriteFn write, LoRaTxAirtimeFn airtime);
+
+/**
+ * Take a free slot to build a frame in
+ * Replies and commands wait up to TX_ACQUIRE_WAIT_MS, bulk frames never.
+ *
+ * @return NULL if no slot is free (counted as dropped)
+ */
+LoRaTxSlot* loraTxAcquire(int loraModule, TxPriority priority);
+
+/**
+ * Queue a built frame / return an unused slot
+ */
+void loraTxSubmit(int loraModule, LoRaTxSlot* slot);
+void loraTxRelease(int loraModule, LoRaTxSlot* slot);
+
+/**
+ * TX task body: send the next frame and wait for the modem
+ *
+ * @param waitMs How long to wait for a frame
+ * @return true if a frame was handled
+ */
+bool loraTxService(int loraModule, unsigned long waitMs);
+
+/**
+ * Hand a line from the module to the TX task ("+EVT:TXP2P DONE", errors)
+ *
+ * @return true if the line was a TX event
+ */
+bool loraTxModemLine(int loraModule, const char* line, size_t length);
+
+/**
+ * Wait until nothing is queued or on air (stamped frames: beacon, census)
+ *
+ * @return false on timeout
+ */
+bool loraTxWaitIdle(int loraModule, unsigned long timeoutMs);
+
+/**
+ * Counters
+ */
+LoRaTxStats loraTxGetStats(int loraModule);
+const char* loraTxPriorityName(TxPriority priority);
+
+#endif // LORA_TX_H
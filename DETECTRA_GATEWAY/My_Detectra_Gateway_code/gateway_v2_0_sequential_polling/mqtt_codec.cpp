@@ -0,0 +1,79 @@
+/**
+ * DETECTRA Gateway v2.0 - MQTT Payload Encoding Implementation
+ */
+
+#include "mqtt_codec.h"
+
+static const char* const TOPIC_NAMES[MQTT_TOPIC_COUNT] = { "status", "polling", "device", "data" };
+
+static uint8_t msgpackMask = 0;     // All JSON by default
+
+// ==================== SETTINGS ====================
+
+void codecSetMask(uint8_t mask) {
+  msgpackMask = mask & ((1 << MQTT_TOPIC_COUNT) - 1);
+}
+
+uint8_t codecGetMask() {
+  return msgpackMask;
+}
+
+void codecSetEncoding(MqttTopic topic, PayloadEncoding encoding) {
+  if (topic >= MQTT_TOPIC_COUNT) return;
+  if (encoding == ENCODING_MSGPACK) msgpackMask |= (1 << topic);
+  else msgpackMask &= ~(1 << topic);
+}
+
+PayloadEncoding codecGetEncoding(MqttTopic topic) {
+  return (msgpackMask & (1 << topic)) ? ENCODING_MSGPACK : ENCODING_JSON;
+}
+
+// ==================== SERIALIZATION ====================
+
+size_t codecSerialize(const JsonDocument& doc, MqttTopic topic, uint8_t* out, size_t capacity) {
+  if (codecGetEncoding(topic) == ENCODING_MSGPACK) {
+    if (measureMsgPack(doc) > capacity) return 0;
+    return serializeMsgPack(doc, out, capacity);
+  }
+
+  if (measureJson(doc) >= capacity) return 0;     // Room for the terminator
+  return serializeJson(doc, (char*)out, capacity);
+}
+
+size_t codecBuildMeta(char* out, size_t capacity) {
+  int written = snprintf(out, capacity, "{\"schema\":\"%s\",\"version\":%d,\"content_types\":{",
+                         MQTT_SCHEMA_NAME, MQTT_SCHEMA_VERSION);
+
+  for (int t = 0; t < MQTT_TOPIC_COUNT && written > 0 && (size_t)written < capacity; t++) {
+    written += snprintf(out + written, capacity - written, "%s\"%s\":\"%s\"", t ? "," : "",
+                        TOPIC_NAMES[t], codecContentType(codecGetEncoding((MqttTopic)t)));
+  }
+  if (written > 0 && (size_t)written < capacity) {
+    written += snprintf(out + written, capacity - written, "}}");
+  }
+
+  return (written > 0 && (size_t)written < capacity) ? written : 0;
+}
+
+// ==================== NAMES ====================
+
+const char* codecTopicName(MqttTopic topic) {
+  return (topic < MQTT_TOPIC_COUNT) ? TOPIC_NAMES[topic] : "unknown";
+}
+
+const char* codecContentType(PayloadEncoding encoding) {
+  return (encoding == ENCODING_MSGPACK) ? "application/msgpack" : "application/json";
+}
+
+MqttTopic codecFindTopic(const char* name) {
+  for (int t = 0; t < MQTT_TOPIC_COUNT; t++) {
+    if (strcmp(name, TOPIC_NAMES[t]) == 0) return (MqttTopic)t;
+  }
+  return MQTT_TOPIC_COUNT;
+}
+
+int codecFindEncoding(const char* name) {
+  if (strcmp(name, "json") == 0) return ENCODING_JSON;
+  if (strcmp(name, "msgpack") == 0) return ENCODING_MSGPACK;
+  return -1;
+}
@@ -0,0 +1,91 @@
+/**
+ * DETECTRA Gateway v2.0 - MQTT Payload Encoding
+ *
+ * Each MQTT topic family can be sent as JSON (default) or MessagePack.
+ * Both carry the same document - same keys, same types - described by
+ * tools/mqtt_decode/detectra_mqtt.schema.json. MessagePack is ~30 %
+ * smaller and much cheaper to parse on the backend.
+ *
+ * PubSubClient speaks MQTT 3.1.1, which has no content-type property.
+ * The content type of every topic is therefore announced in a retained
+ * meta message (codecBuildMeta, topic detectra/<gateway>/meta), and the
+ * first payload byte tells the formats apart as well: '{' for JSON,
+ * 0x80-0x8F / 0xDE / 0xDF (map) for MessagePack.
+ *
+ * Usage:
+ *   uint8_t buffer[1024];
+ *   size_t length = codecSerialize(doc, MQTT_TOPIC_DEVICE, buffer, sizeof(buffer));
+ *   mqttPublishOrQueue(topic, buffer, length, false);
+ */
+
+#ifndef MQTT_CODEC_H
+#define MQTT_CODEC_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// ==================== CONSTANTS ====================
+
+#define MQTT_SCHEMA_NAME      "detectra-mqtt"
+#define MQTT_SCHEMA_VERSION   1             // Bump when a key changes meaning or type
+#define MQTT_ENCODING_NVS_KEY "mqtt_enc"    // Bit per MqttTopic set = MessagePack
+
+// ==================== DATA STRUCTURES ====================
+
+/**
+ * Topic families with a selectable encoding
+ */
+enum MqttTopic : uint8_t {
+  MQTT_TOPIC_STATUS,        // detectra/<gw>/status
+  MQTT_TOPIC_POLLING,       // detectra/<gw>/polling
+  MQTT_TOPIC_DEVICE,        // detectra/<gw>/device/<id>
+  MQTT_TOPIC_DATA,          // detectra/<gw>/data
+  MQTT_TOPIC_COUNT
+};
+
+enum PayloadEncoding : uint8_t {
+  ENCODING_JSON,
+  ENCODING_MSGPACK
+};
+
+// ==================== CODEC FUNCTIONS ====================
+
+/**
+ * Set all encodings from a bitmask (bit n set = topic n as MessagePack)
+ */
+void codecSetMask(uint8_t msgpackMask);
+
+/**
+ * Current encodings as a bitmask (for NVS)
+ */
+uint8_t codecGetMask();
+
+void codecSetEncoding(MqttTopic topic, PayloadEncoding encoding);
+PayloadEncoding codecGetEncoding(MqttTopic topic);
+
+/**
+ * Serialize a document in the topic's encoding
+ *
+ * @return Payload bytes (JSON is also NUL-terminated), 0 if it did not fit
+ */
+size_t codecSerialize(const JsonDocument& doc, MqttTopic topic, uint8_t* out, size_t capacity);
+
+/**
+ * Build the retained meta message: schema name/version + content type per topic
+ *
+ * @return JSON length, 0 if the buffer is too small
+ */
+size_t codecBuildMeta(char* out, size_t capacity);
+
+const char* codecTopicName(MqttTopic topic);      // "status", "polling", "device", "data"
+const char* codecContentType(PayloadEncoding encoding);
+
+/**
+ * Look up a topic / encoding by name
+ *
+ * @return MQTT_TOPIC_COUNT / -1 if unknown
+ */
+MqttTopic codecFindTopic(const char* name);
+int codecFindEncoding(const char* name);          // "json" / "msgpack"
+
+#endif // MQTT_CODEC_H
@@ -0,0 +1,93 @@
+/**
+ * DETECTRA Gateway v2.0 - MQTT Outbox Implementation
+ */
+
+#include "mqtt_outbox.h"
+#include "log.h"
+#include <esp_heap_caps.h>
+
+struct OutboxEntry {
+  char topic[OUTBOX_TOPIC_MAX];
+  uint8_t payload[OUTBOX_PAYLOAD_MAX];
+  uint16_t length;
+  bool retained;
+};
+
+static OutboxEntry* entries = NULL;
+static uint8_t head = 0;            // Next slot to write
+static uint8_t count = 0;
+static OutboxStats stats = {};
+static SemaphoreHandle_t outboxLock = NULL;
+
+bool outboxInit() {
+  size_t bytes = OUTBOX_SLOTS * sizeof(OutboxEntry);
+
+  entries = (OutboxEntry*)heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  if (entries == NULL) {
+    entries = (OutboxEntry*)heap_caps_malloc(bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  }
+  outboxLock = xSemaphoreCreateMutex();
+
+  return entries != NULL;
+}
+
+bool outboxPush(const char* topic, const uint8_t* payload, size_t payloadLength, bool retained) {
+  size_t topicLength = strlen(topic);
+
+  if (entries == NULL || topicLength >= OUTBOX_TOPIC_MAX || payloadLength > OUTBOX_PAYLOAD_MAX) {
+    stats.dropped++;
+    LOG_W("OUTBOX", "Message for %s dropped (%u bytes)", topic, (unsigned)payloadLength);
+    return false;
+  }
+
+  xSemaphoreTake(outboxLock, portMAX_DELAY);
+
+  if (count == OUTBOX_SLOTS) {
+    count--;                        // Overwrite the oldest message
+    stats.dropped++;
+  }
+
+  OutboxEntry& entry = entries[head];
+  memcpy(entry.topic, topic, topicLength + 1);
+  memcpy(entry.payload, payload, payloadLength);
+  entry.length = payloadLength;
+  entry.retained = retained;
+
+  head = (head + 1) % OUTBOX_SLOTS;
+  count++;
+  stats.queued++;
+
+  xSemaphoreGive(outboxLock);
+  return true;
+}
+
+uint8_t outboxFlush(OutboxPublishFn publish, uint8_t maxMessages) {
+  if (entries == NULL || count == 0) return 0;
+
+  uint8_t published = 0;
+
+  // Held across publish() so a concurrent push cannot overwrite the entry being sent
+  xSemaphoreTake(outboxLock, portMAX_DELAY);
+
+  while (count > 0 && published < maxMessages) {
+    OutboxEntry& entry = entries[(head + OUTBOX_SLOTS - count) % OUTBOX_SLOTS];
+    if (!publish(entry.topic, entry.payload, entry.length, entry.retained)) break;
+
+    count--;
+    published++;
+    stats.flushed++;
+  }
+
+  xSemaphoreGive(outboxLock);
+
+  if (published > 0) {
+    LOG_I("OUTBOX", "Flushed %u queued messages (%u waiting)", published, count);
+  }
+  return published;
+}
+
+OutboxStats outboxGetStats() {
+  OutboxStats snapshot = stats;
+  snapshot.depth = count;
+  return snapshot;
+}
@@ -0,0 +1,73 @@
+/**
+ * DETECTRA Gateway v2.0 - MQTT Outbox
+ *
+ * Polling can start before WiFi/MQTT are up (and keeps running through
+ * broker outages). Every message from pollingTask / loraTask is queued
+ * here and flushed from loop() once the broker is reachable, so loop()
+ * stays the only task that calls the MQTT client.
+ *
+ * - Fixed ring of OUTBOX_SLOTS messages, allocated once (PSRAM when
+ *   available, internal RAM otherwise).
+ * - When full, the oldest message is dropped and counted: fresh results
+ *   are worth more than stale ones.
+ * - Messages are flushed in FIFO order; a failed publish stops the flush
+ *   and the message is retried on the next call.
+ * - Payloads are binary-safe (MessagePack topics, see mqtt_codec.h).
+ */
+
+#ifndef MQTT_OUTBOX_H
+#define MQTT_OUTBOX_H
+
+#include <Arduino.h>
+
+// ==================== CONSTANTS ====================
+
+#define OUTBOX_SLOTS          16
+#define OUTBOX_TOPIC_MAX      64
+#define OUTBOX_PAYLOAD_MAX    1024
+#define OUTBOX_FLUSH_BATCH    4             // Messages per flush call (keeps loop() responsive)
+
+// ==================== DATA STRUCTURES ====================
+
+/**
+ * Outbox counters (for status reports)
+ */
+struct OutboxStats {
+  uint32_t queued;                  // Messages accepted into the ring
+  uint32_t flushed;                 // Messages published from the ring
+  uint32_t dropped;                 // Oldest messages overwritten / oversized messages
+  uint8_t depth;                    // Messages currently waiting
+};
+
+/**
+ * Publish callback (returns false if the message was not sent)
+ */
+typedef bool (*OutboxPublishFn)(const char* topic, const uint8_t* payload, size_t length, bool retained);
+
+// ==================== OUTBOX FUNCTIONS ====================
+
+/**
+ * Allocate the ring (call once in setup, before any task publishes)
+ */
+bool outboxInit();
+
+/**
+ * Queue a message for later delivery
+ *
+ * @return false if the message is larger than the slot (dropped)
+ */
+bool outboxPush(const char* topic, const uint8_t* payload, size_t length, bool retained);
+
+/**
+ * Publish up to maxMessages queued messages, oldest first
+ *
+ * @return Number of messages published
+ */
+uint8_t outboxFlush(OutboxPublishFn publish, uint8_t maxMessages = OUTBOX_FLUSH_BATCH);
+
+/**
+ * Current outbox counters
+ */
+OutboxStats outboxGetStats();
+
+#endif // MQTT_OUTBOX_H
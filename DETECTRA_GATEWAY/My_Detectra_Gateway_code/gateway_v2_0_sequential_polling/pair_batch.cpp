@@ -0,0 +1,315 @@
+/**
+ * DETECTRA Gateway v2.0 - Bulk Pairing Implementation
+ */
+
+#include "pair_batch.h"
+#include "log.h"
+
+static PairSendFn sendPair = NULL;
+static PairNotifyFn notifyProgress = NULL;
+static PairNotifyFn notifyDone = NULL;
+static SemaphoreHandle_t pairLock = NULL;
+
+static PairRow rows[PAIR_BATCH_MAX_ROWS];
+static int numRows = 0;
+static uint16_t batchId = 0;
+static bool active = false;
+static uint32_t frames = 0;
+static unsigned long startedMs = 0;
+static unsigned long finishedMs = 0;
+static unsigned long lastTxMs = 0;
+
+static const char* const STATE_NAMES[] = { "rejected", "queued", "sent", "paired", "failed" };
+
+// ==================== CSV ====================
+
+static void trimField(const char*& s, size_t& length) {
+  while (length > 0 && (*s == ' ' || *s == '\t')) { s++; length--; }
+  while (length > 0 && (s[length - 1] == ' ' || s[length - 1] == '\t' || s[length - 1] == '\r')) length--;
+  if (length >= 2 && s[0] == '"' && s[length - 1] == '"') { s++; length -= 2; }
+}
+
+static bool validTableId(const char* s, size_t length) {
+  // ':' splits frame fields, '|' splits the PAIR payload
+  return memchr(s, ':', length) == NULL && memchr(s, '|', length) == NULL;
+}
+
+/**
+ * Check one row's fields (caller assigned them); sets REJECTED + reason
+ */
+static void checkRow(PairRow& row, const char* const* fields, const size_t* lengths, int numFields,
+                     const PairRow* earlier, int numEarlier) {
+  if (numFields > 3) {
+    row.reason = "too many fields";
+  } else if (lengths[0] != 9 || memcmp(fields[0], "ED", 2) != 0) {
+    row.reason = "invalid device ID (EDy-XXXXX)";
+  } else if (numFields < 3 || (lengths[1] == 0 && lengths[2] == 0)) {
+    row.reason = "missing table fields";
+  } else if (lengths[1] > TABLE_ID_MAX || lengths[2] > TABLE_ID_MAX) {
+    row.reason = "table ID too long";
+  } else if (!validTableId(fields[1], lengths[1]) || !validTableId(fields[2], lengths[2])) {
+    row.reason = "table ID contains ':' or '|'";
+  } else {
+    for (int i = 0; i < numEarlier; i++) {
+      if (earlier[i].state != PAIR_ROW_REJECTED && earlier[i].deviceId == row.deviceId) {
+        row.reason = "duplicate device ID";
+        break;
+      }
+    }
+  }
+  if (row.reason != NULL) row.state = PAIR_ROW_REJECTED;
+}
+
+int pairBatchParseCsv(const char* csv, size_t length, PairRow* out, int maxRows, int* truncated) {
+  int count = 0;
+  int extra = 0;
+  bool headerChecked = false;
+  uint16_t line = 0;
+
+  size_t pos = 0;
+  while (pos < length) {
+    size_t end = pos;
+    while (end < length && csv[end] != '\n') end++;
+    line++;
+
+    // Split into at most 4 fields (a 4th only means "too many")
+    const char* fields[4] = { "", "", "", "" };
+    size_t lengths[4] = { 0, 0, 0, 0 };
+    int numFields = 0;
+    size_t start = pos;
+    for (size_t i = pos; i <= end && numFields < 4; i++) {
+      if (i == end || csv[i] == ',') {
+        fields[numFields] = csv + start;
+        lengths[numFields] = i - start;
+        trimField(fields[numFields], lengths[numFields]);
+        numFields++;
+        start = i + 1;
+      }
+    }
+    pos = end + 1;
+
+    // Blank lines and comments
+    if (numFields == 0 || (numFields == 1 && lengths[0] == 0) || (lengths[0] > 0 && fields[0][0] == '#')) continue;
+
+    // Optional header on the first data line
+    if (!headerChecked) {
+      headerChecked = true;
+      if (lengths[0] == 9 && strncasecmp(fields[0], "device_id", 9) == 0) continue;
+    }
+
+    if (count >= maxRows) {
+      extra++;
+      continue;
+    }
+
+    PairRow& row = out[count];
+    row = PairRow();
+    row.line = line;
+    row.state = PAIR_ROW_QUEUED;
+    row.deviceId.assign(fields[0], lengths[0]);
+    row.tableLeft.assign(fields[1], lengths[1]);
+    row.tableRight.assign(fields[2], lengths[2]);
+    checkRow(row, fields, lengths, numFields, out, count);
+    count++;
+  }
+
+  if (truncated != NULL) *truncated = extra;
+  return count;
+}
+
+// ==================== BATCH FUNCTIONS ====================
+
+void pairBatchInit(PairSendFn send, PairNotifyFn progress, PairNotifyFn done) {
+  sendPair = send;
+  notifyProgress = progress;
+  notifyDone = done;
+  pairLock = xSemaphoreCreateMutex();
+}
+
+int pairBatchStart(const PairRow* newRows, int count, unsigned long now) {
+  if (pairLock == NULL || count < 1) return -1;
+  if (count > PAIR_BATCH_MAX_ROWS) count = PAIR_BATCH_MAX_ROWS;
+
+  int queued = 0;
+  for (int i = 0; i < count; i++) {
+    if (newRows[i].state == PAIR_ROW_QUEUED) queued++;
+  }
+  if (queued == 0) return -1;
+
+  xSemaphoreTake(pairLock, portMAX_DELAY);
+  if (active) {
+    xSemaphoreGive(pairLock);
+    return -1;
+  }
+
+  memcpy(rows, newRows, count * sizeof(PairRow));
+  numRows = count;
+  batchId++;
+  active = true;
+  frames = 0;
+  startedMs = now;
+  finishedMs = now;
+  lastTxMs = 0;
+  int id = batchId;
+  xSemaphoreGive(pairLock);
+
+  LOG_I("PAIR", "Batch %d: %d devices to pair, %d rows rejected", id, queued, count - queued);
+  if (notifyProgress != NULL) notifyProgress();
+  return id;
+}
+
+void pairBatchService(unsigned long now) {
+  if (pairLock == NULL || !active) return;
+
+  xSemaphoreTake(pairLock, portMAX_DELAY);
+  bool changed = false;
+
+  // Silent devices: next attempt, or give up
+  int inFlight = 0;
+  for (int i = 0; i < numRows; i++) {
+    PairRow& row = rows[i];
+    if (row.state != PAIR_ROW_SENT) continue;
+    if (now - row.sentAtMs < PAIR_ACK_TIMEOUT_MS) {
+      inFlight++;
+      continue;
+    }
+
+    if (row.attempts >= PAIR_MAX_ATTEMPTS) {
+      row.state = PAIR_ROW_FAILED;
+      row.reason = "no PAIR_ACK";
+      row.doneAtMs = now;
+      LOG_W("PAIR", "%s: no PAIR_ACK after %d attempts", row.deviceId.c_str(), row.attempts);
+    } else {
+      row.state = PAIR_ROW_QUEUED;
+    }
+    changed = true;
+  }
+
+  // Next PAIR frame: a free in-flight slot, spaced from the previous frame
+  PairRow* next = NULL;
+  if (inFlight < PAIR_BATCH_INFLIGHT && (lastTxMs == 0 || now - lastTxMs >= PAIR_TX_SPACING_MS)) {
+    for (int i = 0; i < numRows && next == NULL; i++) {
+      if (rows[i].state == PAIR_ROW_QUEUED) next = &rows[i];
+    }
+  }
+
+  char deviceId[NODE_ID_MAX + 1];
+  char tableLeft[TABLE_ID_MAX + 1];
+  char tableRight[TABLE_ID_MAX + 1];
+  if (next != NULL) {
+    // Commit before sending: PAIR_ACK may arrive before sendPair() returns
+    strcpy(deviceId, next->deviceId.c_str());
+    strcpy(tableLeft, next->tableLeft.c_str());
+    strcpy(tableRight, next->tableRight.c_str());
+    next->state = PAIR_ROW_SENT;
+    next->attempts++;
+    next->sentAtMs = now;
+    lastTxMs = now;
+    frames++;
+    changed = true;
+  }
+
+  // Finished when nothing is queued or waiting
+  bool finished = false;
+  if (next == NULL && inFlight == 0) {
+    finished = true;
+    for (int i = 0; i < numRows && finished; i++) {
+      if (rows[i].state == PAIR_ROW_QUEUED || rows[i].state == PAIR_ROW_SENT) finished = false;
+    }
+  }
+
+  int paired = 0;
+  int failed = 0;
+  if (finished) {
+    active = false;
+    finishedMs = now;
+    for (int i = 0; i < numRows; i++) {
+      if (rows[i].state == PAIR_ROW_PAIRED) paired++;
+      if (rows[i].state == PAIR_ROW_FAILED) failed++;
+    }
+  }
+  int id = batchId;
+  xSemaphoreGive(pairLock);
+
+  if (next != NULL && !sendPair(deviceId, tableLeft, tableRight)) {
+    LOG_W("PAIR", "%s: PAIR not queued - retried after the timeout", deviceId);
+  }
+
+  if (finished) {
+    LOG_I("PAIR", "Batch %d done in %lus: %d paired, %d failed", id, (finishedMs - startedMs) / 1000,
+          paired, failed);
+  }
+  if (changed || finished) {
+    if (notifyProgress != NULL) notifyProgress();
+  }
+  if (finished && notifyDone != NULL) notifyDone();
+}
+
+bool pairBatchHandleAck(const char* deviceId, unsigned long now) {
+  if (pairLock == NULL) return false;
+
+  xSemaphoreTake(pairLock, portMAX_DELAY);
+  bool found = false;
+  for (int i = 0; i < numRows; i++) {
+    PairRow& row = rows[i];
+    if (row.state == PAIR_ROW_REJECTED || row.deviceId != deviceId) continue;
+
+    // A late PAIR_ACK (retry queued, or already given up) still counts
+    found = true;
+    if (row.state != PAIR_ROW_PAIRED) {
+      row.state = PAIR_ROW_PAIRED;
+      row.reason = NULL;
+      row.doneAtMs = now;
+    }
+    break;
+  }
+  xSemaphoreGive(pairLock);
+
+  if (found && notifyProgress != NULL) notifyProgress();
+  return found;
+}
+
+bool pairBatchActive() {
+  return active;
+}
+
+PairBatchStats pairBatchGetStats(unsigned long now) {
+  PairBatchStats stats = {};
+  if (pairLock == NULL) return stats;
+
+  xSemaphoreTake(pairLock, portMAX_DELAY);
+  stats.batchId = batchId;
+  stats.active = active;
+  stats.rows = numRows;
+  stats.frames = frames;
+  stats.elapsedMs = (active ? now : finishedMs) - startedMs;
+  for (int i = 0; i < numRows; i++) {
+    switch (rows[i].state) {
+      case PAIR_ROW_QUEUED:   stats.queued++;   break;
+      case PAIR_ROW_SENT:     stats.sent++;     break;
+      case PAIR_ROW_PAIRED:   stats.paired++;   break;
+      case PAIR_ROW_FAILED:   stats.failed++;   break;
+      default:                stats.rejected++; break;
+    }
+  }
+  xSemaphoreGive(pairLock);
+
+  return stats;
+}
+
+int pairBatchGetRows(PairRow* out, int first, int maxRows) {
+  if (pairLock == NULL || first < 0) return 0;
+
+  xSemaphoreTake(pairLock, portMAX_DELAY);
+  int n = numRows - first;
+  if (n < 0) n = 0;
+  if (n > maxRows) n = maxRows;
+  memcpy(out, rows + first, n * sizeof(PairRow));
+  xSemaphoreGive(pairLock);
+
+  return n;
+}
+
+const char* pairRowStateName(PairRowState state) {
+  return state <= PAIR_ROW_FAILED ? STATE_NAMES[state] : "unknown";
+}
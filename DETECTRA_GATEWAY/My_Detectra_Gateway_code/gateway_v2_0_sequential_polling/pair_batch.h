@@ -0,0 +1,151 @@
+/**
+ * DETECTRA Gateway v2.0 - Bulk Pairing (CSV import)
+ *
+ * Commissions a floor of devices from one CSV upload instead of one
+ * /api/device/pair request per device:
+ *
+ *   device_id,table_left,table_right        <- header optional
+ *   ED0-00001,BLR-13-IL-01,BLR-13-IL-02
+ *   ED0-00002,BLR-13-IL-03,
+ *
+ * - Rows are checked before anything is sent (ID format, missing table
+ *   fields, table length, duplicates). Bad rows are REJECTED with a reason,
+ *   the rest are QUEUED. A row needs all three fields and at least one table;
+ *   an empty field between commas means "no table on that side".
+ * - PAIR frames are pipelined: up to PAIR_BATCH_INFLIGHT devices wait for
+ *   their PAIR_ACK at once, so a silent device costs a timeout but does not
+ *   hold the others. Frames are PAIR_TX_SPACING_MS apart, so each
+ *   PAIR_ACK lands while the gateway is listening.
+ * - A device without PAIR_ACK within PAIR_ACK_TIMEOUT_MS is sent PAIR
+ *   again, up to PAIR_MAX_ATTEMPTS, then FAILED.
+ * - Every change calls the progress callback (WebSocket push), and the end
+ *   of the batch calls the done callback once (single registry write).
+ *
+ * pollingTask calls pairBatchService() between polling cycles; PAIR_ACK
+ * from processIncomingMessage() goes to pairBatchHandleAck().
+ *
+ * Usage:
+ *   pairBatchInit(sendPairFrame, onPairProgress, onPairDone);
+ *   int n = pairBatchParseCsv(csv, length, rows, PAIR_BATCH_MAX_ROWS);
+ *   pairBatchStart(rows, n, millis());
+ *
+ *   pairBatchService(millis());                   // pollingTask, between cycles
+ *   pairBatchHandleAck(deviceId, millis());       // on PAIR_ACK
+ */
+
+#ifndef PAIR_BATCH_H
+#define PAIR_BATCH_H
+
+#include <Arduino.h>
+#include "lora_protocol.h"
+
+// ==================== CONFIGURATION ====================
+
+#define PAIR_BATCH_MAX_ROWS     32        // Rows per CSV (registry capacity)
+#define PAIR_BATCH_CSV_MAX      2048      // Upload limit (bytes)
+#define PAIR_BATCH_INFLIGHT     4         // Devices awaiting PAIR_ACK at once
+#define PAIR_TX_SPACING_MS      1500      // Between PAIR frames: PAIR_ACK airtime + device turnaround
+#define PAIR_ACK_TIMEOUT_MS     8000      // PAIR sent -> PAIR_ACK, then the next attempt
+#define PAIR_MAX_ATTEMPTS       3
+
+// ==================== DATA STRUCTURES ====================
+
+enum PairRowState : uint8_t {
+  PAIR_ROW_REJECTED,        // Invalid row / refused by the gateway - never sent
+  PAIR_ROW_QUEUED,          // Waiting for an in-flight slot
+  PAIR_ROW_SENT,            // PAIR sent, waiting for PAIR_ACK
+  PAIR_ROW_PAIRED,          // PAIR_ACK received
+  PAIR_ROW_FAILED           // No PAIR_ACK after PAIR_MAX_ATTEMPTS
+};
+
+/**
+ * One CSV row
+ */
+struct PairRow {
+  FixedString<NODE_ID_MAX> deviceId;
+  FixedString<TABLE_ID_MAX> tableLeft;
+  FixedString<TABLE_ID_MAX> tableRight;
+  uint16_t line;                    // CSV line number (1-based)
+  PairRowState state;
+  uint8_t attempts;                 // PAIR frames sent
+  const char* reason;               // REJECTED / FAILED: why (static string)
+  unsigned long sentAtMs;           // Last PAIR frame
+  unsigned long doneAtMs;           // PAIRED / FAILED
+};
+
+/**
+ * Batch progress (GET /api/device/pair/bulk, WebSocket)
+ */
+struct PairBatchStats {
+  uint16_t batchId;                 // 0 = none since boot
+  bool active;
+  uint8_t rows;
+  uint8_t queued;
+  uint8_t sent;                     // In flight
+  uint8_t paired;
+  uint8_t failed;
+  uint8_t rejected;
+  uint32_t frames;                  // PAIR frames sent, retries included
+  unsigned long elapsedMs;          // Start -> now, or -> last device done
+};
+
+/**
+ * Sends one PAIR frame (returns false if it could not be queued)
+ */
+typedef bool (*PairSendFn)(const char* deviceId, const char* tableLeft, const char* tableRight);
+
+/**
+ * Batch progress changed / batch finished
+ */
+typedef void (*PairNotifyFn)();
+
+// ==================== BATCH FUNCTIONS ====================
+
+/**
+ * Set the callbacks (call once in setup)
+ */
+void pairBatchInit(PairSendFn send, PairNotifyFn progress, PairNotifyFn done);
+
+/**
+ * Parse and check a CSV upload
+ *
+ * @param rows Output, one entry per data row (QUEUED or REJECTED)
+ * @return Number of rows written (rows beyond maxRows are counted in truncated)
+ */
+int pairBatchParseCsv(const char* csv, size_t length, PairRow* rows, int maxRows, int* truncated = NULL);
+
+/**
+ * Start a batch with the QUEUED rows (REJECTED rows are kept for the report)
+ *
+ * @return Batch ID, or -1 if a batch is running or no row is QUEUED
+ */
+int pairBatchStart(const PairRow* rows, int count, unsigned long now);
+
+/**
+ * Send due PAIR frames and retries, time out silent devices
+ */
+void pairBatchService(unsigned long now);
+
+/**
+ * PAIR_ACK received
+ *
+ * @return true if the device is in the current (or last) batch
+ */
+bool pairBatchHandleAck(const char* deviceId, unsigned long now);
+
+/**
+ * Batch running?
+ */
+bool pairBatchActive();
+
+/**
+ * Progress and rows of the current (or last) batch
+ *
+ * @param first First row to copy (rows are read in small chunks off the stack)
+ * @return Number of rows copied
+ */
+PairBatchStats pairBatchGetStats(unsigned long now);
+int pairBatchGetRows(PairRow* out, int first, int maxRows);
+const char* pairRowStateName(PairRowState state);
+
+#endif // PAIR_BATCH_H
@@ -0,0 +1,315 @@
+/**
+ * DETECTRA Gateway v2.0 - Polling Schedule Engine Implementation
+ */
+
+#include "poll_schedule.h"
+#include "log.h"
+#include <atomic>
+#include <limits.h>
+
+static ScheduleGroup groups[SCHEDULE_MAX_GROUPS];
+static uint16_t defaultCadenceMinutes = 5;
+
+// Timing wheel (device indices chained per bucket)
+static int8_t bucketHead[SCHEDULE_WHEEL_SLOTS];
+static int8_t nextInBucket[REGISTRY_MAX_DEVICES];
+static uint16_t rounds[REGISTRY_MAX_DEVICES];
+static int8_t bucketOf[REGISTRY_MAX_DEVICES];    // -1 = not in the wheel
+static uint8_t cursor = 0;
+static unsigned long wheelTimeMs = 0;             // Start of the cursor bucket
+
+static uint32_t dueMask = 0;                      // Expired, waiting for the next cycle
+static std::atomic<uint32_t> requestMask(0);      // Manual requests from web / WebSocket
+
+static SemaphoreHandle_t scheduleLock = NULL;
+
+static_assert(REGISTRY_MAX_DEVICES <= 32, "dueMask holds one bit per device");
+
+// ==================== TIMING WHEEL ====================
+
+static void wheelRemove(int i) {
+  int bucket = bucketOf[i];
+  if (bucket < 0) return;
+
+  int8_t* link = &bucketHead[bucket];
+  while (*link != -1 && *link != i) link = &nextInBucket[*link];
+  if (*link == i) *link = nextInBucket[i];
+
+  bucketOf[i] = -1;
+}
+
+static void wheelInsert(int i, unsigned long dueMs) {
+  wheelRemove(i);
+
+  long delta = (long)(dueMs - wheelTimeMs);
+  unsigned long ticks = (delta > 0) ? (unsigned long)delta / SCHEDULE_TICK_MS : 0;
+
+  int bucket = (cursor + ticks) % SCHEDULE_WHEEL_SLOTS;
+  rounds[i] = ticks / SCHEDULE_WHEEL_SLOTS;
+  nextInBucket[i] = bucketHead[bucket];
+  bucketHead[bucket] = i;
+  bucketOf[i] = bucket;
+}
+
+static void wheelAdvance(unsigned long now) {
+  while ((long)(now - (wheelTimeMs + SCHEDULE_TICK_MS)) >= 0) {
+    int8_t* link = &bucketHead[cursor];
+    while (*link != -1) {
+      int i = *link;
+      if (rounds[i] == 0) {
+        *link = nextInBucket[i];
+        bucketOf[i] = -1;
+        dueMask |= (1UL << i);
+      } else {
+        rounds[i]--;
+        link = &nextInBucket[i];
+      }
+    }
+
+    cursor = (cursor + 1) % SCHEDULE_WHEEL_SLOTS;
+    wheelTimeMs += SCHEDULE_TICK_MS;
+  }
+}
+
+static void wheelClear() {
+  memset(bucketHead, -1, sizeof(bucketHead));
+  memset(bucketOf, -1, sizeof(bucketOf));
+}
+
+// ==================== CADENCE ====================
+
+uint32_t scheduleBaseCadenceMs(const DeviceInfo& device) {
+  uint16_t minutes = defaultCadenceMinutes;
+
+  const ScheduleGroup* group = scheduleGetGroup(device.scheduleGroup);
+  if (group != NULL) minutes = group->cadenceMinutes;
+  if (device.cadenceMinutes > 0) minutes = device.cadenceMinutes;
+
+  return minutes * 60UL * 1000UL;
+}
+
+uint32_t scheduleCadenceMs(const DeviceInfo& device) {
+  uint8_t stretch = (device.cadenceStretch > 0) ? device.cadenceStretch : 1;
+  return scheduleBaseCadenceMs(device) * stretch;
+}
+
+uint32_t scheduleMinGapMs(const DeviceInfo& device) {
+  uint32_t cadence = scheduleCadenceMs(device);
+  uint32_t earliest = cadence - cadence / 100 * SCHEDULE_JITTER_PCT;
+  return (earliest > SCHEDULE_MERGE_MS) ? earliest - SCHEDULE_MERGE_MS : 0;
+}
+
+static unsigned long jitteredDue(const DeviceInfo& device, unsigned long now) {
+  uint32_t cadence = scheduleCadenceMs(device);
+  uint32_t jitter = cadence / 100 * SCHEDULE_JITTER_PCT;
+  return now + cadence - jitter + random(2 * jitter + 1);
+}
+
+// ==================== SCHEDULING ====================
+
+void scheduleInit(Preferences& prefs, DeviceInfo* devices, int numDevices,
+                  uint16_t defaultMinutes, bool dueNow) {
+  scheduleLock = xSemaphoreCreateMutex();
+  defaultCadenceMinutes = defaultMinutes;
+
+  prefs.begin(REGISTRY_NAMESPACE, true);
+  if (prefs.getBytesLength(SCHEDULE_NVS_KEY) == sizeof(groups)) {
+    prefs.getBytes(SCHEDULE_NVS_KEY, groups, sizeof(groups));
+  }
+  prefs.end();
+
+  unsigned long now = millis();
+  wheelClear();
+  cursor = 0;
+  wheelTimeMs = now;
+
+  for (int i = 0; i < numDevices; i++) {
+    devices[i].nextPollMs = dueNow ? now : jitteredDue(devices[i], now);
+    wheelInsert(i, devices[i].nextPollMs);
+  }
+
+  int groupCount = 0;
+  for (int g = 0; g < SCHEDULE_MAX_GROUPS; g++) {
+    if (groups[g].name[0] != '\0') groupCount++;
+  }
+  LOG_I("SCHEDULE", "%d devices scheduled (default %u min, %d groups)%s", numDevices,
+        defaultCadenceMinutes, groupCount, dueNow ? " - first cycle due now" : "");
+}
+
+void scheduleRebuild(DeviceInfo* devices, int numDevices) {
+  xSemaphoreTake(scheduleLock, portMAX_DELAY);
+
+  wheelClear();
+  dueMask = 0;
+  requestMask.store(0);
+
+  unsigned long now = millis();
+  for (int i = 0; i < numDevices; i++) {
+    if (devices[i].nextPollMs == 0) devices[i].nextPollMs = jitteredDue(devices[i], now);
+    wheelInsert(i, devices[i].nextPollMs);
+  }
+
+  xSemaphoreGive(scheduleLock);
+}
+
+void scheduleCompleted(DeviceInfo* devices, int deviceIndex, unsigned long now) {
+  xSemaphoreTake(scheduleLock, portMAX_DELAY);
+
+  DeviceInfo& device = devices[deviceIndex];
+  device.nextPollMs = jitteredDue(device, now);
+  wheelInsert(deviceIndex, device.nextPollMs);
+
+  xSemaphoreGive(scheduleLock);
+}
+
+void scheduleCadenceChanged(DeviceInfo* devices, int deviceIndex, unsigned long now) {
+  xSemaphoreTake(scheduleLock, portMAX_DELAY);
+
+  DeviceInfo& device = devices[deviceIndex];
+  unsigned long sooner = now + scheduleCadenceMs(device);
+  if (bucketOf[deviceIndex] >= 0 && (long)(sooner - device.nextPollMs) < 0) {
+    device.nextPollMs = sooner;
+    wheelInsert(deviceIndex, sooner);
+  }
+
+  xSemaphoreGive(scheduleLock);
+}
+
+void scheduleRequest(int deviceIndex) {
+  requestMask.fetch_or(deviceIndex < 0 ? 0xFFFFFFFFUL : (1UL << deviceIndex));
+}
+
+bool schedulePending(unsigned long now) {
+  xSemaphoreTake(scheduleLock, portMAX_DELAY);
+
+  wheelAdvance(now);
+  bool pending = (dueMask | requestMask.load()) != 0;
+
+  xSemaphoreGive(scheduleLock);
+  return pending;
+}
+
+unsigned long scheduleIdleMs(const DeviceInfo* devices, int numDevices, unsigned long now) {
+  xSemaphoreTake(scheduleLock, portMAX_DELAY);
+
+  wheelAdvance(now);
+  unsigned long idle = ULONG_MAX;
+  if ((dueMask | requestMask.load()) != 0) idle = 0;
+
+  for (int i = 0; i < numDevices && idle > 0; i++) {
+    long untilDue = (long)(devices[i].nextPollMs - now);
+    if (untilDue <= 0) idle = 0;
+    else if ((unsigned long)untilDue < idle) idle = untilDue;
+  }
+
+  xSemaphoreGive(scheduleLock);
+  return idle;
+}
+
+int scheduleCollect(DeviceInfo* devices, int numDevices, unsigned long now, int* order) {
+  xSemaphoreTake(scheduleLock, portMAX_DELAY);
+
+  wheelAdvance(now);
+  dueMask |= requestMask.exchange(0);
+
+  uint32_t fleetMask = (numDevices >= 32) ? 0xFFFFFFFFUL : ((1UL << numDevices) - 1);
+  dueMask &= fleetMask;
+
+  int count = 0;
+  if (dueMask != 0) {
+    // Merge: anything due within the window rides along with this cycle
+    for (int i = 0; i < numDevices; i++) {
+      bool due = (dueMask & (1UL << i)) != 0;
+      bool soon = (long)(devices[i].nextPollMs - now) <= (long)SCHEDULE_MERGE_MS;
+      if (!due && !soon) continue;
+
+      wheelRemove(i);
+      order[count++] = i;
+    }
+    dueMask = 0;
+  }
+
+  xSemaphoreGive(scheduleLock);
+  return count;
+}
+
+int scheduleUpcoming(const DeviceInfo* devices, int numDevices, unsigned long now,
+                     ScheduleEntry* out, int maxEntries) {
+  int count = 0;
+
+  for (int i = 0; i < numDevices && count < maxEntries; i++) {
+    ScheduleEntry entry = { i, (long)(devices[i].nextPollMs - now), scheduleCadenceMs(devices[i]) };
+
+    // Insertion sort by due time (fleet is small)
+    int pos = count++;
+    while (pos > 0 && out[pos - 1].dueInMs > entry.dueInMs) {
+      out[pos] = out[pos - 1];
+      pos--;
+    }
+    out[pos] = entry;
+  }
+
+  return count;
+}
+
+// ==================== GROUPS ====================
+
+static void saveGroups(Preferences& prefs) {
+  prefs.begin(REGISTRY_NAMESPACE, false);
+  prefs.putBytes(SCHEDULE_NVS_KEY, groups, sizeof(groups));
+  prefs.end();
+}
+
+int scheduleFindGroup(const char* name) {
+  for (int g = 0; g < SCHEDULE_MAX_GROUPS; g++) {
+    if (groups[g].name[0] != '\0' && strcmp(groups[g].name, name) == 0) return g + 1;
+  }
+  return -1;
+}
+
+const ScheduleGroup* scheduleGetGroup(uint8_t groupId) {
+  if (groupId == 0 || groupId > SCHEDULE_MAX_GROUPS) return NULL;
+  const ScheduleGroup* group = &groups[groupId - 1];
+  return (group->name[0] != '\0') ? group : NULL;
+}
+
+int scheduleSetGroup(Preferences& prefs, const char* name, uint16_t cadenceMinutes) {
+  size_t length = strlen(name);
+  if (length == 0 || length > SCHEDULE_GROUP_NAME_MAX || cadenceMinutes > SCHEDULE_MAX_CADENCE_MIN) {
+    return -1;
+  }
+
+  int id = scheduleFindGroup(name);
+
+  if (cadenceMinutes == 0) {
+    // Delete - member devices fall back to the default cadence
+    if (id > 0) {
+      memset(&groups[id - 1], 0, sizeof(ScheduleGroup));
+      saveGroups(prefs);
+      LOG_I("SCHEDULE", "Group %s removed", name);
+    }
+    return 0;
+  }
+
+  if (id < 0) {
+    for (int g = 0; g < SCHEDULE_MAX_GROUPS && id < 0; g++) {
+      if (groups[g].name[0] == '\0') id = g + 1;
+    }
+    if (id < 0) return -1;
+    memcpy(groups[id - 1].name, name, length + 1);
+  }
+
+  groups[id - 1].cadenceMinutes = cadenceMinutes;
+  saveGroups(prefs);
+
+  LOG_I("SCHEDULE", "Group %s: every %u min", name, cadenceMinutes);
+  return id;
+}
+
+void scheduleSetDefaultCadence(uint16_t minutes) {
+  defaultCadenceMinutes = minutes;
+}
+
+uint16_t scheduleGetDefaultCadence() {
+  return defaultCadenceMinutes;
+}
@@ -0,0 +1,173 @@
+/**
+ * DETECTRA Gateway v2.0 - Polling Schedule Engine
+ *
+ * Single source of polling work. Every device has its own due time
+ * (DeviceInfo::nextPollMs) derived from a cadence:
+ *
+ *   per-device override  >  table group cadence  >  gateway default
+ *
+ * e.g. busy lab tables in a "lab" group every 5 minutes, storage rooms in
+ * a "storage" group hourly, everything else on poll_interval.
+ *
+ * Due times are indexed by a hashed timing wheel (SCHEDULE_WHEEL_SLOTS
+ * buckets of SCHEDULE_TICK_MS; longer delays wrap with a round counter),
+ * so finding due devices never scans the fleet.
+ *
+ * When a device comes due, every device due within SCHEDULE_MERGE_MS is
+ * pulled into the same cycle: one census broadcast and one radio session
+ * instead of several back-to-back cycles. Devices that are not due are
+ * not polled at all.
+ *
+ * Each reschedule adds ±SCHEDULE_JITTER_PCT of the cadence so devices
+ * (and neighbouring gateways) drift apart instead of lining up.
+ *
+ * Usage (pollingTask):
+ *   int n = scheduleCollect(devices, config.numDevices, millis(), pollOrder);
+ *   if (n > 0) startPollingCycle(n);
+ *   ...
+ *   scheduleCompleted(devices, deviceIndex, millis());   // after each device
+ */
+
+#ifndef POLL_SCHEDULE_H
+#define POLL_SCHEDULE_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "lora_protocol.h"
+#include "device_registry.h"
+
+// ==================== CONSTANTS ====================
+
+#define SCHEDULE_TICK_MS          5000      // Wheel resolution
+#define SCHEDULE_WHEEL_SLOTS      64        // One revolution = 64 x 5 s = 5m20s
+#define SCHEDULE_MERGE_MS         60000     // Devices due this soon join the current cycle
+#define SCHEDULE_JITTER_PCT       10        // Next poll = cadence ± 10 %
+#define SCHEDULE_MAX_GROUPS       8
+#define SCHEDULE_GROUP_NAME_MAX   15
+#define SCHEDULE_MAX_CADENCE_MIN  1440      // 24 hours
+#define SCHEDULE_NVS_KEY          "sched_groups"
+
+// ==================== DATA STRUCTURES ====================
+
+/**
+ * Named cadence shared by a set of tables (group id = index + 1)
+ */
+struct ScheduleGroup {
+  char name[SCHEDULE_GROUP_NAME_MAX + 1];   // Empty = unused
+  uint16_t cadenceMinutes;
+};
+
+/**
+ * One row of upcoming work (GET /api/schedule)
+ */
+struct ScheduleEntry {
+  int deviceIndex;
+  long dueInMs;                             // Negative = overdue / in the current cycle
+  uint32_t cadenceMs;
+};
+
+// ==================== SCHEDULE FUNCTIONS ====================
+
+/**
+ * Load groups from NVS and schedule every device
+ *
+ * @param defaultCadenceMinutes Gateway default (poll_interval)
+ * @param dueNow true = all devices due immediately (first cycle at boot)
+ */
+void scheduleInit(Preferences& prefs, DeviceInfo* devices, int numDevices,
+                  uint16_t defaultCadenceMinutes, bool dueNow);
+
+/**
+ * Re-index the wheel after devices[] was reordered (pair / remove)
+ */
+void scheduleRebuild(DeviceInfo* devices, int numDevices);
+
+/**
+ * Schedule one device one cadence (± jitter) after now
+ */
+void scheduleCompleted(DeviceInfo* devices, int deviceIndex, unsigned long now);
+
+/**
+ * Apply a cadence / group change: the device keeps its due time unless the
+ * new cadence brings it forward
+ */
+void scheduleCadenceChanged(DeviceInfo* devices, int deviceIndex, unsigned long now);
+
+/**
+ * Ask for devices to be polled as soon as the radio is free (safe from any task)
+ *
+ * @param deviceIndex Device, or -1 for all devices
+ */
+void scheduleRequest(int deviceIndex);
+
+/**
+ * Is any device due (or requested)? Advances the wheel, collects nothing.
+ */
+bool schedulePending(unsigned long now);
+
+/**
+ * Time until the next device comes due (radio time free for bulk transfers)
+ *
+ * @return 0 if a device is due or requested, ULONG_MAX without devices
+ */
+unsigned long scheduleIdleMs(const DeviceInfo* devices, int numDevices, unsigned long now);
+
+/**
+ * Collect the next cycle: due devices plus devices due within SCHEDULE_MERGE_MS
+ *
+ * @param order Output devices[] indices (registry order)
+ * @return Number of devices in the cycle (0 = nothing due)
+ */
+int scheduleCollect(DeviceInfo* devices, int numDevices, unsigned long now, int* order);
+
+/**
+ * Upcoming work sorted by due time
+ *
+ * @return Number of entries written
+ */
+int scheduleUpcoming(const DeviceInfo* devices, int numDevices, unsigned long now,
+                     ScheduleEntry* out, int maxEntries);
+
+/**
+ * Effective cadence for a device (override > group > default, times the
+ * energy plan's cadenceStretch)
+ */
+uint32_t scheduleCadenceMs(const DeviceInfo& device);
+
+/**
+ * Cadence without the energy plan's stretch
+ */
+uint32_t scheduleBaseCadenceMs(const DeviceInfo& device);
+
+/**
+ * Shortest time from completion to the next scheduled poll (earliest jitter,
+ * pulled forward by a merge) - manual requests excepted
+ */
+uint32_t scheduleMinGapMs(const DeviceInfo& device);
+
+// ==================== GROUPS ====================
+
+/**
+ * Create or update a group (cadenceMinutes 0 deletes it)
+ *
+ * @return Group id (1..SCHEDULE_MAX_GROUPS), 0 if deleted, -1 if invalid / table full
+ */
+int scheduleSetGroup(Preferences& prefs, const char* name, uint16_t cadenceMinutes);
+
+/**
+ * Group id by name (-1 if not found)
+ */
+int scheduleFindGroup(const char* name);
+
+/**
+ * Group by id (NULL if id is 0 or unused)
+ */
+const ScheduleGroup* scheduleGetGroup(uint8_t groupId);
+
+/**
+ * Gateway default cadence (poll_interval)
+ */
+void scheduleSetDefaultCadence(uint16_t minutes);
+uint16_t scheduleGetDefaultCadence();
+
+#endif // POLL_SCHEDULE_H
@@ -0,0 +1,240 @@
+/**
+ * DETECTRA Gateway v2.0 - Radio Trace Capture Implementation
+ */
+
+#include "radio_trace.h"
+#include "log.h"
+#include <FS.h>
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+
+static uint8_t* ring = NULL;
+static size_t capacity = 0;
+static size_t tail = 0;             // Offset of the oldest record
+static size_t used = 0;             // Bytes held
+static TraceStats stats = {};
+static SemaphoreHandle_t traceLock = NULL;
+
+static char gatewayId[TRACE_GATEWAY_ID_BYTES] = {};
+static uint8_t exportHeader[TRACE_HEADER_BYTES];
+static size_t exportBytes = 0;
+
+// ==================== HELPERS ====================
+
+static void ringWrite(size_t offset, const uint8_t* data, size_t length) {
+  offset %= capacity;
+  size_t first = (length < capacity - offset) ? length : capacity - offset;
+  memcpy(ring + offset, data, first);
+  memcpy(ring, data + first, length - first);
+}
+
+static void ringRead(size_t offset, uint8_t* data, size_t length) {
+  offset %= capacity;
+  size_t first = (length < capacity - offset) ? length : capacity - offset;
+  memcpy(data, ring + offset, first);
+  memcpy(data + first, ring, length - first);
+}
+
+static void putU32(uint8_t* p, uint32_t v) {
+  p[0] = v;
+  p[1] = v >> 8;
+  p[2] = v >> 16;
+  p[3] = v >> 24;
+}
+
+/**
+ * Size of the record at a ring offset
+ */
+static size_t recordSize(size_t offset) {
+  size_t length = 0;
+  size_t bytes = 7;                 // flags + timestamp
+  for (int shift = 0; shift < 14; shift += 7) {
+    uint8_t b = ring[(offset + bytes++) % capacity];
+    length |= (size_t)(b & 0x7F) << shift;
+    if (!(b & 0x80)) break;
+  }
+  return bytes + length;
+}
+
+/**
+ * Make room for a record, dropping the oldest ones (caller holds the lock)
+ */
+static void reserve(size_t bytes) {
+  while (capacity - used < bytes && stats.records > 0) {
+    size_t size = recordSize(tail);
+    tail = (tail + size) % capacity;
+    used -= size;
+    stats.records--;
+    stats.dropped++;
+  }
+}
+
+// ==================== CAPTURE FUNCTIONS ====================
+
+bool traceInit() {
+  capacity = TRACE_RING_BYTES;
+  ring = (uint8_t*)heap_caps_malloc(capacity, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  if (ring == NULL) {
+    capacity = TRACE_RING_BYTES_INTERNAL;
+    ring = (uint8_t*)heap_caps_malloc(capacity, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  }
+  if (ring == NULL) capacity = 0;
+
+  traceLock = xSemaphoreCreateMutex();
+  stats.enabled = ring != NULL;
+  stats.capacity = capacity;
+
+  LOG_I("TRACE", "Radio trace: %u KB ring", (unsigned)(capacity / 1024));
+  return ring != NULL;
+}
+
+void traceSetGatewayId(const char* id) {
+  strncpy(gatewayId, id, sizeof(gatewayId));
+}
+
+void traceSetEnabled(bool enabled) {
+  stats.enabled = enabled && ring != NULL;
+}
+
+void traceRecord(uint8_t radio, TraceDirection direction, const char* line, size_t length) {
+  if (!stats.enabled) return;
+
+  while (length > 0 && (line[length - 1] == '\r' || line[length - 1] == '\n')) length--;
+  if (length > TRACE_LINE_MAX) length = TRACE_LINE_MAX;
+
+  // flags, 48-bit timestamp, LEB128 length
+  uint8_t header[9];
+  uint64_t us = (uint64_t)esp_timer_get_time();
+  size_t headerBytes = 0;
+  header[headerBytes++] = (radio << TRACE_RADIO_SHIFT) | (direction == TRACE_TX ? TRACE_FLAG_TX : 0);
+  for (int i = 0; i < 6; i++) header[headerBytes++] = us >> (8 * i);
+  size_t v = length;
+  do {
+    header[headerBytes++] = (v & 0x7F) | (v > 0x7F ? 0x80 : 0);
+    v >>= 7;
+  } while (v > 0);
+
+  xSemaphoreTake(traceLock, portMAX_DELAY);
+
+  if (stats.frozen) {
+    stats.missed++;                 // Export reads the ring without the lock
+  } else {
+    reserve(headerBytes + length);
+    size_t head = (tail + used) % capacity;
+    ringWrite(head, header, headerBytes);
+    ringWrite(head + headerBytes, (const uint8_t*)line, length);
+    used += headerBytes + length;
+    stats.records++;
+    stats.recorded++;
+  }
+
+  xSemaphoreGive(traceLock);
+}
+
+void traceClear() {
+  if (traceLock == NULL) return;
+
+  xSemaphoreTake(traceLock, portMAX_DELAY);
+  if (!stats.frozen) {
+    tail = 0;
+    used = 0;
+    stats.records = 0;
+  }
+  xSemaphoreGive(traceLock);
+}
+
+TraceStats traceGetStats() {
+  TraceStats snapshot = stats;
+  snapshot.used = used;
+  return snapshot;
+}
+
+// ==================== EXPORT FUNCTIONS ====================
+
+size_t traceFreeze() {
+  if (ring == NULL) return 0;
+
+  xSemaphoreTake(traceLock, portMAX_DELAY);
+
+  if (stats.frozen) {
+    xSemaphoreGive(traceLock);
+    return 0;
+  }
+  stats.frozen = true;
+
+  memset(exportHeader, 0, sizeof(exportHeader));
+  memcpy(exportHeader, TRACE_MAGIC, 4);
+  exportHeader[4] = TRACE_FORMAT_VERSION;
+  putU32(exportHeader + 8, stats.records);
+  putU32(exportHeader + 12, stats.dropped);
+  memcpy(exportHeader + 16, gatewayId, TRACE_GATEWAY_ID_BYTES);
+  exportBytes = TRACE_HEADER_BYTES + used;
+
+  xSemaphoreGive(traceLock);
+  return exportBytes;
+}
+
+size_t traceRead(size_t offset, uint8_t* buffer, size_t maxLength) {
+  if (!stats.frozen || offset >= exportBytes) return 0;
+
+  size_t copied = 0;
+  if (offset < TRACE_HEADER_BYTES) {
+    copied = TRACE_HEADER_BYTES - offset;
+    if (copied > maxLength) copied = maxLength;
+    memcpy(buffer, exportHeader + offset, copied);
+    offset += copied;
+  }
+
+  size_t records = exportBytes - offset;
+  if (records > maxLength - copied) records = maxLength - copied;
+  ringRead(tail + offset - TRACE_HEADER_BYTES, buffer + copied, records);
+  return copied + records;
+}
+
+void traceThaw() {
+  xSemaphoreTake(traceLock, portMAX_DELAY);
+  stats.frozen = false;
+  xSemaphoreGive(traceLock);
+}
+
+bool traceExport(TraceWriteFn write, void* context) {
+  size_t total = traceFreeze();
+  if (total == 0) return false;
+
+  uint8_t chunk[512];
+  size_t offset = 0;
+  bool ok = true;
+
+  while (ok && offset < total) {
+    size_t length = traceRead(offset, chunk, sizeof(chunk));
+    ok = write(chunk, length, context);
+    offset += length;
+  }
+
+  traceThaw();
+  return ok;
+}
+
+static bool writeFile(const uint8_t* data, size_t length, void* context) {
+  return ((File*)context)->write(data, length) == length;
+}
+
+bool traceFlush(fs::FS& fs, const char* path) {
+  File file = fs.open(path, FILE_WRITE);
+  if (!file) {
+    LOG_E("TRACE", "Cannot open %s", path);
+    return false;
+  }
+
+  unsigned long start = millis();
+  bool ok = traceExport(writeFile, &file);
+  size_t bytes = file.size();
+  file.close();
+
+  if (ok) {
+    LOG_I("TRACE", "Wrote %s (%u bytes, %lums)", path, (unsigned)bytes, millis() - start);
+  } else {
+    LOG_E("TRACE", "Writing %s failed", path);
+  }
+  return ok;
+}
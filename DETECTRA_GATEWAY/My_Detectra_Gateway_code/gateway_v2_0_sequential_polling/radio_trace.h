@@ -0,0 +1,159 @@
+/**
+ * DETECTRA Gateway v2.0 - Radio Trace Capture
+ *
+ * Records every UART line exchanged with the RAK3172 modules (RX lines as
+ * received, TX commands as written) with a microsecond timestamp and the
+ * radio number, so a misbehaving cycle can be taken off the gateway and
+ * replayed on a PC (tools/trace_replay).
+ *
+ * - One byte ring, allocated once (PSRAM when available, a smaller one in
+ *   internal RAM otherwise). When full, the oldest records are dropped.
+ * - Recording takes a short mutex and copies the line; it never waits on
+ *   an export.
+ * - Exports freeze the ring: records arriving meanwhile are counted as
+ *   missed instead of blocking the radio tasks.
+ *
+ * Trace file format (".trc", little-endian):
+ *
+ *   Header (32 bytes)
+ *     char[4]   "DTRC"
+ *     uint8     version (TRACE_FORMAT_VERSION)
+ *     uint8[3]  reserved (0)
+ *     uint32    records in the file
+ *     uint32    records dropped before the first one (ring overwrites)
+ *     char[16]  gateway ID, '\0'-padded
+ *
+ *   Record
+ *     uint8     flags: bit 0 = TX, bits 4-7 = radio (1, 2)
+ *     uint8[6]  timestamp, microseconds since boot (48 bit)
+ *     varint    line length (LEB128, 1-2 bytes)
+ *     char[]    line without "\r\n"
+ *
+ * Usage:
+ *   traceInit();                                  // setup, before the radio
+ *   traceRecord(1, TRACE_RX, line, length);       // loraTask
+ *   traceFlush(FFat, "/radio.trc");               // on demand
+ */
+
+#ifndef RADIO_TRACE_H
+#define RADIO_TRACE_H
+
+#include <Arduino.h>
+
+namespace fs { class FS; }
+
+// ==================== CONFIGURATION ====================
+
+#define TRACE_RING_BYTES          (256UL * 1024)    // PSRAM ring (~2000 polled frames)
+#define TRACE_RING_BYTES_INTERNAL (16UL * 1024)     // Fallback without PSRAM
+#define TRACE_LINE_MAX            1024              // Longer lines are cut
+
+// ==================== FILE FORMAT ====================
+
+#define TRACE_MAGIC               "DTRC"
+#define TRACE_FORMAT_VERSION      1
+#define TRACE_HEADER_BYTES        32
+#define TRACE_GATEWAY_ID_BYTES    16
+#define TRACE_RECORD_MIN_BYTES    8                 // flags + timestamp + 1-byte length
+
+#define TRACE_FLAG_TX             0x01
+#define TRACE_RADIO_SHIFT         4
+
+enum TraceDirection : uint8_t {
+  TRACE_RX,                 // Line read from the module
+  TRACE_TX                  // Command written to the module
+};
+
+// ==================== DATA STRUCTURES ====================
+
+/**
+ * Trace counters (for status reports)
+ */
+struct TraceStats {
+  bool enabled;
+  bool frozen;                      // Export in progress
+  uint32_t capacity;                // Ring size (bytes, 0 = not allocated)
+  uint32_t used;                    // Bytes held
+  uint32_t records;                 // Records held
+  uint32_t recorded;                // Records written since boot
+  uint32_t dropped;                 // Oldest records overwritten
+  uint32_t missed;                  // Records not taken while an export ran
+};
+
+/**
+ * Export sink (returns false to abort)
+ */
+typedef bool (*TraceWriteFn)(const uint8_t* data, size_t length, void* context);
+
+// ==================== CAPTURE FUNCTIONS ====================
+
+/**
+ * Allocate the ring (call once in setup, before the radio is configured)
+ */
+bool traceInit();
+
+/**
+ * Gateway ID written into exported headers
+ */
+void traceSetGatewayId(const char* gatewayId);
+
+/**
+ * Pause / resume recording (the ring is kept)
+ */
+void traceSetEnabled(bool enabled);
+
+/**
+ * Record one line (any task)
+ *
+ * @param radio Module number (1, 2)
+ * @param line Line without "\r\n" (trailing CR/LF are stripped)
+ */
+void traceRecord(uint8_t radio, TraceDirection direction, const char* line, size_t length);
+
+/**
+ * Drop every record (counters are kept)
+ */
+void traceClear();
+
+/**
+ * Current counters
+ */
+TraceStats traceGetStats();
+
+// ==================== EXPORT FUNCTIONS ====================
+
+/**
+ * Freeze the ring for an export
+ *
+ * @return Size of the export in bytes (header + records), 0 if another export runs
+ */
+size_t traceFreeze();
+
+/**
+ * Copy part of the frozen export (e.g. from a chunked HTTP response)
+ *
+ * @param offset Byte offset in the export
+ * @return Bytes copied (0 at the end, or if not frozen)
+ */
+size_t traceRead(size_t offset, uint8_t* buffer, size_t maxLength);
+
+/**
+ * End the export and resume recording
+ */
+void traceThaw();
+
+/**
+ * Write the whole trace to a sink (freezes and thaws itself)
+ *
+ * @return false if another export runs or the sink failed
+ */
+bool traceExport(TraceWriteFn write, void* context);
+
+/**
+ * Write the whole trace to a file (e.g. FFat "/radio.trc")
+ *
+ * @return false if the file cannot be written
+ */
+bool traceFlush(fs::FS& fs, const char* path);
+
+#endif // RADIO_TRACE_H
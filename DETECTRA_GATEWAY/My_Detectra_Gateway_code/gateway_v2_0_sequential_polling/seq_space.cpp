@@ -0,0 +1,312 @@
+/**
+ * DETECTRA Gateway v2.0 - Sequence Spaces & Replay Windows Implementation
+ */
+
+#include "seq_space.h"
+#include "log.h"
+
+#define SEQ_WINDOW_MASK   (~0ULL >> (64 - SEQ_WINDOW))
+
+struct SeqPeer {
+  FixedString<NODE_ID_MAX> peerId;  // Empty = free slot
+  unsigned long lastUsedMs;
+  uint32_t txNext;
+  uint32_t txReserved;              // Sequences below are reserved...
+  uint32_t txSaved;                 // ...and below this one also written to NVS
+  uint32_t rxHighest;
+  uint64_t rxBits;
+  uint32_t rxSaved;
+  uint32_t accepted;
+  uint32_t duplicates;
+  uint32_t stale;
+  uint32_t legacy;
+  uint32_t reseeds;
+};
+
+/**
+ * Stored per peer (NVS blob = array of these)
+ */
+struct __attribute__((packed)) SeqRecord {
+  char peerId[NODE_ID_MAX + 1];
+  uint32_t txReserved;
+  uint32_t rxHighest;
+};
+
+static SeqPeer peers[SEQ_MAX_PEERS];
+static SeqRecord records[SEQ_MAX_PEERS];    // Encode buffer (loop only)
+static SeqStats stats = {};
+static volatile bool dirty = false;
+static SeqKnownFn isKnown = NULL;
+static SemaphoreHandle_t seqLock = NULL;
+
+static const char* const VERDICT_NAMES[] = { "accept", "legacy", "duplicate", "stale" };
+
+// ==================== PEERS ====================
+
+static SeqPeer* findPeer(const char* peerId) {
+  for (int i = 0; i < SEQ_MAX_PEERS; i++) {
+    if (!peers[i].peerId.isEmpty() && peers[i].peerId == peerId) return &peers[i];
+  }
+  return NULL;
+}
+
+static bool isEvictable(const SeqPeer& peer) {
+  if (peer.peerId == BROADCAST_ID) return false;
+  return isKnown == NULL || !isKnown(peer.peerId.c_str());
+}
+
+/**
+ * Entry of a peer, created if new (NULL: table full of registered devices)
+ */
+static SeqPeer* findOrCreatePeer(const char* peerId, unsigned long now) {
+  SeqPeer* peer = findPeer(peerId);
+  if (peer != NULL) return peer;
+
+  // Free slot, else the unregistered peer (a removed device) not used for longest
+  int slot = -1;
+  for (int i = 0; i < SEQ_MAX_PEERS; i++) {
+    if (peers[i].peerId.isEmpty()) { slot = i; break; }
+    if (!isEvictable(peers[i])) continue;
+    if (slot == -1 || now - peers[i].lastUsedMs > now - peers[slot].lastUsedMs) slot = i;
+  }
+  if (slot == -1) {
+    stats.refused++;
+    return NULL;
+  }
+  if (!peers[slot].peerId.isEmpty()) {
+    stats.evictions++;  // Dropped from NVS with the next write, nothing to write now
+  } else {
+    stats.peers++;
+  }
+
+  peer = &peers[slot];
+  *peer = SeqPeer();
+  peer->peerId = peerId;
+  peer->txNext = SEQ_FIRST;
+  return peer;
+}
+
+// ==================== SEQUENCE FUNCTIONS ====================
+
+void seqLoad(Preferences& prefs, SeqKnownFn known) {
+  isKnown = known;
+  seqLock = xSemaphoreCreateMutex();
+
+  prefs.begin(REGISTRY_NAMESPACE, true);  // Read-only
+  size_t length = prefs.getBytesLength(SEQ_NVS_KEY);
+  int count = 0;
+  if (length > 0 && length <= sizeof(records) && length % sizeof(SeqRecord) == 0) {
+    count = prefs.getBytes(SEQ_NVS_KEY, records, length) / sizeof(SeqRecord);
+  }
+  prefs.end();
+
+  unsigned long now = millis();
+  for (int i = 0; i < count; i++) {
+    records[i].peerId[NODE_ID_MAX] = '\0';
+    if (records[i].peerId[0] == '\0') continue;
+
+    // Continue past the last reservation; the RX window restarts at the saved high
+    SeqPeer* peer = findOrCreatePeer(records[i].peerId, now);
+    if (peer == NULL) continue;
+    peer->txNext = records[i].txReserved > SEQ_FIRST ? records[i].txReserved : SEQ_FIRST;
+    peer->txReserved = peer->txSaved = records[i].txReserved;
+    peer->rxHighest = peer->rxSaved = records[i].rxHighest;
+    peer->rxBits = peer->rxHighest != 0 ? SEQ_WINDOW_MASK : 0;
+  }
+  stats.evictions = 0;
+  stats.refused = 0;
+
+  if (count > 0) LOG_I("SEQ", "Restored %d sequence spaces", count);
+}
+
+bool seqService(Preferences& prefs) {
+  if (seqLock == NULL || !dirty) return false;
+
+  xSemaphoreTake(seqLock, portMAX_DELAY);
+  int count = 0;
+  for (int i = 0; i < SEQ_MAX_PEERS; i++) {
+    if (peers[i].peerId.isEmpty()) continue;
+    SeqRecord& record = records[count++];
+    memset(&record, 0, sizeof(record));
+    strncpy(record.peerId, peers[i].peerId.c_str(), NODE_ID_MAX);
+    record.txReserved = peers[i].txReserved;
+    record.rxHighest = peers[i].rxHighest;
+  }
+  dirty = false;  // Changes after this point re-arm the flag
+  xSemaphoreGive(seqLock);
+
+  if (count == 0) return false;
+
+  prefs.begin(REGISTRY_NAMESPACE, false);
+  size_t length = count * sizeof(SeqRecord);
+  size_t written = prefs.putBytes(SEQ_NVS_KEY, records, length);
+  prefs.end();
+
+  if (written != length) {
+    LOG_E("SEQ", "NVS write failed (%u/%u bytes)", (unsigned)written, (unsigned)length);
+    dirty = true;  // Retry on the next loop pass
+    return false;
+  }
+
+  // What is now stored (a peer may have moved on, or been replaced, meanwhile)
+  xSemaphoreTake(seqLock, portMAX_DELAY);
+  for (int i = 0; i < count; i++) {
+    SeqPeer* peer = findPeer(records[i].peerId);
+    if (peer == NULL) continue;
+    peer->txSaved = records[i].txReserved;
+    peer->rxSaved = records[i].rxHighest;
+  }
+  stats.writes++;
+  xSemaphoreGive(seqLock);
+
+  return true;
+}
+
+uint32_t seqNextTx(const char* peerId) {
+  if (seqLock == NULL) return SEQ_FIRST;
+
+  xSemaphoreTake(seqLock, portMAX_DELAY);
+  SeqPeer* entry = findOrCreatePeer(peerId, millis());
+  if (entry == NULL) {
+    xSemaphoreGive(seqLock);
+    LOG_E("SEQ", "No sequence space for %s (table full)", peerId);
+    return SEQ_FIRST;
+  }
+  SeqPeer& peer = *entry;
+  peer.lastUsedMs = millis();
+
+  // Renew at half-way: the write lands long before the reservation runs out
+  if (peer.txNext + SEQ_RESERVE / 2 >= peer.txReserved) {
+    peer.txReserved = peer.txNext + SEQ_RESERVE;
+    dirty = true;
+  }
+  if (peer.txSaved != 0 && peer.txNext >= peer.txSaved) stats.overruns++;
+
+  uint32_t sequence = peer.txNext++;
+  xSemaphoreGive(seqLock);
+
+  return sequence;
+}
+
+uint32_t seqPeekTx(const char* peerId) {
+  if (seqLock == NULL) return SEQ_FIRST;
+
+  xSemaphoreTake(seqLock, portMAX_DELAY);
+  SeqPeer* peer = findPeer(peerId);
+  uint32_t sequence = peer != NULL ? peer->txNext : SEQ_FIRST;
+  xSemaphoreGive(seqLock);
+
+  return sequence;
+}
+
+SeqVerdict seqCheckRx(const char* senderId, uint32_t sequence) {
+  if (seqLock == NULL) return SEQ_LEGACY;
+
+  xSemaphoreTake(seqLock, portMAX_DELAY);
+  SeqPeer* entry = findOrCreatePeer(senderId, millis());
+  if (entry == NULL) {
+    stats.stale++;  // Not registered and no slot left: nothing to check against
+    xSemaphoreGive(seqLock);
+    return SEQ_STALE;
+  }
+  SeqPeer& peer = *entry;
+  peer.lastUsedMs = millis();
+
+  SeqVerdict verdict = SEQ_ACCEPT;
+  uint32_t highest = peer.rxHighest;
+
+  if (sequence < SEQ_FIRST) {
+    // Old 3-digit counter - only until the sender has used its 32-bit space
+    verdict = peer.rxHighest >= SEQ_FIRST ? SEQ_STALE : SEQ_LEGACY;
+  } else if (sequence > peer.rxHighest) {
+    uint32_t shift = sequence - peer.rxHighest;
+    peer.rxBits = shift < SEQ_WINDOW ? ((peer.rxBits << shift) | 1) & SEQ_WINDOW_MASK : 1;
+    peer.rxHighest = sequence;
+  } else if (peer.rxHighest - sequence < SEQ_WINDOW) {
+    uint64_t bit = 1ULL << (peer.rxHighest - sequence);
+    if (peer.rxBits & bit) {
+      verdict = SEQ_DUPLICATE;
+    } else {
+      peer.rxBits |= bit;
+    }
+  } else {
+    verdict = SEQ_STALE;  // Older than the window - only seqReseed() moves it back
+  }
+
+  if (peer.rxHighest >= peer.rxSaved + SEQ_RESERVE) dirty = true;
+
+  switch (verdict) {
+    case SEQ_ACCEPT:    peer.accepted++;   stats.accepted++;   break;
+    case SEQ_LEGACY:    peer.legacy++;     stats.legacy++;     break;
+    case SEQ_DUPLICATE: peer.duplicates++; stats.duplicates++; break;
+    case SEQ_STALE:     peer.stale++;      stats.stale++;      break;
+  }
+  xSemaphoreGive(seqLock);
+
+  if (verdict == SEQ_STALE) {
+    LOG_W("SEQ", "%s: stale sequence %u (highest %u) - dropped", senderId, sequence, highest);
+  } else if (verdict == SEQ_DUPLICATE) {
+    LOG_D("SEQ", "%s: duplicate sequence %u", senderId, sequence);
+  }
+  return verdict;
+}
+
+void seqReseed(const char* peerId, uint32_t sequence) {
+  if (seqLock == NULL) return;
+
+  xSemaphoreTake(seqLock, portMAX_DELAY);
+  SeqPeer* entry = findOrCreatePeer(peerId, millis());
+  if (entry == NULL) {
+    xSemaphoreGive(seqLock);
+    return;
+  }
+  SeqPeer& peer = *entry;
+  peer.lastUsedMs = millis();
+  uint32_t highest = peer.rxHighest;
+  peer.rxHighest = sequence >= SEQ_FIRST ? sequence : 0;
+  peer.rxBits = peer.rxHighest != 0 ? 1 : 0;
+  peer.reseeds++;
+  stats.reseeds++;
+  dirty = true;  // May be below the saved high - store it before a reboot makes it stale again
+  xSemaphoreGive(seqLock);
+
+  LOG_I("SEQ", "%s window re-seeded at %u (was %u)", peerId, sequence, highest);
+}
+
+int seqList(SeqInfo* out, int maxPeers) {
+  if (seqLock == NULL) return 0;
+
+  xSemaphoreTake(seqLock, portMAX_DELAY);
+  int count = 0;
+  for (int i = 0; i < SEQ_MAX_PEERS && count < maxPeers; i++) {
+    const SeqPeer& peer = peers[i];
+    if (peer.peerId.isEmpty()) continue;
+
+    SeqInfo& info = out[count++];
+    info.peerId = peer.peerId;
+    info.txNext = peer.txNext;
+    info.rxHighest = peer.rxHighest;
+    info.accepted = peer.accepted;
+    info.duplicates = peer.duplicates;
+    info.stale = peer.stale;
+    info.legacy = peer.legacy;
+    info.reseeds = peer.reseeds;
+  }
+  xSemaphoreGive(seqLock);
+
+  return count;
+}
+
+SeqStats seqGetStats() {
+  if (seqLock == NULL) return SeqStats();
+
+  xSemaphoreTake(seqLock, portMAX_DELAY);
+  SeqStats copy = stats;
+  xSemaphoreGive(seqLock);
+
+  return copy;
+}
+
+const char* seqVerdictName(SeqVerdict verdict) {
+  return verdict <= SEQ_STALE ? VERDICT_NAMES[verdict] : "unknown";
+}
@@ -0,0 +1,148 @@
+/**
+ * DETECTRA Gateway v2.0 - Sequence Spaces & Replay Windows
+ *
+ * The SEQ field used to be one 3-digit counter for every frame, reset each
+ * cycle: it wrapped after 999 frames and a device could not tell a
+ * retransmission from a new command. Each peer now has its own 32-bit
+ * space in both directions (written as unpadded decimal, see lora_schema.h):
+ *
+ *   TX   seqNextTx(target)      per device ID, plus one for BROADCAST_ID
+ *   RX   seqCheckRx(sender)     highest sequence + SEQ_WINDOW-bit map behind it
+ *
+ *   verdict      when                                    gateway does
+ *   accept       new, or inside the window and unseen    handles the frame
+ *   duplicate    inside the window, already seen         re-sends a DATA ACK only
+ *   stale        older than the window, or below         drops it (replay)
+ *                SEQ_FIRST once the sender went past it
+ *   legacy       below SEQ_FIRST, sender never past it   handles it, unchecked
+ *                (old 3-digit firmware)
+ *
+ * - Persistence: TX counters are saved as reservations of SEQ_RESERVE
+ *   (renewed at half-way, written by seqService() from loop), so after a
+ *   reboot a peer never sees a sequence twice. The RX highest is saved every
+ *   SEQ_RESERVE frames; after a reboot the window restarts there, which
+ *   leaves a gap of at most SEQ_RESERVE sequences a replay could still use.
+ * - Re-seed: a stale frame never moves a window back. A sender that lost
+ *   its counter (storage wiped) is re-seeded only by an explicit event:
+ *   PAIR_ACK while it is being paired, or an operator reset (POST /api/seq/reset).
+ * - Table: every registered device (and BROADCAST_ID) always has its entry.
+ *   A full table only gives up entries of IDs no longer registered; a new
+ *   unregistered ID gets none (its frames are stale).
+ *
+ * Usage:
+ *   seqLoad(preferences, isRegisteredDevice);                 // setup
+ *   frameBegin(f, gatewayId, cmd, target, seqNextTx(target), ts);
+ *   if (seqCheckRx(msg.senderId.c_str(), msg.sequence) == SEQ_STALE) return;
+ *   seqService(preferences);                                  // loop
+ */
+
+#ifndef SEQ_SPACE_H
+#define SEQ_SPACE_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "lora_protocol.h"
+#include "device_registry.h"
+
+// ==================== CONFIGURATION ====================
+
+#define SEQ_MAX_PEERS           (REGISTRY_MAX_DEVICES + 1)  // Devices + BROADCAST_ID (keyed by ID)
+#define SEQ_NVS_KEY             "seq"     // In REGISTRY_NAMESPACE
+
+// ==================== DATA STRUCTURES ====================
+
+enum SeqVerdict : uint8_t {
+  SEQ_ACCEPT,
+  SEQ_LEGACY,                       // Below SEQ_FIRST from a sender never past it: not checked
+  SEQ_DUPLICATE,                    // Seen inside the window (retransmission)
+  SEQ_STALE                         // Older than the window, or below SEQ_FIRST after it (replay)
+};
+
+/**
+ * One peer (GET /api/seq)
+ */
+struct SeqInfo {
+  FixedString<NODE_ID_MAX> peerId;
+  uint32_t txNext;                  // Next sequence sent to the peer
+  uint32_t rxHighest;               // Highest received (0 = none checked yet)
+  uint32_t accepted;
+  uint32_t duplicates;
+  uint32_t stale;
+  uint32_t legacy;
+  uint32_t reseeds;                 // seqReseed() calls (PAIR_ACK, operator reset)
+};
+
+/**
+ * Counters
+ */
+struct SeqStats {
+  uint8_t peers;
+  uint32_t accepted;
+  uint32_t duplicates;
+  uint32_t stale;
+  uint32_t legacy;
+  uint32_t reseeds;
+  uint32_t writes;                  // NVS writes
+  uint32_t overruns;                // TX passed a reservation not yet written
+  uint32_t evictions;               // Unregistered peers dropped for a new one (table full)
+  uint32_t refused;                 // New peers without a slot (table full of registered ones)
+};
+
+/**
+ * Peer ID is a registered device (called with the module lock held)
+ */
+typedef bool (*SeqKnownFn)(const char* peerId);
+
+// ==================== SEQUENCE FUNCTIONS ====================
+
+/**
+ * Restore saved reservations / RX highs and set the registry check (call once in setup)
+ */
+void seqLoad(Preferences& prefs, SeqKnownFn known);
+
+/**
+ * Write reservations / RX highs that changed (from loop)
+ *
+ * @return true if written
+ */
+bool seqService(Preferences& prefs);
+
+/**
+ * Take the next sequence towards a peer (any task)
+ */
+uint32_t seqNextTx(const char* peerId);
+
+/**
+ * Next sequence towards a peer, without taking it (frame length)
+ */
+uint32_t seqPeekTx(const char* peerId);
+
+/**
+ * Check and record a received sequence
+ */
+SeqVerdict seqCheckRx(const char* senderId, uint32_t sequence);
+
+/**
+ * Restart a sender's window at sequence (explicit events only: PAIR_ACK,
+ * operator reset); below SEQ_FIRST forgets it, so its next frame seeds it
+ */
+void seqReseed(const char* peerId, uint32_t sequence);
+
+/**
+ * Known peers, in table order
+ *
+ * @return Number copied
+ */
+int seqList(SeqInfo* out, int maxPeers);
+
+/**
+ * Counters
+ */
+SeqStats seqGetStats();
+
+/**
+ * Label: "accept", "legacy", "duplicate", "stale"
+ */
+const char* seqVerdictName(SeqVerdict verdict);
+
+#endif // SEQ_SPACE_H
@@ -0,0 +1,81 @@
+/**
+ * DETECTRA Gateway v2.0 - Dashboard JSON Builders Implementation
+ */
+
+#include <ArduinoJson.h>
+#include "status_json.h"
+
+String buildDeviceListJSON(const FleetView& view) {
+  StaticJsonDocument<4096> doc;
+  fillDeviceListDocument(view, doc);
+
+  char buffer[4096];
+  serializeJson(doc, buffer);
+  return String(buffer);
+}
+
+void fillDeviceListDocument(const FleetView& view, JsonDocument& doc) {
+  // Add stats section
+  JsonObject stats = doc.createNestedObject("stats");
+  stats["gateway_id"] = view.gatewayId;
+  stats["ip_address"] = view.ipAddress;
+  stats["uptime_ms"] = view.uptimeMs;
+  stats["total_devices"] = view.numDevices;
+
+  // Count online devices
+  int onlineCount = 0;
+  for (int i = 0; i < view.numDevices; i++) {
+    if (view.devices[i].online) onlineCount++;
+  }
+  stats["online_devices"] = onlineCount;
+  stats["total_messages"] = view.totalMessages;
+  stats["truncated_detections"] = view.truncatedDetections;
+  stats["heap_free"] = view.heapFree;
+  stats["heap_min_largest_block"] = view.heapMinLargestBlock;
+  stats["heap_fragmentation_pct"] = view.heapFragmentationPct;
+
+  // Calculate success rate
+  unsigned long totalAttempts = view.successfulPolls + view.failedPolls;
+  float successRate = (totalAttempts > 0) ? (view.successfulPolls * 100.0 / totalAttempts) : 0.0;
+  stats["success_rate"] = successRate;
+
+  // Add devices array
+  JsonArray devicesArray = doc.createNestedArray("devices");
+
+  for (int i = 0; i < view.numDevices; i++) {
+    const DeviceInfo& device = view.devices[i];
+    JsonObject deviceObj = devicesArray.createNestedObject();
+    deviceObj["device_id"] = device.deviceId.c_str();
+    deviceObj["paired"] = device.paired;
+    deviceObj["online"] = device.online;
+    deviceObj["table_left"] = device.tableLeft.c_str();
+    deviceObj["table_right"] = device.tableRight.c_str();
+    deviceObj["battery"] = device.battery;
+    deviceObj["rssi"] = device.rssi;
+    deviceObj["snr"] = device.snr;
+    deviceObj["phase"] = phaseToString(device.phase);
+    deviceObj["last_contact"] = device.lastContact;
+    deviceObj["positions_received"] = device.positionsReceived;
+    deviceObj["positions_requested"] = device.positionsRequested;
+    deviceObj["cadence_stretch"] = device.cadenceStretch;
+  }
+}
+
+String buildPollingStatusJSON(const FleetView& view) {
+  StaticJsonDocument<512> doc;
+  doc["polling_active"] = view.pollingActive;
+  doc["current_device_index"] = view.currentDeviceIndex;
+  doc["total_devices"] = view.cycleDevices;
+  doc["elapsed_ms"] = view.elapsedMs;
+  doc["census_active"] = view.censusActive;
+
+  if (!view.censusActive && view.currentDeviceIndex < view.cycleDevices) {
+    const DeviceInfo& device = view.devices[view.pollOrder[view.currentDeviceIndex]];
+    doc["current_device_id"] = device.deviceId.c_str();
+    doc["current_phase"] = phaseToString(device.phase);
+  }
+
+  char buffer[512];
+  serializeJson(doc, buffer);
+  return String(buffer);
+}
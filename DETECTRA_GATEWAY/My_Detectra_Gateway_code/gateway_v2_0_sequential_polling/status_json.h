@@ -0,0 +1,73 @@
+/**
+ * DETECTRA Gateway v2.0 - Dashboard JSON Builders
+ *
+ * Serializes fleet state for /api/devices, /api/polling and WebSocket pushes.
+ * All inputs arrive through a FleetView, so the same code runs on the gateway
+ * (a view of the live globals) and in the host benchmarks (synthetic fleets
+ * of any size, see tools/bench).
+ */
+
+#ifndef STATUS_JSON_H
+#define STATUS_JSON_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "lora_protocol.h"
+
+/**
+ * Read-only view of the state the dashboard JSON is built from
+ */
+struct FleetView {
+  const char* gatewayId;
+  String ipAddress;
+  unsigned long uptimeMs;
+
+  const DeviceInfo* devices;
+  int numDevices;
+
+  // Polling state
+  bool pollingActive;
+  bool censusActive;
+  int currentDeviceIndex;         // Position in pollOrder[]
+  const int* pollOrder;           // devices[] indices in polling order
+  int cycleDevices;               // Entries used in pollOrder[] this cycle
+  unsigned long elapsedMs;
+
+  // Counters
+  unsigned long totalMessages;
+  unsigned long truncatedDetections;  // DATA detections cut at DETECTIONS_MAX
+  unsigned long successfulPolls;
+  unsigned long failedPolls;
+
+  // Heap watermarks
+  size_t heapFree;
+  size_t heapMinLargestBlock;
+  uint8_t heapFragmentationPct;
+};
+
+/**
+ * Build device list + gateway stats (GET /api/devices)
+ *
+ * @param view Fleet state
+ * @return JSON string {"stats":{...},"devices":[...]}
+ */
+String buildDeviceListJSON(const FleetView& view);
+
+/**
+ * Fill a document with the device list (the same tree buildDeviceListJSON
+ * serializes - used to compare encodings, see tools/bench)
+ *
+ * @param view Fleet state
+ * @param doc Receives {"stats":{...},"devices":[...]}
+ */
+void fillDeviceListDocument(const FleetView& view, JsonDocument& doc);
+
+/**
+ * Build polling progress (GET /api/polling, WebSocket)
+ *
+ * @param view Fleet state
+ * @return JSON string {"polling_active":...}
+ */
+String buildPollingStatusJSON(const FleetView& view);
+
+#endif // STATUS_JSON_H
@@ -0,0 +1,141 @@
+/**
+ * DETECTRA Gateway v2.0 - Per-Table State Implementation
+ */
+
+#include "table_state.h"
+
+static TableStats stats = {};
+
+// ==================== DETECTION PARSING ====================
+
+/**
+ * Is "class" among the detections above the confidence threshold?
+ * Detections: "motherboard:40%,led_on:50%" or "person:2,box:5"
+ */
+static bool detected(const char* detections, const char* className) {
+  size_t classLen = strlen(className);
+  const char* p = detections;
+
+  while (*p != '\0') {
+    const char* itemEnd = strchr(p, ',');
+    if (itemEnd == NULL) itemEnd = p + strlen(p);
+
+    const char* colon = (const char*)memchr(p, ':', itemEnd - p);
+    size_t nameLen = (colon != NULL) ? (size_t)(colon - p) : (size_t)(itemEnd - p);
+
+    if (nameLen == classLen && strncasecmp(p, className, classLen) == 0) {
+      if (colon == NULL) return true;           // Bare class name
+
+      int value = atoi(colon + 1);
+      const char* percent = (const char*)memchr(colon + 1, '%', itemEnd - colon - 1);
+      if (percent != NULL ? value >= TABLE_MIN_CONFIDENCE : value > 0) return true;
+    }
+
+    p = (*itemEnd == ',') ? itemEnd + 1 : itemEnd;
+  }
+  return false;
+}
+
+static bool sameState(const TableState& a, const TableState& b) {
+  return a.occupied == b.occupied && a.equipment == b.equipment && a.tableId == b.tableId;
+}
+
+// ==================== AGGREGATION ====================
+
+void tablesBeginCycle(DeviceTables& tables, const char* left, const char* right) {
+  const char* ids[TABLES_PER_DEVICE] = { left, right };
+
+  for (int t = 0; t < TABLES_PER_DEVICE; t++) {
+    TableState& state = tables.current[t];
+    state.tableId = ids[t];
+    state.occupied = false;
+    state.equipment = EQUIP_UNKNOWN;
+    state.positions = 0;
+  }
+  tables.changedMask = 0;
+  tables.onlineChanged = false;
+}
+
+bool tablesAddPosition(DeviceTables& tables, const char* tableId, const char* detections) {
+  int slot = -1;
+
+  for (int t = 0; t < TABLES_PER_DEVICE && slot < 0; t++) {
+    if (tables.current[t].tableId == tableId) slot = t;
+  }
+  // Unconfigured device: tables are named by the first IDs it reports
+  for (int t = 0; t < TABLES_PER_DEVICE && slot < 0; t++) {
+    if (tables.current[t].tableId.isEmpty()) {
+      tables.current[t].tableId = tableId;
+      slot = t;
+    }
+  }
+  if (slot < 0) return false;
+
+  TableState& state = tables.current[slot];
+  EquipmentState seen = EQUIP_ABSENT;
+  if (detected(detections, TABLE_POWER_CLASS)) seen = EQUIP_ACTIVE;
+  else if (detected(detections, TABLE_EQUIPMENT_CLASS)) seen = EQUIP_IDLE;
+
+  // Any position seeing a person / equipment decides for the whole table
+  if (detected(detections, TABLE_OCCUPANCY_CLASS)) state.occupied = true;
+  if (seen > state.equipment) state.equipment = seen;
+  state.positions++;
+  return true;
+}
+
+// ==================== PUBLISH DECISION ====================
+
+TablePublish tablesDecide(DeviceTables& tables, bool online, unsigned long now) {
+  tables.changedMask = 0;
+  for (int t = 0; t < TABLES_PER_DEVICE; t++) {
+    if (tables.current[t].positions == 0) continue;   // No information this cycle
+    if (!sameState(tables.current[t], tables.published[t])) tables.changedMask |= (1 << t);
+  }
+  tables.onlineChanged = (online != tables.publishedOnline);
+
+  if (!tables.keyframeSent || now - tables.lastKeyframeMs >= TABLE_KEYFRAME_MS) {
+    return TABLES_KEYFRAME;
+  }
+  if (tables.changedMask != 0 || tables.onlineChanged) return TABLES_DELTA;
+  return TABLES_NOTHING;
+}
+
+void tablesCommit(DeviceTables& tables, bool online, TablePublish published, unsigned long now) {
+  switch (published) {
+    case TABLES_KEYFRAME:
+      stats.keyframes++;
+      tables.keyframeSent = true;
+      tables.lastKeyframeMs = now;
+      tables.deltaSeq = 0;
+      break;
+    case TABLES_DELTA:
+      stats.deltas++;
+      tables.deltaSeq++;
+      break;
+    case TABLES_NOTHING:
+      stats.suppressed++;
+      return;
+  }
+
+  for (int t = 0; t < TABLES_PER_DEVICE; t++) {
+    if (tables.current[t].positions > 0) tables.published[t] = tables.current[t];
+  }
+  tables.publishedOnline = online;
+}
+
+void tablesRequestKeyframe(DeviceTables& tables) {
+  tables.keyframeSent = false;
+}
+
+TableStats tablesGetStats() {
+  return stats;
+}
+
+const char* equipmentToString(EquipmentState state) {
+  switch (state) {
+    case EQUIP_ABSENT: return "absent";
+    case EQUIP_IDLE:   return "idle";
+    case EQUIP_ACTIVE: return "active";
+    default:           return "unknown";
+  }
+}
@@ -0,0 +1,129 @@
+/**
+ * DETECTRA Gateway v2.0 - Per-Table State & Delta Publishing
+ *
+ * Each device watches two tables (tableLeft / tableRight) from five
+ * camera positions. The DATA frames of one cycle are folded into a small
+ * state per table - occupied or not, and the equipment state - and only
+ * changes of that state are published. A full record (keyframe) is still
+ * sent periodically so consumers that missed a delta resynchronise.
+ *
+ * - Occupancy: TABLE_OCCUPANCY_CLASS seen at any position of the table.
+ * - Equipment: ABSENT (no TABLE_EQUIPMENT_CLASS), IDLE (present, no
+ *   TABLE_POWER_CLASS) or ACTIVE (TABLE_POWER_CLASS seen).
+ * - Detections below TABLE_MIN_CONFIDENCE % are ignored; count values
+ *   ("person:2") count as detected when > 0.
+ * - A table without any position in this cycle keeps its last state
+ *   (a partial cycle is not a change).
+ *
+ * Usage:
+ *   tablesBeginCycle(deviceTables[i], device.tableLeft.c_str(), device.tableRight.c_str());
+ *   tablesAddPosition(deviceTables[i], msg.data.tableId.c_str(), msg.data.detections.c_str());
+ *   TablePublish what = tablesDecide(deviceTables[i], device.online, millis());
+ *   ... publish ...
+ *   tablesCommit(deviceTables[i], device.online, what, millis());
+ */
+
+#ifndef TABLE_STATE_H
+#define TABLE_STATE_H
+
+#include <Arduino.h>
+#include "lora_protocol.h"
+
+// ==================== CONFIGURATION ====================
+
+#define TABLES_PER_DEVICE         2
+#define TABLE_OCCUPANCY_CLASS     "person"
+#define TABLE_EQUIPMENT_CLASS     "motherboard"
+#define TABLE_POWER_CLASS         "led_on"
+#define TABLE_MIN_CONFIDENCE      30              // % - weaker detections are noise
+#define TABLE_KEYFRAME_MS         (60UL * 60 * 1000)  // Full record at least hourly per device
+
+// ==================== DATA STRUCTURES ====================
+
+enum EquipmentState : uint8_t {
+  EQUIP_UNKNOWN,            // Never observed
+  EQUIP_ABSENT,
+  EQUIP_IDLE,
+  EQUIP_ACTIVE
+};
+
+enum TablePublish : uint8_t {
+  TABLES_NOTHING,           // No change - publish nothing
+  TABLES_DELTA,             // Changed tables / online flag only
+  TABLES_KEYFRAME           // Full device record
+};
+
+/**
+ * Aggregated state of one table
+ */
+struct TableState {
+  FixedString<TABLE_ID_MAX> tableId;
+  bool occupied;
+  EquipmentState equipment;
+  uint8_t positions;        // Positions folded in this cycle (0 = no information)
+};
+
+/**
+ * Table states of one device: this cycle vs. last published
+ */
+struct DeviceTables {
+  TableState current[TABLES_PER_DEVICE];
+  TableState published[TABLES_PER_DEVICE];
+  uint8_t changedMask;      // Bit per table changed since published (set by tablesDecide)
+  bool onlineChanged;
+  bool publishedOnline;
+  bool keyframeSent;        // At least one keyframe since boot
+  uint32_t deltaSeq;        // Increments per delta, reset by a keyframe
+  unsigned long lastKeyframeMs;
+};
+
+/**
+ * Publish counters (for status reports)
+ */
+struct TableStats {
+  uint32_t keyframes;
+  uint32_t deltas;
+  uint32_t suppressed;      // Device results with no change (nothing published)
+};
+
+// ==================== TABLE FUNCTIONS ====================
+
+/**
+ * Start a new cycle for a device (clears the current aggregation)
+ *
+ * @param left  Configured left table ID ("" = take the first ID reported)
+ * @param right Configured right table ID
+ */
+void tablesBeginCycle(DeviceTables& tables, const char* left, const char* right);
+
+/**
+ * Fold one DATA position into its table
+ *
+ * @return false if the table ID matches neither table of the device
+ */
+bool tablesAddPosition(DeviceTables& tables, const char* tableId, const char* detections);
+
+/**
+ * Compare this cycle with the last published state and pick what to send
+ * (sets changedMask / onlineChanged for the message builder)
+ */
+TablePublish tablesDecide(DeviceTables& tables, bool online, unsigned long now);
+
+/**
+ * Record that the decided message was published (or suppressed)
+ */
+void tablesCommit(DeviceTables& tables, bool online, TablePublish published, unsigned long now);
+
+/**
+ * Force the next result of this device to be a keyframe
+ */
+void tablesRequestKeyframe(DeviceTables& tables);
+
+/**
+ * Current publish counters
+ */
+TableStats tablesGetStats();
+
+const char* equipmentToString(EquipmentState state);
+
+#endif // TABLE_STATE_H
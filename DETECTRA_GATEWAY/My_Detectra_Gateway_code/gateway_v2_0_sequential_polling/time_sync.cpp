@@ -0,0 +1,289 @@
+/**
+ * DETECTRA Gateway v2.0 - Time Sync Implementation
+ */
+
+#include "time_sync.h"
+#include "log.h"
+#include <math.h>
+
+/**
+ * Per-device clock. Precise samples (clk_) give the offset; two samples
+ * from the same beacon epoch (the device did not re-set its clock in
+ * between) give the drift.
+ */
+struct DeviceClock {
+  FixedString<NODE_ID_MAX> deviceId;  // Empty = free slot
+  unsigned long lastUsedMs;
+  TimeSyncState state;
+  uint8_t rejectsInRow;
+  uint32_t lostEpoch;                 // Beacons sent when it became LOST
+  bool precise;
+
+  int32_t offsetMs;
+  float errorMs;
+  float driftPpm;
+  bool driftKnown;
+
+  uint64_t sampleAtMs;                // Gateway time of the last precise sample
+  uint32_t sampleEpoch;               // Beacons sent before it
+
+  uint32_t accepted;
+  uint32_t rejected;
+};
+
+static DeviceClock clocks[TIME_MAX_DEVICES];
+static TimeSyncStats stats;
+static uint32_t knownSteps = 0;       // getClockStatus().steps the device clocks refer to
+static bool beaconSoon = true;        // First beacon once the radio is idle
+static SemaphoreHandle_t timeLock = NULL;
+
+// ==================== DEVICE CLOCKS ====================
+
+static DeviceClock* findClock(const char* deviceId) {
+  for (int i = 0; i < TIME_MAX_DEVICES; i++) {
+    if (!clocks[i].deviceId.isEmpty() && clocks[i].deviceId == deviceId) return &clocks[i];
+  }
+  return NULL;
+}
+
+static DeviceClock* findOrCreateClock(const char* deviceId, unsigned long now) {
+  DeviceClock* clock = findClock(deviceId);
+  if (clock != NULL) return clock;
+
+  // Free slot, else the clock not heard from for longest
+  int slot = 0;
+  for (int i = 0; i < TIME_MAX_DEVICES; i++) {
+    if (clocks[i].deviceId.isEmpty()) { slot = i; break; }
+    if (now - clocks[i].lastUsedMs > now - clocks[slot].lastUsedMs) slot = i;
+  }
+
+  clock = &clocks[slot];
+  *clock = DeviceClock();
+  clock->deviceId = deviceId;
+  clock->state = TIME_DEVICE_UNKNOWN;
+  return clock;
+}
+
+static void checkClockStep() {
+  // A step moves the gateway clock under every device - all of them must be re-synced
+  uint32_t steps = getClockStatus().steps;
+  if (steps == knownSteps) return;
+
+  knownSteps = steps;
+  for (int i = 0; i < TIME_MAX_DEVICES; i++) {
+    clocks[i].state = TIME_DEVICE_UNKNOWN;
+    clocks[i].rejectsInRow = 0;
+    clocks[i].sampleAtMs = 0;
+    clocks[i].errorMs = 0.0f;
+  }
+  beaconSoon = true;
+  LOG_I("TIME", "Gateway clock stepped - device clocks reset, beacon queued");
+}
+
+static bool parseClockField(const LoRaMessage& msg, uint64_t& clockMs) {
+  // "bat_95:rssi_-45:snr_8:clk_1728567890123"
+  if (msg.ackStatus != ACK_STATUS_ONLINE) return false;
+
+  HealthPayload health;
+  decodeHealthPayload(msg.payload.c_str(), msg.payload.length(), health);
+  clockMs = health.clockMs;
+  return clockMs > 0;
+}
+
+static void recordSample(DeviceClock& clock, int64_t offsetMs, uint64_t txStartMs) {
+  // Drift from the previous sample, if the device kept its clock since then
+  bool sameEpoch = clock.state != TIME_DEVICE_SYNCED || clock.sampleEpoch == stats.beacons;
+  if (clock.sampleAtMs > 0 && sameEpoch && txStartMs - clock.sampleAtMs >= TIME_DRIFT_MIN_SPAN_MS) {
+    float ppm = (float)(offsetMs - clock.offsetMs) * 1e6f / (float)(txStartMs - clock.sampleAtMs);
+    clock.driftPpm = clock.driftKnown ? clock.driftPpm + (ppm - clock.driftPpm) * TIME_EWMA_WEIGHT : ppm;
+    clock.driftKnown = true;
+  }
+
+  float error = fabsf((float)offsetMs);
+  clock.errorMs = clock.precise ? clock.errorMs + (error - clock.errorMs) * TIME_EWMA_WEIGHT : error;
+  clock.offsetMs = (int32_t)offsetMs;
+  clock.precise = true;
+  clock.sampleAtMs = txStartMs;
+  clock.sampleEpoch = stats.beacons;
+}
+
+// ==================== TIME SYNC FUNCTIONS ====================
+
+void timeSyncInit() {
+  timeLock = xSemaphoreCreateMutex();
+  knownSteps = getClockStatus().steps;
+  LOG_I("TIME", "Beacon every %lus, timestamp tolerance ±%ds", (unsigned long)TIME_BEACON_MS / 1000, TIMESTAMP_TOLERANCE);
+}
+
+bool timeSyncCheck(const LoRaMessage& msg, uint64_t rxMs, unsigned long airtimeMs) {
+  // The device stamped the frame when it started sending
+  uint64_t delay = TIME_RX_LATENCY_MS + airtimeMs;
+  uint64_t txStartMs = (rxMs > delay) ? rxMs - delay : 0;
+
+  bool inTolerance = validateTimestamp(msg.timestamp, (unsigned long)(txStartMs / 1000));
+
+  xSemaphoreTake(timeLock, portMAX_DELAY);
+  checkClockStep();
+
+  DeviceClock& clock = *findOrCreateClock(msg.senderId.c_str(), millis());
+  clock.lastUsedMs = millis();
+
+  uint64_t clockMs;
+  bool sampled = parseClockField(msg, clockMs);
+  if (sampled) {
+    int64_t offsetMs = (int64_t)(clockMs - txStartMs);
+    recordSample(clock, offsetMs, txStartMs);
+    // The header timestamp still has to pass - clk_ does not vouch for it
+    inTolerance = inTolerance && llabs(offsetMs) <= (int64_t)TIMESTAMP_TOLERANCE * 1000;
+  }
+
+  if (clock.state == TIME_DEVICE_LOST && inTolerance && !sampled && clock.lostEpoch == stats.beacons) {
+    // Back on time without a beacon to set it from - not proof it re-synced
+    inTolerance = false;
+  }
+
+  if (inTolerance) {
+    if (clock.state != TIME_DEVICE_SYNCED) {
+      LOG_I("TIME", "%s synced - timestamps are checked from now on", msg.senderId);
+    }
+    clock.state = TIME_DEVICE_SYNCED;
+    clock.rejectsInRow = 0;
+    clock.accepted++;
+    xSemaphoreGive(timeLock);
+    return true;
+  }
+
+  if (clock.state == TIME_DEVICE_UNKNOWN || clock.state == TIME_DEVICE_FREE) {
+    // Not on gateway time (yet) - nothing to check against
+    clock.state = TIME_DEVICE_FREE;
+    clock.accepted++;
+    xSemaphoreGive(timeLock);
+    return true;
+  }
+
+  if (clock.state == TIME_DEVICE_SYNCED && ++clock.rejectsInRow >= TIME_MAX_REJECTS) {
+    // Consistently off: the device lost its time (reboot without RTC) - still rejected
+    LOG_W("TIME", "%s: %u stale timestamps in a row - rejected until it re-syncs",
+          msg.senderId, clock.rejectsInRow);
+    clock.state = TIME_DEVICE_LOST;
+    clock.lostEpoch = stats.beacons;
+    clock.rejectsInRow = 0;
+  }
+
+  clock.rejected++;
+  stats.rejected++;
+  beaconSoon = true;
+  xSemaphoreGive(timeLock);
+
+  LOG_W("TIME", "Dropped %s %s from %s: timestamp %lu, gateway %lu (±%ds)",
+        msg.command, msg.targetId, msg.senderId, msg.timestamp,
+        (unsigned long)(txStartMs / 1000), TIMESTAMP_TOLERANCE);
+  return false;
+}
+
+bool timeSyncBeaconDue(unsigned long now) {
+  xSemaphoreTake(timeLock, portMAX_DELAY);
+  checkClockStep();
+
+  bool due;
+  if (stats.lastBeaconMs == 0) {
+    due = true;
+  } else if (beaconSoon) {
+    due = now - stats.lastBeaconMs >= TIME_BEACON_SOON_MS;
+  } else {
+    due = now - stats.lastBeaconMs >= TIME_BEACON_MS;
+  }
+
+  xSemaphoreGive(timeLock);
+  return due;
+}
+
+size_t timeSyncBuildBeacon(char* out, size_t capacity, unsigned long airtimeMs) {
+  // Format: "t_1728567890123:q_1" - fixed width, so the airtime of a dry run holds
+  TimeBeaconPayload beacon;
+  beacon.timeMs = getCurrentTimeMs() + TIME_TX_LATENCY_MS + airtimeMs;
+  beacon.utc = getClockStatus().synced;
+  return encodeTimeBeaconPayload(out, capacity, beacon);
+}
+
+void timeSyncBeaconSent(unsigned long now) {
+  xSemaphoreTake(timeLock, portMAX_DELAY);
+  stats.beacons++;
+  stats.lastBeaconMs = (now != 0) ? now : 1;
+  beaconSoon = false;
+  xSemaphoreGive(timeLock);
+
+  LOG_D("TIME", "Beacon %u sent", stats.beacons);
+}
+
+unsigned int timeSyncCensusSlotMs(const char* const* deviceIds, int count, unsigned long replyAirtimeMs) {
+  xSemaphoreTake(timeLock, portMAX_DELAY);
+  checkClockStep();
+
+  unsigned long sinceBeaconMs = millis() - stats.lastBeaconMs;
+  float worstMs = 0.0f;
+  bool tight = count > 0 && stats.beacons > 0;
+
+  for (int i = 0; i < count && tight; i++) {
+    const DeviceClock* clock = findClock(deviceIds[i]);
+    if (clock == NULL || clock->state != TIME_DEVICE_SYNCED || !clock->precise) {
+      tight = false;
+      break;
+    }
+
+    // Error seen so far, plus what the drift adds since the device last set its clock
+    float errorMs = clock->errorMs;
+    if (clock->driftKnown) errorMs += fabsf(clock->driftPpm) * sinceBeaconMs * 1e-6f;
+    if (errorMs > worstMs) worstMs = errorMs;
+  }
+
+  unsigned int slotMs = CENSUS_SLOT_MS;
+  if (tight) {
+    // Neighbours may be early and late by the worst error each
+    unsigned long tightMs = replyAirtimeMs + 2 * (unsigned long)ceilf(worstMs) + TIME_SLOT_JITTER_MS;
+    if (tightMs < slotMs) slotMs = (unsigned int)tightMs;
+  }
+
+  stats.censusSlotMs = slotMs;
+  xSemaphoreGive(timeLock);
+  return slotMs;
+}
+
+int timeSyncGetDevices(TimeSyncInfo* out, int maxDevices) {
+  xSemaphoreTake(timeLock, portMAX_DELAY);
+
+  int n = 0;
+  for (int i = 0; i < TIME_MAX_DEVICES && n < maxDevices; i++) {
+    const DeviceClock& clock = clocks[i];
+    if (clock.deviceId.isEmpty()) continue;
+
+    TimeSyncInfo& info = out[n++];
+    info.deviceId = clock.deviceId;
+    info.state = clock.state;
+    info.precise = clock.precise;
+    info.offsetMs = clock.offsetMs;
+    info.errorMs = clock.errorMs;
+    info.driftPpm = clock.driftKnown ? clock.driftPpm : 0.0f;
+    info.accepted = clock.accepted;
+    info.rejected = clock.rejected;
+  }
+
+  xSemaphoreGive(timeLock);
+  return n;
+}
+
+TimeSyncStats timeSyncGetStats() {
+  xSemaphoreTake(timeLock, portMAX_DELAY);
+  TimeSyncStats copy = stats;
+  xSemaphoreGive(timeLock);
+  return copy;
+}
+
+const char* timeSyncStateName(TimeSyncState state) {
+  switch (state) {
+    case TIME_DEVICE_FREE:   return "free";
+    case TIME_DEVICE_SYNCED: return "synced";
+    case TIME_DEVICE_LOST:   return "lost";
+    default:                 return "unknown";
+  }
+}
@@ -0,0 +1,142 @@
+/**
+ * DETECTRA Gateway v2.0 - Time Sync (beacons, device clocks, timestamp checks)
+ *
+ * The gateway clock (getCurrentTimeMs, lora_protocol.h) is disciplined
+ * against NTP when WiFi is up, and runs from the 64-bit timer otherwise.
+ * Devices take their time from it:
+ *
+ * - Every TIME_BEACON_MS (sooner after a clock step or a rejected frame)
+ *   a TIME frame goes to ALL in idle radio time:
+ *
+ *     GW0-00001:TIME:ALL:017:1728567890:t_1728567890123:q_1
+ *
+ *   t_ is the gateway time in ms at the end of the transmission (airtime
+ *   and UART latency included), so a device sets its clock to t_ when the
+ *   frame is received. q_1 = UTC, q_0 = gateway uptime (no NTP yet).
+ * - Every device frame is checked against the gateway clock. A device
+ *   whose timestamps are within ±TIMESTAMP_TOLERANCE is SYNCED, and from
+ *   then on frames outside the tolerance are rejected (replays, stale
+ *   frames). Devices that never get there (older firmware) stay FREE and
+ *   are not checked. After TIME_MAX_REJECTS rejections in a row a device
+ *   is LOST: its frames are still rejected until one is in tolerance and
+ *   either follows a beacon sent since, or carries a clk_ sample in
+ *   tolerance - then it is SYNCED again.
+ * - A device that adds "clk_<ms>" (its clock when it started sending) to
+ *   ACK ONLINE is measured to the millisecond: offset, average error and
+ *   drift against the gateway clock. The header timestamp is checked as
+ *   well; a frame is in tolerance only if both are.
+ *   When every device in a census roster
+ *   is SYNCED and measured, the census slot is sized from those errors
+ *   instead of the fixed CENSUS_SLOT_MS padding, and the census carries
+ *   at_<ms>, the gateway time of slot 0.
+ *
+ * Usage:
+ *   timeSyncInit();
+ *   if (!timeSyncCheck(msg, rxMs, airtimeMs)) drop;      // every received frame
+ *   if (timeSyncBeaconDue(millis())) send a beacon;      // pollingTask, idle
+ *   slotMs = timeSyncCensusSlotMs(ids, count, replyAirtimeMs);
+ */
+
+#ifndef TIME_SYNC_H
+#define TIME_SYNC_H
+
+#include <Arduino.h>
+#include "lora_protocol.h"
+
+// ==================== CONFIGURATION ====================
+
+#define TIME_BEACON_MS            600000    // Beacon period
+#define TIME_BEACON_SOON_MS       5000      // After a clock step / rejected frame
+#define TIME_BEACON_IDLE_MS       1500      // Idle radio time needed to send one
+#define TIME_BEACON_PAYLOAD_MAX   32        // "t_<ms>:q_<n>"
+#define TIME_TX_LATENCY_MS        15        // AT+PSEND written -> radio starts (UART + module)
+#define TIME_RX_LATENCY_MS        10        // Radio done -> line read by loraTask
+#define TIME_MAX_REJECTS          5         // In a row -> device LOST
+#define TIME_MAX_DEVICES          32
+#define TIME_DRIFT_MIN_SPAN_MS    60000     // clk_ samples closer than this give no drift
+#define TIME_EWMA_WEIGHT          0.25f
+#define TIME_SLOT_JITTER_MS       20        // Device TX start jitter on top of its clock error
+
+// ==================== DATA STRUCTURES ====================
+
+enum TimeSyncState : uint8_t {
+  TIME_DEVICE_UNKNOWN,      // No frame since boot / the last clock step
+  TIME_DEVICE_FREE,         // Clock not on gateway time - timestamps not checked
+  TIME_DEVICE_SYNCED,       // On gateway time - timestamps checked
+  TIME_DEVICE_LOST          // Was SYNCED, then off for TIME_MAX_REJECTS frames - rejected until back on time
+};
+
+/**
+ * One device's clock (GET /api/time)
+ */
+struct TimeSyncInfo {
+  FixedString<NODE_ID_MAX> deviceId;
+  TimeSyncState state;
+  bool precise;                     // Sends clk_ - the fields below are measured in ms
+  int32_t offsetMs;                 // Device clock - gateway clock at its last frame
+  float errorMs;                    // Average |offset|
+  float driftPpm;                   // Device clock rate against the gateway clock
+  uint32_t accepted;
+  uint32_t rejected;
+};
+
+/**
+ * Gateway counters
+ */
+struct TimeSyncStats {
+  uint32_t beacons;
+  uint32_t rejected;                // Frames dropped by the timestamp check
+  unsigned long lastBeaconMs;       // millis() of the last beacon (0 = none)
+  unsigned int censusSlotMs;        // Slot of the last census
+};
+
+// ==================== TIME SYNC FUNCTIONS ====================
+
+/**
+ * Reset device clocks (call once in setup, after initTimestamp)
+ */
+void timeSyncInit();
+
+/**
+ * Check a received frame's timestamp and learn the sender's clock
+ *
+ * @param rxMs Gateway time when the frame was read (getCurrentTimeMs)
+ * @param airtimeMs Airtime of the received frame
+ * @return false if the frame must be dropped (SYNCED device, stale timestamp)
+ */
+bool timeSyncCheck(const LoRaMessage& msg, uint64_t rxMs, unsigned long airtimeMs);
+
+/**
+ * Beacon period elapsed, requested, or the gateway clock stepped?
+ */
+bool timeSyncBeaconDue(unsigned long now);
+
+/**
+ * Build the beacon payload, stamped for the end of a transmission
+ *
+ * @param airtimeMs Airtime of the beacon frame (the length does not depend on it)
+ * @return Payload length
+ */
+size_t timeSyncBuildBeacon(char* out, size_t capacity, unsigned long airtimeMs);
+
+/**
+ * Record a sent beacon
+ */
+void timeSyncBeaconSent(unsigned long now);
+
+/**
+ * Census slot for a roster: tight if every device is SYNCED and measured,
+ * CENSUS_SLOT_MS otherwise
+ *
+ * @param replyAirtimeMs Airtime of one ONLINE reply (CENSUS_REPLY_BYTES)
+ */
+unsigned int timeSyncCensusSlotMs(const char* const* deviceIds, int count, unsigned long replyAirtimeMs);
+
+/**
+ * Device clocks and counters
+ */
+int timeSyncGetDevices(TimeSyncInfo* out, int maxDevices);
+TimeSyncStats timeSyncGetStats();
+const char* timeSyncStateName(TimeSyncState state);
+
+#endif // TIME_SYNC_H
@@ -0,0 +1,607 @@
+/**
+ * DETECTRA Gateway v2.0 - Host Micro-Benchmarks
+ *
+ * Times the protocol and serialization hot paths with the real sketch
+ * sources compiled for the host, and counts heap traffic per operation
+ * by interposing malloc/calloc/realloc.
+ *
+ * Usage:
+ *   ./detectra_bench                 Table on stdout
+ *   ./detectra_bench --json          Machine-readable results (see compare.py)
+ *   ./detectra_bench --filter hex    Only benchmarks whose name contains "hex"
+ */
+
+#include <time.h>
+#include <Arduino.h>
+#include "lora_protocol.h"
+#include "lora_frame.h"
+#include "ws_broadcast.h"
+#include "fleet_snapshot.h"
+#ifdef HAVE_ARDUINOJSON
+#include "status_json.h"
+#include "mqtt_codec.h"
+#endif
+
+HostSerial Serial;
+unsigned long hostMicros = 0;
+
+// ==================== ALLOCATION COUNTING ====================
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* p, size_t size);
+void __libc_free(void* p);
+}
+
+static bool countAllocs = false;
+static unsigned long allocCount = 0;
+static unsigned long allocBytes = 0;
+
+extern "C" void* malloc(size_t size) {
+  if (countAllocs) { allocCount++; allocBytes += size; }
+  return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t n, size_t size) {
+  if (countAllocs) { allocCount++; allocBytes += n * size; }
+  return __libc_calloc(n, size);
+}
+
+extern "C" void* realloc(void* p, size_t size) {
+  if (countAllocs) { allocCount++; allocBytes += size; }
+  return __libc_realloc(p, size);
+}
+
+extern "C" void free(void* p) {
+  __libc_free(p);
+}
+
+// ==================== HARNESS ====================
+
+typedef size_t (*BenchFn)();
+
+struct Bench {
+  const char* name;
+  BenchFn fn;
+};
+
+struct BenchResult {
+  double nsPerOp;
+  double allocsPerOp;
+  double bytesPerOp;
+  size_t output;            // Result size of one op (JSON length etc.), 0 if n/a
+};
+
+static volatile size_t sink;
+
+static uint64_t nowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+#define CALIBRATE_NS   20000000ULL   // Grow the batch until one run takes >= 20 ms
+#define REPETITIONS    15            // Report the fastest of 15 runs (robust to scheduler noise)
+#define ALLOC_ITERS    1000
+
+static BenchResult runBench(const Bench& b) {
+  BenchResult r;
+  r.output = b.fn();
+
+  // Calibrate batch size
+  unsigned long iters = 1;
+  uint64_t elapsed = 0;
+  while (true) {
+    uint64_t t0 = nowNs();
+    for (unsigned long i = 0; i < iters; i++) sink = b.fn();
+    elapsed = nowNs() - t0;
+    if (elapsed >= CALIBRATE_NS || iters >= (1UL << 30)) break;
+    iters *= 2;
+  }
+
+  double best = (double)elapsed / iters;
+  for (int rep = 1; rep < REPETITIONS; rep++) {
+    uint64_t t0 = nowNs();
+    for (unsigned long i = 0; i < iters; i++) sink = b.fn();
+    double ns = (double)(nowNs() - t0) / iters;
+    if (ns < best) best = ns;
+  }
+  r.nsPerOp = best;
+
+  // Separate pass for heap traffic (counting perturbs timing)
+  allocCount = 0;
+  allocBytes = 0;
+  countAllocs = true;
+  for (int i = 0; i < ALLOC_ITERS; i++) sink = b.fn();
+  countAllocs = false;
+  r.allocsPerOp = (double)allocCount / ALLOC_ITERS;
+  r.bytesPerOp = (double)allocBytes / ALLOC_ITERS;
+
+  return r;
+}
+
+// ==================== FIXTURES ====================
+
+static const char SECRET[] = "a3f2b1c4d5e6f7a8b9c0d1e2f3a4b5c6";
+
+static const char RX_ACK_ONLINE[] = "ED0-00003:ACK:ONLINE:042:1728567890:bat_95:rssi_-45:snr_8:cyc_12";
+static const char RX_DATA[] =
+  "ED0-00003:DATA:GW0-00001:043:1728567891:"
+  "BLR-13-IL-01:center_right:motherboard:40%,led_on:50%,cable:12%,fan:3%:3/5";
+static const char RX_SIGNED[] =
+  "GW0-00001:POLL:ED0-00003:044:1728567892:null:0000000000000000";
+
+static String rxAckString;
+static String rxSignedString;
+static String secretString;
+static String senderString;
+static String commandString;
+static String targetString;
+static String sequenceString;
+static String payloadString;
+
+static LoRaMessage dataMsg;
+static LoRaMessage healthMsg;
+static LoRaMessage scratchMsg;
+static TxFrame frame;
+
+static uint8_t hexRaw[LORA_MAX_FRAME];
+static char hexText[2 * LORA_MAX_FRAME];
+static uint8_t hexOut[LORA_MAX_FRAME];
+
+// Device -> gateway mix: command + ACK status as they arrive in a poll
+static const char* const DISPATCH_COMMANDS[] = { CMD_ACK, CMD_DATA, CMD_DATA, CMD_ACK, CMD_BLK_STATUS, CMD_ACK };
+static const char* const DISPATCH_TARGETS[] = { STATUS_ONLINE, "GW0-00001", "GW0-00001", STATUS_FINALIZED,
+                                                "GW0-00001", STATUS_SLEEPING };
+static const int DISPATCH_COUNT = sizeof(DISPATCH_COMMANDS) / sizeof(DISPATCH_COMMANDS[0]);
+static FixedString<COMMAND_MAX> dispatchCommands[DISPATCH_COUNT];
+static FixedString<NODE_ID_MAX> dispatchTargets[DISPATCH_COUNT];
+
+static void initFixtures() {
+  rxAckString = RX_ACK_ONLINE;
+  secretString = SECRET;
+  senderString = "GW0-00001";
+  commandString = CMD_START_INFER;
+  targetString = "ED0-00003";
+  sequenceString = "1042";
+  payloadString = "null";
+
+  // Signed frame with a valid HMAC so verifyHMAC walks the full path
+  String body = "GW0-00001:POLL:ED0-00003:044:1728567892:null";
+  rxSignedString = body + ":" + calculateHMAC(body, secretString);
+
+  parseMessage(RX_DATA, strlen(RX_DATA), dataMsg);
+  parseMessage(RX_ACK_ONLINE, strlen(RX_ACK_ONLINE), healthMsg);
+
+  for (int i = 0; i < DISPATCH_COUNT; i++) {
+    dispatchCommands[i] = DISPATCH_COMMANDS[i];
+    dispatchTargets[i] = DISPATCH_TARGETS[i];
+  }
+
+  for (int i = 0; i < LORA_MAX_FRAME; i++) hexRaw[i] = (uint8_t)(i * 37 + 11);
+  hexEncode(hexRaw, LORA_MAX_FRAME, hexText);
+}
+
+// ==================== PROTOCOL BENCHMARKS ====================
+
+static size_t benchParseMessage() {
+  parseMessage(RX_DATA, sizeof(RX_DATA) - 1, scratchMsg);
+  return scratchMsg.valid;
+}
+
+static size_t benchParseMessageString() {
+  LoRaMessage msg = parseMessage(rxAckString);
+  return msg.valid;
+}
+
+static size_t benchParseDataPayload() {
+  parseDataPayload(dataMsg);
+  return dataMsg.data.detections.length();
+}
+
+static size_t benchParseHealthPayload() {
+  parseHealthPayload(healthMsg);
+  return (size_t)healthMsg.health.battery;
+}
+
+static size_t benchCalculateHMAC() {
+  char mac[HMAC_LENGTH];
+  calculateHMAC(RX_DATA, sizeof(RX_DATA) - 1, SECRET, sizeof(SECRET) - 1, mac);
+  return (uint8_t)mac[0];
+}
+
+static size_t benchCalculateHMACString() {
+  String mac = calculateHMAC(rxAckString, secretString);
+  return mac.length();
+}
+
+static size_t benchVerifyHMAC() {
+  return verifyHMAC(rxSignedString, secretString);
+}
+
+static size_t benchBuildMessage() {
+  String msg = buildMessage(senderString, commandString, targetString,
+                            sequenceString, payloadString, secretString);
+  return msg.length();
+}
+
+static size_t benchFrameBuild() {
+  frameBegin(frame, "GW0-00001", CMD_ACK, "ED0-00003", 1043, 1728567891UL);
+  frameAppendInt(frame, 3);
+  frameAppend(frame, "/5");
+  frameFinish(frame, NULL);
+  return frame.lineLen;
+}
+
+static size_t benchHexEncode() {
+  return hexEncode(hexRaw, LORA_MAX_FRAME, hexText);
+}
+
+static size_t benchHexDecode() {
+  return (size_t)hexDecode(hexText, 2 * LORA_MAX_FRAME, hexOut);
+}
+
+static size_t benchDispatchStrings() {
+  // Former processIncomingMessage() chain
+  size_t handled = 0;
+  for (int i = 0; i < DISPATCH_COUNT; i++) {
+    const FixedString<COMMAND_MAX>& command = dispatchCommands[i];
+    const FixedString<NODE_ID_MAX>& status = dispatchTargets[i];
+    if (command == CMD_ACK) {
+      if (status == STATUS_ONLINE) handled += 1;
+      else if (status == STATUS_INFERRING) handled += 2;
+      else if (status == STATUS_FINALIZED) handled += 3;
+      else if (status == STATUS_SLEEPING) handled += 4;
+    } else if (command == CMD_DATA) {
+      handled += 5;
+    } else if (command == CMD_BLK_STATUS) {
+      handled += 6;
+    }
+  }
+  return handled;
+}
+
+static size_t benchDispatchSwitch() {
+  // parseMessage() lookups + switch, as now
+  size_t handled = 0;
+  for (int i = 0; i < DISPATCH_COUNT; i++) {
+    LoRaCommand command = loraCommandFromWire(dispatchCommands[i].c_str(), dispatchCommands[i].length());
+    AckStatus status = (command == LORA_CMD_ACK)
+                         ? ackStatusFromWire(dispatchTargets[i].c_str(), dispatchTargets[i].length())
+                         : ACK_STATUS_NONE;
+    switch (command) {
+      case LORA_CMD_ACK:        handled += status; break;
+      case LORA_CMD_DATA:       handled += 5; break;
+      case LORA_CMD_BLK_STATUS: handled += 6; break;
+      default:                  break;
+    }
+  }
+  return handled;
+}
+
+// ==================== JSON BENCHMARKS ====================
+
+#ifdef HAVE_ARDUINOJSON
+
+#define FLEET_MAX 256
+
+static DeviceInfo fleet[FLEET_MAX];
+static int fleetOrder[FLEET_MAX];
+
+static void initFleet() {
+  for (int i = 0; i < FLEET_MAX; i++) {
+    DeviceInfo& d = fleet[i];
+    char id[16];
+    snprintf(id, sizeof(id), "ED0-%05d", i + 1);
+    d.deviceId = id;
+    d.phase = (PollingPhase)(i % 7);
+    d.retryCount = 0;
+    d.positionsReceived = i % 6;
+    d.commandSent = false;
+    d.censusSeen = true;
+    d.online = (i % 5) != 0;
+    d.paired = true;
+    d.battery = 40 + i % 60;
+    d.rssi = -40 - i % 80;
+    d.snr = 10 - i % 15;
+    d.lastContact = 1000UL * i;
+
+    char table[16];
+    snprintf(table, sizeof(table), "BLR-13-IL-%02d", (2 * i) % 100);
+    d.tableLeft = table;
+    snprintf(table, sizeof(table), "BLR-13-IL-%02d", (2 * i + 1) % 100);
+    d.tableRight = table;
+
+    fleetOrder[i] = i;
+  }
+}
+
+static FleetView fleetOf(int numDevices) {
+  FleetView view;
+  view.gatewayId = "GW0-00001";
+  view.ipAddress = "192.168.1.100";
+  view.uptimeMs = 86400000UL;
+  view.devices = fleet;
+  view.numDevices = numDevices;
+  view.pollingActive = true;
+  view.censusActive = false;
+  view.currentDeviceIndex = numDevices / 2;
+  view.pollOrder = fleetOrder;
+  view.cycleDevices = numDevices;
+  view.elapsedMs = 42000;
+  view.totalMessages = 123456;
+  view.truncatedDetections = 0;
+  view.successfulPolls = 9876;
+  view.failedPolls = 54;
+  view.heapFree = 181234;
+  view.heapMinLargestBlock = 65524;
+  view.heapFragmentationPct = 12;
+  return view;
+}
+
+static FleetView fleet15, fleet30, fleet256;
+
+static size_t benchDeviceList15()   { return buildDeviceListJSON(fleet15).length(); }
+static size_t benchDeviceList30()   { return buildDeviceListJSON(fleet30).length(); }
+static size_t benchDeviceList256()  { return buildDeviceListJSON(fleet256).length(); }
+static size_t benchPollStatus15()   { return buildPollingStatusJSON(fleet15).length(); }
+static size_t benchPollStatus30()   { return buildPollingStatusJSON(fleet30).length(); }
+static size_t benchPollStatus256()  { return buildPollingStatusJSON(fleet256).length(); }
+
+// ==================== ENCODING BENCHMARKS ====================
+
+// JSON vs MessagePack for the same document: "output" is the payload size
+static StaticJsonDocument<1024> deviceRecord;       // Keyframe as built by publishDeviceData()
+static DynamicJsonDocument list30(16384);           // Device list, 30 devices
+static DynamicJsonDocument parsed(16384);
+static uint8_t encoded[16384];
+static char list30Json[16384];
+static uint8_t list30MsgPack[16384];
+static size_t list30JsonLen, list30MsgPackLen;
+
+static void initEncodingFixtures() {
+  deviceRecord["type"] = "keyframe";
+  deviceRecord["gateway_id"] = "GW0-00001";
+  deviceRecord["device_id"] = "ED0-00003";
+  deviceRecord["seq"] = 0;
+  deviceRecord["online"] = true;
+  deviceRecord["battery"] = 87;
+  deviceRecord["rssi"] = -71;
+  deviceRecord["snr"] = 6;
+  deviceRecord["last_position"] = "right";
+  deviceRecord["last_table_id"] = "BLR-13-IL-02";
+  deviceRecord["last_detections"] = "motherboard:38%,led_on:52%";
+  deviceRecord["positions_received"] = 5;
+  deviceRecord["total_polls"] = 1234;
+  deviceRecord["successful_polls"] = 1220;
+  deviceRecord["failed_polls"] = 14;
+  deviceRecord["last_contact"] = 86395000UL;
+  JsonArray tables = deviceRecord.createNestedArray("tables");
+  for (int t = 0; t < 2; t++) {
+    JsonObject table = tables.createNestedObject();
+    table["table_id"] = t ? "BLR-13-IL-02" : "BLR-13-IL-01";
+    table["occupied"] = t == 0;
+    table["equipment"] = t ? "idle" : "active";
+  }
+  deviceRecord["timestamp"] = 86400000UL;
+
+  fillDeviceListDocument(fleet30, list30);
+  list30JsonLen = serializeJson(list30, list30Json, sizeof(list30Json));
+  list30MsgPackLen = serializeMsgPack(list30, list30MsgPack, sizeof(list30MsgPack));
+}
+
+static size_t benchDeviceJson() {
+  codecSetMask(0);
+  return codecSerialize(deviceRecord, MQTT_TOPIC_DEVICE, encoded, sizeof(encoded));
+}
+
+static size_t benchDeviceMsgPack() {
+  codecSetMask(1 << MQTT_TOPIC_DEVICE);
+  return codecSerialize(deviceRecord, MQTT_TOPIC_DEVICE, encoded, sizeof(encoded));
+}
+
+static size_t benchList30Json()     { return serializeJson(list30, (char*)encoded, sizeof(encoded)); }
+static size_t benchList30MsgPack()  { return serializeMsgPack(list30, encoded, sizeof(encoded)); }
+
+// Backend side: parse cost of the same payload
+static size_t benchList30JsonParse() {
+  deserializeJson(parsed, list30Json, list30JsonLen);
+  return list30JsonLen;
+}
+
+static size_t benchList30MsgPackParse() {
+  deserializeMsgPack(parsed, list30MsgPack, list30MsgPackLen);
+  return list30MsgPackLen;
+}
+
+#endif // HAVE_ARDUINOJSON
+
+// ==================== WEBSOCKET FAN-OUT ====================
+
+// One dashboard update to N clients: notifyWebClients(String) per phase
+// transition (before) vs. the coalescing shared-buffer broadcaster
+static AsyncWebSocket fakeWs("/ws");
+static int fanoutClients = -1;
+
+static String buildSnapshot() {
+  return String("{\"polling_active\":true,\"current_device_index\":7,\"total_devices\":15,"
+                "\"elapsed_ms\":183500,\"census_active\":false,\"current_device_id\":\"ED0-00008\","
+                "\"current_phase\":\"DATA_COLLECTION\"}");
+}
+
+static void useClients(int count) {
+  if (fanoutClients == count) return;
+  for (int i = 1; i <= fanoutClients; i++) wsClientDisconnected(i);
+  fakeWs.setClients(count);
+  for (int i = 1; i <= count; i++) wsClientConnected(i);
+  fanoutClients = count;
+}
+
+static size_t fanoutLegacy(int clients, int updates) {
+  useClients(clients);
+  for (int u = 0; u < updates; u++) fakeWs.textAll(buildSnapshot());
+  return updates;                          // Snapshots actually sent
+}
+
+static size_t fanoutShared(int clients, int updates) {
+  useClients(clients);
+  uint32_t before = wsGetStats().flushes;
+  for (int u = 0; u < updates; u++) wsNotify(WS_TOPIC_POLLING);
+  hostMicros += WS_COALESCE_MS * 1000UL;
+  wsService(millis());
+  return wsGetStats().flushes - before;   // Snapshots actually sent
+}
+
+static size_t benchFanoutLegacy1()     { return fanoutLegacy(1, 1); }
+static size_t benchFanoutLegacy5()     { return fanoutLegacy(5, 1); }
+static size_t benchFanoutLegacy20()    { return fanoutLegacy(20, 1); }
+static size_t benchFanoutShared1()     { return fanoutShared(1, 1); }
+static size_t benchFanoutShared5()     { return fanoutShared(5, 1); }
+static size_t benchFanoutShared20()    { return fanoutShared(20, 1); }
+static size_t benchBurstLegacy20()     { return fanoutLegacy(20, 5); }
+static size_t benchBurstShared20()     { return fanoutShared(20, 5); }
+
+// ==================== FLEET SNAPSHOTS ====================
+
+// Writer side of every phase boundary (fillFleetSnapshot() copying 15
+// devices) and the reader side of every dashboard / status build
+static DeviceInfo liveDevices[15];
+static int liveOrder[15];
+
+static void fillLive(FleetSnapshot& snapshot) {
+  snapshot.numDevices = 15;
+  for (int i = 0; i < 15; i++) snapshot.devices[i] = liveDevices[i];
+  memcpy(snapshot.pollOrder, liveOrder, sizeof(liveOrder));
+  snapshot.pollingActive = true;
+  snapshot.censusActive = false;
+  snapshot.currentDeviceIndex = 7;
+  snapshot.cycleDevices = 15;
+  snapshot.pollingStartTime = 0;
+  snapshot.totalMessages = 123456;
+  snapshot.truncatedDetections = 0;
+  snapshot.successfulPolls = 9876;
+  snapshot.failedPolls = 54;
+}
+
+static void initLiveFleet() {
+  for (int i = 0; i < 15; i++) {
+    char id[16];
+    snprintf(id, sizeof(id), "ED0-%05d", i + 1);
+    liveDevices[i].deviceId = id;
+    liveDevices[i].sharedSecret = "0123456789abcdef0123456789abcdef";
+    liveDevices[i].tableLeft = "BLR-13-IL-02";
+    liveDevices[i].tableRight = "BLR-13-IL-01";
+    liveOrder[i] = i;
+  }
+  fleetSnapshotInit(fillLive);
+}
+
+static size_t benchFleetPublish() {
+  uint32_t before = fleetSnapshotGetStats().version;
+  fleetPublish();
+  return fleetSnapshotGetStats().version - before;   // Snapshots published
+}
+
+static size_t benchFleetRead() {
+  FleetReader snapshot;
+  return snapshot->devices[snapshot->pollOrder[snapshot->currentDeviceIndex]].deviceId.length();
+}
+
+// ==================== REGISTRY ====================
+
+static const Bench BENCHES[] = {
+  { "parse_message",            benchParseMessage },
+  { "parse_message_string",     benchParseMessageString },
+  { "parse_data_payload",       benchParseDataPayload },
+  { "parse_health_payload",     benchParseHealthPayload },
+  { "calculate_hmac",           benchCalculateHMAC },
+  { "calculate_hmac_string",    benchCalculateHMACString },
+  { "verify_hmac",              benchVerifyHMAC },
+  { "build_message",            benchBuildMessage },
+  { "frame_build",              benchFrameBuild },
+  { "hex_encode_255",           benchHexEncode },
+  { "hex_decode_255",           benchHexDecode },
+  { "dispatch_strings_6",       benchDispatchStrings },
+  { "dispatch_switch_6",        benchDispatchSwitch },
+  { "ws_fanout_legacy_1",       benchFanoutLegacy1 },
+  { "ws_fanout_legacy_5",       benchFanoutLegacy5 },
+  { "ws_fanout_legacy_20",      benchFanoutLegacy20 },
+  { "ws_fanout_shared_1",       benchFanoutShared1 },
+  { "ws_fanout_shared_5",       benchFanoutShared5 },
+  { "ws_fanout_shared_20",      benchFanoutShared20 },
+  { "ws_burst5_legacy_20",      benchBurstLegacy20 },
+  { "ws_burst5_shared_20",      benchBurstShared20 },
+  { "fleet_publish_15",         benchFleetPublish },
+  { "fleet_read",               benchFleetRead },
+#ifdef HAVE_ARDUINOJSON
+  { "json_device_list_15",      benchDeviceList15 },
+  { "json_device_list_30",      benchDeviceList30 },
+  { "json_device_list_256",     benchDeviceList256 },
+  { "json_polling_status_15",   benchPollStatus15 },
+  { "json_polling_status_30",   benchPollStatus30 },
+  { "json_polling_status_256",  benchPollStatus256 },
+  { "codec_device_json",        benchDeviceJson },
+  { "codec_device_msgpack",     benchDeviceMsgPack },
+  { "codec_list30_json",        benchList30Json },
+  { "codec_list30_msgpack",     benchList30MsgPack },
+  { "codec_list30_json_parse",  benchList30JsonParse },
+  { "codec_list30_mp_parse",    benchList30MsgPackParse },
+#endif
+};
+
+static const int NUM_BENCHES = sizeof(BENCHES) / sizeof(BENCHES[0]);
+
+int main(int argc, char** argv) {
+  bool json = false;
+  const char* filter = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--json") == 0) {
+      json = true;
+    } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+      filter = argv[++i];
+    } else {
+      fprintf(stderr, "usage: %s [--json] [--filter SUBSTRING]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  initFixtures();
+  wsBroadcastInit(&fakeWs, buildSnapshot, buildSnapshot);
+  initLiveFleet();
+#ifdef HAVE_ARDUINOJSON
+  initFleet();
+  fleet15 = fleetOf(15);
+  fleet30 = fleetOf(30);
+  fleet256 = fleetOf(256);
+  initEncodingFixtures();
+#else
+  if (!json) fprintf(stderr, "[BENCH] ArduinoJson not found - JSON benchmarks skipped\n");
+#endif
+
+  if (json) {
+    printf("{\n  \"benchmarks\": {");
+  } else {
+    printf("%-26s %12s %10s %12s %8s\n", "benchmark", "ns/op", "allocs/op", "bytes/op", "output");
+  }
+
+  bool first = true;
+  for (int i = 0; i < NUM_BENCHES; i++) {
+    if (filter && !strstr(BENCHES[i].name, filter)) continue;
+    BenchResult r = runBench(BENCHES[i]);
+
+    if (json) {
+      printf("%s\n    \"%s\": {\"ns_per_op\": %.1f, \"allocs_per_op\": %.2f, \"bytes_per_op\": %.1f, \"output\": %zu}",
+             first ? "" : ",", BENCHES[i].name, r.nsPerOp, r.allocsPerOp, r.bytesPerOp, r.output);
+    } else {
+      printf("%-26s %12.1f %10.2f %12.1f %8zu\n",
+             BENCHES[i].name, r.nsPerOp, r.allocsPerOp, r.bytesPerOp, r.output);
+    }
+    fflush(stdout);
+    first = false;
+  }
+
+  if (json) printf("\n  }\n}\n");
+  return 0;
+}
@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+"""
+DETECTRA Gateway v2.0 - Benchmark regression check
+
+Compares a detectra_bench --json run against the stored baseline.
+
+Fails (exit 1) when a benchmark
+  - got slower than baseline * (1 + tolerance), or
+  - allocates more often / more bytes per op than the baseline.
+
+Usage:
+  python3 compare.py baseline.json results.json [--tolerance 0.25]
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        return json.load(f)["benchmarks"]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare benchmark results against a baseline")
+    parser.add_argument("baseline")
+    parser.add_argument("results")
+    parser.add_argument("--tolerance", type=float, default=0.25,
+                        help="allowed ns/op slowdown as a fraction (default 0.25 = +25%%)")
+    args = parser.parse_args()
+
+    baseline = load(args.baseline)
+    results = load(args.results)
+    failures = 0
+
+    print("%-26s %12s %12s %8s  %s" % ("benchmark", "base ns/op", "ns/op", "delta", "allocs/op"))
+
+    for name, cur in results.items():
+        base = baseline.get(name)
+        if base is None:
+            print("%-26s %12s %12.1f %8s  %.2f  (new, not in baseline)" %
+                  (name, "-", cur["ns_per_op"], "-", cur["allocs_per_op"]))
+            continue
+
+        delta = (cur["ns_per_op"] - base["ns_per_op"]) / base["ns_per_op"]
+        problems = []
+        if delta > args.tolerance:
+            problems.append("slower than +%d%%" % round(args.tolerance * 100))
+        if cur["allocs_per_op"] > base["allocs_per_op"]:
+            problems.append("allocs %.2f -> %.2f" % (base["allocs_per_op"], cur["allocs_per_op"]))
+        if cur["bytes_per_op"] > base["bytes_per_op"]:
+            problems.append("bytes %.1f -> %.1f" % (base["bytes_per_op"], cur["bytes_per_op"]))
+
+        print("%-26s %12.1f %12.1f %+7.1f%%  %.2f  %s" %
+              (name, base["ns_per_op"], cur["ns_per_op"], delta * 100, cur["allocs_per_op"],
+               "REGRESSION: " + ", ".join(problems) if problems else "ok"))
+        failures += len(problems) > 0
+
+    for name in baseline:
+        if name not in results:
+            print("%-26s (in baseline, not run)" % name)
+
+    if failures:
+        print("\n%d benchmark(s) regressed" % failures)
+        return 1
+
+    print("\nNo regressions")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,161 @@
+/**
+ * Host build shim for the Arduino core (benchmarks only)
+ *
+ * String follows the ESP32 WString allocation pattern - one heap buffer,
+ * grown with realloc on concat - so allocation counts measured on the host
+ * track what the gateway pays. Only the members used by the protocol and
+ * JSON modules are provided.
+ */
+
+#ifndef BENCH_HOST_ARDUINO_H
+#define BENCH_HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+
+typedef uint8_t byte;
+
+// Simulated clock - fixed unless a benchmark advances it, so timestamps
+// (and therefore frame lengths and allocation sizes) are reproducible
+extern unsigned long hostMicros;
+
+inline unsigned long micros() { return hostMicros; }
+inline unsigned long millis() { return hostMicros / 1000; }
+inline uint32_t esp_random() { return (uint32_t)rand(); }
+
+class String {
+public:
+  String() : buf_(NULL), len_(0), cap_(0) {}
+  String(const char* s) : buf_(NULL), len_(0), cap_(0) { if (s) copy(s, strlen(s)); }
+  String(const String& o) : buf_(NULL), len_(0), cap_(0) { copy(o.c_str(), o.len_); }
+  String(char c) : buf_(NULL), len_(0), cap_(0) { copy(&c, 1); }
+  String(int v) : buf_(NULL), len_(0), cap_(0) { fmt("%d", v); }
+  String(unsigned int v) : buf_(NULL), len_(0), cap_(0) { fmt("%u", v); }
+  String(long v) : buf_(NULL), len_(0), cap_(0) { fmt("%ld", v); }
+  String(unsigned long v) : buf_(NULL), len_(0), cap_(0) { fmt("%lu", v); }
+  String(float v, unsigned int decimals = 2) : buf_(NULL), len_(0), cap_(0) { fmt("%.*f", (int)decimals, (double)v); }
+  String(double v, unsigned int decimals = 2) : buf_(NULL), len_(0), cap_(0) { fmt("%.*f", (int)decimals, v); }
+  ~String() { free(buf_); }
+
+  String& operator=(const String& o) { if (this != &o) copy(o.c_str(), o.len_); return *this; }
+  String& operator=(const char* s) { copy(s ? s : "", s ? strlen(s) : 0); return *this; }
+
+  unsigned int length() const { return len_; }
+  const char* c_str() const { return buf_ ? buf_ : ""; }
+  bool isEmpty() const { return len_ == 0; }
+
+  bool reserve(unsigned int size) {
+    if (buf_ && cap_ >= size) return true;
+    char* p = (char*)realloc(buf_, size + 1);
+    if (!p) return false;
+    if (!buf_) p[0] = '\0';
+    buf_ = p;
+    cap_ = size;
+    return true;
+  }
+
+  bool concat(const char* s, unsigned int n) {
+    if (n == 0) return true;
+    if (!reserve(len_ + n)) return false;
+    memcpy(buf_ + len_, s, n);
+    len_ += n;
+    buf_[len_] = '\0';
+    return true;
+  }
+  bool concat(const char* s) { return s ? concat(s, strlen(s)) : false; }
+  bool concat(const String& s) { return concat(s.c_str(), s.len_); }
+  bool concat(char c) { return concat(&c, 1); }
+
+  String& operator+=(const String& s) { concat(s); return *this; }
+  String& operator+=(const char* s) { concat(s); return *this; }
+  String& operator+=(char c) { concat(c); return *this; }
+
+  char operator[](unsigned int i) const { return i < len_ ? buf_[i] : 0; }
+  char& operator[](unsigned int i) { static char dummy; return i < len_ ? buf_[i] : dummy; }
+  char charAt(unsigned int i) const { return (*this)[i]; }
+
+  bool operator==(const String& o) const { return len_ == o.len_ && memcmp(c_str(), o.c_str(), len_) == 0; }
+  bool operator==(const char* s) const { return strcmp(c_str(), s ? s : "") == 0; }
+  bool operator!=(const String& o) const { return !(*this == o); }
+  bool operator!=(const char* s) const { return !(*this == s); }
+
+  int indexOf(char c, unsigned int from = 0) const {
+    if (from >= len_) return -1;
+    const char* p = strchr(c_str() + from, c);
+    return p ? (int)(p - c_str()) : -1;
+  }
+  int lastIndexOf(char c) const {
+    const char* p = strrchr(c_str(), c);
+    return p ? (int)(p - c_str()) : -1;
+  }
+  String substring(unsigned int from) const { return substring(from, len_); }
+  String substring(unsigned int from, unsigned int to) const {
+    if (from > to) { unsigned int t = from; from = to; to = t; }
+    if (from >= len_) return String();
+    if (to > len_) to = len_;
+    String r;
+    r.concat(c_str() + from, to - from);
+    return r;
+  }
+  bool startsWith(const String& p) const { return p.len_ <= len_ && memcmp(c_str(), p.c_str(), p.len_) == 0; }
+
+  void toLowerCase() { for (unsigned int i = 0; i < len_; i++) buf_[i] = tolower(buf_[i]); }
+  void toUpperCase() { for (unsigned int i = 0; i < len_; i++) buf_[i] = toupper(buf_[i]); }
+  long toInt() const { return atol(c_str()); }
+
+  // Read-only byte access for ArduinoJson's string adapter
+  const char* begin() const { return c_str(); }
+
+private:
+  char* buf_;
+  unsigned int len_;
+  unsigned int cap_;
+
+  void copy(const char* s, unsigned int n) {
+    len_ = 0;
+    if (buf_) buf_[0] = '\0';
+    concat(s, n);
+    if (!buf_) reserve(0);
+  }
+
+  template <typename T>
+  void fmt(const char* f, T v) {
+    char tmp[32];
+    int n = snprintf(tmp, sizeof(tmp), f, v);
+    copy(tmp, (unsigned int)n);
+  }
+
+  void fmt(const char* f, int decimals, double v) {
+    char tmp[64];
+    int n = snprintf(tmp, sizeof(tmp), f, decimals, v);
+    copy(tmp, (unsigned int)n);
+  }
+};
+
+inline String operator+(const String& a, const String& b) { String r(a); r += b; return r; }
+inline String operator+(const String& a, const char* b) { String r(a); r += b; return r; }
+inline String operator+(const char* a, const String& b) { String r(a); r += b; return r; }
+
+// Serial output is discarded so logging does not distort timings
+struct HostSerial {
+  template <typename T> size_t print(const T&) { return 0; }
+  template <typename T> size_t println(const T&) { return 0; }
+  size_t println() { return 0; }
+};
+extern HostSerial Serial;
+
+// FreeRTOS - the benchmarks are single-threaded, locks are no-ops
+typedef void* SemaphoreHandle_t;
+#define portMAX_DELAY 0xFFFFFFFFUL
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return (SemaphoreHandle_t)1; }
+inline int xSemaphoreTake(SemaphoreHandle_t, unsigned long) { return 1; }
+inline int xSemaphoreGive(SemaphoreHandle_t) { return 1; }
+inline SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() { return (SemaphoreHandle_t)1; }
+inline int xSemaphoreTakeRecursive(SemaphoreHandle_t, unsigned long) { return 1; }
+inline int xSemaphoreGiveRecursive(SemaphoreHandle_t) { return 1; }
+
+#endif // BENCH_HOST_ARDUINO_H
@@ -0,0 +1,110 @@
+/**
+ * Host build shim for ESPAsyncWebServer's WebSocket (benchmarks only)
+ *
+ * Mirrors the heap traffic of the 1.2.x library on the send path; the
+ * messages are freed again right away because nothing goes out on TCP:
+ *
+ * - text(const char*, len) / textAll(String): one message object plus a
+ *   copy of the payload per client (AsyncWebSocketBasicMessage).
+ * - makeBuffer(len): one shared payload; text(buffer) then only allocates
+ *   the message object per client (AsyncWebSocketMultiMessage).
+ */
+
+#ifndef BENCH_HOST_ESPASYNCWEBSERVER_H
+#define BENCH_HOST_ESPASYNCWEBSERVER_H
+
+#include <Arduino.h>
+
+#define HOST_WS_MESSAGE_BYTES   48      // sizeof(AsyncWebSocketBasicMessage) on the ESP32
+#define HOST_WS_MAX_CLIENTS     32
+
+// Keeps the compiler from eliding the malloc/free pairs below
+static void* volatile hostWsQueued;
+
+class AsyncWebSocketMessageBuffer {
+public:
+  explicit AsyncWebSocketMessageBuffer(size_t length)
+    : data_((uint8_t*)malloc(length)), length_(length), count_(0) {}
+  ~AsyncWebSocketMessageBuffer() { free(data_); }
+
+  uint8_t* get() { return data_; }
+  size_t length() const { return length_; }
+  void lock() { count_++; }
+  void unlock() { if (count_ > 0) count_--; }
+  bool canDelete() const { return count_ == 0; }
+
+private:
+  uint8_t* data_;
+  size_t length_;
+  int count_;
+};
+
+class AsyncWebSocketClient {
+public:
+  AsyncWebSocketClient() : id_(0), full_(false) {}
+
+  uint32_t id() const { return id_; }
+  bool queueIsFull() const { return full_; }
+
+  void text(const char* message, size_t length) {
+    void* msg = malloc(HOST_WS_MESSAGE_BYTES);
+    void* copy = malloc(length);
+    memcpy(copy, message, length);
+    hostWsQueued = msg;
+    hostWsQueued = copy;
+    free(copy);
+    free(msg);
+  }
+  void text(const String& message) { text(message.c_str(), message.length()); }
+
+  void text(AsyncWebSocketMessageBuffer* buffer) {
+    void* msg = malloc(HOST_WS_MESSAGE_BYTES);
+    hostWsQueued = msg;
+    buffer->lock();
+    buffer->unlock();
+    free(msg);
+  }
+
+  uint32_t id_;
+  bool full_;                       // Simulated full send queue
+};
+
+class AsyncWebSocket {
+public:
+  explicit AsyncWebSocket(const char*) : numClients_(0), buffer_(NULL) {}
+
+  void setClients(int count) {
+    numClients_ = count;
+    for (int i = 0; i < count; i++) clients_[i].id_ = i + 1;
+  }
+
+  AsyncWebSocketClient* client(uint32_t id) {
+    for (int i = 0; i < numClients_; i++) {
+      if (clients_[i].id_ == id) return &clients_[i];
+    }
+    return NULL;
+  }
+
+  void textAll(const String& message) {
+    for (int i = 0; i < numClients_; i++) clients_[i].text(message);
+  }
+
+  AsyncWebSocketMessageBuffer* makeBuffer(size_t length) {
+    buffer_ = new AsyncWebSocketMessageBuffer(length);
+    return buffer_;
+  }
+
+  void _cleanBuffers() {
+    if (buffer_ != NULL && buffer_->canDelete()) {
+      delete buffer_;
+      buffer_ = NULL;
+    }
+  }
+
+private:
+  AsyncWebSocketClient clients_[HOST_WS_MAX_CLIENTS];
+  int numClients_;
+  AsyncWebSocketMessageBuffer* buffer_;
+};
+
+#endif // BENCH_HOST_ESPASYNCWEBSERVER_H
@@ -0,0 +1,19 @@
+/**
+ * Host build shim for esp_heap_caps.h (benchmarks and simulators only)
+ *
+ * Every capability maps to malloc - the host has one heap.
+ */
+
+#ifndef BENCH_HOST_ESP_HEAP_CAPS_H
+#define BENCH_HOST_ESP_HEAP_CAPS_H
+
+#include <stdlib.h>
+
+#define MALLOC_CAP_8BIT      (1 << 2)
+#define MALLOC_CAP_SPIRAM    (1 << 10)
+#define MALLOC_CAP_INTERNAL  (1 << 11)
+
+inline void* heap_caps_malloc(size_t size, unsigned int) { return malloc(size); }
+inline void heap_caps_free(void* p) { free(p); }
+
+#endif // BENCH_HOST_ESP_HEAP_CAPS_H
@@ -0,0 +1,17 @@
+/**
+ * Host build shim for esp_timer.h (benchmarks and simulators only)
+ *
+ * Follows the simulated clock of Arduino.h, so gateway time is as
+ * reproducible as millis().
+ */
+
+#ifndef BENCH_HOST_ESP_TIMER_H
+#define BENCH_HOST_ESP_TIMER_H
+
+#include <stdint.h>
+
+extern unsigned long hostMicros;
+
+inline int64_t esp_timer_get_time() { return (int64_t)hostMicros; }
+
+#endif // BENCH_HOST_ESP_TIMER_H
@@ -0,0 +1,59 @@
+/**
+ * Host build shim for mbedtls/md.h (benchmarks only)
+ *
+ * Maps the HMAC subset used by lora_protocol.cpp onto OpenSSL 3 EVP_MAC.
+ * mbedtls_md_setup() allocates on the ESP32 as well, so the HMAC
+ * allocation counts are representative, byte counts are not.
+ */
+
+#ifndef BENCH_HOST_MBEDTLS_MD_H
+#define BENCH_HOST_MBEDTLS_MD_H
+
+#include <openssl/hmac.h>
+#include <openssl/evp.h>
+
+typedef enum { MBEDTLS_MD_SHA256 } mbedtls_md_type_t;
+typedef struct { int unused; } mbedtls_md_info_t;
+
+typedef struct {
+  EVP_MAC_CTX* ctx;
+} mbedtls_md_context_t;
+
+inline const mbedtls_md_info_t* mbedtls_md_info_from_type(mbedtls_md_type_t) {
+  static mbedtls_md_info_t info;
+  return &info;
+}
+
+inline void mbedtls_md_init(mbedtls_md_context_t* c) {
+  c->ctx = NULL;
+}
+
+inline int mbedtls_md_setup(mbedtls_md_context_t* c, const mbedtls_md_info_t*, int) {
+  static EVP_MAC* mac = EVP_MAC_fetch(NULL, "HMAC", NULL);
+  c->ctx = EVP_MAC_CTX_new(mac);
+  return c->ctx ? 0 : -1;
+}
+
+inline int mbedtls_md_hmac_starts(mbedtls_md_context_t* c, const unsigned char* key, size_t keyLength) {
+  OSSL_PARAM params[] = {
+    OSSL_PARAM_construct_utf8_string("digest", (char*)"SHA256", 0),
+    OSSL_PARAM_construct_end()
+  };
+  return EVP_MAC_init(c->ctx, key, keyLength, params) == 1 ? 0 : -1;
+}
+
+inline int mbedtls_md_hmac_update(mbedtls_md_context_t* c, const unsigned char* input, size_t length) {
+  return EVP_MAC_update(c->ctx, input, length) == 1 ? 0 : -1;
+}
+
+inline int mbedtls_md_hmac_finish(mbedtls_md_context_t* c, unsigned char* output) {
+  size_t outLength = 0;
+  return EVP_MAC_final(c->ctx, output, &outLength, 32) == 1 ? 0 : -1;
+}
+
+inline void mbedtls_md_free(mbedtls_md_context_t* c) {
+  EVP_MAC_CTX_free(c->ctx);
+  c->ctx = NULL;
+}
+
+#endif // BENCH_HOST_MBEDTLS_MD_H
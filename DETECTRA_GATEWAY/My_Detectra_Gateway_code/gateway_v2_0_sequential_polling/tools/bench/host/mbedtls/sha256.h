@@ -0,0 +1,18 @@
+/**
+ * Host build shim for mbedtls/sha256.h (benchmarks and simulators only)
+ *
+ * The one-shot mbedtls 2.x call used by bulk_transfer.cpp, on OpenSSL.
+ */
+
+#ifndef BENCH_HOST_MBEDTLS_SHA256_H
+#define BENCH_HOST_MBEDTLS_SHA256_H
+
+#include <openssl/sha.h>
+
+inline int mbedtls_sha256_ret(const unsigned char* input, size_t length, unsigned char output[32], int is224) {
+  (void)is224;
+  SHA256(input, length, output);
+  return 0;
+}
+
+#endif // BENCH_HOST_MBEDTLS_SHA256_H
@@ -0,0 +1,469 @@
+/**
+ * DETECTRA Gateway v2.0 - Bulk Transfer Simulator
+ *
+ * Runs the gateway's bulk transfer engine (bulk_transfer.cpp) against
+ * simulated edge devices on a simulated clock. Every frame is built with
+ * the gateway's frame code and parsed with parseMessage(), so the payload
+ * formats are exercised end to end.
+ *
+ * The device side here is the reference implementation of the BLK_*
+ * protocol (lora_protocol.h) for the RPi firmware:
+ *
+ * - BLK_OFFER: keep the chunks already held for the same SHA-256 (resume),
+ *   reply BLK_STATUS
+ * - BLK_DATA: store the chunk, verify the hash once all chunks are in,
+ *   reply BLK_STATUS if the frame carries the 'A' flag
+ * - BLK_QUERY: reply BLK_STATUS (UNKNOWN for a transfer it does not know)
+ *
+ * The radio model: every receiver loses a frame with --loss probability,
+ * the gateway does not hear replies while it transmits, and the channel is
+ * busy with polling cycles (--cadence / --cycle), which the engine must
+ * leave alone. Each cycle's own gateway airtime (--poll-airtime) is charged
+ * to the duty-cycle budget like the gateway's polls are.
+ *
+ * Every gateway frame is logged; the run fails if any hour of it is over
+ * the duty-cycle budget.
+ *
+ * Usage:
+ *   ./bulk_sim                                 5 devices, 20 KB blob, 5 % loss
+ *   ./bulk_sim --devices 10 --size 65536 --loss 0.1
+ *   ./bulk_sim --outage 2:600:1800             Device 2 offline at 600 s for 1800 s, then reboots
+ *   ./bulk_sim --corrupt 1                     Device 1 stores one chunk wrongly (hash failure)
+ *   ./bulk_sim --duty 100                      10 % duty-cycle sub-band
+ *   ./bulk_sim --poll-airtime 3000             3 s of gateway frames per polling cycle
+ */
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <Arduino.h>
+#include <openssl/sha.h>
+#include "lora_protocol.h"
+#include "lora_frame.h"
+#include "bulk_transfer.h"
+
+HostSerial Serial;
+unsigned long hostMicros = 0;
+
+#define SIM_GATEWAY_ID      "GW0-00001"
+#define SIM_STEP_MS         100           // pollingTask loop period
+#define SIM_TURNAROUND_MS   200           // Device RX -> TX
+#define SIM_SF              9
+#define SIM_BW              125
+#define SIM_CR_DENOM        6
+#define SIM_PREAMBLE        8
+
+// ==================== OPTIONS ====================
+
+struct Outage {
+  int device;
+  unsigned long startMs;
+  unsigned long endMs;
+};
+
+struct Options {
+  int devices = 5;
+  size_t size = 20000;
+  double loss = 0.05;
+  unsigned int duty = BULK_DUTY_PERMILLE;
+  unsigned long cadenceMs = 300000;
+  unsigned long cycleMs = 40000;
+  unsigned long pollAirtimeMs = 1000;
+  unsigned long limitMs = 48UL * 3600 * 1000;
+  unsigned int seed = 1;
+  int corrupt = -1;
+  std::vector<Outage> outages;
+};
+
+static double chance() {
+  return rand() / (RAND_MAX + 1.0);
+}
+
+static unsigned long airtime(size_t frameBytes) {
+  return loraAirtimeMs(frameBytes, SIM_SF, SIM_BW, SIM_CR_DENOM, SIM_PREAMBLE);
+}
+
+// ==================== SIMULATED DEVICE ====================
+
+struct SimDevice {
+  std::string id;
+  std::vector<Outage> outages;
+  bool corruptOnce = false;
+
+  // Transfer state (chunks are kept by hash, across reboots)
+  bool known = false;               // Transfer ID in RAM
+  uint16_t transferId = 0;
+  uint32_t size = 0;
+  uint16_t chunks = 0;
+  uint8_t sha[BULK_HASH_BYTES] = {};
+  std::vector<uint8_t> data;
+  std::vector<bool> have;
+  bool installed = false;
+  bool hashFailed = false;          // Reported once, then the chunks are requested again
+
+  unsigned long framesHeard = 0;
+  unsigned long replies = 0;
+  unsigned long airtimeMs = 0;
+  unsigned long installedAtMs = 0;
+
+  bool online(unsigned long now) {
+    for (const Outage& o : outages) {
+      if (now >= o.startMs && now < o.endMs) return false;
+    }
+    return true;
+  }
+
+  void reboot() {
+    known = false;                  // RAM state lost; chunks on the SD card remain
+  }
+
+  BulkStatus status() {
+    BulkStatus s;
+    memset(&s, 0, sizeof(s));
+    s.transferId = transferId;
+    if (installed) {
+      s.kind = BULK_STATUS_DONE;
+    } else if (hashFailed) {
+      s.kind = BULK_STATUS_HASH_FAIL;
+      hashFailed = false;
+    } else {
+      s.kind = BULK_STATUS_PROGRESS;
+      while (s.base < chunks && have[s.base]) s.base++;
+      for (int n = 0; n < BULK_ACK_SPAN && s.base + n < chunks; n++) {
+        if (have[s.base + n]) s.bitmap[n / 8] |= 1 << (n % 8);
+      }
+    }
+    return s;
+  }
+
+  void verify(unsigned long now) {
+    uint8_t digest[BULK_HASH_BYTES];
+    SHA256(data.data(), size, digest);
+    if (memcmp(digest, sha, BULK_HASH_BYTES) == 0) {
+      installed = true;
+      installedAtMs = now;
+    } else {
+      hashFailed = true;
+      have.assign(chunks, false);
+    }
+  }
+
+  /**
+   * Handle one gateway frame
+   *
+   * @return true with reply filled if the device answers
+   */
+  bool handle(const LoRaMessage& msg, unsigned long now, char* reply, size_t capacity) {
+    bool forMe = msg.targetId == id.c_str();
+    if (!forMe && !(msg.targetId == BROADCAST_ID)) return false;
+    framesHeard++;
+
+    if (msg.commandId == LORA_CMD_BLK_OFFER && forMe) {
+      uint16_t tid, count;
+      uint32_t blobSize;
+      uint8_t hash[BULK_HASH_BYTES];
+      char name[BULK_NAME_MAX + 1];
+      if (!parseBulkOffer(msg, tid, blobSize, count, hash, name)) return false;
+
+      if (memcmp(hash, sha, BULK_HASH_BYTES) != 0 || blobSize != size) {
+        memcpy(sha, hash, BULK_HASH_BYTES);
+        size = blobSize;
+        chunks = count;
+        data.assign(size, 0);
+        have.assign(chunks, false);
+        installed = false;
+        hashFailed = false;
+      }
+      known = true;
+      transferId = tid;
+      return buildBulkStatus(reply, capacity, status()) > 0;
+    }
+
+    if (msg.commandId == LORA_CMD_BLK_DATA) {
+      uint16_t tid, index;
+      bool ack;
+      uint8_t chunk[BULK_CHUNK_BYTES];
+      int length = parseBulkChunk(msg, tid, index, ack, chunk);
+      if (length < 0 || !known || tid != transferId || index >= chunks) return false;
+
+      if (!installed && !have[index]) {
+        if (corruptOnce && index == chunks / 2) {
+          chunk[0] ^= 0xFF;
+          corruptOnce = false;
+        }
+        memcpy(&data[(size_t)index * BULK_CHUNK_BYTES], chunk, length);
+        have[index] = true;
+
+        bool complete = true;
+        for (bool h : have) complete = complete && h;
+        if (complete) verify(now);
+      }
+      return ack && forMe && buildBulkStatus(reply, capacity, status()) > 0;
+    }
+
+    if (msg.commandId == LORA_CMD_BLK_QUERY && forMe) {
+      uint16_t tid = (uint16_t)atoi(msg.payload.c_str());
+      if (!known || tid != transferId) {
+        snprintf(reply, capacity, "%u:UNKNOWN", tid);
+        return true;
+      }
+      return buildBulkStatus(reply, capacity, status()) > 0;
+    }
+
+    if (msg.commandId == LORA_CMD_BLK_ABORT) {
+      if (known && (uint16_t)atoi(msg.payload.c_str()) == transferId) known = false;
+    }
+    return false;
+  }
+};
+
+// ==================== RADIO ====================
+
+struct Uplink {
+  unsigned long startMs;            // Reply on air
+  unsigned long endMs;
+  std::string frame;
+  bool lost;
+};
+
+static std::vector<SimDevice> devices;
+static std::vector<Uplink> uplinks;
+static Options options;
+static unsigned long gatewayFrames = 0;
+static unsigned long deviceAirtimeMs = 0;
+static unsigned long collisions = 0;
+static std::vector<std::pair<unsigned long, unsigned long>> txLog;  // Gateway frames: start, airtime
+
+/**
+ * Most gateway airtime in any hour of the run
+ */
+static unsigned long busiestHourMs() {
+  unsigned long best = 0, sum = 0;
+  size_t first = 0;
+  for (size_t i = 0; i < txLog.size(); i++) {
+    sum += txLog[i].second;
+    while (txLog[i].first - txLog[first].first >= 3600000UL) sum -= txLog[first++].second;
+    if (sum > best) best = sum;
+  }
+  return best;
+}
+
+static size_t simSend(const char* command, const char* targetId, const char* payload) {
+  unsigned long now = millis();
+
+  static TxFrame frame;
+  frameBegin(frame, SIM_GATEWAY_ID, command, targetId, 1, getCurrentTimestamp());
+  frameAppend(frame, payload);
+  if (!frameFinish(frame, NULL)) return 0;
+
+  unsigned long txEnd = now + airtime(frame.textLen);
+  gatewayFrames++;
+  txLog.push_back(std::make_pair(now, airtime(frame.textLen)));
+
+  // Half duplex: replies on air while we transmit are not heard
+  for (Uplink& u : uplinks) {
+    if (!u.lost && u.startMs < txEnd && u.endMs > now) {
+      u.lost = true;
+      collisions++;
+    }
+  }
+
+  LoRaMessage msg = parseMessage(String(frame.text));
+  if (!msg.valid) return frame.textLen;
+
+  for (SimDevice& device : devices) {
+    if (!device.online(txEnd) || chance() < options.loss) continue;
+
+    char reply[LORA_MAX_FRAME + 1];
+    if (!device.handle(msg, txEnd, reply, sizeof(reply))) continue;
+
+    TxFrame up;
+    frameBegin(up, device.id.c_str(), CMD_BLK_STATUS, SIM_GATEWAY_ID, 1, getCurrentTimestamp());
+    frameAppend(up, reply);
+    if (!frameFinish(up, NULL)) continue;
+
+    unsigned long upAirtime = airtime(up.textLen);
+    Uplink u;
+    u.startMs = txEnd + SIM_TURNAROUND_MS;
+    u.endMs = u.startMs + upAirtime;
+    u.frame = up.text;
+    u.lost = chance() < options.loss;
+    uplinks.push_back(u);
+
+    device.replies++;
+    device.airtimeMs += upAirtime;
+    deviceAirtimeMs += upAirtime;
+  }
+  return frame.textLen;
+}
+
+static void deliverUplinks(unsigned long now) {
+  for (size_t i = 0; i < uplinks.size();) {
+    if (uplinks[i].endMs > now) {
+      i++;
+      continue;
+    }
+    if (!uplinks[i].lost) {
+      LoRaMessage msg = parseMessage(String(uplinks[i].frame.c_str()));
+      if (msg.valid && msg.commandId == LORA_CMD_BLK_STATUS) bulkHandleStatus(msg, now);
+    }
+    uplinks.erase(uplinks.begin() + i);
+  }
+}
+
+// ==================== MAIN ====================
+
+static void usage() {
+  fprintf(stderr,
+    "Usage: bulk_sim [--devices N] [--size BYTES] [--loss P] [--duty PERMILLE]\n"
+    "                [--cadence S] [--cycle S] [--poll-airtime MS] [--outage DEV:START_S:DURATION_S]...\n"
+    "                [--corrupt DEV] [--limit H] [--seed N]\n");
+}
+
+static bool parseOptions(int argc, char** argv) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (i + 1 >= argc) {
+      usage();
+      return false;
+    }
+    const char* value = argv[++i];
+
+    if (arg == "--devices") options.devices = atoi(value);
+    else if (arg == "--size") options.size = strtoul(value, NULL, 10);
+    else if (arg == "--loss") options.loss = atof(value);
+    else if (arg == "--duty") options.duty = atoi(value);
+    else if (arg == "--cadence") options.cadenceMs = strtoul(value, NULL, 10) * 1000;
+    else if (arg == "--cycle") options.cycleMs = strtoul(value, NULL, 10) * 1000;
+    else if (arg == "--poll-airtime") options.pollAirtimeMs = strtoul(value, NULL, 10);
+    else if (arg == "--limit") options.limitMs = strtoul(value, NULL, 10) * 3600 * 1000;
+    else if (arg == "--seed") options.seed = atoi(value);
+    else if (arg == "--corrupt") options.corrupt = atoi(value);
+    else if (arg == "--outage") {
+      Outage o;
+      unsigned long start, duration;
+      if (sscanf(value, "%d:%lu:%lu", &o.device, &start, &duration) != 3) {
+        usage();
+        return false;
+      }
+      o.startMs = start * 1000;
+      o.endMs = (start + duration) * 1000;
+      options.outages.push_back(o);
+    } else {
+      usage();
+      return false;
+    }
+  }
+
+  if (options.devices < 1 || options.devices > BULK_MAX_TARGETS || options.size == 0 ||
+      options.size > BULK_MAX_BYTES || options.cycleMs >= options.cadenceMs) {
+    fprintf(stderr, "devices 1-%d, size 1-%lu, cycle shorter than cadence\n",
+            BULK_MAX_TARGETS, (unsigned long)BULK_MAX_BYTES);
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  if (!parseOptions(argc, argv)) return 2;
+  srand(options.seed);
+
+  std::vector<std::string> ids;
+  for (int i = 1; i <= options.devices; i++) {
+    char id[16];
+    snprintf(id, sizeof(id), "ED0-%05d", i);
+    SimDevice device;
+    device.id = id;
+    device.corruptOnce = options.corrupt == i;
+    for (const Outage& o : options.outages) {
+      if (o.device == i) device.outages.push_back(o);
+    }
+    devices.push_back(device);
+    ids.push_back(id);
+  }
+
+  bulkInit(simSend, airtime);
+  bulkSetDutyPermille(options.duty);
+
+  uint8_t* blob = bulkReserve(options.size);
+  for (size_t i = 0; i < options.size; i++) blob[i] = (uint8_t)rand();
+
+  const char* targets[BULK_MAX_TARGETS];
+  for (int i = 0; i < options.devices; i++) targets[i] = ids[i].c_str();
+
+  // Polling cycles start half a cadence in (the boot cycle has just finished)
+  unsigned long now = 0;
+  if (options.pollAirtimeMs > 0) {
+    bulkChargeAirtime(options.pollAirtimeMs, now);
+    txLog.push_back(std::make_pair(now, options.pollAirtimeMs));
+  }
+  bulkStart("models/detector.tflite", targets, options.devices, now);
+
+  while (bulkActive() && now < options.limitMs) {
+    hostMicros = (uint64_t)now * 1000;
+    deliverUplinks(now);
+
+    for (SimDevice& device : devices) {
+      for (const Outage& o : device.outages) {
+        if (now == o.endMs) device.reboot();
+      }
+    }
+
+    unsigned long phase = (now + options.cadenceMs / 2) % options.cadenceMs;
+    bool polling = phase < options.cycleMs;
+    if (phase == 0 && options.pollAirtimeMs > 0) {
+      // The cycle's POLL / START_INFER / FINALIZE / ACK frames
+      bulkChargeAirtime(options.pollAirtimeMs, now);
+      txLog.push_back(std::make_pair(now, options.pollAirtimeMs));
+    }
+    if (!polling) bulkService(now, options.cadenceMs - phase);
+
+    now += SIM_STEP_MS;
+  }
+
+  // Report
+  BulkStats stats = bulkGetStats(now);
+  BulkTargetInfo info[BULK_MAX_TARGETS];
+  int count = bulkGetTargets(info, BULK_MAX_TARGETS);
+
+  printf("Blob: %lu bytes in %u chunks to %d devices, loss %.0f %%, duty %.1f %%\n",
+         (unsigned long)stats.size, stats.chunks, count, options.loss * 100, options.duty / 10.0);
+  printf("Polling cycles: %lus every %lus, %.1f s gateway airtime each\n\n",
+         options.cycleMs / 1000, options.cadenceMs / 1000, options.pollAirtimeMs / 1000.0);
+
+  printf("%-11s %-8s %9s %10s %8s %6s %8s %10s\n",
+         "device", "state", "chunks", "done s", "resumes", "hash", "replies", "airtime s");
+  int incomplete = 0;
+  for (int i = 0; i < count; i++) {
+    if (info[i].state != BULK_TARGET_DONE) incomplete++;
+    char chunks[16];
+    snprintf(chunks, sizeof(chunks), "%u/%u", info[i].received, stats.chunks);
+    printf("%-11s %-8s %9s %10.1f %8u %6u %8lu %10.1f\n", info[i].deviceId.c_str(),
+           bulkTargetStateName(info[i].state), chunks, info[i].doneMs / 1000.0, info[i].resumes,
+           info[i].hashFails, devices[i].replies, devices[i].airtimeMs / 1000.0);
+  }
+
+  double elapsedS = stats.elapsedMs / 1000.0;
+  double delivered = (double)stats.size * stats.done;
+  printf("\nElapsed          %.1f s (%.1f h)\n", elapsedS, elapsedS / 3600);
+  printf("Gateway frames   %lu (%lu chunks, %lu shared, %lu retransmitted, %lu timeouts)\n",
+         (unsigned long)stats.frames, (unsigned long)stats.chunksSent, (unsigned long)stats.chunksShared,
+         (unsigned long)stats.retransmissions, (unsigned long)stats.timeouts);
+  printf("Gateway airtime  %.1f s (%.2f %% of elapsed)\n", stats.airtimeMs / 1000.0,
+         elapsedS > 0 ? stats.airtimeMs / elapsedS / 10 : 0.0);
+  printf("Device airtime   %.1f s (%lu replies lost to our own TX)\n", deviceAirtimeMs / 1000.0, collisions);
+  printf("Throughput       %.1f B/s delivered (%.0f bytes to %u devices)\n",
+         elapsedS > 0 ? delivered / elapsedS : 0.0, delivered, stats.done);
+  printf("Airtime per KB   %.2f s gateway per delivered KB (%.2f s per blob KB)\n",
+         delivered > 0 ? stats.airtimeMs / delivered * 1.024 : 0.0,
+         stats.size > 0 ? stats.airtimeMs / (double)stats.size * 1.024 : 0.0);
+  printf("Held back        %lu service calls (idle time / duty budget)\n", (unsigned long)stats.heldBack);
+
+  // Polls included: the budget covers everything the gateway sends
+  unsigned long busiest = busiestHourMs();
+  bool overBudget = busiest > stats.budgetMs;
+  printf("Busiest hour     %.1f s gateway airtime, polls included (budget %.1f s)%s\n",
+         busiest / 1000.0, stats.budgetMs / 1000.0, overBudget ? " - DUTY CYCLE EXCEEDED" : "");
+
+  return incomplete > 0 || overBudget ? 1 : 0;
+}
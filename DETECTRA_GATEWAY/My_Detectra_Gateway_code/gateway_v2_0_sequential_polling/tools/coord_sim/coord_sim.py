@@ -0,0 +1,309 @@
+#!/usr/bin/env python3
+"""
+DETECTRA Gateway v2.0 - Multi-gateway coordination simulator
+
+Runs simulated gateways against an MQTT broker (e.g. a local Mosquitto).
+They speak the same coordination protocol as the firmware
+(gateway_coord.h / gateway_coord.cpp).
+
+  simulate  N simulated gateways announce, split the superframe into windows
+            and "transmit" device polls inside their own window. At the end,
+            every pair of transmissions on the same channel is checked for
+            overlap, and per-gateway airtime is reported.
+
+  monitor   Listen to real (and simulated) gateways and check that the
+            windows they announce on the same channel never overlap.
+
+Usage:
+  python3 coord_sim.py simulate --gateways 3 --duration 900
+  python3 coord_sim.py simulate --gateways 4 --demand 400,100,100,50 --superframe-ms 60000
+  python3 coord_sim.py monitor --duration 600
+
+Requires paho-mqtt (pip install paho-mqtt).
+"""
+
+import argparse
+import json
+import random
+import sys
+import threading
+import time
+
+import paho.mqtt.client as mqtt
+
+TOPIC_PREFIX = "detectra/coord/"
+TOPIC_FILTER = "detectra/coord/+"
+
+# Same values as gateway_coord.h
+SUPERFRAME_MS = 300000
+GUARD_MS = 2000
+CLOCK_MAX_AGE_MS = 500
+ANNOUNCE_MS = 30000
+PEER_TIMEOUT_MS = 95000
+MIN_DEMAND = 50
+
+
+def effective_demand(demand):
+    return max(MIN_DEMAND, min(1000, demand))
+
+
+def compute_window(self_id, self_channel, self_demand, peers, superframe_ms):
+    """Mirror of computeWindow() in gateway_coord.cpp."""
+    total = effective_demand(self_demand)
+    before = 0
+    sharing = 0
+    for peer_id, peer in peers.items():
+        if peer["channel"] != self_channel:
+            continue
+        demand = effective_demand(peer["demand"])
+        total += demand
+        sharing += 1
+        if peer_id < self_id:
+            before += demand
+    if sharing == 0:
+        return 0, superframe_ms, 0
+    start = superframe_ms * before // total
+    length = superframe_ms * effective_demand(self_demand) // total
+    return start, length, sharing
+
+
+def millis():
+    return int(time.monotonic() * 1000)
+
+
+def utc_ms():
+    return int(time.time() * 1000)
+
+
+class SimGateway:
+    def __init__(self, args, gateway_id, channel, demand, poll_ms, transmissions, lock):
+        self.id = gateway_id
+        self.channel = channel
+        self.demand = demand
+        self.poll_ms = poll_ms
+        self.superframe_ms = args.superframe_ms
+        self.announce_ms = args.announce_ms
+        self.boot_offset = random.randint(0, 3_600_000)   # Gateways boot at different times
+        self.clock_offset = 0
+        self.peers = {}
+        self.transmissions = transmissions
+        self.lock = lock
+        self.busy_until = 0
+
+        self.topic = TOPIC_PREFIX + gateway_id
+        self.client = mqtt.Client(client_id="sim-" + gateway_id)
+        self.client.will_set(self.topic, payload="", qos=0, retain=True)
+        self.client.on_connect = self.on_connect
+        self.client.on_message = self.on_message
+        self.client.connect(args.host, args.port)
+        self.client.loop_start()
+
+    def now(self):
+        return millis() + self.boot_offset
+
+    def on_connect(self, client, userdata, flags, rc):
+        client.subscribe(TOPIC_FILTER)
+        self.announce()
+
+    def on_message(self, client, userdata, msg):
+        peer_id = msg.topic[len(TOPIC_PREFIX):]
+        if peer_id == self.id:
+            return
+        now = self.now()
+        with self.lock:
+            if not msg.payload:
+                self.peers.pop(peer_id, None)
+                return
+            data = json.loads(msg.payload)
+            self.peers[peer_id] = {"channel": data.get("channel", ""),
+                                   "demand": data.get("demand", MIN_DEMAND),
+                                   "last_seen": now}
+            # Follow the channel leader's clock (lowest ID on our channel)
+            leader = min([p for p, v in self.peers.items() if v["channel"] == self.channel] + [self.id])
+            # ...only from a fresh announcement: the retained copy on subscribe can be 30 s old
+            if peer_id == leader and "clock_ms" in data:
+                age = utc_ms() - data.get("sent_ms", 0)
+                if data.get("sent_ms", 0) and -CLOCK_MAX_AGE_MS <= age <= CLOCK_MAX_AGE_MS:
+                    self.clock_offset = data["clock_ms"] + age - now
+
+    def expire(self, now):
+        for peer_id in [p for p, v in self.peers.items() if now - v["last_seen"] > PEER_TIMEOUT_MS]:
+            del self.peers[peer_id]
+
+    def announce(self):
+        now = self.now()
+        with self.lock:
+            self.expire(now)
+            start, length, _ = compute_window(self.id, self.channel, self.demand, self.peers, self.superframe_ms)
+            payload = {"gateway_id": self.id, "channel": self.channel,
+                       "demand": effective_demand(self.demand), "clock_ms": now + self.clock_offset,
+                       "sent_ms": utc_ms(),
+                       "superframe_ms": self.superframe_ms,
+                       "window_start_ms": start, "window_ms": length}
+        self.client.publish(self.topic, json.dumps(payload), retain=True)
+
+    def can_transmit(self, now):
+        """Mirror of coordCanTransmit()."""
+        with self.lock:
+            self.expire(now)
+            start, length, sharing = compute_window(self.id, self.channel, self.demand, self.peers,
+                                                    self.superframe_ms)
+            if sharing == 0:
+                return True
+            pos = (now + self.clock_offset) % self.superframe_ms
+        usable = length - GUARD_MS if length > 2 * GUARD_MS else length // 2
+        need = min(self.poll_ms, usable)
+        return start <= pos and pos + need <= start + usable
+
+    def tick(self):
+        now = self.now()
+        wall = millis()
+        if wall >= self.busy_until and self.can_transmit(now):
+            # Always has work queued: measures how much airtime the window really gives
+            self.busy_until = wall + self.poll_ms
+            with self.lock:
+                self.transmissions.append((self.id, self.channel, wall, self.busy_until))
+
+    def stop(self):
+        self.client.publish(self.topic, "", retain=True)
+        self.client.loop_stop()
+        self.client.disconnect()
+
+
+def simulate(args):
+    demands = [int(d) for d in args.demand.split(",")] if args.demand else []
+    channels = args.channels.split(",")
+    transmissions = []
+    lock = threading.Lock()
+
+    gateways = []
+    for i in range(args.gateways):
+        gateway_id = "SIM-%05d" % (i + 1)
+        demand = demands[i] if i < len(demands) else 200
+        channel = channels[i % len(channels)]
+        gateways.append(SimGateway(args, gateway_id, channel, demand, args.poll_ms, transmissions, lock))
+
+    print("Simulating %d gateways for %ds (superframe %dms, poll %dms)"
+          % (args.gateways, args.duration, args.superframe_ms, args.poll_ms))
+
+    # Let announcements settle before measuring
+    time.sleep(2)
+    with lock:
+        transmissions.clear()
+
+    start = time.time()
+    last_announce = 0
+    while time.time() - start < args.duration:
+        if millis() - last_announce >= args.announce_ms:
+            for gw in gateways:
+                gw.announce()
+            last_announce = millis()
+        for gw in gateways:
+            gw.tick()
+        time.sleep(0.05)
+
+    for gw in gateways:
+        gw.stop()
+
+    # Overlap check: transmissions on the same channel must never intersect
+    collisions = 0
+    ordered = sorted(transmissions, key=lambda t: t[2])
+    for i, a in enumerate(ordered):
+        for b in ordered[i + 1:]:
+            if b[2] >= a[3]:
+                break
+            if a[1] == b[1] and a[0] != b[0]:
+                collisions += 1
+                print("COLLISION %s [%d-%d] vs %s [%d-%d]" % (a[0], a[2], a[3], b[0], b[2], b[3]))
+
+    elapsed_ms = args.duration * 1000
+    print("\n%-10s %-20s %6s %6s %8s" % ("gateway", "channel", "demand", "polls", "airtime"))
+    total_airtime = {}
+    for gw in gateways:
+        polls = [t for t in transmissions if t[0] == gw.id]
+        airtime = sum(t[3] - t[2] for t in polls)
+        total_airtime[gw.channel] = total_airtime.get(gw.channel, 0) + airtime
+        print("%-10s %-20s %6d %6d %7.1f%%" % (gw.id, gw.channel, effective_demand(gw.demand), len(polls),
+                                               100.0 * airtime / elapsed_ms))
+    for channel, airtime in total_airtime.items():
+        print("channel %s utilisation %.1f%%" % (channel, 100.0 * airtime / elapsed_ms))
+
+    print("\n%d collisions" % collisions)
+    return 1 if collisions else 0
+
+
+def monitor(args):
+    announcements = {}
+    lock = threading.Lock()
+    overlaps = [0]
+
+    def on_message(client, userdata, msg):
+        peer_id = msg.topic[len(TOPIC_PREFIX):]
+        with lock:
+            if not msg.payload:
+                announcements.pop(peer_id, None)
+                print("%s withdrew" % peer_id)
+                return
+            data = json.loads(msg.payload)
+            data["received"] = millis()
+            announcements[peer_id] = data
+            check(announcements, overlaps)
+
+    client = mqtt.Client(client_id="coord-monitor-%d" % random.randint(0, 99999))
+    client.on_connect = lambda c, u, f, rc: c.subscribe(TOPIC_FILTER)
+    client.on_message = on_message
+    client.connect(args.host, args.port)
+    client.loop_start()
+
+    time.sleep(args.duration)
+    client.loop_stop()
+    print("\n%d overlapping window pairs seen" % overlaps[0])
+    return 1 if overlaps[0] else 0
+
+
+def check(announcements, overlaps):
+    """Windows of gateways on the same channel, in each one's superframe clock, must not intersect."""
+    now = millis()
+    live = {k: v for k, v in announcements.items() if now - v["received"] <= PEER_TIMEOUT_MS}
+    by_channel = {}
+    for gateway_id, a in live.items():
+        by_channel.setdefault(a["channel"], []).append((gateway_id, a))
+
+    for channel, members in by_channel.items():
+        line = ", ".join("%s@%d+%d" % (g, a["window_start_ms"], a["window_ms"]) for g, a in sorted(members))
+        print("[%s] %s" % (channel, line))
+        for i, (ga, a) in enumerate(members):
+            for gb, b in members[i + 1:]:
+                a_start, a_end = a["window_start_ms"], a["window_start_ms"] + a["window_ms"]
+                b_start, b_end = b["window_start_ms"], b["window_start_ms"] + b["window_ms"]
+                if a_start < b_end and b_start < a_end:
+                    overlaps[0] += 1
+                    print("  OVERLAP %s and %s" % (ga, gb))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="DETECTRA multi-gateway coordination simulator")
+    parser.add_argument("--host", default="localhost")
+    parser.add_argument("--port", type=int, default=1883)
+    sub = parser.add_subparsers(dest="mode", required=True)
+
+    sim = sub.add_parser("simulate", help="run simulated gateways and check for collisions")
+    sim.add_argument("--gateways", type=int, default=3)
+    sim.add_argument("--duration", type=int, default=900, help="seconds")
+    sim.add_argument("--demand", help="comma-separated permille per gateway (default 200 each)")
+    sim.add_argument("--channels", default="868000000/9/125",
+                     help="comma-separated channels assigned round-robin")
+    sim.add_argument("--poll-ms", type=int, default=45000, help="simulated device poll duration")
+    sim.add_argument("--superframe-ms", type=int, default=SUPERFRAME_MS,
+                     help="shorten for quick runs (real gateways use %d)" % SUPERFRAME_MS)
+    sim.add_argument("--announce-ms", type=int, default=ANNOUNCE_MS)
+
+    mon = sub.add_parser("monitor", help="check announced windows of live gateways")
+    mon.add_argument("--duration", type=int, default=600, help="seconds")
+
+    args = parser.parse_args()
+    sys.exit(simulate(args) if args.mode == "simulate" else monitor(args))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,260 @@
+#!/usr/bin/env python3
+"""
+DETECTRA Gateway v2.0 - MQTT payload decoder
+
+Decodes gateway payloads in either encoding (JSON or MessagePack, see
+mqtt_codec.h) to JSON and optionally validates them against
+detectra_mqtt.schema.json. The format is detected from the first byte,
+so mixed topics decode without reading the meta topic first.
+
+Usage:
+  python3 mqtt_decode.py payload.bin                     # file ('-' = stdin)
+  python3 mqtt_decode.py --hex 89a474797065a864656c7461...
+  python3 mqtt_decode.py --subscribe "detectra/#" --host localhost --validate
+
+--subscribe requires paho-mqtt 1.x (pip install "paho-mqtt<2").
+The decoder itself has no dependencies: decode() can be imported by
+backend code.
+"""
+
+import argparse
+import json
+import os
+import struct
+import sys
+
+SCHEMA_PATH = os.path.join(os.path.dirname(os.path.abspath(__file__)), "detectra_mqtt.schema.json")
+
+
+# ==================== MESSAGEPACK ====================
+
+class MsgPackError(ValueError):
+    pass
+
+
+def _unpack(data, pos):
+    if pos >= len(data):
+        raise MsgPackError("truncated at byte %d" % pos)
+    b = data[pos]
+    pos += 1
+
+    if b <= 0x7F:
+        return b, pos
+    if b >= 0xE0:
+        return b - 0x100, pos
+    if 0x80 <= b <= 0x8F:
+        return _unpack_map(data, pos, b & 0x0F)
+    if 0x90 <= b <= 0x9F:
+        return _unpack_array(data, pos, b & 0x0F)
+    if 0xA0 <= b <= 0xBF:
+        return _unpack_str(data, pos, b & 0x1F)
+
+    fixed = {
+        0xCC: ">B", 0xCD: ">H", 0xCE: ">I", 0xCF: ">Q",
+        0xD0: ">b", 0xD1: ">h", 0xD2: ">i", 0xD3: ">q",
+        0xCA: ">f", 0xCB: ">d",
+    }
+    if b in fixed:
+        fmt = fixed[b]
+        size = struct.calcsize(fmt)
+        if pos + size > len(data):
+            raise MsgPackError("truncated number at byte %d" % pos)
+        return struct.unpack_from(fmt, data, pos)[0], pos + size
+
+    if b == 0xC0:
+        return None, pos
+    if b == 0xC2:
+        return False, pos
+    if b == 0xC3:
+        return True, pos
+
+    lengths = {0xD9: ">B", 0xDA: ">H", 0xDB: ">I",       # str 8/16/32
+               0xC4: ">B", 0xC5: ">H", 0xC6: ">I",       # bin 8/16/32
+               0xDC: ">H", 0xDD: ">I",                   # array 16/32
+               0xDE: ">H", 0xDF: ">I"}                   # map 16/32
+    if b in lengths:
+        fmt = lengths[b]
+        n = struct.unpack_from(fmt, data, pos)[0]
+        pos += struct.calcsize(fmt)
+        if b in (0xD9, 0xDA, 0xDB):
+            return _unpack_str(data, pos, n)
+        if b in (0xC4, 0xC5, 0xC6):
+            return bytes(data[pos:pos + n]).hex(), pos + n
+        if b in (0xDC, 0xDD):
+            return _unpack_array(data, pos, n)
+        return _unpack_map(data, pos, n)
+
+    raise MsgPackError("unsupported type 0x%02X at byte %d" % (b, pos - 1))
+
+
+def _unpack_str(data, pos, n):
+    if pos + n > len(data):
+        raise MsgPackError("truncated string at byte %d" % pos)
+    return bytes(data[pos:pos + n]).decode("utf-8"), pos + n
+
+
+def _unpack_array(data, pos, n):
+    items = []
+    for _ in range(n):
+        item, pos = _unpack(data, pos)
+        items.append(item)
+    return items, pos
+
+
+def _unpack_map(data, pos, n):
+    result = {}
+    for _ in range(n):
+        key, pos = _unpack(data, pos)
+        value, pos = _unpack(data, pos)
+        result[key] = value
+    return result, pos
+
+
+def unpackb(data):
+    value, pos = _unpack(data, 0)
+    if pos != len(data):
+        raise MsgPackError("%d trailing bytes" % (len(data) - pos))
+    return value
+
+
+# ==================== DECODING ====================
+
+def content_type(payload):
+    """'application/json' or 'application/msgpack' from the first byte."""
+    if not payload:
+        return None
+    first = payload[0]
+    if first == ord("{"):
+        return "application/json"
+    if 0x80 <= first <= 0x8F or first in (0xDE, 0xDF):
+        return "application/msgpack"
+    return None
+
+
+def decode(payload):
+    """Decode one gateway payload (bytes) to a Python dict."""
+    kind = content_type(payload)
+    if kind == "application/json":
+        return json.loads(payload.decode("utf-8"))
+    if kind == "application/msgpack":
+        return unpackb(payload)
+    raise ValueError("not a DETECTRA payload (first byte 0x%02X)" % payload[0] if payload else "empty payload")
+
+
+def topic_kind(topic):
+    """Schema definition for a topic: detectra/<gw>/status -> 'status'."""
+    parts = topic.split("/")
+    if len(parts) >= 3 and parts[2] in ("status", "polling", "device", "data", "meta"):
+        return parts[2]
+    return None
+
+
+# ==================== VALIDATION ====================
+
+_TYPES = {"object": dict, "array": list, "string": str, "boolean": bool}
+
+
+def _check_type(value, expected):
+    if expected == "integer":
+        return isinstance(value, int) and not isinstance(value, bool)
+    if expected == "number":
+        return isinstance(value, (int, float)) and not isinstance(value, bool)
+    return isinstance(value, _TYPES[expected])
+
+
+def validate(value, schema, root, path="$"):
+    """Check the subset of JSON Schema used by detectra_mqtt.schema.json. Returns a list of errors."""
+    if "$ref" in schema:
+        schema = root["definitions"][schema["$ref"].split("/")[-1]]
+
+    errors = []
+    if "type" in schema and not _check_type(value, schema["type"]):
+        return ["%s: expected %s, got %r" % (path, schema["type"], value)]
+    if "enum" in schema and value not in schema["enum"]:
+        errors.append("%s: %r not in %s" % (path, value, schema["enum"]))
+    if "const" in schema and value != schema["const"]:
+        errors.append("%s: expected %r" % (path, schema["const"]))
+
+    if isinstance(value, dict):
+        for key in schema.get("required", []):
+            if key not in value:
+                errors.append("%s: missing %s" % (path, key))
+        for key, sub in schema.get("properties", {}).items():
+            if key in value:
+                errors += validate(value[key], sub, root, path + "." + key)
+    if isinstance(value, list) and "items" in schema:
+        for i, item in enumerate(value):
+            errors += validate(item, schema["items"], root, "%s[%d]" % (path, i))
+    return errors
+
+
+def load_schema():
+    with open(SCHEMA_PATH) as f:
+        return json.load(f)
+
+
+# ==================== CLI ====================
+
+def report(topic, payload, kind, schema):
+    try:
+        doc = decode(payload)
+    except ValueError as e:
+        print("%s: %s" % (topic or "payload", e), file=sys.stderr)
+        return False
+
+    header = "%s (%s, %d bytes)" % (topic or "payload", content_type(payload), len(payload))
+    print(header)
+    print(json.dumps(doc, indent=2))
+
+    if schema is not None and kind is not None:
+        errors = validate(doc, schema["definitions"][kind], schema)
+        for error in errors:
+            print("  INVALID %s" % error)
+        return not errors
+    return True
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode DETECTRA gateway MQTT payloads (JSON / MessagePack)")
+    parser.add_argument("file", nargs="?", help="payload file ('-' = stdin)")
+    parser.add_argument("--hex", help="payload as a hex string")
+    parser.add_argument("--kind", choices=["status", "polling", "device", "data", "meta"],
+                        help="schema definition for --validate (default: from the topic)")
+    parser.add_argument("--validate", action="store_true", help="check against detectra_mqtt.schema.json")
+    parser.add_argument("--subscribe", metavar="TOPIC", help="decode live messages, e.g. 'detectra/#'")
+    parser.add_argument("--host", default="localhost")
+    parser.add_argument("--port", type=int, default=1883)
+    args = parser.parse_args()
+
+    schema = load_schema() if args.validate else None
+
+    if args.subscribe:
+        import paho.mqtt.client as mqtt
+
+        def on_message(client, userdata, msg):
+            if msg.topic.startswith("detectra/coord/"):
+                return                               # Gateway-to-gateway traffic (always JSON)
+            report(msg.topic, msg.payload, args.kind or topic_kind(msg.topic), schema)
+
+        client = mqtt.Client()
+        client.on_connect = lambda c, u, f, rc: c.subscribe(args.subscribe)
+        client.on_message = on_message
+        client.connect(args.host, args.port)
+        client.loop_forever()
+        return 0
+
+    if args.hex:
+        payload = bytes.fromhex(args.hex)
+    elif args.file == "-":
+        payload = sys.stdin.buffer.read()
+    elif args.file:
+        with open(args.file, "rb") as f:
+            payload = f.read()
+    else:
+        parser.error("give a file, --hex or --subscribe")
+
+    return 0 if report(None, payload, args.kind, schema) else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
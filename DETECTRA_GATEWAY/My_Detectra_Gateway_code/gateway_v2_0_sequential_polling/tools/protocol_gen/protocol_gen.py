@@ -0,0 +1,871 @@
+#!/usr/bin/env python3
+"""
+DETECTRA Gateway v2.0 - LoRa protocol code generator
+
+Generates both sides of the LoRa protocol from lora_protocol.schema.json:
+
+  lora_schema.h / lora_schema.cpp           Gateway (sketch directory)
+      CMD_* / STATUS_* wire strings, LoRaCommand / AckStatus enums,
+      loraCommandFromWire() / ackStatusFromWire() (switch on length and
+      first character, one memcmp), typed payload structs with
+      encode<Name>Payload() / decode<Name>Payload().
+
+  RPI_ZERO_DETECTRA/scripts/detectra_lora.py   Edge devices
+      Command / AckStatus enums, payload dataclasses with encode() /
+      decode(), parse_frame() / build_frame(), SequenceCounter /
+      ReplayWindow (SEQ field).
+
+Payload wire rules (same on both sides):
+  - Fields are joined with the payload's separator (default ':').
+  - Tagged fields are written as "<tag>_<value>" when required or not at
+    their default, and may come in any order. Unknown tags are ignored.
+  - Untagged fields are positional and always written.
+  - A payload with every field at its default is sent as "null".
+
+Sequences (SEQ field, same on both sides):
+  - Each sender counts a 32-bit sequence per peer, from SEQ_FIRST, written
+    as unpadded decimal. Values below SEQ_FIRST are the old 3-digit counter
+    and are not checked.
+  - The receiver keeps the highest sequence per peer and a SEQ_WINDOW-bit
+    map behind it: seen again = duplicate, older than the map = stale.
+
+Usage:
+  python3 protocol_gen.py            Regenerate
+  python3 protocol_gen.py --check    Exit 1 if a generated file is out of date
+"""
+
+import argparse
+import json
+import os
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+SKETCH_DIR = os.path.normpath(os.path.join(HERE, "..", ".."))
+REPO_DIR = os.path.normpath(os.path.join(SKETCH_DIR, "..", "..", ".."))
+
+SCHEMA_PATH = os.path.join(HERE, "lora_protocol.schema.json")
+HEADER_PATH = os.path.join(SKETCH_DIR, "lora_schema.h")
+SOURCE_PATH = os.path.join(SKETCH_DIR, "lora_schema.cpp")
+PYTHON_PATH = os.path.join(REPO_DIR, "RPI_ZERO_DETECTRA", "scripts", "detectra_lora.py")
+
+C_TYPES = {
+    "bool": "bool",
+    "int8": "int8_t", "int16": "int16_t", "int32": "int32_t",
+    "uint8": "uint8_t", "uint16": "uint16_t", "uint32": "uint32_t", "uint64": "uint64_t",
+}
+
+SIGNED = {"int8", "int16", "int32"}
+
+DIRECTIONS = {"gw>dev": "Gateway → device", "dev>gw": "Device → gateway", "both": "Both ways"}
+
+
+# ==================== SCHEMA ====================
+
+def camel(name):
+    parts = name.split("_")
+    return parts[0] + "".join(p[:1].upper() + p[1:] for p in parts[1:])
+
+
+def pascal(name):
+    return "".join(p[:1].upper() + p[1:] for p in name.split("_"))
+
+
+def const_name(name):
+    return name.upper()
+
+
+def load_schema(path):
+    with open(path) as f:
+        schema = json.load(f)
+
+    names = set()
+    for payload_name, payload in schema["payloads"].items():
+        payload.setdefault("separator", ":")
+        for field in payload["fields"]:
+            if field["type"] not in C_TYPES and field["type"] != "str":
+                raise SystemExit("%s.%s: unknown type %s" % (payload_name, field["name"], field["type"]))
+            if field["type"] == "str" and "max" not in field:
+                raise SystemExit("%s.%s: str needs max" % (payload_name, field["name"]))
+            if "tag" in field and not field.get("required") and "default" not in field:
+                raise SystemExit("%s.%s: optional tagged field needs a default" % (payload_name, field["name"]))
+
+    sequence = schema["sequence"]
+    if not 1 <= sequence["window"] <= 64:
+        raise SystemExit("sequence.window must be 1..64 (one uint64_t bitmap)")
+    if sequence["first"] < 1000:
+        raise SystemExit("sequence.first must be above the old 3-digit counter (>= 1000)")
+
+    for entry in schema["commands"]:
+        if entry["direction"] not in DIRECTIONS:
+            raise SystemExit("%s: unknown direction %s" % (entry["name"], entry["direction"]))
+
+    for entry in schema["commands"] + schema["statuses"]:
+        if entry["name"] in names:
+            raise SystemExit("duplicate name %s" % entry["name"])
+        names.add(entry["name"])
+        if "payload" in entry and entry["payload"] not in schema["payloads"]:
+            raise SystemExit("%s: unknown payload %s" % (entry["name"], entry["payload"]))
+
+    return schema
+
+
+def defaultable(field):
+    """Field has a value that lets the whole payload collapse to "null"."""
+    if "tag" in field:
+        return not field.get("required")
+    return field["type"] == "str"
+
+
+def default_value(field):
+    if field["type"] == "str":
+        return ""
+    if field["type"] == "bool":
+        return bool(field.get("default", False))
+    return field.get("default", 0)
+
+
+# ==================== C++ ====================
+
+def c_default_literal(field):
+    value = default_value(field)
+    if field["type"] == "bool":
+        return "true" if value else "false"
+    return str(value)
+
+
+def c_wire_switch(function, enum_unknown, prefix, entries):
+    """Lookup by length, then first character, then one memcmp."""
+    by_length = {}
+    for entry in entries:
+        by_length.setdefault(len(entry["name"]), []).append(entry)
+
+    lines = ["inline %s(const char* s, size_t length) {" % function, "  switch (length) {"]
+    for length in sorted(by_length):
+        lines.append("    case %d:" % length)
+        group = by_length[length]
+        by_first = {}
+        for entry in group:
+            by_first.setdefault(entry["name"][0], []).append(entry)
+
+        if len(group) == 1:
+            entry = group[0]
+            lines.append('      if (memcmp(s, "%s", %d) == 0) return %s%s;'
+                         % (entry["name"], length, prefix, const_name(entry["name"])))
+        else:
+            lines.append("      switch (s[0]) {")
+            for first in sorted(by_first):
+                lines.append("        case '%s':" % first)
+                for entry in by_first[first]:
+                    lines.append('          if (memcmp(s, "%s", %d) == 0) return %s%s;'
+                                 % (entry["name"], length, prefix, const_name(entry["name"])))
+                lines.append("          break;")
+            lines.append("      }")
+        lines.append("      break;")
+    lines += ["  }", "  return %s;" % enum_unknown, "}"]
+    return lines
+
+
+def c_comment_column(text, comment, column):
+    if len(text) >= column:
+        return "%s  // %s" % (text, comment)
+    return "%s%s// %s" % (text, " " * (column - len(text)), comment)
+
+
+def gen_header(schema):
+    commands = schema["commands"]
+    statuses = schema["statuses"]
+    payloads = schema["payloads"]
+    out = []
+    w = out.append
+
+    w("/**")
+    w(" * DETECTRA Gateway v2.0 - LoRa Protocol Schema (GENERATED - do not edit)")
+    w(" *")
+    w(" * Generated by tools/protocol_gen/protocol_gen.py from")
+    w(" * tools/protocol_gen/lora_protocol.schema.json, together with the edge")
+    w(" * device module RPI_ZERO_DETECTRA/scripts/detectra_lora.py. Change the")
+    w(" * schema and run the generator; both sides then agree by construction.")
+    w(" *")
+    w(" * Dispatch on the enums (parseMessage fills msg.commandId / msg.ackStatus):")
+    w(" *")
+    w(" *   switch (msg.commandId) {")
+    w(" *     case LORA_CMD_ACK:  ...msg.ackStatus...")
+    w(" *     case LORA_CMD_DATA: ...")
+    w(" *   }")
+    w(" *")
+    w(" * Payloads: fields joined by ':' (or the payload's separator), tagged")
+    w(" * fields as \"<tag>_<value>\" in any order, \"null\" when all are default.")
+    w(" */")
+    w("")
+    w("#ifndef LORA_SCHEMA_H")
+    w("#define LORA_SCHEMA_H")
+    w("")
+    w("#include <Arduino.h>")
+    w('#include "fixed_string.h"')
+    w("")
+    w("#define LORA_SCHEMA_VERSION   %d" % schema["version"])
+    w("")
+    w("// ==================== WIRE STRINGS ====================")
+    w("")
+    w("// Commands")
+    for entry in commands:
+        text = '#define CMD_%-13s "%s"' % (const_name(entry["name"]), entry["name"])
+        w(c_comment_column(text, "%s: %s" % (DIRECTIONS[entry["direction"]], entry["doc"]), 41))
+    w("")
+    w("// ACK status (device -> gateway, in the TARGET field)")
+    for entry in statuses:
+        text = '#define STATUS_%-11s "%s"' % (const_name(entry["name"]), entry["name"])
+        w(c_comment_column(text, entry["doc"], 41))
+    w("")
+    w(c_comment_column('#define BROADCAST_ID          "%s"' % schema["broadcast_id"],
+                       "Addressed to every paired device", 41))
+    w(c_comment_column('#define NULL_PAYLOAD          "%s"' % schema["null_payload"], "Empty payload", 41))
+    longest = max(commands, key=lambda entry: len(entry["name"]))["name"]
+    w(c_comment_column("#define COMMAND_MAX           %d" % len(longest), '"%s"' % longest, 41))
+    w("")
+    sequence = schema["sequence"]
+    w("// Sequences (SEQ field): a 32-bit space per sender and peer")
+    w(c_comment_column("#define SEQ_FIRST             %d" % sequence["first"],
+                       "Below: old 3-digit counter, not checked", 41))
+    w(c_comment_column("#define SEQ_WINDOW            %d" % sequence["window"], "Replay window (bits)", 41))
+    w(c_comment_column("#define SEQ_RESERVE           %d" % sequence["reserve"],
+                       "Sequences per persisted reservation", 41))
+    w("")
+    w("// ==================== ENUMS ====================")
+    w("")
+    w("enum LoRaCommand : uint8_t {")
+    w("  LORA_CMD_UNKNOWN,")
+    for entry in commands:
+        w("  LORA_CMD_%s," % const_name(entry["name"]))
+    w("  LORA_CMD_COUNT")
+    w("};")
+    w("")
+    w("enum AckStatus : uint8_t {")
+    w("  ACK_STATUS_NONE,          // Not an ACK, or an unknown status")
+    for entry in statuses:
+        w("  ACK_STATUS_%s," % const_name(entry["name"]))
+    w("  ACK_STATUS_COUNT")
+    w("};")
+    w("")
+    w("/**")
+    w(" * Wire string -> enum (switch on length and first character, one memcmp)")
+    w(" */")
+    out.extend(c_wire_switch("LoRaCommand loraCommandFromWire", "LORA_CMD_UNKNOWN", "LORA_CMD_", commands))
+    w("")
+    out.extend(c_wire_switch("AckStatus ackStatusFromWire", "ACK_STATUS_NONE", "ACK_STATUS_", statuses))
+    w("")
+    w("/**")
+    w(" * Enum -> wire string")
+    w(" */")
+    w("inline const char* loraCommandName(LoRaCommand command) {")
+    w("  static const char* const NAMES[LORA_CMD_COUNT] = {")
+    w('    "?", %s' % ", ".join("CMD_%s" % const_name(e["name"]) for e in commands))
+    w("  };")
+    w('  return (command < LORA_CMD_COUNT) ? NAMES[command] : "?";')
+    w("}")
+    w("")
+    w("inline const char* ackStatusName(AckStatus status) {")
+    w("  static const char* const NAMES[ACK_STATUS_COUNT] = {")
+    w('    "?", %s' % ", ".join("STATUS_%s" % const_name(e["name"]) for e in statuses))
+    w("  };")
+    w('  return (status < ACK_STATUS_COUNT) ? NAMES[status] : "?";')
+    w("}")
+    w("")
+    w("// ==================== PAYLOADS ====================")
+
+    for name, payload in payloads.items():
+        struct = pascal(name) + "Payload"
+        w("")
+        w("/**")
+        w(" * %s" % payload["doc"])
+        w(" */")
+        w("struct %s {" % struct)
+        for field in payload["fields"]:
+            if field["type"] == "str":
+                text = "  FixedString<%d> %s;" % (field["max"], camel(field["name"]))
+            elif "tag" in field and not field.get("required"):
+                text = "  %s %s = %s;" % (C_TYPES[field["type"]], camel(field["name"]), c_default_literal(field))
+            else:
+                text = "  %s %s = %s;" % (C_TYPES[field["type"]], camel(field["name"]),
+                                          "false" if field["type"] == "bool" else "0")
+            tag = (field["tag"] + "_ - ") if "tag" in field else ""
+            w(c_comment_column(text, tag + field["doc"], 40))
+        w("};")
+        w("")
+        w("size_t encode%s(char* out, size_t capacity, const %s& p);" % (struct, struct))
+        w("bool decode%s(const char* payload, size_t length, %s& p);" % (struct, struct))
+
+    w("")
+    w("#endif // LORA_SCHEMA_H")
+    return out
+
+
+def c_encode_field(field, separator):
+    member = "p." + camel(field["name"])
+    tag = ('"%s_"' % field["tag"]) if "tag" in field else "NULL"
+    t = field["type"]
+    if t == "str":
+        call = "schemaPutStr(w, %s, %s.c_str(), %s.length());" % (tag, member, member)
+    elif t == "bool":
+        call = "schemaPutUInt(w, %s, %s ? 1 : 0, 0);" % (tag, member)
+    elif t in SIGNED:
+        call = "schemaPutInt(w, %s, %s);" % (tag, member)
+    else:
+        call = "schemaPutUInt(w, %s, %s, %d);" % (tag, member, field.get("width", 0))
+
+    if "tag" in field and not field.get("required"):
+        return ["  if (%s != %s) %s" % (member, c_default_literal(field), call)]
+    return ["  " + call]
+
+
+def c_decode_assign(field, start, length, indent):
+    member = "p." + camel(field["name"])
+    t = field["type"]
+    flag = "have" + pascal(field["name"])
+    lines = []
+    if t == "str":
+        lines.append("%sif (!%s.assign(%s, %s)) return false;" % (indent, member, start, length))
+        return lines
+    if t in SIGNED:
+        lines.append("%sint64_t value;" % indent)
+        lines.append("%sif (schemaParseInt(%s, %s, value)) {" % (indent, start, length))
+    else:
+        lines.append("%suint64_t value;" % indent)
+        lines.append("%sif (schemaParseUInt(%s, %s, value)) {" % (indent, start, length))
+    if t == "bool":
+        lines.append("%s  %s = value != 0;" % (indent, member))
+    elif t == "uint64":
+        lines.append("%s  %s = value;" % (indent, member))
+    else:
+        lines.append("%s  %s = (%s)value;" % (indent, member, C_TYPES[t]))
+    if field.get("required"):
+        lines.append("%s  %s = true;" % (indent, flag))
+    lines.append("%s}" % indent)
+    return lines
+
+
+def gen_source(schema):
+    payloads = schema["payloads"]
+    out = []
+    w = out.append
+
+    w("/**")
+    w(" * DETECTRA Gateway v2.0 - LoRa Protocol Schema (GENERATED - do not edit)")
+    w(" *")
+    w(" * See lora_schema.h and tools/protocol_gen/protocol_gen.py")
+    w(" */")
+    w("")
+    w('#include "lora_schema.h"')
+    w("")
+    w("// ==================== HELPERS ====================")
+    w("")
+    w("struct SchemaWriter {")
+    w("  char* out;")
+    w("  size_t capacity;")
+    w("  size_t length;")
+    w("  char separator;")
+    w("  bool ok;")
+    w("};")
+    w("")
+    w("static void schemaPut(SchemaWriter& w, const char* s, size_t n) {")
+    w("  if (!w.ok || w.length + n >= w.capacity) {")
+    w("    w.ok = false;")
+    w("    return;")
+    w("  }")
+    w("  memcpy(w.out + w.length, s, n);")
+    w("  w.length += n;")
+    w("}")
+    w("")
+    w("static void schemaBeginField(SchemaWriter& w, const char* tag) {")
+    w("  if (w.length > 0) schemaPut(w, &w.separator, 1);")
+    w("  if (tag != NULL) schemaPut(w, tag, strlen(tag));")
+    w("}")
+    w("")
+    w("static void schemaPutUInt(SchemaWriter& w, const char* tag, uint64_t value, int width) {")
+    w("  char digits[20];")
+    w("  int n = 0;")
+    w("  do {")
+    w("    digits[n++] = '0' + (char)(value % 10);")
+    w("    value /= 10;")
+    w("  } while (value > 0 && n < (int)sizeof(digits));")
+    w("  while (n < width && n < (int)sizeof(digits)) digits[n++] = '0';")
+    w("")
+    w("  char text[20];")
+    w("  for (int i = 0; i < n; i++) text[i] = digits[n - 1 - i];")
+    w("  schemaBeginField(w, tag);")
+    w("  schemaPut(w, text, n);")
+    w("}")
+    w("")
+    w("static void schemaPutInt(SchemaWriter& w, const char* tag, int64_t value) {")
+    w("  if (value >= 0) {")
+    w("    schemaPutUInt(w, tag, (uint64_t)value, 0);")
+    w("    return;")
+    w("  }")
+    w("  schemaBeginField(w, tag);")
+    w('  schemaPut(w, "-", 1);')
+    w("  SchemaWriter digits = { w.out, w.capacity, w.length, w.separator, w.ok };")
+    w("  schemaPutUInt(digits, NULL, (uint64_t)(-(value + 1)) + 1, 0);")
+    w("  w.length = digits.length;")
+    w("  w.ok = digits.ok;")
+    w("}")
+    w("")
+    w("static void schemaPutStr(SchemaWriter& w, const char* tag, const char* s, size_t n) {")
+    w("  schemaBeginField(w, tag);")
+    w("  schemaPut(w, s, n);")
+    w("}")
+    w("")
+    w("static size_t schemaFinish(SchemaWriter& w) {")
+    w("  if (!w.ok) return 0;")
+    w("  w.out[w.length] = '\\0';")
+    w("  return w.length;")
+    w("}")
+    w("")
+    w("static size_t schemaNull(char* out, size_t capacity) {")
+    w("  size_t n = sizeof(NULL_PAYLOAD) - 1;")
+    w("  if (n >= capacity) return 0;")
+    w("  memcpy(out, NULL_PAYLOAD, n + 1);")
+    w("  return n;")
+    w("}")
+    w("")
+    w("static bool schemaIsNull(const char* s, size_t n) {")
+    w("  return n == 0 || (n == sizeof(NULL_PAYLOAD) - 1 && memcmp(s, NULL_PAYLOAD, n) == 0);")
+    w("}")
+    w("")
+    w("static bool schemaNextField(const char*& cursor, const char* end, char separator,")
+    w("                            const char*& field, size_t& length) {")
+    w("  if (cursor == NULL) return false;")
+    w("  const char* stop = (const char*)memchr(cursor, separator, end - cursor);")
+    w("  field = cursor;")
+    w("  length = (stop != NULL ? stop : end) - cursor;")
+    w("  cursor = (stop != NULL) ? stop + 1 : NULL;")
+    w("  return true;")
+    w("}")
+    w("")
+    w("static bool schemaTag(const char* field, size_t length, const char* tag, size_t tagLength) {")
+    w("  return length >= tagLength && memcmp(field, tag, tagLength) == 0;")
+    w("}")
+    w("")
+    w("static bool schemaParseUInt(const char* s, size_t n, uint64_t& value) {")
+    w("  if (n == 0) return false;")
+    w("  value = 0;")
+    w("  for (size_t i = 0; i < n; i++) {")
+    w("    if (s[i] < '0' || s[i] > '9') return false;")
+    w("    value = value * 10 + (uint64_t)(s[i] - '0');")
+    w("  }")
+    w("  return true;")
+    w("}")
+    w("")
+    w("static bool schemaParseInt(const char* s, size_t n, int64_t& value) {")
+    w("  bool negative = n > 0 && s[0] == '-';")
+    w("  uint64_t magnitude;")
+    w("  if (!schemaParseUInt(s + (negative ? 1 : 0), n - (negative ? 1 : 0), magnitude)) return false;")
+    w("  value = negative ? -(int64_t)magnitude : (int64_t)magnitude;")
+    w("  return true;")
+    w("}")
+
+    for name, payload in payloads.items():
+        struct = pascal(name) + "Payload"
+        fields = payload["fields"]
+        separator = payload["separator"]
+        tagged = [f for f in fields if "tag" in f]
+        positional = [f for f in fields if "tag" not in f]
+        required = [f for f in tagged if f.get("required")]
+
+        w("")
+        w("// ==================== %s PAYLOAD ====================" % name.replace("_", " ").upper())
+        w("")
+        w("size_t encode%s(char* out, size_t capacity, const %s& p) {" % (struct, struct))
+        if all(defaultable(f) for f in fields):
+            conditions = []
+            for f in fields:
+                member = "p." + camel(f["name"])
+                if f["type"] == "str":
+                    conditions.append("%s.isEmpty()" % member)
+                else:
+                    conditions.append("%s == %s" % (member, c_default_literal(f)))
+            w("  if (%s) {" % (" && ".join(conditions)))
+            w("    return schemaNull(out, capacity);")
+            w("  }")
+            w("")
+        w("  SchemaWriter w = { out, capacity, 0, '%s', capacity > 0 };" % separator)
+        for field in fields:
+            out.extend(c_encode_field(field, separator))
+        w("  return schemaFinish(w);")
+        w("}")
+        w("")
+        w("bool decode%s(const char* payload, size_t length, %s& p) {" % (struct, struct))
+        w("  p = %s();" % struct)
+        w("  if (schemaIsNull(payload, length)) return %s;"
+          % ("true" if not required and not positional else "false"))
+        w("")
+        for field in required:
+            w("  bool have%s = false;" % pascal(field["name"]))
+        if positional:
+            w("  int position = 0;")
+        w("  const char* cursor = payload;")
+        w("  const char* field;")
+        w("  size_t fieldLength;")
+        w("")
+        w("  while (schemaNextField(cursor, payload + length, '%s', field, fieldLength)) {" % separator)
+        for index, f in enumerate(tagged):
+            tag = f["tag"] + "_"
+            w('    %s (schemaTag(field, fieldLength, "%s", %d)) {' % ("if" if index == 0 else "} else if", tag, len(tag)))
+            out.extend(c_decode_assign(f, "field + %d" % len(tag), "fieldLength - %d" % len(tag), "      "))
+        if tagged and positional:
+            w("    } else {")
+        elif tagged:
+            w("    }")
+
+        if positional:
+            indent = "      " if tagged else "    "
+            w("%sswitch (position++) {" % indent)
+            for index, f in enumerate(positional):
+                w("%s  case %d: {" % (indent, index))
+                out.extend(c_decode_assign(f, "field", "fieldLength", indent + "    "))
+                w("%s    break;" % indent)
+                w("%s  }" % indent)
+            w("%s  default:" % indent)
+            w("%s    break;" % indent)
+            w("%s}" % indent)
+            if tagged:
+                w("    }")
+        w("  }")
+        w("")
+        checks = ["have" + pascal(f["name"]) for f in required]
+        if positional:
+            checks.append("position >= %d" % len(positional))
+        w("  return %s;" % (" && ".join(checks) if checks else "true"))
+        w("}")
+
+    return out
+
+
+# ==================== PYTHON ====================
+
+def gen_python(schema):
+    out = []
+    w = out.append
+
+    w('"""')
+    w("DETECTRA LoRa protocol - edge device side (GENERATED - do not edit)")
+    w("")
+    w("Generated by DETECTRA_GATEWAY/.../tools/protocol_gen/protocol_gen.py from")
+    w("lora_protocol.schema.json, together with the gateway's lora_schema.h.")
+    w("Change the schema and run the generator; both sides then agree.")
+    w("")
+    w("    frame = parse_frame(line)")
+    w("    if frame.command == Command.POLL and frame.target == BROADCAST_ID:")
+    w("        census = CensusPayload.decode(frame.payload)")
+    w("    reply = HealthPayload(battery=95, rssi=-45, snr=8, cycle_id=census.cycle_id)")
+    w("    send(build_frame(my_id, Command.ACK, AckStatus.ONLINE, tx_seq.next(), int(time.time()), reply.encode()))")
+    w("")
+    w("Sequences: one SequenceCounter (persisted) for frames to the gateway, and")
+    w("a ReplayWindow each for the gateway's unicast and ALL frames:")
+    w("")
+    w('    tx_seq = SequenceCounter("/var/lib/detectra/seq_tx")')
+    w("    rx_unicast, rx_broadcast = ReplayWindow(), ReplayWindow()")
+    w("    window = rx_broadcast if frame.target == BROADCAST_ID else rx_unicast")
+    w('    if window.check(frame.sequence) in ("duplicate", "stale"):')
+    w("        ...  # already handled / replayed - answer a duplicate again, drop a stale frame")
+    w("")
+    w("Windows are re-seeded only on an explicit event - PAIR from the gateway while")
+    w("unpaired (rx_unicast.reset(frame.sequence)), or an operator reset; a stale")
+    w("frame never moves a window back.")
+    w('"""')
+    w("")
+    w("import os")
+    w("from dataclasses import dataclass, fields")
+    w("from enum import Enum")
+    w("from typing import ClassVar, Optional")
+    w("")
+    sequence = schema["sequence"]
+    w("SCHEMA_VERSION = %d" % schema["version"])
+    w('BROADCAST_ID = "%s"' % schema["broadcast_id"])
+    w('NULL_PAYLOAD = "%s"' % schema["null_payload"])
+    w("SEQ_FIRST = %d  # Below: old 3-digit counter, not checked" % sequence["first"])
+    w("SEQ_WINDOW = %d  # Replay window (bits)" % sequence["window"])
+    w("SEQ_RESERVE = %d  # Sequences per persisted reservation" % sequence["reserve"])
+    w("")
+    w("")
+    w("class Command(str, Enum):")
+    for entry in schema["commands"]:
+        w('    %s = "%s"  # %s: %s' % (const_name(entry["name"]), entry["name"],
+                                     DIRECTIONS[entry["direction"]], entry["doc"]))
+    w("")
+    w("")
+    w("class AckStatus(str, Enum):")
+    for entry in schema["statuses"]:
+        w('    %s = "%s"  # %s' % (const_name(entry["name"]), entry["name"], entry["doc"]))
+    w("")
+    w("")
+    w("# ==================== PAYLOAD RULES ====================")
+    w("")
+    w("def _encode(payload) -> str:")
+    w("    parts = []")
+    w("    all_default = True")
+    w("    for f in fields(payload):")
+    w("        tag, kind, default, required, width, _ = payload.SPEC[f.name]")
+    w("        value = getattr(payload, f.name)")
+    w('        defaultable = (tag is not None and not required) or (tag is None and kind == "str")')
+    w("        at_default = defaultable and value == default")
+    w("        all_default = all_default and at_default")
+    w("        if tag is not None and at_default:")
+    w("            continue")
+    w('        if kind == "bool":')
+    w('            text = "1" if value else "0"')
+    w('        elif kind == "str":')
+    w("            text = str(value)")
+    w("        else:")
+    w("            text = str(int(value)).zfill(width) if width else str(int(value))")
+    w('        parts.append(text if tag is None else "%s_%s" % (tag, text))')
+    w("    if all_default:")
+    w("        return NULL_PAYLOAD")
+    w("    return payload.SEPARATOR.join(parts)")
+    w("")
+    w("")
+    w("def _decode(cls, text: str):")
+    w("    payload = cls()")
+    w("    positional = [f.name for f in fields(cls) if cls.SPEC[f.name][0] is None]")
+    w("    required = {f.name for f in fields(cls) if cls.SPEC[f.name][3]}")
+    w("    if text in (\"\", NULL_PAYLOAD):")
+    w("        if required or positional:")
+    w('            raise ValueError("%s: required fields missing" % cls.__name__)')
+    w("        return payload")
+    w("")
+    w("    tags = {spec[0] + \"_\": name for name, spec in cls.SPEC.items() if spec[0] is not None}")
+    w("    seen = set()")
+    w("    position = 0")
+    w("    for part in text.split(cls.SEPARATOR):")
+    w("        name = next((n for t, n in tags.items() if part.startswith(t)), None)")
+    w("        if name is not None:")
+    w("            raw = part[len(cls.SPEC[name][0]) + 1:]")
+    w("        elif position < len(positional):")
+    w("            name, raw = positional[position], part")
+    w("            position += 1")
+    w("        else:")
+    w("            continue")
+    w("        kind = cls.SPEC[name][1]")
+    w('        if kind == "str":')
+    w("            if len(raw) > cls.SPEC[name][5]:")
+    w('                raise ValueError("%s.%s: longer than %d" % (cls.__name__, name, cls.SPEC[name][5]))')
+    w("            setattr(payload, name, raw)")
+    w("        else:")
+    w("            try:")
+    w("                number = int(raw, 10)")
+    w("            except ValueError:")
+    w("                continue  # Malformed number: field stays at its default")
+    w('            setattr(payload, name, bool(number) if kind == "bool" else number)')
+    w("        seen.add(name)")
+    w("")
+    w("    if not required <= seen or position < len(positional):")
+    w('        raise ValueError("%s: required fields missing in %r" % (cls.__name__, text))')
+    w("    return payload")
+    w("")
+    w("")
+    w("# ==================== PAYLOADS ====================")
+
+    for name, payload in schema["payloads"].items():
+        cls = pascal(name) + "Payload"
+        w("")
+        w("")
+        w("@dataclass")
+        w("class %s:" % cls)
+        w('    """%s"""' % payload["doc"])
+        w("")
+        w('    SEPARATOR: ClassVar[str] = "%s"' % payload["separator"])
+        w("    # name: (tag, type, default, required, width, max length)")
+        w("    SPEC: ClassVar[dict] = {")
+        for field in payload["fields"]:
+            w("        %r: (%r, %r, %r, %r, %r, %r)," % (
+                field["name"], field.get("tag"), field["type"], default_value(field),
+                bool(field.get("required")), field.get("width", 0), field.get("max", 0)))
+        w("    }")
+        w("")
+        for field in payload["fields"]:
+            py_type = {"str": "str", "bool": "bool"}.get(field["type"], "int")
+            w("    %s: %s = %r  # %s" % (field["name"], py_type, default_value(field), field["doc"]))
+        w("")
+        w("    def encode(self) -> str:")
+        w("        return _encode(self)")
+        w("")
+        w("    @classmethod")
+        w('    def decode(cls, text: str) -> "%s":' % cls)
+        w("        return _decode(cls, text)")
+
+    w("")
+    w("")
+    w("COMMAND_PAYLOADS = {")
+    for entry in schema["commands"]:
+        if "payload" in entry:
+            w("    Command.%s: %sPayload," % (const_name(entry["name"]), pascal(entry["payload"])))
+    w("}")
+    w("")
+    w("STATUS_PAYLOADS = {")
+    for entry in schema["statuses"]:
+        if "payload" in entry:
+            w("    AckStatus.%s: %sPayload," % (const_name(entry["name"]), pascal(entry["payload"])))
+    w("}")
+    w("")
+    w("")
+    w("# ==================== FRAMES ====================")
+    w("")
+    w("@dataclass")
+    w("class Frame:")
+    w("    sender: str")
+    w("    command: Optional[Command]  # None = not in the schema")
+    w("    command_text: str")
+    w("    target: str")
+    w("    sequence: int")
+    w("    timestamp: int")
+    w("    payload: str")
+    w("")
+    w("    @property")
+    w("    def status(self) -> Optional[AckStatus]:")
+    w('        """ACK status of a device ACK (carried in the target field)"""')
+    w("        if self.command != Command.ACK:")
+    w("            return None")
+    w("        try:")
+    w("            return AckStatus(self.target)")
+    w("        except ValueError:")
+    w("            return None")
+    w("")
+    w("")
+    w("def parse_frame(text: str) -> Frame:")
+    w('    """SENDER:COMMAND:TARGET:SEQ:TIMESTAMP:PAYLOAD (payload keeps its colons)"""')
+    w('    parts = text.strip().split(":", 5)')
+    w("    if len(parts) < 6:")
+    w('        raise ValueError("expected 6 fields, got %d" % len(parts))')
+    w("    sender, command, target, sequence, timestamp, payload = parts")
+    w("    try:")
+    w("        known: Optional[Command] = Command(command)")
+    w("    except ValueError:")
+    w("        known = None")
+    w("    return Frame(sender, known, command, target, int(sequence), int(timestamp), payload)")
+    w("")
+    w("")
+    w("def build_frame(sender: str, command, target, sequence: int, timestamp: int, payload: str = NULL_PAYLOAD) -> str:")
+    w('    command = command.value if isinstance(command, Enum) else command')
+    w('    target = target.value if isinstance(target, Enum) else target')
+    w('    return "%s:%s:%s:%d:%d:%s" % (sender, command, target, sequence & 0xFFFFFFFF, timestamp, payload or NULL_PAYLOAD)')
+    w("")
+    w("")
+    w("# ==================== SEQUENCES ====================")
+    w("")
+    w("class SequenceCounter:")
+    w('    """')
+    w("    Outgoing sequence space, persisted across restarts. Only reservations")
+    w("    of SEQ_RESERVE are written to path (moved on at half-way), so a restart")
+    w("    continues past the last one and never reuses a sequence.")
+    w('    """')
+    w("")
+    w("    def __init__(self, path: str):")
+    w("        self.path = path")
+    w("        try:")
+    w("            with open(path) as f:")
+    w("                self._next = max(int(f.read().strip() or 0), SEQ_FIRST)")
+    w("        except (OSError, ValueError):")
+    w("            self._next = SEQ_FIRST")
+    w("        self._reserved = self._next")
+    w("")
+    w("    def next(self) -> int:")
+    w("        if self._next + SEQ_RESERVE // 2 >= self._reserved:")
+    w("            self._reserved = self._next + SEQ_RESERVE")
+    w('            tmp = self.path + ".tmp"')
+    w('            with open(tmp, "w") as f:')
+    w("                f.write(str(self._reserved))")
+    w("            os.replace(tmp, self.path)")
+    w("        value = self._next")
+    w("        self._next += 1")
+    w("        return value")
+    w("")
+    w("")
+    w("class ReplayWindow:")
+    w('    """')
+    w("    Incoming sequences from one peer: the highest seen and a SEQ_WINDOW-bit")
+    w("    map behind it. check() records the sequence and returns \"accept\",")
+    w("    \"duplicate\" (seen - a retransmission), \"stale\" (older than the map -")
+    w("    a replay, or below SEQ_FIRST once past it) or \"legacy\" (below SEQ_FIRST")
+    w("    from a peer never past it - old firmware, not checked).")
+    w('    """')
+    w("")
+    w("    def __init__(self, highest: int = 0):")
+    w("        self.highest = highest")
+    w("        self.bits = (1 << SEQ_WINDOW) - 1 if highest else 0")
+    w("")
+    w("    def reset(self, sequence: int = 0):")
+    w('        """Re-seed at sequence (PAIR, operator reset); 0 forgets the peer"""')
+    w("        self.highest = sequence if sequence >= SEQ_FIRST else 0")
+    w("        self.bits = 1 if self.highest else 0")
+    w("")
+    w("    def check(self, sequence: int) -> str:")
+    w("        if sequence < SEQ_FIRST:")
+    w("            # Old 3-digit counter - only until the sender has used its 32-bit space")
+    w('            return "stale" if self.highest >= SEQ_FIRST else "legacy"')
+    w("        if sequence > self.highest:")
+    w("            shift = sequence - self.highest")
+    w("            self.bits = ((self.bits << shift) | 1) & ((1 << SEQ_WINDOW) - 1) if shift < SEQ_WINDOW else 1")
+    w("            self.highest = sequence")
+    w('            return "accept"')
+    w("        age = self.highest - sequence")
+    w("        if age < SEQ_WINDOW:")
+    w("            if (self.bits >> age) & 1:")
+    w('                return "duplicate"')
+    w("            self.bits |= 1 << age")
+    w('            return "accept"')
+    w('        return "stale"')
+    w("")
+    w("")
+    w("def decode_payload(frame: Frame):")
+    w('    """Typed payload of a frame, or None (no payload / custom format)"""')
+    w("    if frame.command == Command.ACK and frame.status is not None:")
+    w("        cls = STATUS_PAYLOADS.get(frame.status)")
+    w("    elif frame.command == Command.POLL and frame.target != BROADCAST_ID:")
+    w("        return None  # Unicast health check")
+    w("    else:")
+    w("        cls = COMMAND_PAYLOADS.get(frame.command)")
+    w("    return cls.decode(frame.payload) if cls else None")
+    return out
+
+
+# ==================== OUTPUT ====================
+
+def render(lines, newline):
+    return newline.join(lines) + newline
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate the LoRa protocol code for gateway and devices")
+    parser.add_argument("--check", action="store_true", help="exit 1 if a generated file is out of date")
+    args = parser.parse_args()
+
+    schema = load_schema(SCHEMA_PATH)
+    outputs = [
+        (HEADER_PATH, render(gen_header(schema), "\r\n")),   # Sketch sources use CRLF
+        (SOURCE_PATH, render(gen_source(schema), "\r\n")),
+        (PYTHON_PATH, render(gen_python(schema), "\n")),
+    ]
+
+    stale = 0
+    for path, text in outputs:
+        current = None
+        if os.path.exists(path):
+            with open(path, newline="") as f:
+                current = f.read()
+        if current == text:
+            continue
+        if args.check:
+            print("out of date: %s" % os.path.relpath(path, REPO_DIR))
+            stale += 1
+            continue
+        os.makedirs(os.path.dirname(path), exist_ok=True)
+        with open(path, "w", newline="") as f:
+            f.write(text)
+        print("wrote %s" % os.path.relpath(path, REPO_DIR))
+
+    if args.check and stale:
+        print("run: python3 tools/protocol_gen/protocol_gen.py")
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,350 @@
+/**
+ * DETECTRA Gateway v2.0 - Radio Trace Replay
+ *
+ * Replays a radio trace (.trc, see radio_trace.h) captured on the gateway
+ * through the gateway's RX/TX code on a PC: every RX line goes through
+ * rxLineFrameHex() -> hexDecode() -> parseMessage() and the payload
+ * parsers, exactly as in loraTask; TX lines are decoded back from their
+ * AT+PSEND hex. The simulated clock follows the trace, so getCurrentTimestamp()
+ * and millis() see the same values as on the gateway.
+ *
+ * Output: a decoded timeline, per-device reply latencies, and the time the
+ * parser path took per line (use --repeat for a stable number).
+ *
+ * Usage:
+ *   ./trace_replay radio.trc                  Timeline + summary, as fast as possible
+ *   ./trace_replay radio.trc --speed 1        Real time (10 = ten times faster)
+ *   ./trace_replay radio.trc --quiet --repeat 200
+ *                                             Parser timing on real traffic
+ */
+
+#include <time.h>
+#include <unistd.h>
+#include <map>
+#include <string>
+#include <vector>
+#include <Arduino.h>
+#include "lora_protocol.h"
+#include "lora_frame.h"
+#include "radio_trace.h"
+
+HostSerial Serial;
+unsigned long hostMicros = 0;
+
+// ==================== TRACE FILE ====================
+
+struct TraceLine {
+  uint64_t us;
+  uint8_t radio;
+  bool tx;
+  std::string text;
+};
+
+struct Trace {
+  uint32_t records;
+  uint32_t dropped;
+  char gatewayId[TRACE_GATEWAY_ID_BYTES + 1];
+  std::vector<TraceLine> lines;
+};
+
+static uint32_t getU32(const uint8_t* p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool loadTrace(const char* path, Trace& trace) {
+  FILE* f = fopen(path, "rb");
+  if (f == NULL) {
+    fprintf(stderr, "Cannot open %s\n", path);
+    return false;
+  }
+  std::vector<uint8_t> data;
+  uint8_t chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) data.insert(data.end(), chunk, chunk + n);
+  fclose(f);
+
+  if (data.size() < TRACE_HEADER_BYTES || memcmp(data.data(), TRACE_MAGIC, 4) != 0) {
+    fprintf(stderr, "%s: not a DETECTRA radio trace\n", path);
+    return false;
+  }
+  if (data[4] != TRACE_FORMAT_VERSION) {
+    fprintf(stderr, "%s: trace format %u, expected %u\n", path, data[4], TRACE_FORMAT_VERSION);
+    return false;
+  }
+
+  trace.records = getU32(&data[8]);
+  trace.dropped = getU32(&data[12]);
+  memcpy(trace.gatewayId, &data[16], TRACE_GATEWAY_ID_BYTES);
+  trace.gatewayId[TRACE_GATEWAY_ID_BYTES] = '\0';
+
+  size_t p = TRACE_HEADER_BYTES;
+  while (p + TRACE_RECORD_MIN_BYTES <= data.size()) {
+    TraceLine line;
+    uint8_t flags = data[p++];
+    line.tx = flags & TRACE_FLAG_TX;
+    line.radio = flags >> TRACE_RADIO_SHIFT;
+    line.us = 0;
+    for (int i = 0; i < 6; i++) line.us |= (uint64_t)data[p++] << (8 * i);
+
+    size_t length = 0;
+    for (int shift = 0; p < data.size(); shift += 7) {
+      uint8_t b = data[p++];
+      length |= (size_t)(b & 0x7F) << shift;
+      if (!(b & 0x80)) break;
+    }
+    if (p + length > data.size()) break;
+
+    line.text.assign((const char*)&data[p], length);
+    p += length;
+    trace.lines.push_back(line);
+  }
+
+  if (trace.lines.size() != trace.records) {
+    fprintf(stderr, "%s: truncated - %zu of %u records\n", path, trace.lines.size(), trace.records);
+  }
+  return true;
+}
+
+// ==================== REPLAY ====================
+
+struct Options {
+  double speed = 0;                 // 0 = as fast as possible
+  int repeat = 1;
+  bool quiet = false;
+};
+
+/**
+ * Per-device reply latency (last gateway TX to the device -> its next RX frame)
+ */
+struct DeviceStats {
+  unsigned long sent = 0;
+  unsigned long replies = 0;
+  unsigned long answered = 0;       // Replies to a TX (late / duplicate ones carry no latency)
+  uint64_t pendingUs = 0;           // Time of the unanswered TX (0 = none)
+  uint64_t latencyMinUs = UINT64_MAX;
+  uint64_t latencyMaxUs = 0;
+  uint64_t latencySumUs = 0;
+};
+
+struct ReplayStats {
+  unsigned long rxLines = 0;
+  unsigned long txLines = 0;
+  unsigned long frames = 0;
+  unsigned long invalid = 0;
+  unsigned long other = 0;          // AT replies, events
+  std::map<std::string, unsigned long> commands;
+  std::map<std::string, DeviceStats> devices;
+};
+
+static uint64_t nowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * Decode one line with the firmware's RX path
+ *
+ * @return true if it carried a valid frame
+ */
+static bool decodeLine(const TraceLine& line, LoRaMessage& msg) {
+  const char* text = line.text.c_str();
+  size_t length = line.text.size();
+
+  const char* hex;
+  size_t hexLength = 0;
+  if (line.tx) {
+    if (strncmp(text, AT_PSEND_PREFIX, AT_PSEND_PREFIX_LEN) != 0) return false;
+    hex = text + AT_PSEND_PREFIX_LEN;
+    hexLength = length - AT_PSEND_PREFIX_LEN;
+  } else {
+    hex = rxLineFrameHex(text, length, &hexLength);
+    if (hex == NULL) return false;
+  }
+
+  char decoded[LORA_MAX_FRAME + 1];
+  if (hexLength > 2 * LORA_MAX_FRAME) hexLength = 2 * LORA_MAX_FRAME;
+  int decodedLength = hexDecode(hex, hexLength, (uint8_t*)decoded);
+  if (decodedLength < 0) {
+    msg.valid = false;
+    return false;
+  }
+  decoded[decodedLength] = '\0';
+
+  parseMessage(decoded, decodedLength, msg);
+  if (msg.valid && msg.commandId == LORA_CMD_DATA) parseDataPayload(msg);
+  if (msg.valid && msg.ackStatus == ACK_STATUS_ONLINE) parseHealthPayload(msg);
+  return msg.valid;
+}
+
+static void printLine(const TraceLine& line, uint64_t startUs, const LoRaMessage* msg) {
+  printf("%12.6f  R%u %s  ", (line.us - startUs) / 1e6, line.radio, line.tx ? "TX" : "RX");
+  if (msg == NULL) {
+    printf("%s\n", line.text.c_str());
+    return;
+  }
+  printf("%-9s -> %-9s %-11s #%03u", msg->senderId.c_str(), msg->targetId.c_str(),
+         msg->command.c_str(), msg->sequence);
+  if (msg->commandId == LORA_CMD_DATA) {
+    printf("  %s %s %u/%u", msg->data.tableId.c_str(), msg->data.position.c_str(),
+           msg->data.positionIndex, msg->data.totalPositions);
+  } else if (!msg->payload.isEmpty()) {
+    printf("  %s", msg->payload.c_str());
+  }
+  printf("\n");
+}
+
+/**
+ * One pass over the trace
+ *
+ * @return Nanoseconds spent in the RX/TX decode path
+ */
+static uint64_t replay(const Trace& trace, const Options& options, bool print, ReplayStats& stats) {
+  if (trace.lines.empty()) return 0;
+
+  uint64_t startUs = trace.lines.front().us;
+  uint64_t wallStartNs = nowNs();
+  uint64_t decodeNs = 0;
+
+  hostMicros = 0;
+  initTimestamp();
+
+  for (const TraceLine& line : trace.lines) {
+    // Real / accelerated time: wait until this record is due
+    if (options.speed > 0) {
+      uint64_t dueNs = wallStartNs + (uint64_t)((line.us - startUs) * 1000.0 / options.speed);
+      uint64_t now = nowNs();
+      if (dueNs > now) usleep((dueNs - now) / 1000);
+    }
+
+    hostMicros = line.us;           // getCurrentTimestamp() / millis() follow the trace
+
+    LoRaMessage msg;
+    uint64_t t0 = nowNs();
+    bool frame = decodeLine(line, msg);
+    decodeNs += nowNs() - t0;
+
+    if (line.tx) stats.txLines++;
+    else stats.rxLines++;
+
+    if (!frame) {
+      // A hex line that does not decode to a frame is a corrupted RX frame
+      size_t hexLength;
+      if (!line.tx && rxLineFrameHex(line.text.c_str(), line.text.size(), &hexLength) != NULL) {
+        stats.invalid++;
+      } else {
+        stats.other++;
+      }
+      if (print) printLine(line, startUs, NULL);
+      continue;
+    }
+
+    stats.frames++;
+    stats.commands[std::string(line.tx ? "TX " : "RX ") + msg.command.c_str()]++;
+
+    if (line.tx) {
+      if (msg.targetId != BROADCAST_ID) {
+        DeviceStats& device = stats.devices[msg.targetId.c_str()];
+        device.sent++;
+        device.pendingUs = line.us;
+      }
+    } else {
+      DeviceStats& device = stats.devices[msg.senderId.c_str()];
+      device.replies++;
+      if (device.pendingUs != 0) {
+        uint64_t latency = line.us - device.pendingUs;
+        device.answered++;
+        device.latencySumUs += latency;
+        if (latency < device.latencyMinUs) device.latencyMinUs = latency;
+        if (latency > device.latencyMaxUs) device.latencyMaxUs = latency;
+        device.pendingUs = 0;
+      }
+    }
+
+    if (print) printLine(line, startUs, &msg);
+  }
+
+  return decodeNs;
+}
+
+static void printSummary(const Trace& trace, const ReplayStats& stats) {
+  double spanS = (trace.lines.back().us - trace.lines.front().us) / 1e6;
+
+  printf("\nTrace: gateway %s, %zu records over %.1f s (%u dropped before the first)\n",
+         trace.gatewayId[0] ? trace.gatewayId : "?", trace.lines.size(), spanS, trace.dropped);
+  printf("Lines: %lu RX, %lu TX - %lu frames, %lu invalid, %lu other\n\n",
+         stats.rxLines, stats.txLines, stats.frames, stats.invalid, stats.other);
+
+  for (const auto& command : stats.commands) {
+    printf("  %-16s %6lu\n", command.first.c_str(), command.second);
+  }
+
+  printf("\n%-10s %6s %8s %10s %10s %10s\n", "device", "sent", "replies", "min ms", "avg ms", "max ms");
+  for (const auto& entry : stats.devices) {
+    const DeviceStats& d = entry.second;
+    if (d.answered > 0) {
+      printf("%-10s %6lu %8lu %10.1f %10.1f %10.1f\n", entry.first.c_str(), d.sent, d.replies,
+             d.latencyMinUs / 1e3, d.latencySumUs / 1e3 / d.answered, d.latencyMaxUs / 1e3);
+    } else {
+      printf("%-10s %6lu %8lu %10s %10s %10s\n", entry.first.c_str(), d.sent, d.replies, "-", "-", "-");
+    }
+  }
+}
+
+// ==================== MAIN ====================
+
+static void usage() {
+  fprintf(stderr, "usage: trace_replay FILE.trc [--speed X] [--repeat N] [--quiet]\n"
+                  "  --speed X   replay at X times real time (default: as fast as possible)\n"
+                  "  --repeat N  replay N times and report the decode time per line\n"
+                  "  --quiet     no timeline, summary only\n");
+}
+
+int main(int argc, char** argv) {
+  const char* path = NULL;
+  Options options;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+      options.speed = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+      options.repeat = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--quiet") == 0) {
+      options.quiet = true;
+    } else if (argv[i][0] != '-' && path == NULL) {
+      path = argv[i];
+    } else {
+      usage();
+      return 2;
+    }
+  }
+  if (path == NULL || options.repeat < 1) {
+    usage();
+    return 2;
+  }
+
+  Trace trace;
+  if (!loadTrace(path, trace)) return 1;
+  if (trace.lines.empty()) {
+    printf("Trace is empty\n");
+    return 0;
+  }
+
+  ReplayStats stats;
+  uint64_t decodeNs = replay(trace, options, !options.quiet, stats);
+  printSummary(trace, stats);
+
+  // Further passes only time the decode path (stats of the first pass are reported)
+  for (int i = 1; i < options.repeat; i++) {
+    ReplayStats discard;
+    Options fast = options;
+    fast.speed = 0;
+    decodeNs += replay(trace, fast, false, discard);
+  }
+
+  double lines = (double)trace.lines.size() * options.repeat;
+  printf("\nDecode path: %.0f ns/line (%d pass%s)\n", decodeNs / lines, options.repeat,
+         options.repeat == 1 ? "" : "es");
+
+  return stats.invalid > 0 ? 1 : 0;
+}
@@ -0,0 +1,316 @@
+/**
+ * DETECTRA Gateway v2.0 - Display & Indicator Task Implementation
+ */
+
+#include "ui_task.h"
+#include "log.h"
+
+/**
+ * A running beep / flash pattern
+ */
+struct UiPattern {
+  bool active;
+  bool on;                          // In the on phase
+  uint8_t remaining;                // On phases still to start
+  uint16_t onMs;
+  uint16_t offMs;
+  unsigned long nextMs;             // Next phase change
+  uint8_t r, g, b;
+};
+
+static Adafruit_SSD1306* panel = NULL;
+static TwoWire* bus = NULL;
+static uint8_t panelAddress = 0;
+static UiRenderFn renderScreen = NULL;
+static UiLedFn writeLed = NULL;
+static UiBuzzerFn writeBuzzer = NULL;
+
+static QueueHandle_t effects = NULL;
+static SemaphoreHandle_t statsLock = NULL;
+static UiStats stats = {};
+
+static uint8_t shown[UI_FRAME_BYTES_MAX];     // Frame on the panel
+static bool shownValid = false;               // false: next flush sends every page
+static int frameBytes = 0;
+static unsigned long lastRenderMs = 0;
+static bool renderPending = true;
+
+static UiPattern beep = {};
+static UiPattern flash = {};
+static uint8_t baseR = 0, baseG = 0, baseB = 0;  // Solid LED color
+
+static bool due(unsigned long now, unsigned long deadline) {
+  return (long)(now - deadline) >= 0;
+}
+
+// ==================== DISPLAY ====================
+
+static bool sendCommands(const uint8_t* commands, size_t count) {
+  bus->beginTransmission(panelAddress);
+  bus->write((uint8_t)0x00);                  // Co = 0, D/C = 0: command stream
+  bus->write(commands, count);
+  return bus->endTransmission() == 0;
+}
+
+/**
+ * Send columns [first, last] of one page
+ */
+static bool sendSpan(int page, int first, int last, const uint8_t* data) {
+  const uint8_t window[] = {
+    0x21, (uint8_t)first, (uint8_t)last,      // Column address
+    0x22, (uint8_t)page, (uint8_t)page        // Page address
+  };
+  if (!sendCommands(window, sizeof(window))) return false;
+
+  for (int x = first; x <= last; x += UI_I2C_CHUNK) {
+    int n = last - x + 1;
+    if (n > UI_I2C_CHUNK) n = UI_I2C_CHUNK;
+    bus->beginTransmission(panelAddress);
+    bus->write((uint8_t)0x40);                // Co = 0, D/C = 1: data stream
+    bus->write(data + x, n);
+    if (bus->endTransmission() != 0) return false;
+  }
+  return true;
+}
+
+/**
+ * Send what differs from the panel (the changed column span of each page)
+ *
+ * @return Pages sent, -1 on an I2C error (the whole frame is resent next time)
+ */
+static int flushChanges(const uint8_t* frame, int width, int pages) {
+  int sent = 0;
+  uint32_t bytes = 0;
+
+  for (int page = 0; page < pages; page++) {
+    const uint8_t* now = frame + page * width;
+    uint8_t* old = shown + page * width;
+
+    int first = 0;
+    int last = width - 1;
+    if (shownValid) {
+      while (first < width && now[first] == old[first]) first++;
+      if (first == width) continue;
+      while (now[last] == old[last]) last--;
+    }
+
+    if (!sendSpan(page, first, last, now)) {
+      shownValid = false;
+      xSemaphoreTake(statsLock, portMAX_DELAY);
+      stats.i2cErrors++;
+      xSemaphoreGive(statsLock);
+      return -1;
+    }
+    memcpy(old + first, now + first, last - first + 1);
+    bytes += last - first + 1;
+    sent++;
+  }
+
+  xSemaphoreTake(statsLock, portMAX_DELAY);
+  stats.pagesSent += sent;
+  stats.pagesSkipped += pages - sent;
+  stats.bytesSent += bytes;
+  xSemaphoreGive(statsLock);
+
+  shownValid = true;
+  return sent;
+}
+
+static void refreshDisplay(unsigned long now) {
+  lastRenderMs = now;
+  renderPending = false;
+  if (panel == NULL || renderScreen == NULL) return;
+
+  unsigned long startUs = micros();
+  renderScreen(*panel);
+  uint32_t renderUs = micros() - startUs;
+
+  bool full = !shownValid;
+  startUs = micros();
+  int sent = flushChanges(panel->getBuffer(), panel->width(), panel->height() / 8);
+  uint32_t flushUs = micros() - startUs;
+
+  xSemaphoreTake(statsLock, portMAX_DELAY);
+  stats.renders++;
+  stats.renderUsTotal += renderUs;
+  if (renderUs > stats.renderUsMax) stats.renderUsMax = renderUs;
+  if (sent == 0) {
+    stats.unchanged++;
+  } else if (sent > 0) {
+    stats.flushes++;
+    stats.flushUsTotal += flushUs;
+    if (flushUs > stats.flushUsMax) stats.flushUsMax = flushUs;
+    if (full && stats.fullFlushUs == 0) stats.fullFlushUs = flushUs;
+  }
+  xSemaphoreGive(statsLock);
+}
+
+// ==================== EFFECTS ====================
+
+static void startPattern(UiPattern& pattern, const UiEffect& effect, unsigned long now) {
+  pattern.active = effect.repeats > 0 && effect.onMs > 0;
+  pattern.on = true;
+  pattern.remaining = effect.repeats > 0 ? effect.repeats - 1 : 0;
+  pattern.onMs = effect.onMs;
+  pattern.offMs = effect.offMs;
+  pattern.nextMs = now + effect.onMs;
+  pattern.r = effect.r;
+  pattern.g = effect.g;
+  pattern.b = effect.b;
+}
+
+/**
+ * Advance a pattern past its deadline
+ *
+ * @return true if the output changed (on <-> off, or finished)
+ */
+static bool stepPattern(UiPattern& pattern, unsigned long now) {
+  if (!pattern.active || !due(now, pattern.nextMs)) return false;
+
+  if (pattern.on) {
+    pattern.on = false;
+    if (pattern.remaining == 0) {
+      pattern.active = false;
+    } else {
+      pattern.nextMs += pattern.offMs;
+    }
+  } else {
+    pattern.on = true;
+    pattern.remaining--;
+    pattern.nextMs += pattern.onMs;
+  }
+  return true;
+}
+
+static void showLed() {
+  if (writeLed == NULL) return;
+  if (flash.active && flash.on) {
+    writeLed(flash.r, flash.g, flash.b);
+  } else {
+    writeLed(baseR, baseG, baseB);
+  }
+}
+
+static void applyEffect(const UiEffect& effect, unsigned long now) {
+  switch (effect.kind) {
+    case UI_FX_BEEP:
+      // A new beep replaces the running one
+      startPattern(beep, effect, now);
+      if (writeBuzzer != NULL) writeBuzzer(beep.active);
+      break;
+    case UI_FX_LED:
+      baseR = effect.r;
+      baseG = effect.g;
+      baseB = effect.b;
+      showLed();
+      break;
+    case UI_FX_LED_FLASH:
+      startPattern(flash, effect, now);
+      showLed();
+      break;
+    case UI_FX_REFRESH:
+      renderPending = true;
+      break;
+  }
+}
+
+static void queueEffect(const UiEffect& effect) {
+  if (effects == NULL) return;
+
+  bool queued = xQueueSend(effects, &effect, 0) == pdTRUE;
+
+  xSemaphoreTake(statsLock, portMAX_DELAY);
+  if (queued) {
+    stats.effects++;
+  } else {
+    stats.effectsDropped++;
+  }
+  xSemaphoreGive(statsLock);
+}
+
+// ==================== UI FUNCTIONS ====================
+
+void uiInit(Adafruit_SSD1306* display, TwoWire* wire, uint8_t address,
+            UiRenderFn render, UiLedFn led, UiBuzzerFn buzzer) {
+  panel = display;
+  bus = wire;
+  panelAddress = address;
+  renderScreen = render;
+  writeLed = led;
+  writeBuzzer = buzzer;
+
+  effects = xQueueCreate(UI_EFFECT_QUEUE, sizeof(UiEffect));
+  statsLock = xSemaphoreCreateMutex();
+
+  if (panel != NULL) {
+    frameBytes = panel->width() * panel->height() / 8;
+    if (frameBytes > UI_FRAME_BYTES_MAX) {
+      LOG_E("UI", "%dx%d panel larger than the frame copy - display disabled", panel->width(), panel->height());
+      panel = NULL;
+    } else {
+      bus->setClock(UI_I2C_CLOCK_HZ);   // Adafruit_SSD1306 drops to 100 kHz after begin()
+    }
+  }
+  stats.displayPresent = panel != NULL;
+  shownValid = false;
+  renderPending = true;
+}
+
+void uiService(unsigned long waitMs) {
+  // Sleep until the next refresh or pattern step, or an effect arrives
+  unsigned long now = millis();
+  unsigned long wait = renderPending ? 0 : UI_REFRESH_MS - (now - lastRenderMs);
+  if (wait > UI_REFRESH_MS) wait = 0;           // Refresh overdue
+  if (beep.active) {
+    unsigned long left = due(now, beep.nextMs) ? 0 : beep.nextMs - now;
+    if (left < wait) wait = left;
+  }
+  if (flash.active) {
+    unsigned long left = due(now, flash.nextMs) ? 0 : flash.nextMs - now;
+    if (left < wait) wait = left;
+  }
+  if (wait > waitMs) wait = waitMs;
+
+  UiEffect effect;
+  if (effects != NULL && xQueueReceive(effects, &effect, pdMS_TO_TICKS(wait)) == pdTRUE) {
+    do {
+      applyEffect(effect, millis());
+    } while (xQueueReceive(effects, &effect, 0) == pdTRUE);
+  }
+
+  now = millis();
+  if (stepPattern(beep, now) && writeBuzzer != NULL) writeBuzzer(beep.active && beep.on);
+  if (stepPattern(flash, now)) showLed();
+
+  if (renderPending || now - lastRenderMs >= UI_REFRESH_MS) refreshDisplay(now);
+}
+
+void uiBeep(uint16_t ms, uint8_t repeats, uint16_t gapMs) {
+  UiEffect effect = { UI_FX_BEEP, 0, 0, 0, ms, gapMs, repeats };
+  queueEffect(effect);
+}
+
+void uiLed(uint8_t r, uint8_t g, uint8_t b) {
+  UiEffect effect = { UI_FX_LED, r, g, b, 0, 0, 0 };
+  queueEffect(effect);
+}
+
+void uiLedFlash(uint8_t r, uint8_t g, uint8_t b, uint16_t ms, uint8_t repeats) {
+  UiEffect effect = { UI_FX_LED_FLASH, r, g, b, ms, ms, repeats };
+  queueEffect(effect);
+}
+
+void uiRefresh() {
+  UiEffect effect = { UI_FX_REFRESH, 0, 0, 0, 0, 0, 0 };
+  queueEffect(effect);
+}
+
+UiStats uiGetStats() {
+  if (statsLock == NULL) return UiStats();
+
+  xSemaphoreTake(statsLock, portMAX_DELAY);
+  UiStats copy = stats;
+  xSemaphoreGive(statsLock);
+
+  return copy;
+}
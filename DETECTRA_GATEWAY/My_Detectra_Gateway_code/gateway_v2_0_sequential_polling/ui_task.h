@@ -0,0 +1,129 @@
+/**
+ * DETECTRA Gateway v2.0 - Display & Indicator Task
+ *
+ * The OLED, NeoPixel and buzzer are driven from one low-priority task, so
+ * neither loop() (MQTT, WebSocket) nor the radio tasks wait on them:
+ *
+ * - Display: every UI_REFRESH_MS (or at once after uiRefresh()) the status
+ *   screen is rendered into the SSD1306 RAM buffer and compared with the
+ *   frame on the panel. Only the changed column span of each changed page
+ *   goes over I2C; an unchanged frame costs no I2C traffic at all.
+ * - Buzzer / NeoPixel: uiBeep() and uiLed() only queue an effect. The task
+ *   plays beep and blink patterns from their deadlines instead of
+ *   delay(), so a 500 ms alert beep no longer blocks the caller.
+ *
+ * Render / flush times and bytes sent go into the stats (GET /api/diag,
+ * "display"). That time used to be spent inside loop().
+ *
+ * Usage:
+ *   uiInit(&display, &Wire, OLED_ADDR, renderStatusScreen, writeLedColor, writeBuzzer);
+ *   uiService(waitMs);                  // UI task loop
+ *
+ *   uiBeep(200);                        // any task
+ *   uiLed(0, 255, 0);
+ *   uiLedFlash(255, 0, 0, 150, 3);
+ */
+
+#ifndef UI_TASK_H
+#define UI_TASK_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <Adafruit_SSD1306.h>
+
+// ==================== CONFIGURATION ====================
+
+#define UI_REFRESH_MS           500       // Status screen render period
+#define UI_EFFECT_QUEUE         8         // Pending beep / LED effects
+#define UI_FRAME_BYTES_MAX      1024      // 128x64 panel
+#define UI_I2C_CHUNK            32        // Data bytes per I2C transaction (Wire buffer: 128)
+#define UI_I2C_CLOCK_HZ         400000
+
+// ==================== DATA STRUCTURES ====================
+
+enum UiEffectKind : uint8_t {
+  UI_FX_BEEP,               // onMs on, offMs off, repeats times
+  UI_FX_LED,                // Solid color (stays)
+  UI_FX_LED_FLASH,          // Colour for onMs, back to the solid color for offMs, repeats times
+  UI_FX_REFRESH             // Render now (uiRefresh)
+};
+
+/**
+ * One queued effect
+ */
+struct UiEffect {
+  UiEffectKind kind;
+  uint8_t r, g, b;
+  uint16_t onMs;
+  uint16_t offMs;
+  uint8_t repeats;
+};
+
+/**
+ * Counters (times in us)
+ */
+struct UiStats {
+  bool displayPresent;              // OLED answered at boot
+  uint32_t renders;
+  uint32_t unchanged;               // Frames identical to the panel - nothing sent
+  uint32_t pagesSent;
+  uint32_t pagesSkipped;
+  uint32_t bytesSent;               // Frame data over I2C
+  uint32_t renderUsTotal;
+  uint32_t renderUsMax;
+  uint32_t flushUsTotal;            // Flushes that sent at least one page
+  uint32_t flushUsMax;
+  uint32_t flushes;
+  uint32_t fullFlushUs;             // First frame: whole panel (what every refresh used to cost)
+  uint32_t i2cErrors;
+  uint32_t effects;
+  uint32_t effectsDropped;          // Queue full
+};
+
+/**
+ * Draws the status screen into the display buffer (no display() call)
+ */
+typedef void (*UiRenderFn)(Adafruit_SSD1306& display);
+
+/**
+ * Hardware writers, called from the UI task only
+ */
+typedef void (*UiLedFn)(uint8_t r, uint8_t g, uint8_t b);
+typedef void (*UiBuzzerFn)(bool on);
+
+// ==================== UI FUNCTIONS ====================
+
+/**
+ * Set up the effect queue (call once in setup, before the UI task starts)
+ *
+ * @param display NULL if the OLED did not answer (effects still run)
+ */
+void uiInit(Adafruit_SSD1306* display, TwoWire* wire, uint8_t address,
+            UiRenderFn render, UiLedFn led, UiBuzzerFn buzzer);
+
+/**
+ * UI task body: wait for an effect or the next deadline, then play
+ * effects and refresh the display when due
+ *
+ * @param waitMs Longest wait
+ */
+void uiService(unsigned long waitMs);
+
+/**
+ * Queue effects (any task, never blocks)
+ */
+void uiBeep(uint16_t ms, uint8_t repeats = 1, uint16_t gapMs = 100);
+void uiLed(uint8_t r, uint8_t g, uint8_t b);
+void uiLedFlash(uint8_t r, uint8_t g, uint8_t b, uint16_t ms, uint8_t repeats = 1);
+
+/**
+ * Render at the next wake instead of the next period
+ */
+void uiRefresh();
+
+/**
+ * Counters
+ */
+UiStats uiGetStats();
+
+#endif // UI_TASK_H
@@ -448,12 +448,30 @@ const char* HTML_DASHBOARD = R"rawliteral(
                     <p id="pairStatusText"></p>
                 </div>
             </form>
+
+            <h2 style="margin-top: 25px;">Bulk Import (CSV)</h2>
+            <div class="form-group">
+                <label for="pairCsv">device_id,table_left,table_right - one device per line</label>
+                <textarea id="pairCsv" rows="6" style="width: 100%;"
+                          placeholder="ED0-00001,BLR-13-IL-01,BLR-13-IL-02"></textarea>
+                <input type="file" id="pairCsvFile" accept=".csv,text/csv" onchange="loadPairCsv(event)">
+            </div>
+            <div class="button-group">
+                <button type="button" onclick="importPairCsv()">Import &amp; Pair</button>
+            </div>
+            <div id="pairBatch" style="margin-top: 15px; display: none;">
+                <p id="pairBatchText"></p>
+                <table style="width: 100%;">
+                    <tbody id="pairBatchRows"></tbody>
+                </table>
+            </div>
         </div>
     </div>
 
     <script>
         let ws = null;
         let pollingActive = false;
+        const jobStates = {};
 
         // Connect to WebSocket
         function connectWebSocket() {
@@ -501,6 +519,14 @@ const char* HTML_DASHBOARD = R"rawliteral(
             if (data.log) {
                 addLog(data.log);
             }
+
+            if (data.type === 'pairing') {
+                updatePairBatch(data);
+            }
+
+            if (data.type === 'jobs') {
+                updateJobs(data.jobs);
+            }
         }
 
         function updatePollingStatus(data) {
@@ -513,6 +539,9 @@ const char* HTML_DASHBOARD = R"rawliteral(
                 document.getElementById('progressFill').textContent = Math.round(progress) + '%';
 
                 let statusText = `Polling device ${data.current_device_index + 1}/${data.total_devices}`;
+                if (data.census_active) {
+                    statusText = `Health census (${data.total_devices} slots)`;
+                }
                 if (data.current_device_id) {
                     statusText += ` (${data.current_device_id})`;
                 }
@@ -574,6 +603,7 @@ const char* HTML_DASHBOARD = R"rawliteral(
                 const actionsCell = row.insertCell();
                 actionsCell.innerHTML = `
                     <button onclick="pollDevice('${device.device_id}')" style="padding: 5px 10px; font-size: 0.9em; margin-right: 5px;">📡 POLL</button>
+                    <button onclick="pollDevice('${device.device_id}', 'health')" style="padding: 5px 10px; font-size: 0.9em; margin-right: 5px;">❤ HEALTH</button>
                     <button onclick="removeDevice('${device.device_id}')" class="danger" style="padding: 5px 10px; font-size: 0.9em;">Remove</button>
                 `;
             });
@@ -631,16 +661,17 @@ const char* HTML_DASHBOARD = R"rawliteral(
                 });
         }
 
-        function pollDevice(deviceId) {
-            fetch('/api/poll/device', {
+        function pollDevice(deviceId, kind = 'poll') {
+            // Queued as a job - runs between cycle devices, the result arrives as a "jobs" push
+            fetch('/api/jobs', {
                 method: 'POST',
                 headers: { 'Content-Type': 'application/json' },
-                body: JSON.stringify({ device_id: deviceId })
+                body: JSON.stringify({ device_id: deviceId, kind: kind })
             })
             .then(response => response.json())
             .then(data => {
                 if (data.success) {
-                    addLog(`POLL sent to ${deviceId}`);
+                    addLog(`Job ${data.job_id}: ${kind} ${deviceId} ${data.state}`);
                 } else {
                     addLog('Error: ' + (data.error || 'Unknown error'));
                     alert('Failed to poll device: ' + (data.error || 'Unknown error'));
@@ -724,6 +755,82 @@ const char* HTML_DASHBOARD = R"rawliteral(
             });
         }
 
+        function loadPairCsv(event) {
+            const file = event.target.files[0];
+            if (!file) return;
+            file.text().then(text => { document.getElementById('pairCsv').value = text; });
+        }
+
+        function importPairCsv() {
+            const csv = document.getElementById('pairCsv').value;
+            if (!csv.trim()) return;
+
+            document.getElementById('pairBatch').style.display = 'block';
+            document.getElementById('pairBatchText').textContent = 'Uploading...';
+            document.getElementById('pairBatchText').style.color = '';
+
+            fetch('/api/device/pair/bulk', {
+                method: 'POST',
+                headers: { 'Content-Type': 'text/csv' },
+                body: csv
+            })
+            .then(response => response.json())
+            .then(data => {
+                if (data.success) {
+                    addLog(`Pairing batch ${data.batch_id}: ${data.queued} devices queued, ${data.rejected} rejected`);
+                    // Progress then arrives over the WebSocket
+                    fetch('/api/device/pair/bulk').then(r => r.json()).then(updatePairBatch);
+                } else {
+                    document.getElementById('pairBatchText').textContent = '✗ Import failed: ' + (data.error || 'Unknown error');
+                    document.getElementById('pairBatchText').style.color = '#ff4444';
+                }
+            })
+            .catch(error => {
+                document.getElementById('pairBatchText').textContent = '✗ Network error: ' + error;
+                document.getElementById('pairBatchText').style.color = '#ff4444';
+            });
+        }
+
+        function updateJobs(jobs) {
+            // Log each job once when it finishes
+            (jobs || []).forEach(job => {
+                if (jobStates[job.job_id] === job.state) return;
+                jobStates[job.job_id] = job.state;
+
+                if (job.state === 'done') {
+                    let text = `Job ${job.job_id}: ${job.kind} ${job.device_id} done in ${(job.run_ms / 1000).toFixed(1)}s`;
+                    if (job.result && job.result.battery >= 0) text += ` - battery ${job.result.battery}%, RSSI ${job.result.rssi} dBm`;
+                    addLog(text);
+                } else if (job.state === 'failed') {
+                    addLog(`Job ${job.job_id}: ${job.kind} ${job.device_id} failed (${job.error})`);
+                }
+            });
+        }
+
+        function updatePairBatch(data) {
+            if (!data.batch_id) return;
+
+            document.getElementById('pairBatch').style.display = 'block';
+            const done = data.paired + data.failed;
+            let text = `Batch ${data.batch_id}: ${data.paired} paired, ${data.failed} failed, ` +
+                       `${data.sent} waiting, ${data.queued} queued, ${data.rejected} rejected`;
+            text += data.active ? ` (${Math.round(data.elapsed_ms / 1000)}s)` : ` - done in ${Math.round(data.elapsed_ms / 1000)}s`;
+            document.getElementById('pairBatchText').textContent = text;
+            document.getElementById('pairBatchText').style.color = (!data.active && done > 0 && data.failed === 0) ? '#00ff88' : '';
+
+            const tbody = document.getElementById('pairBatchRows');
+            tbody.innerHTML = '';
+            (data.rows || []).forEach(row => {
+                const tr = tbody.insertRow();
+                tr.insertCell().textContent = row.line;
+                tr.insertCell().textContent = row.device_id;
+                tr.insertCell().textContent = row.state + (row.attempts > 1 ? ` (${row.attempts} tries)` : '');
+                tr.insertCell().textContent = row.reason || '';
+            });
+
+            if (!data.active) refreshStatus();
+        }
+
         function removeDevice(deviceId) {
             if (!confirm(`Remove device ${deviceId}?`)) return;
 
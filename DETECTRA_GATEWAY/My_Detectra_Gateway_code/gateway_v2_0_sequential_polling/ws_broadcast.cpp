@@ -0,0 +1,173 @@
+/**
+ * DETECTRA Gateway v2.0 - WebSocket Broadcaster Implementation
+ */
+
+#include "ws_broadcast.h"
+#include "log.h"
+#include <atomic>
+
+struct WsClientState {
+  uint32_t id;                      // 0 = free
+  uint8_t staleMask;                // Topics skipped because the queue was full
+};
+
+static AsyncWebSocket* ws = NULL;
+static WsBuildFn builders[WS_TOPIC_COUNT] = {};
+
+static std::atomic<uint8_t> dirtyMask(0);
+static std::atomic<unsigned long> firstDirtyMs(0);
+
+static WsClientState clients[WS_MAX_CLIENTS];
+static uint8_t numClients = 0;
+static SemaphoreHandle_t clientLock = NULL;
+
+static WsStats stats = {};
+
+static const char* const BUCKET_NAMES[WS_COST_BUCKETS] = { "1", "5", "20" };
+
+// ==================== HELPERS ====================
+
+static int costBucket(int clientCount) {
+  if (clientCount <= 1) return 0;
+  if (clientCount <= 5) return 1;
+  return 2;
+}
+
+static void recordCost(int clientCount, uint32_t us, size_t bytes) {
+  WsFanoutCost& cost = stats.cost[costBucket(clientCount)];
+  cost.flushes++;
+  cost.totalUs += us;
+  cost.bytes += bytes;
+  if (us > cost.maxUs) cost.maxUs = us;
+}
+
+/**
+ * Build one snapshot and send it to every client (staleOnly: only the
+ * clients that missed this topic). Caller holds clientLock.
+ */
+static void flushTopic(WsTopic topic, bool staleOnly) {
+  uint8_t bit = 1 << topic;
+  unsigned long startUs = micros();
+
+  String json = builders[topic]();
+  AsyncWebSocketMessageBuffer* buffer = ws->makeBuffer(json.length());
+  if (buffer == NULL) {
+    LOG_W("WS", "No memory for a %u byte update", json.length());
+    return;
+  }
+  memcpy(buffer->get(), json.c_str(), json.length());
+
+  buffer->lock();                   // Keep the buffer alive until every client has queued it
+
+  for (int i = 0; i < numClients; i++) {
+    WsClientState& state = clients[i];
+    if (staleOnly && !(state.staleMask & bit)) continue;
+
+    AsyncWebSocketClient* client = ws->client(state.id);
+    if (client == NULL) continue;
+
+    if (client->queueIsFull()) {
+      state.staleMask |= bit;       // Gets the snapshot current when its queue drains
+      stats.skipped++;
+      continue;
+    }
+
+    client->text(buffer);
+    if (state.staleMask & bit) stats.catchUps++;
+    state.staleMask &= ~bit;
+    stats.sent++;
+  }
+
+  buffer->unlock();
+  ws->_cleanBuffers();              // Frees the buffer now if nobody queued it
+
+  stats.flushes++;
+  recordCost(numClients, micros() - startUs, json.length());
+}
+
+// ==================== BROADCAST ====================
+
+void wsBroadcastInit(AsyncWebSocket* socket, WsBuildFn buildPolling, WsBuildFn buildDevices) {
+  ws = socket;
+  builders[WS_TOPIC_POLLING] = buildPolling;
+  builders[WS_TOPIC_DEVICES] = buildDevices;
+  clientLock = xSemaphoreCreateMutex();
+}
+
+void wsSetBuilder(WsTopic topic, WsBuildFn build) {
+  if (topic < WS_TOPIC_COUNT) builders[topic] = build;
+}
+
+void wsNotify(WsTopic topic) {
+  stats.notifies++;
+  if (dirtyMask.fetch_or(1 << topic) == 0) {
+    firstDirtyMs = millis();        // Window starts at the first change
+  }
+}
+
+void wsService(unsigned long now) {
+  if (ws == NULL) return;
+
+  uint8_t due = 0;
+  if (dirtyMask.load() != 0 && now - firstDirtyMs.load() >= WS_COALESCE_MS) {
+    due = dirtyMask.exchange(0);
+  }
+
+  xSemaphoreTake(clientLock, portMAX_DELAY);
+
+  for (int t = 0; t < WS_TOPIC_COUNT; t++) {
+    uint8_t bit = 1 << t;
+
+    if (builders[t] == NULL) continue;
+
+    if (due & bit) {
+      // No dashboard open - nothing to build
+      if (numClients > 0) flushTopic((WsTopic)t, false);
+      continue;
+    }
+
+    // Catch up clients that were skipped while their queue was full
+    for (int i = 0; i < numClients; i++) {
+      if (!(clients[i].staleMask & bit)) continue;
+
+      AsyncWebSocketClient* client = ws->client(clients[i].id);
+      if (client != NULL && !client->queueIsFull()) {
+        flushTopic((WsTopic)t, true);
+        break;
+      }
+    }
+  }
+
+  xSemaphoreGive(clientLock);
+}
+
+void wsClientConnected(uint32_t clientId) {
+  xSemaphoreTake(clientLock, portMAX_DELAY);
+  if (numClients < WS_MAX_CLIENTS) {
+    clients[numClients].id = clientId;
+    clients[numClients].staleMask = 0;
+    numClients++;
+  }
+  xSemaphoreGive(clientLock);
+}
+
+void wsClientDisconnected(uint32_t clientId) {
+  xSemaphoreTake(clientLock, portMAX_DELAY);
+  for (int i = 0; i < numClients; i++) {
+    if (clients[i].id == clientId) {
+      clients[i] = clients[--numClients];
+      break;
+    }
+  }
+  xSemaphoreGive(clientLock);
+}
+
+WsStats wsGetStats() {
+  WsStats snapshot = stats;
+  snapshot.clients = numClients;
+  return snapshot;
+}
+
+const char* wsCostBucketName(int bucket) {
+  return (bucket >= 0 && bucket < WS_COST_BUCKETS) ? BUCKET_NAMES[bucket] : "?";
+}
@@ -0,0 +1,115 @@
+/**
+ * DETECTRA Gateway v2.0 - WebSocket Broadcaster
+ *
+ * Dashboard pushes are state snapshots (polling progress, device list),
+ * so only the latest one matters. Instead of serializing and sending on
+ * every phase transition:
+ *
+ * - wsNotify() only marks a topic dirty (any task, no allocation).
+ * - wsService() (loop) waits WS_COALESCE_MS after the first mark, builds
+ *   the JSON once and copies it into one AsyncWebSocketMessageBuffer that
+ *   all clients share (reference counted by the library) - one payload
+ *   allocation per update instead of one per client.
+ * - A client whose send queue is full is skipped and remembers the topic
+ *   as stale. Once its queue drains it gets the then-current snapshot, so
+ *   slow dashboards see fewer, merged updates instead of overflowing.
+ *
+ * Fan-out cost (build + send, microseconds) is recorded per client-count
+ * bucket: 1, up to 5 and up to 20 connected dashboards. More than 8
+ * dashboards need -DDEFAULT_MAX_WS_CLIENTS=20 for the web server library.
+ *
+ * Usage:
+ *   wsBroadcastInit(&ws, buildPollingStatusJSON, buildDeviceListJSON);
+ *   wsNotify(WS_TOPIC_POLLING);             // phase transition
+ *   wsService(millis());                    // every loop()
+ */
+
+#ifndef WS_BROADCAST_H
+#define WS_BROADCAST_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+// ==================== CONFIGURATION ====================
+
+#define WS_COALESCE_MS        200           // Updates within this window are sent once
+#define WS_MAX_CLIENTS        24            // Tracked dashboards (per-client stale state)
+#define WS_COST_BUCKETS       3             // <= 1, <= 5, <= 20 (and more) clients
+
+// ==================== DATA STRUCTURES ====================
+
+enum WsTopic : uint8_t {
+  WS_TOPIC_POLLING,         // buildPollingStatusJSON()
+  WS_TOPIC_DEVICES,         // buildDeviceListJSON()
+  WS_TOPIC_PAIRING,         // buildPairingJSON() - bulk pairing progress (wsSetBuilder)
+  WS_TOPIC_JOBS,            // buildJobsJSON() - ad-hoc job states (wsSetBuilder)
+  WS_TOPIC_COUNT
+};
+
+/**
+ * Snapshot builder for one topic
+ */
+typedef String (*WsBuildFn)();
+
+/**
+ * Fan-out cost for one client-count bucket
+ */
+struct WsFanoutCost {
+  uint32_t flushes;
+  uint32_t totalUs;                 // Build + buffer + send, summed
+  uint32_t maxUs;
+  uint32_t bytes;                   // Payload bytes built (each shared by all clients)
+};
+
+/**
+ * Broadcaster counters (for status reports)
+ */
+struct WsStats {
+  uint32_t notifies;                // wsNotify() calls
+  uint32_t flushes;                 // Snapshots built and sent
+  uint32_t sent;                    // Client sends (one shared buffer each)
+  uint32_t skipped;                 // Sends skipped - client queue full
+  uint32_t catchUps;                // Stale clients sent the current snapshot later
+  uint8_t clients;                  // Connected dashboards now
+  WsFanoutCost cost[WS_COST_BUCKETS];
+};
+
+// ==================== BROADCAST FUNCTIONS ====================
+
+/**
+ * Set up the broadcaster (call once, before the web server starts)
+ */
+void wsBroadcastInit(AsyncWebSocket* socket, WsBuildFn buildPolling, WsBuildFn buildDevices);
+
+/**
+ * Builder for a further topic (a topic without one is never sent)
+ */
+void wsSetBuilder(WsTopic topic, WsBuildFn build);
+
+/**
+ * Mark a topic as changed (safe from any task)
+ */
+void wsNotify(WsTopic topic);
+
+/**
+ * Send due snapshots and catch up stale clients (call from loop)
+ */
+void wsService(unsigned long now);
+
+/**
+ * Track dashboards (call from the WS_EVT_CONNECT / WS_EVT_DISCONNECT events)
+ */
+void wsClientConnected(uint32_t clientId);
+void wsClientDisconnected(uint32_t clientId);
+
+/**
+ * Current counters
+ */
+WsStats wsGetStats();
+
+/**
+ * Client-count bucket label ("1", "5", "20")
+ */
+const char* wsCostBucketName(int bucket);
+
+#endif // WS_BROADCAST_H
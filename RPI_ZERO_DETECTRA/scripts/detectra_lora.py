@@ -0,0 +1,422 @@
+"""
+DETECTRA LoRa protocol - edge device side (GENERATED - do not edit)
+
+Generated by DETECTRA_GATEWAY/.../tools/protocol_gen/protocol_gen.py from
+lora_protocol.schema.json, together with the gateway's lora_schema.h.
+Change the schema and run the generator; both sides then agree.
+
+    frame = parse_frame(line)
+    if frame.command == Command.POLL and frame.target == BROADCAST_ID:
+        census = CensusPayload.decode(frame.payload)
+    reply = HealthPayload(battery=95, rssi=-45, snr=8, cycle_id=census.cycle_id)
+    send(build_frame(my_id, Command.ACK, AckStatus.ONLINE, tx_seq.next(), int(time.time()), reply.encode()))
+
+Sequences: one SequenceCounter (persisted) for frames to the gateway, and
+a ReplayWindow each for the gateway's unicast and ALL frames:
+
+    tx_seq = SequenceCounter("/var/lib/detectra/seq_tx")
+    rx_unicast, rx_broadcast = ReplayWindow(), ReplayWindow()
+    window = rx_broadcast if frame.target == BROADCAST_ID else rx_unicast
+    if window.check(frame.sequence) in ("duplicate", "stale"):
+        ...  # already handled / replayed - answer a duplicate again, drop a stale frame
+
+Windows are re-seeded only on an explicit event - PAIR from the gateway while
+unpaired (rx_unicast.reset(frame.sequence)), or an operator reset; a stale
+frame never moves a window back.
+"""
+
+import os
+from dataclasses import dataclass, fields
+from enum import Enum
+from typing import ClassVar, Optional
+
+SCHEMA_VERSION = 1
+BROADCAST_ID = "ALL"
+NULL_PAYLOAD = "null"
+SEQ_FIRST = 1000  # Below: old 3-digit counter, not checked
+SEQ_WINDOW = 64  # Replay window (bits)
+SEQ_RESERVE = 256  # Sequences per persisted reservation
+
+
+class Command(str, Enum):
+    POLL = "POLL"  # Gateway → device: health check (to ALL: broadcast census)
+    START_INFER = "START_INFER"  # Gateway → device: begin inference
+    ACK = "ACK"  # Both ways: acknowledge (device: status in TARGET)
+    FINALIZE = "FINALIZE"  # Gateway → device: complete cycle
+    SLEEP = "SLEEP"  # Gateway → device: enter listening mode
+    TIME = "TIME"  # Gateway → device: time-sync beacon to ALL (see time_sync.h)
+    PAIR = "PAIR"  # Gateway → device: pair, with the tables to watch
+    DATA = "DATA"  # Device → gateway: inference data
+    PAIR_ACK = "PAIR_ACK"  # Device → gateway: pairing accepted
+    BLK_OFFER = "BLK_OFFER"  # Gateway → device: bulk - announce a blob
+    BLK_DATA = "BLK_DATA"  # Gateway → device: bulk - one chunk
+    BLK_QUERY = "BLK_QUERY"  # Gateway → device: bulk - report received chunks
+    BLK_ABORT = "BLK_ABORT"  # Gateway → device: bulk - drop the transfer
+    BLK_STATUS = "BLK_STATUS"  # Device → gateway: bulk - chunk bitmap / DONE / HASH_FAIL / UNKNOWN
+
+
+class AckStatus(str, Enum):
+    ONLINE = "ONLINE"  # Device responding
+    INFERRING = "INFERRING"  # Device processing
+    FINALIZED = "FINALIZED"  # Cycle completed
+    SLEEPING = "SLEEPING"  # Entering RX mode
+
+
+# ==================== PAYLOAD RULES ====================
+
+def _encode(payload) -> str:
+    parts = []
+    all_default = True
+    for f in fields(payload):
+        tag, kind, default, required, width, _ = payload.SPEC[f.name]
+        value = getattr(payload, f.name)
+        defaultable = (tag is not None and not required) or (tag is None and kind == "str")
+        at_default = defaultable and value == default
+        all_default = all_default and at_default
+        if tag is not None and at_default:
+            continue
+        if kind == "bool":
+            text = "1" if value else "0"
+        elif kind == "str":
+            text = str(value)
+        else:
+            text = str(int(value)).zfill(width) if width else str(int(value))
+        parts.append(text if tag is None else "%s_%s" % (tag, text))
+    if all_default:
+        return NULL_PAYLOAD
+    return payload.SEPARATOR.join(parts)
+
+
+def _decode(cls, text: str):
+    payload = cls()
+    positional = [f.name for f in fields(cls) if cls.SPEC[f.name][0] is None]
+    required = {f.name for f in fields(cls) if cls.SPEC[f.name][3]}
+    if text in ("", NULL_PAYLOAD):
+        if required or positional:
+            raise ValueError("%s: required fields missing" % cls.__name__)
+        return payload
+
+    tags = {spec[0] + "_": name for name, spec in cls.SPEC.items() if spec[0] is not None}
+    seen = set()
+    position = 0
+    for part in text.split(cls.SEPARATOR):
+        name = next((n for t, n in tags.items() if part.startswith(t)), None)
+        if name is not None:
+            raw = part[len(cls.SPEC[name][0]) + 1:]
+        elif position < len(positional):
+            name, raw = positional[position], part
+            position += 1
+        else:
+            continue
+        kind = cls.SPEC[name][1]
+        if kind == "str":
+            if len(raw) > cls.SPEC[name][5]:
+                raise ValueError("%s.%s: longer than %d" % (cls.__name__, name, cls.SPEC[name][5]))
+            setattr(payload, name, raw)
+        else:
+            try:
+                number = int(raw, 10)
+            except ValueError:
+                continue  # Malformed number: field stays at its default
+            setattr(payload, name, bool(number) if kind == "bool" else number)
+        seen.add(name)
+
+    if not required <= seen or position < len(positional):
+        raise ValueError("%s: required fields missing in %r" % (cls.__name__, text))
+    return payload
+
+
+# ==================== PAYLOADS ====================
+
+
+@dataclass
+class HealthPayload:
+    """ACK ONLINE: bat_95:rssi_-45:snr_8[:cyc_12][:clk_1728567890123]"""
+
+    SEPARATOR: ClassVar[str] = ":"
+    # name: (tag, type, default, required, width, max length)
+    SPEC: ClassVar[dict] = {
+        'battery': ('bat', 'int8', -1, False, 0, 0),
+        'rssi': ('rssi', 'int16', -999, False, 0, 0),
+        'snr': ('snr', 'int16', -999, False, 0, 0),
+        'cycle_id': ('cyc', 'int32', -1, False, 0, 0),
+        'clock_ms': ('clk', 'uint64', 0, False, 0, 0),
+    }
+
+    battery: int = -1  # Battery percentage (-1 unknown)
+    rssi: int = -999  # Signal strength (-999 unknown)
+    snr: int = -999  # Signal-to-noise ratio (-999 unknown)
+    cycle_id: int = -1  # Census cycle echoed back (-1 if unicast reply)
+    clock_ms: int = 0  # Device clock when it started sending (0 = not sent)
+
+    def encode(self) -> str:
+        return _encode(self)
+
+    @classmethod
+    def decode(cls, text: str) -> "HealthPayload":
+        return _decode(cls, text)
+
+
+@dataclass
+class CensusPayload:
+    """POLL to ALL: cyc_12:slot_600:ED0-00001,ED0-00002[:at_1728567891742]"""
+
+    SEPARATOR: ClassVar[str] = ":"
+    # name: (tag, type, default, required, width, max length)
+    SPEC: ClassVar[dict] = {
+        'cycle_id': ('cyc', 'uint32', 0, True, 0, 0),
+        'slot_ms': ('slot', 'uint16', 0, True, 0, 0),
+        'roster': (None, 'str', '', False, 0, 230),
+        'at_ms': ('at', 'uint64', 0, False, 0, 0),
+    }
+
+    cycle_id: int = 0  # Echoed back as cyc_ in the ONLINE reply
+    slot_ms: int = 0  # Slot length
+    roster: str = ''  # Comma-separated device IDs - position = slot
+    at_ms: int = 0  # Gateway time of slot 0 (0 = slots from RX end + guard)
+
+    def encode(self) -> str:
+        return _encode(self)
+
+    @classmethod
+    def decode(cls, text: str) -> "CensusPayload":
+        return _decode(cls, text)
+
+
+@dataclass
+class StartInferPayload:
+    """START_INFER: [pos_3]"""
+
+    SEPARATOR: ClassVar[str] = ":"
+    # name: (tag, type, default, required, width, max length)
+    SPEC: ClassVar[dict] = {
+        'positions': ('pos', 'uint8', 5, False, 0, 0),
+    }
+
+    positions: int = 5  # Positions to report (5 = full scan)
+
+    def encode(self) -> str:
+        return _encode(self)
+
+    @classmethod
+    def decode(cls, text: str) -> "StartInferPayload":
+        return _decode(cls, text)
+
+
+@dataclass
+class DataAckPayload:
+    """ACK to a DATA frame: 3/5 (positions received / requested)"""
+
+    SEPARATOR: ClassVar[str] = "/"
+    # name: (tag, type, default, required, width, max length)
+    SPEC: ClassVar[dict] = {
+        'received': (None, 'uint8', 0, False, 0, 0),
+        'requested': (None, 'uint8', 0, False, 0, 0),
+    }
+
+    received: int = 0  # Positions received so far
+    requested: int = 0  # Positions requested this poll
+
+    def encode(self) -> str:
+        return _encode(self)
+
+    @classmethod
+    def decode(cls, text: str) -> "DataAckPayload":
+        return _decode(cls, text)
+
+
+@dataclass
+class SleepPayload:
+    """SLEEP: [wake_840]"""
+
+    SEPARATOR: ClassVar[str] = ":"
+    # name: (tag, type, default, required, width, max length)
+    SPEC: ClassVar[dict] = {
+        'wake_s': ('wake', 'uint32', 0, False, 0, 0),
+    }
+
+    wake_s: int = 0  # Radio may be off this long (0 = stay in RX)
+
+    def encode(self) -> str:
+        return _encode(self)
+
+    @classmethod
+    def decode(cls, text: str) -> "SleepPayload":
+        return _decode(cls, text)
+
+
+@dataclass
+class TimeBeaconPayload:
+    """TIME: t_1728567890123:q_1"""
+
+    SEPARATOR: ClassVar[str] = ":"
+    # name: (tag, type, default, required, width, max length)
+    SPEC: ClassVar[dict] = {
+        'time_ms': ('t', 'uint64', 0, True, 13, 0),
+        'utc': ('q', 'bool', False, True, 0, 0),
+    }
+
+    time_ms: int = 0  # Gateway time at the end of the transmission
+    utc: bool = False  # 1 = UTC, 0 = gateway uptime
+
+    def encode(self) -> str:
+        return _encode(self)
+
+    @classmethod
+    def decode(cls, text: str) -> "TimeBeaconPayload":
+        return _decode(cls, text)
+
+
+@dataclass
+class PairPayload:
+    """PAIR: BLR-13-IL-02|BLR-13-IL-01 (left|right, either may be empty)"""
+
+    SEPARATOR: ClassVar[str] = "|"
+    # name: (tag, type, default, required, width, max length)
+    SPEC: ClassVar[dict] = {
+        'table_left': (None, 'str', '', False, 0, 15),
+        'table_right': (None, 'str', '', False, 0, 15),
+    }
+
+    table_left: str = ''  # Table on the left
+    table_right: str = ''  # Table on the right
+
+    def encode(self) -> str:
+        return _encode(self)
+
+    @classmethod
+    def decode(cls, text: str) -> "PairPayload":
+        return _decode(cls, text)
+
+
+COMMAND_PAYLOADS = {
+    Command.POLL: CensusPayload,
+    Command.START_INFER: StartInferPayload,
+    Command.ACK: DataAckPayload,
+    Command.SLEEP: SleepPayload,
+    Command.TIME: TimeBeaconPayload,
+    Command.PAIR: PairPayload,
+}
+
+STATUS_PAYLOADS = {
+    AckStatus.ONLINE: HealthPayload,
+}
+
+
+# ==================== FRAMES ====================
+
+@dataclass
+class Frame:
+    sender: str
+    command: Optional[Command]  # None = not in the schema
+    command_text: str
+    target: str
+    sequence: int
+    timestamp: int
+    payload: str
+
+    @property
+    def status(self) -> Optional[AckStatus]:
+        """ACK status of a device ACK (carried in the target field)"""
+        if self.command != Command.ACK:
+            return None
+        try:
+            return AckStatus(self.target)
+        except ValueError:
+            return None
+
+
+def parse_frame(text: str) -> Frame:
+    """SENDER:COMMAND:TARGET:SEQ:TIMESTAMP:PAYLOAD (payload keeps its colons)"""
+    parts = text.strip().split(":", 5)
+    if len(parts) < 6:
+        raise ValueError("expected 6 fields, got %d" % len(parts))
+    sender, command, target, sequence, timestamp, payload = parts
+    try:
+        known: Optional[Command] = Command(command)
+    except ValueError:
+        known = None
+    return Frame(sender, known, command, target, int(sequence), int(timestamp), payload)
+
+
+def build_frame(sender: str, command, target, sequence: int, timestamp: int, payload: str = NULL_PAYLOAD) -> str:
+    command = command.value if isinstance(command, Enum) else command
+    target = target.value if isinstance(target, Enum) else target
+    return "%s:%s:%s:%d:%d:%s" % (sender, command, target, sequence & 0xFFFFFFFF, timestamp, payload or NULL_PAYLOAD)
+
+
+# ==================== SEQUENCES ====================
+
+class SequenceCounter:
+    """
+    Outgoing sequence space, persisted across restarts. Only reservations
+    of SEQ_RESERVE are written to path (moved on at half-way), so a restart
+    continues past the last one and never reuses a sequence.
+    """
+
+    def __init__(self, path: str):
+        self.path = path
+        try:
+            with open(path) as f:
+                self._next = max(int(f.read().strip() or 0), SEQ_FIRST)
+        except (OSError, ValueError):
+            self._next = SEQ_FIRST
+        self._reserved = self._next
+
+    def next(self) -> int:
+        if self._next + SEQ_RESERVE // 2 >= self._reserved:
+            self._reserved = self._next + SEQ_RESERVE
+            tmp = self.path + ".tmp"
+            with open(tmp, "w") as f:
+                f.write(str(self._reserved))
+            os.replace(tmp, self.path)
+        value = self._next
+        self._next += 1
+        return value
+
+
+class ReplayWindow:
+    """
+    Incoming sequences from one peer: the highest seen and a SEQ_WINDOW-bit
+    map behind it. check() records the sequence and returns "accept",
+    "duplicate" (seen - a retransmission), "stale" (older than the map -
+    a replay, or below SEQ_FIRST once past it) or "legacy" (below SEQ_FIRST
+    from a peer never past it - old firmware, not checked).
+    """
+
+    def __init__(self, highest: int = 0):
+        self.highest = highest
+        self.bits = (1 << SEQ_WINDOW) - 1 if highest else 0
+
+    def reset(self, sequence: int = 0):
+        """Re-seed at sequence (PAIR, operator reset); 0 forgets the peer"""
+        self.highest = sequence if sequence >= SEQ_FIRST else 0
+        self.bits = 1 if self.highest else 0
+
+    def check(self, sequence: int) -> str:
+        if sequence < SEQ_FIRST:
+            # Old 3-digit counter - only until the sender has used its 32-bit space
+            return "stale" if self.highest >= SEQ_FIRST else "legacy"
+        if sequence > self.highest:
+            shift = sequence - self.highest
+            self.bits = ((self.bits << shift) | 1) & ((1 << SEQ_WINDOW) - 1) if shift < SEQ_WINDOW else 1
+            self.highest = sequence
+            return "accept"
+        age = self.highest - sequence
+        if age < SEQ_WINDOW:
+            if (self.bits >> age) & 1:
+                return "duplicate"
+            self.bits |= 1 << age
+            return "accept"
+        return "stale"
+
+
+def decode_payload(frame: Frame):
+    """Typed payload of a frame, or None (no payload / custom format)"""
+    if frame.command == Command.ACK and frame.status is not None:
+        cls = STATUS_PAYLOADS.get(frame.status)
+    elif frame.command == Command.POLL and frame.target != BROADCAST_ID:
+        return None  # Unicast health check
+    else:
+        cls = COMMAND_PAYLOADS.get(frame.command)
+    return cls.decode(frame.payload) if cls else None